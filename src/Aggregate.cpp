@@ -71,7 +71,7 @@ public:
     PSI_STD::vector<SourceLocation> movable_locations, copyable_locations;
     
     // Handle members
-    PSI_STD::vector<SharedPtr<Parser::Statement> > members_parsed = Parser::parse_statement_list(generic->compile_context().error_context(), generic->location().logical, m_body);
+    PSI_STD::vector<SharedPtr<Parser::Statement> > members_parsed = generic->compile_context().parse_cache().statement_list(generic->location().logical, m_body);
     for (PSI_STD::vector<SharedPtr<Parser::Statement> >::const_iterator ii = members_parsed.begin(), ie = members_parsed.end(); ii != ie; ++ii) {
       if (*ii && (*ii)->expression) {
         const Parser::Statement& stmt = **ii;
@@ -460,7 +460,7 @@ public:
   }
 };
 
-const SIVtable DefaultMemberMacroCommon::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.DefaultMemberMacroCommon", Macro);
+const SIVtable DefaultMemberMacroCommon::vtable = PSI_COMPILER_TREE_ABSTRACT(DefaultMemberMacroCommon, "psi.compiler.DefaultMemberMacroCommon", Macro);
 
 class DefaultMemberMacro : public DefaultMemberMacroCommon {
 public:
@@ -605,7 +605,7 @@ public:
     
     AggregateMemberResult result;
     
-    PSI_STD::vector<Parser::TokenExpression> args = Parser::parse_identifier_list(self.compile_context().error_context(), location.logical, args_expr->text);
+    PSI_STD::vector<Parser::TokenExpression> args = self.compile_context().parse_cache().identifier_list(location.logical, args_expr->text);
     switch (self.m_which) {
     case which_init:
       if (args.size() != 1)
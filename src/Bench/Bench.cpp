@@ -0,0 +1,231 @@
+#include "Bench.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+namespace Psi {
+  namespace Bench {
+    double SampleSet::min() const {
+      PSI_ASSERT(!empty());
+      return *std::min_element(m_samples.begin(), m_samples.end());
+    }
+
+    double SampleSet::max() const {
+      PSI_ASSERT(!empty());
+      return *std::max_element(m_samples.begin(), m_samples.end());
+    }
+
+    double SampleSet::mean() const {
+      PSI_ASSERT(!empty());
+      return std::accumulate(m_samples.begin(), m_samples.end(), 0.0) / m_samples.size();
+    }
+
+    /**
+     * \brief Sample standard deviation.
+     *
+     * Zero if there are fewer than two samples.
+     */
+    double SampleSet::stddev() const {
+      if (m_samples.size() < 2)
+        return 0;
+
+      double m = mean(), sum_sq = 0;
+      for (std::vector<double>::const_iterator ii = m_samples.begin(), ie = m_samples.end(); ii != ie; ++ii)
+        sum_sq += (*ii - m) * (*ii - m);
+      return std::sqrt(sum_sq / (m_samples.size() - 1));
+    }
+
+    /**
+     * \brief Half-width of the 95% confidence interval of the mean.
+     *
+     * Uses Student's t-distribution, so this is meaningful for small
+     * sample counts.
+     */
+    double SampleSet::confidence_95() const {
+      static const double t_table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+      };
+      const std::size_t t_table_size = sizeof(t_table) / sizeof(t_table[0]);
+
+      if (m_samples.size() < 2)
+        return 0;
+
+      std::size_t df = m_samples.size() - 1;
+      double t = (df <= t_table_size) ? t_table[df - 1] : 1.960;
+      return t * stddev() / std::sqrt(double(m_samples.size()));
+    }
+
+    /**
+     * \brief Summarize this sample set as a JSON object.
+     *
+     * \param scale Multiplier applied to each statistic, used to change units.
+     */
+    PropertyValue SampleSet::summary(double scale) const {
+      PropertyValue pv;
+      pv["count"] = int(m_samples.size());
+      if (!empty()) {
+        pv["min"] = min() * scale;
+        pv["max"] = max() * scale;
+        pv["mean"] = mean() * scale;
+        pv["stddev"] = stddev() * scale;
+        pv["ci95"] = confidence_95() * scale;
+      }
+      return pv;
+    }
+
+    /**
+     * \brief Estimate how a cost grows with problem size.
+     *
+     * Fits \f$ y = a x^k \f$ by least squares on log-log axes and returns \c k,
+     * so 1 indicates linear scaling and anything much larger is superlinear.
+     * Points with non-positive coordinates are ignored; if fewer than two
+     * distinct sizes remain, returns zero.
+     */
+    double scaling_exponent(const std::vector<std::pair<double, double> >& points) {
+      double sx = 0, sy = 0, sxx = 0, sxy = 0;
+      unsigned n = 0;
+      for (std::vector<std::pair<double, double> >::const_iterator ii = points.begin(), ie = points.end(); ii != ie; ++ii) {
+        if ((ii->first <= 0) || (ii->second <= 0))
+          continue;
+        double x = std::log(ii->first), y = std::log(ii->second);
+        sx += x; sy += y; sxx += x*x; sxy += x*y;
+        ++n;
+      }
+
+      double denominator = n*sxx - sx*sx;
+      if ((n < 2) || (denominator <= 0))
+        return 0;
+      return (n*sxy - sx*sy) / denominator;
+    }
+
+    /**
+     * \brief Split a comma separated list.
+     */
+    std::vector<std::string> split_list(const std::string& s) {
+      std::vector<std::string> result;
+      std::string::size_type pos = 0;
+      while (true) {
+        std::string::size_type next = s.find(',', pos);
+        std::string part = s.substr(pos, next == std::string::npos ? std::string::npos : next - pos);
+        if (!part.empty())
+          result.push_back(part);
+        if (next == std::string::npos)
+          return result;
+        pos = next + 1;
+      }
+    }
+
+    /**
+     * \brief Split a comma separated list of positive integers.
+     */
+    std::vector<unsigned> split_unsigned_list(const std::string& s) {
+      std::vector<std::string> parts = split_list(s);
+      std::vector<unsigned> result;
+      for (std::vector<std::string>::const_iterator ii = parts.begin(), ie = parts.end(); ii != ie; ++ii) {
+        // strtoul accepts a leading minus sign, so check for digits first
+        char *end;
+        unsigned long value = std::strtoul(ii->c_str(), &end, 10);
+        if (ii->empty() || !std::isdigit((unsigned char)(*ii)[0]) || *end || !value || (value > UINT_MAX))
+          throw std::runtime_error("Not a positive integer: " + *ii);
+        result.push_back(value);
+      }
+      return result;
+    }
+
+    namespace {
+      void write_json_string(std::ostream& os, const String& s) {
+        os << '"';
+        for (const char *ii = s.c_str(), *ie = ii + s.length(); ii != ie; ++ii) {
+          switch (*ii) {
+          case '"': os << "\\\""; break;
+          case '\\': os << "\\\\"; break;
+          case '\n': os << "\\n"; break;
+          case '\t': os << "\\t"; break;
+          default:
+            if (static_cast<unsigned char>(*ii) < 0x20) {
+              char buf[8];
+              std::sprintf(buf, "\\u%04x", *ii);
+              os << buf;
+            } else {
+              os << *ii;
+            }
+          }
+        }
+        os << '"';
+      }
+
+      void write_indent(std::ostream& os, unsigned indent) {
+        os << '\n';
+        std::fill_n(std::ostreambuf_iterator<char>(os), indent, ' ');
+      }
+    }
+
+    /**
+     * \brief Write a PropertyValue as JSON.
+     */
+    void write_json(std::ostream& os, const PropertyValue& value, unsigned indent) {
+      switch (value.type()) {
+      case PropertyValue::t_null: os << "null"; break;
+      case PropertyValue::t_boolean: os << (value.boolean() ? "true" : "false"); break;
+      case PropertyValue::t_integer: os << value.integer(); break;
+      case PropertyValue::t_str: write_json_string(os, value.str()); break;
+
+      case PropertyValue::t_real: {
+        double x = value.real();
+        if ((x != x) || (x - x != 0)) {
+          // NaN and infinity have no JSON representation
+          os << "null";
+        } else {
+          char buf[32];
+          std::sprintf(buf, "%.9g", x);
+          os << buf;
+        }
+        break;
+      }
+
+      case PropertyValue::t_map: {
+        const PropertyMap& map = value.map();
+        os << '{';
+        for (PropertyMap::const_iterator ii = map.begin(), ie = map.end(); ii != ie; ++ii) {
+          if (ii != map.begin())
+            os << ',';
+          write_indent(os, indent + 2);
+          write_json_string(os, ii->first);
+          os << ": ";
+          write_json(os, ii->second, indent + 2);
+        }
+        if (!map.empty())
+          write_indent(os, indent);
+        os << '}';
+        break;
+      }
+
+      case PropertyValue::t_list: {
+        const PropertyList& list = value.list();
+        os << '[';
+        for (PropertyList::const_iterator ii = list.begin(), ie = list.end(); ii != ie; ++ii) {
+          if (ii != list.begin())
+            os << ',';
+          write_indent(os, indent + 2);
+          write_json(os, *ii, indent + 2);
+        }
+        if (!list.empty())
+          write_indent(os, indent);
+        os << ']';
+        break;
+      }
+
+      default: PSI_FAIL("Unknown property value type");
+      }
+    }
+  }
+}
@@ -0,0 +1,49 @@
+#ifndef HPP_PSI_BENCH
+#define HPP_PSI_BENCH
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "../PropertyValue.hpp"
+
+/**
+ * \file
+ *
+ * Common support code for benchmark programs: sample statistics and
+ * JSON output of results.
+ */
+
+namespace Psi {
+  namespace Bench {
+    /**
+     * \brief A set of timing samples, in seconds.
+     */
+    class SampleSet {
+      std::vector<double> m_samples;
+
+    public:
+      void add(double sample) {m_samples.push_back(sample);}
+      bool empty() const {return m_samples.empty();}
+      std::size_t size() const {return m_samples.size();}
+      const std::vector<double>& samples() const {return m_samples;}
+
+      double min() const;
+      double max() const;
+      double mean() const;
+      double stddev() const;
+      double confidence_95() const;
+
+      PropertyValue summary(double scale=1) const;
+    };
+
+    double scaling_exponent(const std::vector<std::pair<double, double> >& points);
+
+    std::vector<std::string> split_list(const std::string& s);
+    std::vector<unsigned> split_unsigned_list(const std::string& s);
+
+    void write_json(std::ostream& os, const PropertyValue& value, unsigned indent=0);
+  }
+}
+
+#endif
@@ -0,0 +1,473 @@
+/*
+ * psi-bench: compile time scaling benchmarks.
+ *
+ * Synthesizes Psi programs of configurable size and times each phase of
+ * the compilation pipeline on each requested JIT backend.
+ */
+
+#include "Bench.hpp"
+
+#include "../Compiler.hpp"
+#include "../Configuration.hpp"
+#include "../OptionParser.hpp"
+#include "../Parser.hpp"
+#include "../TermBuilder.hpp"
+#include "../Tree.hpp"
+#include "../Platform/Platform.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <boost/format.hpp>
+
+namespace Psi {
+  namespace Bench {
+    namespace {
+      /**
+       * \brief Generates a Psi program whose complexity is controlled by a single size parameter.
+       *
+       * Every generated program defines a function \c main taking no arguments.
+       */
+      struct ProgramGenerator {
+        const char *name;
+        const char *description;
+        /// Write a program of size \c n, which is at least 1, to \c os
+        void (*generate) (std::ostream& os, unsigned n);
+      };
+
+      /// N functions, each calling the previous one
+      void generate_functions(std::ostream& os, unsigned n) {
+        PSI_ASSERT(n > 0);
+        os << "f0 : function () [];\n";
+        for (unsigned i = 1; i < n; ++i)
+          os << 'f' << i << " : function () [f" << i-1 << "();];\n";
+        os << "main : function () [f" << n-1 << "();];\n";
+      }
+
+      /// N aggregate types, each instantiated once
+      void generate_types(std::ostream& os, unsigned n) {
+        for (unsigned i = 0; i < n; ++i)
+          os << 't' << i << " : struct [x : int; y : long; z : pointer(ubyte);];\n";
+        os << "main : function () [\n";
+        for (unsigned i = 0; i < n; ++i)
+          os << "  v" << i << " : new t" << i << ";\n";
+        os << "];\n";
+      }
+
+      /// N implementations of a single interface, each invoked once
+      void generate_interfaces(std::ostream& os, unsigned n) {
+        os << "ti : interface (X:type) [\n"
+              "  invoke : function (:X -: pointer(ubyte));\n"
+              "] where [];\n";
+        for (unsigned i = 0; i < n; ++i)
+          os << 'i' << i << " : struct [x : int; ti [invoke : (a) [{i" << i << "}];];];\n";
+        os << "main : function () [\n";
+        for (unsigned i = 0; i < n; ++i)
+          os << "  v" << i << " : new i" << i << ";\n  ti.invoke(v" << i << ");\n";
+        os << "];\n";
+      }
+
+      /**
+       * N implementations listed on one interface, each invoked once.
+       * 
+       * Each invocation is in its own function, and the functions call each
+       * other as a binary tree so that call depth stays logarithmic in N.
+       */
+      void generate_overloads(std::ostream& os, unsigned n) {
+        for (unsigned i = 0; i < n; ++i)
+          os << 't' << i << " : struct [x : int;];\n";
+        os << "ti : interface (X:type) [\n"
+              "  invoke : function (:X -: pointer(ubyte));\n"
+              "] where [\n";
+        for (unsigned i = 0; i < n; ++i)
+          os << "  ti (t" << i << ") [invoke : (a) [{t" << i << "}];];\n";
+        os << "];\n";
+        for (unsigned i = 0; i < n; ++i) {
+          os << 'f' << i << " : function () [v : new t" << i << "; ti.invoke(v);";
+          for (unsigned j = 2*i+1; (j <= 2*i+2) && (j < n); ++j)
+            os << " f" << j << "();";
+          os << "];\n";
+        }
+        os << "main : function () [f0();];\n";
+      }
+
+      /// N nested blocks, each with a local variable requiring construction
+      void generate_nesting(std::ostream& os, unsigned n) {
+        os << "t : struct [x : int;];\n";
+        os << "main : function () [\n  ";
+        for (unsigned i = 0; i < n; ++i)
+          os << "(n" << i << " : new t; ";
+        os << "()";
+        for (unsigned i = 0; i < n; ++i)
+          os << ')';
+        os << ";\n];\n";
+      }
+
+      const ProgramGenerator generators[] = {
+        {"functions", "N functions forming a call chain", &generate_functions},
+        {"types", "N struct types, each constructed once", &generate_types},
+        {"interfaces", "N implementations of one interface, each invoked once", &generate_interfaces},
+        {"overloads", "N implementations listed on one interface, each invoked once", &generate_overloads},
+        {"nesting", "N nested blocks with local variables", &generate_nesting}
+      };
+      const std::size_t n_generators = sizeof(generators) / sizeof(generators[0]);
+
+      const ProgramGenerator* find_generator(const std::string& name) {
+        for (std::size_t ii = 0; ii != n_generators; ++ii) {
+          if (name == generators[ii].name)
+            return &generators[ii];
+        }
+        return NULL;
+      }
+
+      /// Pipeline phases, in the order they run
+      const char *const phase_names[] = {"context", "parse", "compile", "complete", "jit", "run"};
+      const std::size_t n_phases = sizeof(phase_names) / sizeof(phase_names[0]);
+
+      enum OptionKeys {
+        opt_key_help,
+        opt_key_config,
+        opt_key_set,
+        opt_key_generator,
+        opt_key_sizes,
+        opt_key_jit,
+        opt_key_repeat,
+        opt_key_output,
+        opt_key_emit,
+        opt_key_max_exponent
+      };
+
+      struct BenchOptions {
+        std::string program_name;
+        PropertyValue configuration;
+        std::vector<const ProgramGenerator*> generators;
+        std::vector<unsigned> sizes;
+        std::vector<std::string> jits;
+        unsigned repeat;
+        std::string output;
+        bool emit;
+        double max_exponent;
+      };
+
+      bool parse_options(int argc, const char **argv, BenchOptions& options) {
+        options.program_name = find_program_name(argv[0]);
+        options.sizes.push_back(10);
+        options.sizes.push_back(100);
+        options.sizes.push_back(1000);
+        options.repeat = 3;
+        options.emit = false;
+        options.max_exponent = 0;
+
+        OptionsDescription desc;
+        desc.allow_unknown = false;
+        desc.allow_positional = false;
+        desc.opts.push_back(option_description(opt_key_help, false, 'h', "help", "Print this help"));
+        desc.opts.push_back(option_description(opt_key_config, true, 'c', "config", "Read a configuration file"));
+        desc.opts.push_back(option_description(opt_key_set, true, 's', "set", "Set a configuration property"));
+        desc.opts.push_back(option_description(opt_key_generator, true, 'g', "generator", "Comma separated list of program generators (default: all)"));
+        desc.opts.push_back(option_description(opt_key_sizes, true, 'n', "sizes", "Comma separated list of program sizes (default: 10,100,1000)"));
+        desc.opts.push_back(option_description(opt_key_jit, true, 'j', "jit", "Comma separated list of TVM configurations to benchmark (default: all configured)"));
+        desc.opts.push_back(option_description(opt_key_repeat, true, 'r', "repeat", "Number of times to repeat each measurement (default: 3)"));
+        desc.opts.push_back(option_description(opt_key_output, true, 'o', "output", "Write JSON results to a file rather than standard output"));
+        desc.opts.push_back(option_description(opt_key_emit, false, '\0', "emit", "Print the generated programs rather than compiling them"));
+        desc.opts.push_back(option_description(opt_key_max_exponent, true, '\0', "max-exponent", "Fail if any phase scales worse than N^x"));
+
+        std::vector<std::string> config_files, extra_config;
+
+        OptionParser parser(desc, argc, argv);
+        try {
+          while (!parser.empty()) {
+            OptionValue val = parser.next();
+            switch (val.key) {
+            case opt_key_help:
+              options_help(std::cerr, options.program_name, "", desc);
+              std::cerr << "\nGenerators:\n";
+              for (std::size_t ii = 0; ii != n_generators; ++ii)
+                std::cerr << boost::format("  %-12s %s\n") % generators[ii].name % generators[ii].description;
+              return false;
+
+            case opt_key_config: config_files.push_back(val.value); break;
+            case opt_key_set: extra_config.push_back(val.value); break;
+            case opt_key_output: options.output = val.value; break;
+            case opt_key_emit: options.emit = true; break;
+            case opt_key_sizes: options.sizes = split_unsigned_list(val.value); break;
+            case opt_key_jit: options.jits = split_list(val.value); break;
+
+            case opt_key_generator: {
+              std::vector<std::string> names = split_list(val.value);
+              for (std::vector<std::string>::const_iterator ii = names.begin(), ie = names.end(); ii != ie; ++ii) {
+                const ProgramGenerator *gen = find_generator(*ii);
+                if (!gen)
+                  throw OptionParseError("Unknown generator: " + *ii);
+                options.generators.push_back(gen);
+              }
+              break;
+            }
+
+            case opt_key_repeat: {
+              std::vector<unsigned> repeat = split_unsigned_list(val.value);
+              if (repeat.size() != 1)
+                throw OptionParseError("--repeat expects a single value");
+              options.repeat = repeat.front();
+              break;
+            }
+
+            case opt_key_max_exponent:
+              options.max_exponent = std::atof(val.value.c_str());
+              break;
+
+            default: PSI_FAIL("Unexpected option key");
+            }
+          }
+        } catch (std::runtime_error& ex) {
+          std::cerr << ex.what() << '\n';
+          options_usage(std::cerr, options.program_name, "", "-h");
+          return false;
+        }
+
+        if (options.generators.empty()) {
+          for (std::size_t ii = 0; ii != n_generators; ++ii)
+            options.generators.push_back(&generators[ii]);
+        }
+
+        configuration_builtin(options.configuration);
+        configuration_read_files(options.configuration);
+        configuration_environment(options.configuration);
+        for (std::vector<std::string>::const_iterator ii = config_files.begin(), ie = config_files.end(); ii != ie; ++ii)
+          options.configuration.parse_file(*ii);
+        for (std::vector<std::string>::const_iterator ii = extra_config.begin(), ie = extra_config.end(); ii != ie; ++ii)
+          options.configuration.parse_configuration(ii->c_str());
+
+        // Default to every JIT which has a configuration
+        if (options.jits.empty()) {
+          const PropertyValue& tvm = options.configuration.get("tvm");
+          if (tvm.type() == PropertyValue::t_map) {
+            for (PropertyMap::const_iterator ii = tvm.map().begin(), ie = tvm.map().end(); ii != ie; ++ii) {
+              if ((ii->second.type() == PropertyValue::t_map) && ii->second.has_key("kind"))
+                options.jits.push_back(ii->first);
+            }
+          }
+        }
+
+        return true;
+      }
+
+      Parser::Text source_text(const String& url, const SharedPtrHandle& data_handle, const char *begin, const char *end) {
+        PhysicalSourceLocation loc;
+        loc.file.reset(new SourceFile);
+        loc.file->url = url;
+        loc.first_line = loc.first_column = 1;
+        loc.last_line = loc.last_column = 0;
+        return Parser::Text(loc, data_handle, begin, end);
+      }
+
+      /**
+       * \brief Compile and run a program once, recording the time spent in each phase.
+       *
+       * \param caches Receives the usage counts of the parse and overload lookup caches.
+       *
+       * \return Empty string on success, otherwise a description of the failure.
+       */
+      std::string run_once(const PropertyValue& configuration, const SharedPtr<std::vector<char> >& source, double *phase_times, PropertyValue& caches) {
+        using namespace Psi::Compiler;
+
+        std::ostringstream errors;
+        CompileErrorContext error_context(&errors);
+
+        double t0 = Platform::monotonic_time();
+        try {
+          CompileContext compile_context(&error_context, configuration);
+          TreePtr<Module> module = Module::new_(compile_context, "main", compile_context.root_location());
+          TreePtr<EvaluateContext> root_evaluate_context = evaluate_context_root(module);
+          TreePtr<EvaluateContext> module_evaluate_context = evaluate_context_module(module, root_evaluate_context, module->location());
+          LogicalSourceLocationPtr root_location = compile_context.root_location().logical;
+          double t1 = Platform::monotonic_time();
+
+          Parser::Text text = source_text("(bench)", source, vector_begin_ptr(*source), vector_end_ptr(*source));
+          PSI_STD::vector<SharedPtr<Parser::Statement> > statements = Parser::parse_namespace(error_context, root_location, text);
+          double t2 = Platform::monotonic_time();
+
+          TreePtr<Namespace> ns = compile_namespace(statements, module_evaluate_context, SourceLocation(text.location, root_location));
+          double t3 = Platform::monotonic_time();
+
+          ns->complete();
+          std::string init = "main()";
+          Parser::Text init_text = source_text("(init)", SharedPtrHandle(), init.c_str(), init.c_str() + init.length());
+          SourceLocation init_location(init_text.location, root_location);
+          SharedPtr<Parser::Expression> init_expr = Parser::parse_expression(error_context, root_location, init_text);
+          TreePtr<EvaluateContext> init_evaluate_context = evaluate_context_dictionary(module, init_location, ns->members);
+          TreePtr<Term> init_tree = compile_term(init_expr, init_evaluate_context, root_location);
+          init_tree->complete();
+          TreePtr<FunctionType> main_type = TermBuilder::function_type(result_mode_functional, compile_context.builtins().empty_type, default_, default_, init_location);
+          TreePtr<ModuleGlobal> main_function = TermBuilder::function(module, main_type, link_public, default_, default_, init_location, init_tree, "_Y_jit_entry");
+          double t4 = Platform::monotonic_time();
+
+          void (*main_ptr) ();
+          *reinterpret_cast<void**>(&main_ptr) = compile_context.jit_compile(main_function);
+          double t5 = Platform::monotonic_time();
+
+          main_ptr();
+          double t6 = Platform::monotonic_time();
+
+          phase_times[0] = t1 - t0;
+          phase_times[1] = t2 - t1;
+          phase_times[2] = t3 - t2;
+          phase_times[3] = t4 - t3;
+          phase_times[4] = t5 - t4;
+          phase_times[5] = t6 - t5;
+
+          const Parser::ParseCache::Statistics& parse_stats = compile_context.parse_cache().statistics();
+          PropertyValue& parse_cache = caches["parse"];
+          parse_cache["hits"] = int(parse_stats.hits);
+          parse_cache["misses"] = int(parse_stats.misses);
+          parse_cache["uncached"] = int(parse_stats.uncached);
+
+          const OverloadLookupCache::Statistics& overload_stats = compile_context.overload_cache().statistics();
+          PropertyValue& overload_cache = caches["overload"];
+          overload_cache["hits"] = int(overload_stats.hits);
+          overload_cache["misses"] = int(overload_stats.misses);
+          overload_cache["candidates"] = int(overload_stats.candidates);
+        } catch (CompileException&) {
+          std::string msg = errors.str();
+          return msg.empty() ? "compilation failed" : msg;
+        } catch (std::exception& ex) {
+          return ex.what();
+        }
+
+        return "";
+      }
+
+      /**
+       * \brief Run every size of one generator on one JIT.
+       *
+       * \return Whether every phase scaled no worse than \c max_exponent (if that is non-zero).
+       */
+      bool run_series(const BenchOptions& options, const ProgramGenerator& generator, const std::string& jit, PropertyList& results) {
+        PropertyValue configuration = options.configuration;
+        configuration["targets"]["host"]["tvm"] = jit;
+
+        std::vector<std::vector<std::pair<double, double> > > scaling(n_phases + 1);
+        for (std::vector<unsigned>::const_iterator ii = options.sizes.begin(), ie = options.sizes.end(); ii != ie; ++ii) {
+          std::ostringstream ss;
+          generator.generate(ss, *ii);
+          std::string src_str = ss.str();
+          SharedPtr<std::vector<char> > source(new std::vector<char>(src_str.begin(), src_str.end()));
+
+          PropertyValue result;
+          result["generator"] = generator.name;
+          result["jit"] = jit;
+          result["size"] = int(*ii);
+          result["source_bytes"] = int(source->size());
+
+          std::vector<SampleSet> samples(n_phases + 1);
+          for (unsigned repeat = 0; repeat != options.repeat; ++repeat) {
+            double phase_times[n_phases];
+            std::string error = run_once(configuration, source, phase_times, result["caches"]);
+            if (!error.empty()) {
+              result["error"] = error;
+              break;
+            }
+
+            double total = 0;
+            for (std::size_t phase = 0; phase != n_phases; ++phase) {
+              samples[phase].add(phase_times[phase]);
+              total += phase_times[phase];
+            }
+            samples[n_phases].add(total);
+          }
+
+          PropertyValue& phases = result["phases"];
+          for (std::size_t phase = 0; phase != n_phases; ++phase) {
+            phases[phase_names[phase]] = samples[phase].summary();
+            if (!samples[phase].empty())
+              scaling[phase].push_back(std::make_pair(double(*ii), samples[phase].min()));
+          }
+          result["total"] = samples[n_phases].summary();
+          if (!samples[n_phases].empty())
+            scaling[n_phases].push_back(std::make_pair(double(*ii), samples[n_phases].min()));
+
+          std::cerr << boost::format("%s/%s/%u: ") % generator.name % jit % *ii;
+          if (samples[n_phases].empty())
+            std::cerr << "failed\n";
+          else
+            std::cerr << boost::format("%.6fs\n") % samples[n_phases].min();
+
+          results.push_back(result);
+        }
+
+        // Summarize scaling of each phase over the whole series
+        PropertyValue series;
+        series["generator"] = generator.name;
+        series["jit"] = jit;
+        bool ok = true;
+        PropertyValue& exponents = series["scaling_exponent"];
+        for (std::size_t phase = 0; phase != n_phases + 1; ++phase) {
+          const char *name = (phase == n_phases) ? "total" : phase_names[phase];
+          double k = scaling_exponent(scaling[phase]);
+          exponents[name] = k;
+          // Context setup is independent of program size and running the generated code is
+          // too quick to fit reliably, so only the compiler phases are checked
+          bool checked = (phase != 0) && (phase != n_phases - 1);
+          if ((options.max_exponent > 0) && checked && (k > options.max_exponent)) {
+            std::cerr << boost::format("%s/%s: phase '%s' scales as N^%.2f, limit is N^%.2f\n") % generator.name % jit % name % k % options.max_exponent;
+            ok = false;
+          }
+        }
+        results.push_back(series);
+
+        return ok;
+      }
+    }
+  }
+}
+
+int main(int argc, const char **argv) {
+  using namespace Psi;
+  using namespace Psi::Bench;
+
+  BenchOptions options;
+  if (!parse_options(argc, argv, options))
+    return EXIT_FAILURE;
+
+  if (options.emit) {
+    for (std::vector<const ProgramGenerator*>::const_iterator ii = options.generators.begin(), ie = options.generators.end(); ii != ie; ++ii) {
+      for (std::vector<unsigned>::const_iterator ji = options.sizes.begin(), je = options.sizes.end(); ji != je; ++ji) {
+        std::cout << "// " << (*ii)->name << ' ' << *ji << '\n';
+        (*ii)->generate(std::cout, *ji);
+      }
+    }
+    return EXIT_SUCCESS;
+  }
+
+  PropertyValue results;
+  results["program"] = "psi-bench";
+  PropertyValue& sizes = results["sizes"] = PropertyList();
+  for (std::vector<unsigned>::const_iterator ii = options.sizes.begin(), ie = options.sizes.end(); ii != ie; ++ii)
+    sizes.list().push_back(int(*ii));
+  PropertyValue& runs = results["results"] = PropertyList();
+
+  bool ok = true;
+  for (std::vector<const ProgramGenerator*>::const_iterator ii = options.generators.begin(), ie = options.generators.end(); ii != ie; ++ii) {
+    for (std::vector<std::string>::const_iterator ji = options.jits.begin(), je = options.jits.end(); ji != je; ++ji) {
+      if (!run_series(options, **ii, *ji, runs.list()))
+        ok = false;
+    }
+  }
+
+  if (options.output.empty()) {
+    write_json(std::cout, results);
+    std::cout << '\n';
+  } else {
+    std::ofstream os(options.output.c_str());
+    write_json(os, results);
+    os << '\n';
+    if (!os) {
+      std::cerr << boost::format("%s: cannot write %s\n") % options.program_name % options.output;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
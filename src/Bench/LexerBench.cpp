@@ -0,0 +1,301 @@
+/*
+ * psi-lexer-bench: lexer throughput benchmark.
+ *
+ * Measures how quickly the parser front end gets through large sources,
+ * either files given on the command line or a synthesized program, and
+ * reports the result in MB/s.
+ */
+
+#include "Bench.hpp"
+
+#include "../OptionParser.hpp"
+#include "../Parser.hpp"
+#include "../Platform/Platform.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <boost/format.hpp>
+
+namespace Psi {
+  namespace Bench {
+    namespace {
+      enum OptionKeys {
+        opt_key_help,
+        opt_key_size,
+        opt_key_repeat,
+        opt_key_output,
+        opt_key_emit
+      };
+
+      struct BenchOptions {
+        std::string program_name;
+        std::vector<std::string> files;
+        unsigned size;
+        unsigned repeat;
+        std::string output;
+        bool emit;
+      };
+
+      bool parse_options(int argc, const char **argv, BenchOptions& options) {
+        options.program_name = find_program_name(argv[0]);
+        options.size = 16;
+        options.repeat = 5;
+        options.emit = false;
+
+        OptionsDescription desc;
+        desc.allow_unknown = false;
+        desc.allow_positional = true;
+        desc.opts.push_back(option_description(opt_key_help, false, 'h', "help", "Print this help"));
+        desc.opts.push_back(option_description(opt_key_size, true, 'm', "megabytes", "Size of the synthesized source, if no files are given (default: 16)"));
+        desc.opts.push_back(option_description(opt_key_repeat, true, 'r', "repeat", "Number of times to repeat each measurement (default: 5)"));
+        desc.opts.push_back(option_description(opt_key_output, true, 'o', "output", "Write JSON results to a file rather than standard output"));
+        desc.opts.push_back(option_description(opt_key_emit, false, '\0', "emit", "Print the synthesized source rather than lexing it"));
+
+        OptionParser parser(desc, argc, argv);
+        try {
+          while (!parser.empty()) {
+            OptionValue val = parser.next();
+            switch (val.key) {
+            case OptionValue::positional: options.files.push_back(val.value); break;
+
+            case opt_key_help:
+              options_help(std::cerr, options.program_name, "[file] ...", desc);
+              return false;
+
+            case opt_key_output: options.output = val.value; break;
+            case opt_key_emit: options.emit = true; break;
+
+            case opt_key_size:
+            case opt_key_repeat: {
+              std::vector<unsigned> value = split_unsigned_list(val.value);
+              if (value.size() != 1)
+                throw OptionParseError("Expected a single value: " + val.value);
+              (val.key == opt_key_size ? options.size : options.repeat) = value.front();
+              break;
+            }
+
+            default: PSI_FAIL("Unexpected option key");
+            }
+          }
+        } catch (std::runtime_error& ex) {
+          std::cerr << ex.what() << '\n';
+          options_usage(std::cerr, options.program_name, "[file] ...", "-h");
+          return false;
+        }
+
+        return true;
+      }
+
+      /**
+       * \brief Synthesize a program of roughly \c megabytes MB.
+       *
+       * The content is a mixture of the identifiers, whitespace, nested
+       * brackets and string literals typical of generated code.
+       */
+      void generate_source(std::ostream& os, unsigned megabytes) {
+        const std::size_t target = std::size_t(megabytes) << 20;
+        std::size_t written = 0;
+        for (unsigned i = 0; written < target; ++i) {
+          std::ostringstream ss;
+          ss << "generated_function_" << i << " : function (first_argument : int; second_argument : pointer(ubyte)) > int [\n"
+                "  local_value_" << i << " : new generated_structure_type_" << i % 97 << ";\n"
+                "  intermediate_result : add(first_argument, multiply(local_value_" << i << ".field_name, 1234567));\n"
+                "  if (compare_less(intermediate_result, 0)) [\n"
+                "    report_message(second_argument, {message text for function " << i << "});\n"
+                "  ];\n"
+                "  intermediate_result;\n"
+                "];\n\n";
+          std::string s = ss.str();
+          os << s;
+          written += s.size();
+        }
+      }
+
+      Parser::Text source_text(const String& url, const SharedPtrHandle& data_handle, const char *begin, const char *end) {
+        PhysicalSourceLocation loc;
+        loc.file.reset(new SourceFile);
+        loc.file->url = url;
+        loc.first_line = loc.first_column = 1;
+        loc.last_line = loc.last_column = 0;
+        return Parser::Text(loc, data_handle, begin, end);
+      }
+
+      /// Counts accumulated while lexing nested statement lists
+      struct LexStatistics {
+        std::size_t statements;
+        std::size_t bytes;
+        std::size_t errors;
+        int last_line;
+      };
+
+      void lex_statements(CompileErrorContext& error_context, const LogicalSourceLocationPtr& location,
+                          const PSI_STD::vector<SharedPtr<Parser::Statement> >& statements, LexStatistics& stats);
+
+      /// Lex the contents of every statement list nested within an expression
+      void lex_expression(CompileErrorContext& error_context, const LogicalSourceLocationPtr& location,
+                          const SharedPtr<Parser::Expression>& expr, LexStatistics& stats) {
+        if (!expr)
+          return;
+
+        switch (expr->expression_type) {
+        case Parser::expression_token: {
+          const Parser::TokenExpression& token = static_cast<const Parser::TokenExpression&>(*expr);
+          if (token.token_type == Parser::token_square_bracket) {
+            stats.bytes += token.text.end - token.text.begin;
+            try {
+              lex_statements(error_context, location, Parser::parse_statement_list(error_context, location, token.text), stats);
+            } catch (CompileException&) {
+              ++stats.errors;
+            }
+          }
+          break;
+        }
+
+        case Parser::expression_evaluate: {
+          const Parser::EvaluateExpression& eval = static_cast<const Parser::EvaluateExpression&>(*expr);
+          lex_expression(error_context, location, eval.object, stats);
+          for (PSI_STD::vector<SharedPtr<Parser::Expression> >::const_iterator ii = eval.parameters.begin(), ie = eval.parameters.end(); ii != ie; ++ii)
+            lex_expression(error_context, location, *ii, stats);
+          break;
+        }
+
+        case Parser::expression_dot: {
+          const Parser::DotExpression& dot = static_cast<const Parser::DotExpression&>(*expr);
+          lex_expression(error_context, location, dot.object, stats);
+          lex_expression(error_context, location, dot.member, stats);
+          for (PSI_STD::vector<SharedPtr<Parser::Expression> >::const_iterator ii = dot.parameters.begin(), ie = dot.parameters.end(); ii != ie; ++ii)
+            lex_expression(error_context, location, *ii, stats);
+          break;
+        }
+
+        default:
+          break;
+        }
+      }
+
+      void lex_statements(CompileErrorContext& error_context, const LogicalSourceLocationPtr& location,
+                          const PSI_STD::vector<SharedPtr<Parser::Statement> >& statements, LexStatistics& stats) {
+        for (PSI_STD::vector<SharedPtr<Parser::Statement> >::const_iterator ii = statements.begin(), ie = statements.end(); ii != ie; ++ii) {
+          if (!*ii)
+            continue;
+          ++stats.statements;
+          stats.last_line = std::max(stats.last_line, (*ii)->location.last_line);
+          lex_expression(error_context, location, (*ii)->expression, stats);
+        }
+      }
+
+      /**
+       * \brief Benchmark one source buffer.
+       *
+       * Two passes are timed: the top level namespace, which consists
+       * mostly of scanning bracketed bodies, and then every statement list
+       * nested in those bodies, which is dominated by identifiers and
+       * whitespace.
+       */
+      PropertyValue run_source(const BenchOptions& options, const std::string& name, const SharedPtrHandle& data_handle, const char *begin, const char *end) {
+        PropertyValue result;
+        result["source"] = name;
+        result["bytes"] = int(end - begin);
+
+        std::ostringstream errors;
+        CompileErrorContext error_context(&errors);
+        LogicalSourceLocationPtr location = LogicalSourceLocation::new_root();
+        Parser::Text text = source_text(name, data_handle, begin, end);
+
+        SampleSet namespace_samples, body_samples;
+        LexStatistics stats;
+        for (unsigned repeat = 0; repeat != options.repeat; ++repeat) {
+          stats.statements = stats.bytes = stats.errors = 0;
+          stats.last_line = 0;
+
+          double t0 = Platform::monotonic_time();
+          PSI_STD::vector<SharedPtr<Parser::Statement> > statements;
+          try {
+            statements = Parser::parse_namespace(error_context, location, text);
+          } catch (CompileException&) {
+            result["error"] = errors.str();
+            return result;
+          }
+          double t1 = Platform::monotonic_time();
+          lex_statements(error_context, location, statements, stats);
+          double t2 = Platform::monotonic_time();
+
+          namespace_samples.add(t1 - t0);
+          body_samples.add(t2 - t1);
+        }
+
+        const double megabyte = 1 << 20;
+        result["namespace"] = namespace_samples.summary();
+        result["namespace_mb_per_s"] = (end - begin) / megabyte / namespace_samples.min();
+        result["bodies"] = body_samples.summary();
+        result["body_bytes"] = int(stats.bytes);
+        result["body_mb_per_s"] = stats.bytes / megabyte / body_samples.min();
+        // Checksums so that changes to the lexer which alter its output are noticed
+        result["statements"] = int(stats.statements);
+        result["last_line"] = stats.last_line;
+        result["errors"] = int(stats.errors);
+
+        std::cerr << boost::format("%s: namespace %.1f MB/s, bodies %.1f MB/s\n")
+          % name % result["namespace_mb_per_s"].real() % result["body_mb_per_s"].real();
+
+        return result;
+      }
+    }
+  }
+}
+
+int main(int argc, const char **argv) {
+  using namespace Psi;
+  using namespace Psi::Bench;
+
+  BenchOptions options;
+  if (!parse_options(argc, argv, options))
+    return EXIT_FAILURE;
+
+  if (options.emit) {
+    generate_source(std::cout, options.size);
+    return EXIT_SUCCESS;
+  }
+
+  PropertyValue results;
+  results["program"] = "psi-lexer-bench";
+  PropertyValue& runs = results["results"] = PropertyList();
+
+  if (options.files.empty()) {
+    std::ostringstream ss;
+    generate_source(ss, options.size);
+    std::string src_str = ss.str();
+    SharedPtr<std::vector<char> > source(new std::vector<char>(src_str.begin(), src_str.end()));
+    std::string name = boost::str(boost::format("(generated %uMB)") % options.size);
+    runs.list().push_back(run_source(options, name, source, vector_begin_ptr(*source), vector_end_ptr(*source)));
+  }
+
+  for (std::vector<std::string>::const_iterator ii = options.files.begin(), ie = options.files.end(); ii != ie; ++ii) {
+    SharedPtr<Platform::FileData> source;
+    try {
+      source = Platform::read_file(*ii);
+    } catch (Platform::PlatformError& ex) {
+      std::cerr << boost::format("%s: %s\n") % options.program_name % ex.what();
+      return EXIT_FAILURE;
+    }
+    runs.list().push_back(run_source(options, *ii, source, source->begin(), source->end()));
+  }
+
+  if (options.output.empty()) {
+    write_json(std::cout, results);
+    std::cout << '\n';
+  } else {
+    std::ofstream os(options.output.c_str());
+    write_json(os, results);
+    os << '\n';
+    if (!os) {
+      std::cerr << boost::format("%s: cannot write %s\n") % options.program_name % options.output;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,240 @@
+/*
+ * psi-map-bench: persistent map benchmark.
+ *
+ * Compares the hash trie behind SharedMap against the red-black tree
+ * it replaced, timing insertion, copy-plus-insert, lookup and merge
+ * over a range of map sizes, and reports nanoseconds per operation.
+ */
+
+#include "Bench.hpp"
+
+#include "../OptionParser.hpp"
+#include "../SharedMap.hpp"
+#include "../Platform/Platform.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include <boost/format.hpp>
+
+namespace Psi {
+  namespace Bench {
+    namespace {
+      enum OptionKeys {
+        opt_key_help,
+        opt_key_sizes,
+        opt_key_repeat,
+        opt_key_output
+      };
+
+      struct BenchOptions {
+        std::string program_name;
+        std::vector<unsigned> sizes;
+        unsigned repeat;
+        std::string output;
+      };
+
+      bool parse_options(int argc, const char **argv, BenchOptions& options) {
+        options.program_name = find_program_name(argv[0]);
+        options.sizes = split_unsigned_list("10,100,1000,10000,100000,1000000");
+        options.repeat = 3;
+
+        OptionsDescription desc;
+        desc.allow_unknown = false;
+        desc.allow_positional = false;
+        desc.opts.push_back(option_description(opt_key_help, false, 'h', "help", "Print this help"));
+        desc.opts.push_back(option_description(opt_key_sizes, true, 's', "sizes", "Comma separated list of map sizes (default: 10,100,...,1000000)"));
+        desc.opts.push_back(option_description(opt_key_repeat, true, 'r', "repeat", "Number of times to repeat each measurement (default: 3)"));
+        desc.opts.push_back(option_description(opt_key_output, true, 'o', "output", "Write JSON results to a file rather than standard output"));
+
+        OptionParser parser(desc, argc, argv);
+        try {
+          while (!parser.empty()) {
+            OptionValue val = parser.next();
+            switch (val.key) {
+            case opt_key_help:
+              options_help(std::cerr, options.program_name, "", desc);
+              return false;
+
+            case opt_key_output: options.output = val.value; break;
+            case opt_key_sizes: options.sizes = split_unsigned_list(val.value); break;
+
+            case opt_key_repeat: {
+              std::vector<unsigned> value = split_unsigned_list(val.value);
+              if (value.size() != 1)
+                throw OptionParseError("Expected a single value: " + val.value);
+              options.repeat = value.front();
+              break;
+            }
+
+            default: PSI_FAIL("Unexpected option key");
+            }
+          }
+        } catch (std::runtime_error& ex) {
+          std::cerr << ex.what() << '\n';
+          options_usage(std::cerr, options.program_name, "", "-h");
+          return false;
+        }
+
+        return true;
+      }
+
+      /// Keys look like the tree and value pointers which the compiler uses as map keys
+      typedef const void *Key;
+
+      /**
+       * \brief The red-black tree map used before SharedHashTrie.
+       */
+      class RbTreeMap {
+        typedef std::pair<Key, std::size_t> value_type;
+
+        struct Get1st {
+          const Key& operator () (const value_type& v) const {
+            return v.first;
+          }
+        };
+
+        SharedRbTree<Key, value_type, Get1st, ThreeWayComparatorAdaptor<Key> > m_tree;
+
+      public:
+        void put(Key key, std::size_t value) {m_tree.insert(value_type(key, value));}
+        const std::size_t* lookup(Key key) const {const value_type *ptr = m_tree.lookup(key); return ptr ? &ptr->second : NULL;}
+        std::size_t size() const {return m_tree.size();}
+        void merge(const RbTreeMap& src) {m_tree.merge(src.m_tree);}
+      };
+
+      typedef SharedMap<Key, std::size_t> HashTrieMap;
+
+      /// Distinct, aligned, shuffled pseudo-pointers
+      std::vector<Key> make_keys(std::size_t n) {
+        std::vector<Key> keys(n);
+        for (std::size_t ii = 0; ii != n; ++ii)
+          keys[ii] = reinterpret_cast<Key>(0x100000 + ii * 16);
+        boost::uint32_t state = 12345;
+        for (std::size_t ii = n; ii > 1; --ii) {
+          state = state * 1103515245u + 12345u;
+          std::swap(keys[ii - 1], keys[(state >> 8) % ii]);
+        }
+        return keys;
+      }
+
+      template<typename Map>
+      Map build(const std::vector<Key>& keys, std::size_t begin, std::size_t end, std::size_t step=1) {
+        Map map;
+        for (std::size_t ii = begin; ii < end; ii += step)
+          map.put(keys[ii], ii);
+        return map;
+      }
+
+      /**
+       * \brief Benchmark one map implementation at one size.
+       *
+       * \c keys holds twice as many keys as the map size so that
+       * insertions of new keys into a full map can be timed.
+       */
+      template<typename Map>
+      PropertyValue run_map(const BenchOptions& options, const char *name, const std::vector<Key>& keys, std::size_t n) {
+        SampleSet insert_samples, copy_insert_samples, lookup_samples, merge_samples, merge_disjoint_samples;
+        std::size_t checksum = 0;
+        const std::size_t n_extra = n / 10 + 1;
+
+        for (unsigned repeat = 0; repeat != options.repeat; ++repeat) {
+          double t0 = Platform::monotonic_time();
+          Map map = build<Map>(keys, 0, n);
+          double t1 = Platform::monotonic_time();
+          insert_samples.add(t1 - t0);
+
+          // Each insertion goes into a fresh copy while the original stays live
+          for (std::size_t ii = n; ii != 2 * n; ++ii) {
+            Map copy(map);
+            copy.put(keys[ii], ii);
+            checksum += copy.size();
+          }
+          double t2 = Platform::monotonic_time();
+          copy_insert_samples.add(t2 - t1);
+
+          for (std::size_t ii = 0; ii != n; ++ii)
+            checksum += *map.lookup(keys[ii]);
+          double t3 = Platform::monotonic_time();
+          lookup_samples.add(t3 - t2);
+
+          // Two maps derived from a common parent, as for scopes in the compiler
+          Map left(map), right(map);
+          for (std::size_t ii = 0; ii != n_extra; ++ii) {
+            left.put(keys[n + ii], ii);
+            right.put(keys[n + n_extra + ii], ii);
+          }
+          double t4 = Platform::monotonic_time();
+          left.merge(right);
+          double t5 = Platform::monotonic_time();
+          merge_samples.add(t5 - t4);
+          checksum += left.size();
+
+          Map even = build<Map>(keys, 0, n, 2), odd = build<Map>(keys, 1, n, 2);
+          double t6 = Platform::monotonic_time();
+          even.merge(odd);
+          double t7 = Platform::monotonic_time();
+          merge_disjoint_samples.add(t7 - t6);
+          checksum += even.size();
+        }
+
+        const double ns = 1e9;
+        PropertyValue result;
+        result["map"] = name;
+        result["size"] = int(n);
+        result["insert"] = insert_samples.summary();
+        result["insert_ns"] = insert_samples.min() * ns / n;
+        result["copy_insert"] = copy_insert_samples.summary();
+        result["copy_insert_ns"] = copy_insert_samples.min() * ns / n;
+        result["lookup"] = lookup_samples.summary();
+        result["lookup_ns"] = lookup_samples.min() * ns / n;
+        result["merge"] = merge_samples.summary();
+        result["merge_ns"] = merge_samples.min() * ns / n_extra;
+        result["merge_disjoint"] = merge_disjoint_samples.summary();
+        result["merge_disjoint_ns"] = merge_disjoint_samples.min() * ns / n;
+        result["checksum"] = int(checksum % 1000000007);
+
+        std::cerr << boost::format("%s %u: insert %.0f ns, copy+insert %.0f ns, lookup %.0f ns, merge %.0f ns/new key, disjoint merge %.0f ns/key\n")
+          % name % n % result["insert_ns"].real() % result["copy_insert_ns"].real() % result["lookup_ns"].real()
+          % result["merge_ns"].real() % result["merge_disjoint_ns"].real();
+
+        return result;
+      }
+    }
+  }
+}
+
+int main(int argc, const char **argv) {
+  using namespace Psi;
+  using namespace Psi::Bench;
+
+  BenchOptions options;
+  if (!parse_options(argc, argv, options))
+    return EXIT_FAILURE;
+
+  PropertyValue results;
+  results["program"] = "psi-map-bench";
+  PropertyValue& runs = results["results"] = PropertyList();
+
+  for (std::vector<unsigned>::const_iterator ii = options.sizes.begin(), ie = options.sizes.end(); ii != ie; ++ii) {
+    std::vector<Key> keys = make_keys(2 * std::size_t(*ii) + 2 * (*ii / 10 + 1));
+    runs.list().push_back(run_map<RbTreeMap>(options, "rbtree", keys, *ii));
+    runs.list().push_back(run_map<HashTrieMap>(options, "hashtrie", keys, *ii));
+  }
+
+  if (options.output.empty()) {
+    write_json(std::cout, results);
+    std::cout << '\n';
+  } else {
+    std::ofstream os(options.output.c_str());
+    write_json(os, results);
+    os << '\n';
+    if (!os) {
+      std::cerr << boost::format("%s: cannot write %s\n") % options.program_name % options.output;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
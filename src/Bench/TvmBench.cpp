@@ -0,0 +1,446 @@
+/*
+ * psi-tvm-bench: speed of code generated by each TVM backend.
+ *
+ * JIT compiles a set of TVM assembler kernels on each backend and times
+ * the resulting native code.
+ */
+
+#include "Bench.hpp"
+
+#include "../Configuration.hpp"
+#include "../OptionParser.hpp"
+#include "../Platform/Platform.hpp"
+#include "../Tvm/Test.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+
+namespace Psi {
+  namespace Bench {
+    namespace {
+      /**
+       * \brief A TVM function to benchmark.
+       *
+       * Every kernel exports a function \c f with the signature
+       * <tt>uiptr (uiptr n)</tt> which performs \c n iterations of some
+       * operation, and returns a value depending on all of them so that
+       * the work cannot be optimized away.
+       */
+      struct Kernel {
+        const char *name;
+        const char *description;
+        const char *source;
+        /// Reference implementation used to check the generated code
+        Tvm::Jit::UIntPtr (*expected) (Tvm::Jit::UIntPtr n);
+      };
+
+      Tvm::Jit::UIntPtr int_loop_expected(Tvm::Jit::UIntPtr n) {
+        Tvm::Jit::UIntPtr acc = 0;
+        for (Tvm::Jit::UIntPtr i = 0; i != n; ++i)
+          acc += i * i;
+        return acc;
+      }
+
+      Tvm::Jit::UIntPtr memcpy_expected(Tvm::Jit::UIntPtr n) {
+        return n ? n - 1 : 0;
+      }
+
+      Tvm::Jit::UIntPtr memzero_expected(Tvm::Jit::UIntPtr n) {
+        return n ? n - 1 : 0;
+      }
+
+      Tvm::Jit::UIntPtr aggregate_call_expected(Tvm::Jit::UIntPtr n) {
+        Tvm::Jit::UIntPtr v[4] = {0, 0, 0, 0};
+        for (Tvm::Jit::UIntPtr i = 0; i != n; ++i) {
+          Tvm::Jit::UIntPtr w[4] = {v[1], v[2], v[3], v[0] + 1};
+          std::copy(w, w + 4, v);
+        }
+        return v[0];
+      }
+
+      Tvm::Jit::UIntPtr dynamic_alloca_expected(Tvm::Jit::UIntPtr n) {
+        Tvm::Jit::UIntPtr acc = 0;
+        for (Tvm::Jit::UIntPtr i = 0; i != n; ++i)
+          acc += i + i % 16;
+        return acc;
+      }
+
+      const Kernel kernels[] = {
+        {"int_loop", "Integer arithmetic in a loop",
+        "%f = export function (%n : uiptr) > uiptr {\n"
+        "  br %entry;\n"
+        "block %entry:\n"
+        "  %i = phi uiptr: > #up0, %body > (add %i #up1);\n"
+        "  %acc = phi uiptr: > #up0, %body > (add %acc (mul %i %i));\n"
+        "  cond_br (cmp_lt %i %n) %body %exit;\n"
+        "block %body(%entry):\n"
+        "  br %entry;\n"
+        "block %exit(%entry):\n"
+        "  return %acc;\n"
+        "};\n",
+        &int_loop_expected},
+
+        {"memcpy_struct", "Copy a 64 byte struct using memcpy",
+        "%s = define struct uiptr uiptr uiptr uiptr uiptr uiptr uiptr uiptr;\n"
+        "%f = export function (%n : uiptr) > uiptr {\n"
+        "  %a = alloca %s;\n"
+        "  %b = alloca %s;\n"
+        "  store (zero %s) %a;\n"
+        "  store (zero %s) %b;\n"
+        "  br %entry;\n"
+        "block %entry:\n"
+        "  %i = phi uiptr: > #up0, %body > (add %i #up1);\n"
+        "  cond_br (cmp_lt %i %n) %body %exit;\n"
+        "block %body(%entry):\n"
+        "  store %i (gep %a #up0);\n"
+        "  memcpy %b %a #up1;\n"
+        "  br %entry;\n"
+        "block %exit(%entry):\n"
+        "  %r = load (gep %b #up0);\n"
+        "  return %r;\n"
+        "};\n",
+        &memcpy_expected},
+
+        {"memzero_struct", "Clear a 32 byte struct using memzero",
+        "%s = define struct uiptr uiptr uiptr uiptr;\n"
+        "%f = export function (%n : uiptr) > uiptr {\n"
+        "  %a = alloca %s;\n"
+        "  store (zero %s) %a;\n"
+        "  br %entry;\n"
+        "block %entry:\n"
+        "  %i = phi uiptr: > #up0, %body > (add %i #up1);\n"
+        "  %acc = phi uiptr: > #up0, %body > (add %acc %x);\n"
+        "  cond_br (cmp_lt %i %n) %body %exit;\n"
+        "block %body(%entry):\n"
+        "  memzero (pointer_cast %a byte) #up32 #up8;\n"
+        "  store %i (gep %a #up3);\n"
+        "  %x = load (gep %a #up0);\n"
+        "  br %entry;\n"
+        "block %exit(%entry):\n"
+        "  %r = load (gep %a #up3);\n"
+        "  return %r;\n"
+        "};\n",
+        &memzero_expected},
+
+        {"aggregate_call", "Pass and return a struct by value",
+        "%s = define struct uiptr uiptr uiptr uiptr;\n"
+        "%g = function (%x : %s) > %s {\n"
+        "  return (struct_v (element %x #up1) (element %x #up2) (element %x #up3) (add (element %x #up0) #up1));\n"
+        "};\n"
+        "%f = export function (%n : uiptr) > uiptr {\n"
+        "  %v = alloca %s;\n"
+        "  store (zero %s) %v;\n"
+        "  br %entry;\n"
+        "block %entry:\n"
+        "  %i = phi uiptr: > #up0, %body > (add %i #up1);\n"
+        "  cond_br (cmp_lt %i %n) %body %exit;\n"
+        "block %body(%entry):\n"
+        "  %x = load %v;\n"
+        "  %y = call %g %x;\n"
+        "  store %y %v;\n"
+        "  br %entry;\n"
+        "block %exit(%entry):\n"
+        "  %r = load (gep %v #up0);\n"
+        "  return %r;\n"
+        "};\n",
+        &aggregate_call_expected},
+
+        {"dynamic_alloca", "Variable size stack allocation in a loop",
+        "%f = export function (%n : uiptr) > uiptr {\n"
+        "  br %entry;\n"
+        "block %entry:\n"
+        "  %i = phi uiptr: > #up0, %body > (add %i #up1);\n"
+        "  %acc = phi uiptr: > #up0, %body > (add %acc (add %x %y));\n"
+        "  cond_br (cmp_lt %i %n) %body %exit;\n"
+        "block %body(%entry):\n"
+        "  %m = sub %i (mul (div %i #up16) #up16);\n"
+        "  %p = alloca uiptr (add %m #up2);\n"
+        "  %q = pointer_offset %p (add %m #up1);\n"
+        "  store %i %p;\n"
+        "  store %m %q;\n"
+        "  %x = load %p;\n"
+        "  %y = load %q;\n"
+        "  freea %p;\n"
+        "  br %entry;\n"
+        "block %exit(%entry):\n"
+        "  return %acc;\n"
+        "};\n",
+        &dynamic_alloca_expected}
+      };
+      const std::size_t n_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+      const Kernel* find_kernel(const std::string& name) {
+        for (std::size_t ii = 0; ii != n_kernels; ++ii) {
+          if (name == kernels[ii].name)
+            return &kernels[ii];
+        }
+        return NULL;
+      }
+
+      /// A JIT configuration to benchmark
+      struct JitTarget {
+        std::string label;
+        PropertyValue config;
+      };
+
+      enum OptionKeys {
+        opt_key_help,
+        opt_key_config,
+        opt_key_set,
+        opt_key_kernel,
+        opt_key_jit,
+        opt_key_llvm_opt,
+        opt_key_samples,
+        opt_key_min_time,
+        opt_key_output
+      };
+
+      struct BenchOptions {
+        std::string program_name;
+        std::vector<const Kernel*> kernels;
+        std::vector<JitTarget> jits;
+        unsigned samples;
+        double min_time;
+        std::string output;
+      };
+
+      bool parse_options(int argc, const char **argv, BenchOptions& options) {
+        options.program_name = find_program_name(argv[0]);
+        options.samples = 10;
+        options.min_time = 0.01;
+
+        OptionsDescription desc;
+        desc.allow_unknown = false;
+        desc.allow_positional = false;
+        desc.opts.push_back(option_description(opt_key_help, false, 'h', "help", "Print this help"));
+        desc.opts.push_back(option_description(opt_key_config, true, 'c', "config", "Read a configuration file"));
+        desc.opts.push_back(option_description(opt_key_set, true, 's', "set", "Set a configuration property"));
+        desc.opts.push_back(option_description(opt_key_kernel, true, 'k', "kernel", "Comma separated list of kernels (default: all)"));
+        desc.opts.push_back(option_description(opt_key_jit, true, 'j', "jit", "Comma separated list of TVM configurations to benchmark (default: all configured)"));
+        desc.opts.push_back(option_description(opt_key_llvm_opt, true, '\0', "llvm-opt", "Comma separated list of optimization levels for LLVM configurations (default: 0,1,2,3)"));
+        desc.opts.push_back(option_description(opt_key_samples, true, 'r', "samples", "Number of timing samples per kernel (default: 10)"));
+        desc.opts.push_back(option_description(opt_key_min_time, true, '\0', "min-time", "Minimum duration of each sample in seconds (default: 0.01)"));
+        desc.opts.push_back(option_description(opt_key_output, true, 'o', "output", "Write JSON results to a file rather than standard output"));
+
+        std::vector<std::string> config_files, extra_config, jit_names, llvm_opt;
+
+        OptionParser parser(desc, argc, argv);
+        try {
+          while (!parser.empty()) {
+            OptionValue val = parser.next();
+            switch (val.key) {
+            case opt_key_help:
+              options_help(std::cerr, options.program_name, "", desc);
+              std::cerr << "\nKernels:\n";
+              for (std::size_t ii = 0; ii != n_kernels; ++ii)
+                std::cerr << boost::format("  %-16s %s\n") % kernels[ii].name % kernels[ii].description;
+              return false;
+
+            case opt_key_config: config_files.push_back(val.value); break;
+            case opt_key_set: extra_config.push_back(val.value); break;
+            case opt_key_jit: jit_names = split_list(val.value); break;
+            case opt_key_llvm_opt: llvm_opt = split_list(val.value); break;
+            case opt_key_output: options.output = val.value; break;
+            case opt_key_min_time: options.min_time = std::atof(val.value.c_str()); break;
+
+            case opt_key_kernel: {
+              std::vector<std::string> names = split_list(val.value);
+              for (std::vector<std::string>::const_iterator ii = names.begin(), ie = names.end(); ii != ie; ++ii) {
+                const Kernel *kernel = find_kernel(*ii);
+                if (!kernel)
+                  throw OptionParseError("Unknown kernel: " + *ii);
+                options.kernels.push_back(kernel);
+              }
+              break;
+            }
+
+            case opt_key_samples: {
+              std::vector<unsigned> samples = split_unsigned_list(val.value);
+              if (samples.size() != 1)
+                throw OptionParseError("--samples expects a single value");
+              options.samples = samples.front();
+              break;
+            }
+
+            default: PSI_FAIL("Unexpected option key");
+            }
+          }
+        } catch (std::runtime_error& ex) {
+          std::cerr << ex.what() << '\n';
+          options_usage(std::cerr, options.program_name, "", "-h");
+          return false;
+        }
+
+        if (options.kernels.empty()) {
+          for (std::size_t ii = 0; ii != n_kernels; ++ii)
+            options.kernels.push_back(&kernels[ii]);
+        }
+
+        if (llvm_opt.empty()) {
+          const char *default_levels[] = {"0", "1", "2", "3"};
+          llvm_opt.assign(default_levels, default_levels + 4);
+        }
+
+        PropertyValue configuration;
+        configuration_builtin(configuration);
+        configuration_read_files(configuration);
+        configuration_environment(configuration);
+        for (std::vector<std::string>::const_iterator ii = config_files.begin(), ie = config_files.end(); ii != ie; ++ii)
+          configuration.parse_file(*ii);
+        for (std::vector<std::string>::const_iterator ii = extra_config.begin(), ie = extra_config.end(); ii != ie; ++ii)
+          configuration.parse_configuration(ii->c_str());
+
+        const PropertyValue& tvm = configuration.get("tvm");
+        if (jit_names.empty() && (tvm.type() == PropertyValue::t_map)) {
+          for (PropertyMap::const_iterator ii = tvm.map().begin(), ie = tvm.map().end(); ii != ie; ++ii) {
+            if ((ii->second.type() == PropertyValue::t_map) && ii->second.has_key("kind"))
+              jit_names.push_back(ii->first);
+          }
+        }
+
+        // LLVM is benchmarked once per optimization level
+        for (std::vector<std::string>::const_iterator ii = jit_names.begin(), ie = jit_names.end(); ii != ie; ++ii) {
+          const PropertyValue *jit_config = tvm.path_value_ptr(*ii);
+          if (!jit_config) {
+            std::cerr << boost::format("%s: no configuration for JIT '%s'\n") % options.program_name % *ii;
+            return false;
+          }
+
+          boost::optional<std::string> kind = jit_config->path_str("kind");
+          if (kind && (*kind == "llvm")) {
+            for (std::vector<std::string>::const_iterator ji = llvm_opt.begin(), je = llvm_opt.end(); ji != je; ++ji) {
+              JitTarget target;
+              target.label = *ii + "-O" + *ji;
+              target.config = *jit_config;
+              target.config["opt"] = boost::lexical_cast<int>(*ji);
+              options.jits.push_back(target);
+            }
+          } else {
+            JitTarget target;
+            target.label = *ii;
+            target.config = *jit_config;
+            options.jits.push_back(target);
+          }
+        }
+
+        return true;
+      }
+
+      typedef Tvm::Jit::UIntPtr (*KernelFunction) (Tvm::Jit::UIntPtr);
+
+      /**
+       * \brief Time a single kernel on a single JIT.
+       */
+      PropertyValue run_kernel(const BenchOptions& options, const boost::shared_ptr<Tvm::JitFactory>& jit_factory, const Kernel& kernel) {
+        PropertyValue result;
+        result["kernel"] = kernel.name;
+
+        Tvm::Test::ContextFixture fixture(jit_factory);
+        KernelFunction f;
+        double t0 = Platform::monotonic_time();
+        try {
+          *reinterpret_cast<void**>(&f) = fixture.jit_single("f", kernel.source);
+        } catch (std::exception& ex) {
+          result["error"] = ex.what();
+          return result;
+        }
+        result["compile_time"] = Platform::monotonic_time() - t0;
+
+        const Tvm::Jit::UIntPtr check_n = 100;
+        Tvm::Jit::UIntPtr value = f(check_n), expected = kernel.expected(check_n);
+        if (value != expected) {
+          result["error"] = boost::str(boost::format("Incorrect result: expected %s, got %s") % expected % value);
+          return result;
+        }
+
+        // Find an iteration count which takes at least min_time
+        Tvm::Jit::UIntPtr n = 1000;
+        while (true) {
+          double start = Platform::monotonic_time();
+          f(n);
+          if ((Platform::monotonic_time() - start >= options.min_time) || (n >= (Tvm::Jit::UIntPtr(1) << 40)))
+            break;
+          n *= 2;
+        }
+        result["iterations"] = double(n);
+
+        SampleSet samples;
+        for (unsigned ii = 0; ii != options.samples; ++ii) {
+          double start = Platform::monotonic_time();
+          f(n);
+          samples.add((Platform::monotonic_time() - start) / n);
+        }
+        result["ns_per_iteration"] = samples.summary(1e9);
+
+        return result;
+      }
+    }
+  }
+}
+
+int main(int argc, const char **argv) {
+  using namespace Psi;
+  using namespace Psi::Bench;
+
+  BenchOptions options;
+  if (!parse_options(argc, argv, options))
+    return EXIT_FAILURE;
+
+  // ContextFixture::jit_single reports failures through the test framework
+  Test::StreamLogger logger(&std::cerr, options.program_name, Test::log_level_fail);
+  Test::set_test_logger(&logger);
+
+  CompileErrorContext error_context(&std::cerr);
+  CompileErrorPair error_pair = error_context.bind(SourceLocation::root_location("(jit)"));
+
+  PropertyValue results;
+  results["program"] = "psi-tvm-bench";
+  PropertyValue& runs = results["results"] = PropertyList();
+
+  bool ok = true;
+  for (std::vector<JitTarget>::const_iterator ii = options.jits.begin(), ie = options.jits.end(); ii != ie; ++ii) {
+    boost::shared_ptr<Tvm::JitFactory> jit_factory;
+    try {
+      jit_factory = Tvm::JitFactory::get_specific(error_pair, ii->config);
+    } catch (std::exception& ex) {
+      std::cerr << boost::format("%s: cannot load JIT '%s': %s\n") % options.program_name % ii->label % ex.what();
+      ok = false;
+      continue;
+    }
+
+    for (std::vector<const Kernel*>::const_iterator ji = options.kernels.begin(), je = options.kernels.end(); ji != je; ++ji) {
+      PropertyValue result = run_kernel(options, jit_factory, **ji);
+      result["jit"] = ii->label;
+
+      std::cerr << boost::format("%s/%s: ") % (*ji)->name % ii->label;
+      if (result.has_key("error")) {
+        std::cerr << "failed: " << result.get("error").str() << '\n';
+        ok = false;
+      } else {
+        const PropertyValue& ns = result.get("ns_per_iteration");
+        std::cerr << boost::format("%.3f +/- %.3f ns/iter\n") % ns.get("mean").real() % ns.get("ci95").real();
+      }
+
+      runs.list().push_back(result);
+    }
+  }
+
+  if (options.output.empty()) {
+    write_json(std::cout, results);
+    std::cout << '\n';
+  } else {
+    std::ofstream os(options.output.c_str());
+    write_json(os, results);
+    os << '\n';
+    if (!os) {
+      std::cerr << boost::format("%s: cannot write %s\n") % options.program_name % options.output;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -91,28 +91,38 @@ namespace Psi {
           TreePtr<Term> self_instance = TermBuilder::instance(self, vector_of<TreePtr<Term> >(upref, param), self->location());
           TreePtr<Term> self_pointer = TermBuilder::pointer(self_instance, upref, self->location());
           
+          /*
+           * Lifecycle functions must not keep the addresses of the objects they are
+           * passed, and copies must not modify their source. The destination of
+           * an initialization is fresh storage, so cannot alias the source, but
+           * assignment may be to the source itself.
+           */
           FunctionParameterType self_derived_p(parameter_mode_functional, self_pointer);
-          FunctionParameterType out_param_p(parameter_mode_output, param);
-          FunctionParameterType in_param_p(parameter_mode_input, param);
+          FunctionParameterType out_param_p(parameter_mode_output, param, parameter_flag_nocapture);
+          FunctionParameterType init_param_p(parameter_mode_output, param, parameter_flag_noalias|parameter_flag_nocapture);
+          FunctionParameterType in_param_p(parameter_mode_input, param, parameter_flag_nocapture);
+          FunctionParameterType copy_in_param_p(parameter_mode_input, param, parameter_flag_nocapture|parameter_flag_readonly);
           
-          TreePtr<Term> binary_type = TermBuilder::function_type(result_mode_functional, builtins.empty_type, vector_of(self_derived_p, out_param_p, in_param_p), default_, self->location().named_child("BinaryType"));
-          TreePtr<Term> binary_ptr_type = TermBuilder::pointer(binary_type, self->location().named_child("BinaryTypePtr"));
-
           if (m_movable) {
             TreePtr<Term> unary_type = TermBuilder::function_type(result_mode_functional, builtins.empty_type, vector_of(self_derived_p, out_param_p), default_, self->location().named_child("UnaryType"));
             TreePtr<Term> unary_ptr_type = TermBuilder::pointer(unary_type, self->location().named_child("UnaryTypePtr"));
+            TreePtr<Term> move_type = TermBuilder::function_type(result_mode_functional, builtins.empty_type, vector_of(self_derived_p, out_param_p, in_param_p), default_, self->location().named_child("MoveType"));
+            TreePtr<Term> move_init_type = TermBuilder::function_type(result_mode_functional, builtins.empty_type, vector_of(self_derived_p, init_param_p, in_param_p), default_, self->location().named_child("MoveInitType"));
             
             members.resize(5);
             members[interface_movable_init] = unary_ptr_type;
             members[interface_movable_fini] = unary_ptr_type;
             members[interface_movable_clear] = unary_ptr_type;
-            members[interface_movable_move] = binary_ptr_type;
-            members[interface_movable_move_init] = binary_ptr_type;
+            members[interface_movable_move] = TermBuilder::pointer(move_type, self->location().named_child("MoveTypePtr"));
+            members[interface_movable_move_init] = TermBuilder::pointer(move_init_type, self->location().named_child("MoveInitTypePtr"));
           } else {
+            TreePtr<Term> copy_type = TermBuilder::function_type(result_mode_functional, builtins.empty_type, vector_of(self_derived_p, out_param_p, copy_in_param_p), default_, self->location().named_child("CopyType"));
+            TreePtr<Term> copy_init_type = TermBuilder::function_type(result_mode_functional, builtins.empty_type, vector_of(self_derived_p, init_param_p, copy_in_param_p), default_, self->location().named_child("CopyInitType"));
+            
             members.resize(3);
             members[interface_copyable_movable] = self->compile_context().builtins().movable_interface->type_after(vector_of<TreePtr<Term> >(param), self->location().named_child("MovableBasePointer"));
-            members[interface_copyable_copy] = binary_ptr_type;
-            members[interface_copyable_copy_init] = binary_ptr_type;
+            members[interface_copyable_copy] = TermBuilder::pointer(copy_type, self->location().named_child("CopyTypePtr"));
+            members[interface_copyable_copy_init] = TermBuilder::pointer(copy_init_type, self->location().named_child("CopyInitTypePtr"));
           }
           
           return TermBuilder::struct_type(compile_context, members, self->location())->parameterize(self->location(), vector_of(upref, param));
@@ -1,17 +1,53 @@
 #include "Compiler.hpp"
 #include "TvmLowering.hpp"
+#include "Parser.hpp"
+#include "SharedMap.hpp"
+#include "StaticDispatch.hpp"
+#include "GarbageCollection.hpp"
 
 #include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
 
+#include <algorithm>
+#include <iostream>
+
 #if PSI_HAVE_EXECINFO
 #include <execinfo.h>
 #endif
 
 namespace Psi {
   namespace Compiler {
-    bool si_derived(const SIVtable *base, const SIVtable *derived) {
+    /**
+     * \brief Build the ancestor display of a vtable.
+     * 
+     * Only the \c super chain is used, so this does not depend on the
+     * displays of ancestors having been built. Vtables are static so the
+     * display is never freed.
+     */
+    SIDisplay si_build_display(const SIVtable *vptr) {
+      std::size_t depth = 0;
+      for (const SIVtable *super = vptr->super; super; super = super->super) {
+        PSI_ASSERT(super != vptr);
+        ++depth;
+      }
+      
+      const SIVtable **ancestors = new const SIVtable*[depth + 1];
+      std::size_t index = depth;
+      for (const SIVtable *super = vptr; super; super = super->super)
+        ancestors[index--] = super;
+      
+      SIDisplay result = {ancestors, depth};
+      return result;
+    }
+    
+    /**
+     * \brief Walk the super chain of \c derived looking for \c base.
+     * 
+     * Used by si_derived() during static initialization, before the
+     * display of either vtable is available.
+     */
+    bool si_derived_slow(const SIVtable *base, const SIVtable *derived) {
       for (const SIVtable *super = derived; super; super = super->super) {
         PSI_ASSERT(super->super != derived);
         if (super == base)
@@ -21,10 +57,6 @@ namespace Psi {
       return false;
     }
 
-    bool si_is_a(const SIBase *object, const SIVtable *cls) {
-      return si_derived(cls, object->m_vptr);
-    }
-
 #if PSI_DEBUG
     std::set<void*> CompileContext::object_pointers() {
       std::set<void*> pointers;
@@ -39,7 +71,10 @@ namespace Psi {
     m_running_completion_stack(NULL),
     m_functional_term_buckets(initial_functional_term_buckets),
     m_functional_term_set(FunctionalTermSetType::bucket_traits(m_functional_term_buckets.get(), m_functional_term_buckets.size())),
-    m_root_location(PhysicalSourceLocation(), LogicalSourceLocation::new_root()) {
+    m_root_location(PhysicalSourceLocation(), LogicalSourceLocation::new_root()),
+    m_parse_cache(new Parser::ParseCache(error_context)),
+    m_overload_cache(new OverloadLookupCache()),
+    m_evaluate_context_lookups(0) {
       PSI_ASSERT(error_context);
       
 #if PSI_OBJECT_PTR_DEBUG
@@ -82,6 +117,7 @@ namespace Psi {
     CompileContext::~CompileContext() {
       m_builtins = BuiltinTypes();
       m_jit.reset();
+      m_overload_cache->clear();
 
       // Add extra reference to each Tree
       BOOST_FOREACH(Object& t, m_gc_list)
@@ -271,6 +307,81 @@ namespace Psi {
     }
 #endif
 
+    struct CompileContext::GCAccessor {
+      std::size_t refcount(Object& obj) {
+        return obj.m_reference_count;
+      }
+      
+      void decrement(Object& obj) {
+        derived_vptr(&obj)->gc_decrement(&obj);
+      }
+      
+      void increment(Object& obj, std::vector<Object*> *revived) {
+        derived_vptr(&obj)->gc_increment(&obj, revived);
+      }
+    };
+    
+    /**
+     * \brief Destroy objects which are only referenced by other unreachable objects.
+     * 
+     * Reference counting alone cannot free cycles, which are common since
+     * delayed evaluation callbacks refer back to the trees which hold them,
+     * so without this a long running context grows without bound.
+     * 
+     * This must only be called between top level statements: an object
+     * referenced only by raw pointers, such as those held while a tree is
+     * being completed, would be destroyed. The cost is proportional to the
+     * number of objects in the context, so callers should not call this
+     * until object_count() has grown substantially since the last collection.
+     * 
+     * The overload lookup cache is cleared first since it holds references
+     * to the trees it has seen. The parse cache is cleared too, since its
+     * entries keep the source text they were parsed from alive.
+     * 
+     * \return The number of objects destroyed.
+     */
+    std::size_t CompileContext::collect_garbage() {
+      PSI_ASSERT(!m_running_completion_stack);
+      m_overload_cache->clear();
+      m_parse_cache->clear();
+      
+      GCListType unreachable;
+      GCAccessor accessor;
+      garbage_collect(m_gc_list, unreachable, accessor);
+      
+      BOOST_FOREACH(Object& t, unreachable) {
+        // Remove hash-consed terms from the lookup table so that they cannot be
+        // returned by get_functional while their members are being cleared
+        if (si_is_a(&t, &Functional::vtable)) {
+          Functional& f = static_cast<Functional&>(t);
+          if (f.m_set_hook.is_linked())
+            m_functional_term_set.erase(m_functional_term_set.iterator_to(f));
+        }
+        t.m_reference_count += PSI_COMPILE_CONTEXT_REFERENCE_GUARD;
+      }
+      
+      BOOST_FOREACH(Object& t, unreachable)
+        derived_vptr(&t)->gc_clear(&t);
+      
+      std::size_t count = 0;
+      while (!unreachable.empty()) {
+        Object& t = unreachable.front();
+        unreachable.pop_front();
+        if (t.m_reference_count == PSI_COMPILE_CONTEXT_REFERENCE_GUARD) {
+          t.m_reference_count = 0;
+          derived_vptr(&t)->destroy(&t);
+          ++count;
+        } else {
+          // A reference was not released by gc_clear, so the object cannot safely be destroyed
+          PSI_WARNING_FAIL2("Incorrect reference count during garbage collection", si_vptr(&t)->classname);
+          t.m_reference_count -= PSI_COMPILE_CONTEXT_REFERENCE_GUARD;
+          m_gc_list.push_back(t);
+        }
+      }
+      
+      return count;
+    }
+
     /**
      * \brief JIT compile a global variable or function.
      */
@@ -345,17 +456,32 @@ namespace Psi {
       return result;
     }
 
+    LookupResult<TreePtr<Term> > EvaluateContext::lookup(const Symbol& name, const SourceLocation& location, const TreePtr<EvaluateContext>& evaluate_context) const {
+      if (!name)
+        return lookup_result_none;
+      compile_context().count_evaluate_context_lookup();
+      ResultStorage<LookupResult<TreePtr<Term> > > result;
+      derived_vptr(this)->lookup(result.ptr(), this, &name, &location, &evaluate_context);
+      return result.done();
+    }
+
+    LookupResult<TreePtr<Term> > EvaluateContext::lookup(const String& name, const SourceLocation& location) const {
+      return lookup(compile_context().symbols().find(name.c_str(), name.c_str() + name.length()), location);
+    }
+
     class EvaluateContextDictionary : public EvaluateContext {
     public:
       static const EvaluateContextVtable vtable;
 
-      typedef PSI_STD::map<String, TreePtr<Term> > NameMapType;
+      typedef boost::unordered_map<Symbol, TreePtr<Term> > NameMapType;
 
       EvaluateContextDictionary(const TreePtr<Module>& module,
                                 const SourceLocation& location,
-                                const NameMapType& entries_,
+                                const PSI_STD::map<String, TreePtr<Term> >& entries_,
                                 const TreePtr<EvaluateContext>& next_)
-      : EvaluateContext(&vtable, module, location), entries(entries_), next(next_) {
+      : EvaluateContext(&vtable, module, location), next(next_) {
+        for (PSI_STD::map<String, TreePtr<Term> >::const_iterator ii = entries_.begin(), ie = entries_.end(); ii != ie; ++ii)
+          entries.insert(std::make_pair(compile_context().symbols().intern(ii->first), ii->second));
       }
 
       NameMapType entries;
@@ -368,7 +494,7 @@ namespace Psi {
         ("next", &EvaluateContextDictionary::next);
       }
 
-      static LookupResult<TreePtr<Term> > lookup_impl(const EvaluateContextDictionary& self, const String& name, const SourceLocation& location, const TreePtr<EvaluateContext>& evaluate_context) {
+      static LookupResult<TreePtr<Term> > lookup_impl(const EvaluateContextDictionary& self, const Symbol& name, const SourceLocation& location, const TreePtr<EvaluateContext>& evaluate_context) {
         NameMapType::const_iterator it = self.entries.find(name);
         if (it != self.entries.end()) {
           return lookup_result_match(it->second);
@@ -407,6 +533,90 @@ namespace Psi {
       return evaluate_context_dictionary(parent->module(), location, names, parent);
     }
 
+    /**
+     * \brief Evaluation context which extends an earlier scope with more names.
+     *
+     * Each instance owns only the names it adds. \c index maps every name
+     * visible in the scope to its definition and shares structure with the
+     * index of the scope it extends, so adding \c k names to a scope of
+     * \c n costs O(k log n) rather than a copy of all \c n.
+     * 
+     * The scope being extended is not kept alive, so a definition which has
+     * been shadowed by a later one can be collected once nothing else refers
+     * to it. References held by \c index are not visible to the garbage
+     * collector, which treats them as external. This cannot hide a cycle:
+     * a definition only refers to scopes created before it was defined,
+     * which cannot contain it.
+     */
+    class EvaluateContextPersistent : public EvaluateContext {
+    public:
+      static const EvaluateContextVtable vtable;
+
+      typedef boost::unordered_map<Symbol, TreePtr<Term> > NameMapType;
+      typedef SharedMap<Symbol, TreePtr<Term> > IndexType;
+
+      EvaluateContextPersistent(const TreePtr<Module>& module,
+                                const SourceLocation& location,
+                                const PSI_STD::map<String, TreePtr<Term> >& entries_,
+                                const TreePtr<EvaluateContext>& previous)
+      : EvaluateContext(&vtable, module, location) {
+        if (const EvaluateContextPersistent *base = dyn_tree_cast<EvaluateContextPersistent>(previous.get())) {
+          index = base->index;
+          next = base->next;
+        } else {
+          next = previous;
+        }
+
+        for (PSI_STD::map<String, TreePtr<Term> >::const_iterator ii = entries_.begin(), ie = entries_.end(); ii != ie; ++ii) {
+          Symbol name = compile_context().symbols().intern(ii->first);
+          entries[name] = ii->second;
+          index.put(name, ii->second);
+        }
+      }
+
+      NameMapType entries;
+      IndexType index;
+      TreePtr<EvaluateContext> next;
+
+      template<typename Visitor>
+      static void visit(Visitor& v) {
+        visit_base<EvaluateContext>(v);
+        v("entries", &EvaluateContextPersistent::entries)
+        ("next", &EvaluateContextPersistent::next);
+      }
+
+      static LookupResult<TreePtr<Term> > lookup_impl(const EvaluateContextPersistent& self, const Symbol& name, const SourceLocation& location, const TreePtr<EvaluateContext>& evaluate_context) {
+        if (const TreePtr<Term> *value = self.index.lookup(name)) {
+          return lookup_result_match(*value);
+        } else if (self.next) {
+          return self.next->lookup(name, location, evaluate_context);
+        } else {
+          return lookup_result_none;
+        }
+      }
+
+      static void overload_list_impl(const EvaluateContextPersistent& self, const TreePtr<OverloadType>& overload_type,
+                                     PSI_STD::vector<TreePtr<OverloadValue> >& overload_list) {
+        if (self.next)
+          self.next->overload_list(overload_type, overload_list);
+      }
+    };
+
+    const EvaluateContextVtable EvaluateContextPersistent::vtable =
+    PSI_COMPILER_EVALUATE_CONTEXT(EvaluateContextPersistent, "psi.compiler.EvaluateContextPersistent", EvaluateContext);
+
+    /**
+     * \brief Create an evaluation context which adds names to an existing scope.
+     *
+     * Intended for scopes which grow a few names at a time, such as the
+     * interactive interpreter's. When \c previous was itself created by this
+     * function, names are not looked up through the chain of earlier scopes
+     * but in a single index shared with \c previous.
+     */
+    TreePtr<EvaluateContext> evaluate_context_extend(const TreePtr<Module>& module, const SourceLocation& location, const PSI_STD::map<String, TreePtr<Term> >& entries, const TreePtr<EvaluateContext>& previous) {
+      return TreePtr<EvaluateContext>(::new EvaluateContextPersistent(module, location, entries, previous));
+    }
+
     class EvaluateContextModule : public EvaluateContext {
     public:
       static const EvaluateContextVtable vtable;
@@ -427,7 +637,7 @@ namespace Psi {
         v("next", &EvaluateContextModule::next);
       }
 
-      static LookupResult<TreePtr<Term> > lookup_impl(const EvaluateContextModule& self, const String& name, const SourceLocation& location, const TreePtr<EvaluateContext>& evaluate_context) {
+      static LookupResult<TreePtr<Term> > lookup_impl(const EvaluateContextModule& self, const Symbol& name, const SourceLocation& location, const TreePtr<EvaluateContext>& evaluate_context) {
         return self.next->lookup(name, location, evaluate_context);
       }
       
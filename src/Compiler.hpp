@@ -18,12 +18,14 @@
 #include "Array.hpp"
 #include "ErrorContext.hpp"
 #include "PropertyValue.hpp"
+#include "Symbol.hpp"
 
 namespace Psi {
   namespace Parser {
     struct Expression;
     struct Statement;
     struct TokenExpression;
+    class ParseCache;
   }
   
   namespace Tvm {
@@ -39,6 +41,7 @@ namespace Psi {
     class Type;
     class Macro;
     class EvaluateContext;
+    class OverloadLookupCache;
     
     /// \brief Type passed to macros during term evaluation
     struct MacroTermArgument {typedef TreePtr<Term> EvaluateResultType;};
@@ -278,7 +281,7 @@ namespace Psi {
      */
     struct EvaluateContextVtable {
       TreeVtable base;
-      void (*lookup) (LookupResult<TreePtr<Term> >*, const EvaluateContext*, const String*, const SourceLocation*, const TreePtr<EvaluateContext>*);
+      void (*lookup) (LookupResult<TreePtr<Term> >*, const EvaluateContext*, const Symbol*, const SourceLocation*, const TreePtr<EvaluateContext>*);
       void (*overload_list) (const EvaluateContext*, const OverloadType*, PSI_STD::vector<TreePtr<OverloadValue> >*);
     };
 
@@ -294,15 +297,19 @@ namespace Psi {
       m_module(module) {
       }
 
-      LookupResult<TreePtr<Term> > lookup(const String& name, const SourceLocation& location, const TreePtr<EvaluateContext>& evaluate_context) const {
-        ResultStorage<LookupResult<TreePtr<Term> > > result;
-        derived_vptr(this)->lookup(result.ptr(), this, &name, &location, &evaluate_context);
-        return result.done();
-      }
+      /**
+       * \brief Look up a name.
+       * 
+       * Every name defined in a scope is interned in the context's
+       * SymbolTable, so a null symbol is never found.
+       */
+      LookupResult<TreePtr<Term> > lookup(const Symbol& name, const SourceLocation& location, const TreePtr<EvaluateContext>& evaluate_context) const;
 
-      LookupResult<TreePtr<Term> > lookup(const String& name, const SourceLocation& location) const {
+      LookupResult<TreePtr<Term> > lookup(const Symbol& name, const SourceLocation& location) const {
         return lookup(name, location, tree_from(this));
       }
+
+      LookupResult<TreePtr<Term> > lookup(const String& name, const SourceLocation& location) const;
       
       /// \brief Get all overloads of a certain type.
       void overload_list(const TreePtr<OverloadType>& overload_type, PSI_STD::vector<TreePtr<OverloadValue> >& overload_list) const {
@@ -319,7 +326,7 @@ namespace Psi {
      */
     template<typename Derived, typename Impl=Derived>
     struct EvaluateContextWrapper : NonConstructible {
-      static void lookup(LookupResult<TreePtr<Term> > *result, const EvaluateContext *self, const String *name, const SourceLocation *location, const TreePtr<EvaluateContext>* evaluate_context) {
+      static void lookup(LookupResult<TreePtr<Term> > *result, const EvaluateContext *self, const Symbol *name, const SourceLocation *location, const TreePtr<EvaluateContext>* evaluate_context) {
         new (result) LookupResult<TreePtr<Term> >(Impl::lookup_impl(*static_cast<const Derived*>(self), *name, *location, *evaluate_context));
       }
       
@@ -409,11 +416,12 @@ namespace Psi {
       friend class Functional;
       friend class RunningTreeCallback;
       struct ObjectDisposer;
+      struct GCAccessor;
 
       CompileErrorContext *m_error_context;
       RunningTreeCallback *m_running_completion_stack;
 
-      typedef boost::intrusive::list<Object, boost::intrusive::constant_time_size<false> > GCListType;
+      typedef boost::intrusive::list<Object> GCListType;
       GCListType m_gc_list;
 
       struct FunctionalTermHasher {std::size_t operator () (const Functional& f) const {return f.m_hash;}};
@@ -429,6 +437,10 @@ namespace Psi {
       SourceLocation m_root_location;
       BuiltinTypes m_builtins;
       boost::shared_ptr<TvmJit> m_jit;
+      UniquePtr<Parser::ParseCache> m_parse_cache;
+      UniquePtr<OverloadLookupCache> m_overload_cache;
+      SymbolTable m_symbols;
+      std::size_t m_evaluate_context_lookups;
 
       TreePtr<Functional> get_functional_ptr(const Functional& f, const SourceLocation& location);
       
@@ -466,6 +478,10 @@ namespace Psi {
       void* jit_compile(const TreePtr<Global>& global);
       void jit_compile_many(const PSI_STD::vector<TreePtr<Global> >& globals);
 
+      /// \brief Get the number of objects owned by this context.
+      std::size_t object_count() const {return m_gc_list.size();}
+      std::size_t collect_garbage();
+
       template<typename T>
       TreePtr<T> get_functional(const T& t, const SourceLocation& location) {
         return treeptr_cast<T>(get_functional_ptr(t, location));
@@ -473,6 +489,18 @@ namespace Psi {
       
       /// \brief Get the error reporting context
       CompileErrorContext& error_context() {return *m_error_context;}
+      /// \brief Get the cache used to parse source text belonging to this context
+      Parser::ParseCache& parse_cache() {return *m_parse_cache;}
+      /// \brief Get the JIT used by this context
+      TvmJit& jit() {return *m_jit;}
+      /// \brief Get the cache of overload_lookup() results in this context
+      OverloadLookupCache& overload_cache() {return *m_overload_cache;}
+      /// \brief Get the table of identifiers used in this context
+      SymbolTable& symbols() {return m_symbols;}
+      /// \brief Count one evaluation context searched by EvaluateContext::lookup
+      void count_evaluate_context_lookup() {++m_evaluate_context_lookups;}
+      /// \brief Get the number of evaluation contexts searched by name lookups in this context
+      std::size_t evaluate_context_lookups() const {return m_evaluate_context_lookups;}
       
       /// Forwards to CompileErrorContext::error_throw
       PSI_ATTRIBUTE((PSI_NORETURN)) void error_throw(const SourceLocation& loc, const ErrorMessage& message, unsigned flags=0) {error_context().error_throw(loc, message, flags);}
@@ -508,6 +536,7 @@ namespace Psi {
     PSI_COMPILER_EXPORT TreePtr<EvaluateContext> evaluate_context_dictionary(const TreePtr<Module>&, const SourceLocation&, const std::map<String, TreePtr<Term> >&, const TreePtr<EvaluateContext>&);
     PSI_COMPILER_EXPORT TreePtr<EvaluateContext> evaluate_context_dictionary(const TreePtr<Module>&, const SourceLocation&, const std::map<String, TreePtr<Term> >&);
     PSI_COMPILER_EXPORT TreePtr<EvaluateContext> evaluate_context_dictionary(const SourceLocation&, const std::map<String, TreePtr<Term> >&, const TreePtr<EvaluateContext>&);
+    PSI_COMPILER_EXPORT TreePtr<EvaluateContext> evaluate_context_extend(const TreePtr<Module>&, const SourceLocation&, const PSI_STD::map<String, TreePtr<Term> >&, const TreePtr<EvaluateContext>&);
     PSI_COMPILER_EXPORT TreePtr<EvaluateContext> evaluate_context_root(const TreePtr<Module>& module);
 
     PSI_COMPILER_EXPORT TreePtr<Term> compile_term(const SharedPtr<Parser::Expression>&, const TreePtr<EvaluateContext>&, const LogicalSourceLocationPtr&);
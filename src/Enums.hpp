@@ -26,6 +26,17 @@ namespace Psi {
     
     PSI_VISIT_SIMPLE(ParameterMode);
     
+    /**
+     * \brief Promises a function makes about how it uses a reference parameter.
+     * 
+     * These are not checked; they are passed on to the code generator.
+     */
+    enum ParameterFlags {
+      parameter_flag_noalias=0x1, ///< No other reference available to the function refers to the same object
+      parameter_flag_nocapture=0x2, ///< The reference is not kept after the function returns
+      parameter_flag_readonly=0x4 ///< The object is not modified through this reference
+    };
+    
     /**
      * \brief Storage modes for function return values and jump parameters.
      *
@@ -81,6 +92,17 @@ namespace Psi {
     
     PSI_VISIT_SIMPLE(StatementMode);
     
+    /**
+     * \brief Expected outcome of a conditional.
+     */
+    PSI_SMALL_ENUM(BranchHint) {
+      branch_hint_none, ///< Nothing is known
+      branch_hint_likely, ///< Condition is usually true
+      branch_hint_unlikely ///< Condition is usually false
+    };
+    
+    PSI_VISIT_SIMPLE(BranchHint);
+    
     /**
      * \brief Indices of members in the Movable interface
      */
@@ -73,17 +73,17 @@ namespace Psi {
         const Parser::TokenExpression& token_expression = checked_cast<Parser::TokenExpression&>(*expression);
 
         if (token_expression.token_type == Parser::token_identifier) {
-          String name = token_expression.text.str();
-          LookupResult<TreePtr<Term> > id = evaluate_context->lookup(name, location);
+          const Parser::Text& name = token_expression.text;
+          LookupResult<TreePtr<Term> > id = evaluate_context->lookup(compile_context.symbols().find(name.begin, name.end), location);
 
           switch (id.type()) {
-          case lookup_result_type_none: compile_context.error_throw(location, boost::format("Name not found: %s") % name);
-          case lookup_result_type_conflict: compile_context.error_throw(location, boost::format("Conflict on lookup of: %s") % name);
+          case lookup_result_type_none: compile_context.error_throw(location, boost::format("Name not found: %s") % name.str());
+          case lookup_result_type_conflict: compile_context.error_throw(location, boost::format("Conflict on lookup of: %s") % name.str());
           default: break;
           }
 
           if (!id.value())
-            compile_context.error_throw(location, boost::format("Successful lookup of '%s' returned NULL value") % name, CompileError::error_internal);
+            compile_context.error_throw(location, boost::format("Successful lookup of '%s' returned NULL value") % name.str(), CompileError::error_internal);
 
           expression_macro(evaluate_context, id.value(), mode_tag, location)->cast_raw(result, id.value(), evaluate_context, arg, location);
         } else {
@@ -205,7 +205,7 @@ namespace Psi {
       typedef DelayedValue<TreePtr<Statement>, TreePtr<EvaluateContext> > StatementValueType;
       TreePtr<EvaluateContext> m_next;
       PSI_STD::vector<StatementValueType> m_statements;
-      typedef PSI_STD::map<String, std::size_t> NameMapType;
+      typedef boost::unordered_map<Symbol, std::size_t> NameMapType;
       NameMapType m_names;
       bool m_has_last;
       
@@ -227,7 +227,7 @@ namespace Psi {
             LogicalSourceLocationPtr logical_location;
             if (named_expr.name) {
               String expr_name(named_expr.name->begin, named_expr.name->end);
-              m_names.insert(std::make_pair(expr_name, index));
+              m_names.insert(std::make_pair(compile_context().symbols().intern(expr_name), index));
               logical_location = location.logical->new_child(expr_name);
             } else {
               logical_location = location.logical;
@@ -260,7 +260,7 @@ namespace Psi {
         ("next", &BlockContext::m_next);
       }
 
-      static LookupResult<TreePtr<Term> > lookup_impl(const BlockContext& self, const String& name, const SourceLocation& location, const TreePtr<EvaluateContext>& evaluate_context) {
+      static LookupResult<TreePtr<Term> > lookup_impl(const BlockContext& self, const Symbol& name, const SourceLocation& location, const TreePtr<EvaluateContext>& evaluate_context) {
         NameMapType::const_iterator it = self.m_names.find(name);
         if (it != self.m_names.end()) {
           return lookup_result_match(self.m_statements[it->second].get(self, &BlockContext::get_ptr));
@@ -304,7 +304,7 @@ namespace Psi {
     TreePtr<Term> compile_from_bracket(const SharedPtr<Parser::TokenExpression>& expr,
                                        const TreePtr<EvaluateContext>& evaluate_context,
                                        const SourceLocation& location) {
-      return compile_block(Parser::parse_statement_list(evaluate_context->compile_context().error_context(), location.logical, expr->text),
+      return compile_block(evaluate_context->compile_context().parse_cache().statement_list(location.logical, expr->text),
                            evaluate_context, location);
     }
 
@@ -338,7 +338,11 @@ namespace Psi {
     class NamespaceContext : public EvaluateContext {
       typedef DelayedValue<TreePtr<Term>, TreePtr<EvaluateContext> > EntryType;
       typedef PSI_STD::map<String, EntryType> NameMapType;
+      /// Entries ordered by name, so that completion order is deterministic
       NameMapType m_entries;
+      /// Index of m_entries used for lookup
+      typedef boost::unordered_map<Symbol, const EntryType*> SymbolMapType;
+      SymbolMapType m_symbols;
       TreePtr<EvaluateContext> m_next;
       
       TreePtr<EvaluateContext> get_ptr() const {return tree_from(this);}
@@ -363,6 +367,9 @@ namespace Psi {
                                                                  NamespaceEntry(named_expr.expression, (StatementMode)named_expr.mode, entry_location))));
           }
         }
+        
+        for (NameMapType::const_iterator ii = m_entries.begin(), ie = m_entries.end(); ii != ie; ++ii)
+          m_symbols.insert(std::make_pair(compile_context().symbols().intern(ii->first), &ii->second));
       }
       
       Namespace::NameMapType names() const {
@@ -379,10 +386,10 @@ namespace Psi {
         ("next", &NamespaceContext::m_next);
       }
 
-      static LookupResult<TreePtr<Term> > lookup_impl(const NamespaceContext& self, const String& name, const SourceLocation& location, const TreePtr<EvaluateContext>& evaluate_context) {
-        NameMapType::const_iterator it = self.m_entries.find(name);
-        if (it != self.m_entries.end()) {
-          return lookup_result_match(it->second.get(self, &NamespaceContext::get_ptr));
+      static LookupResult<TreePtr<Term> > lookup_impl(const NamespaceContext& self, const Symbol& name, const SourceLocation& location, const TreePtr<EvaluateContext>& evaluate_context) {
+        SymbolMapType::const_iterator it = self.m_symbols.find(name);
+        if (it != self.m_symbols.end()) {
+          return lookup_result_match(it->second->get(self, &NamespaceContext::get_ptr));
         } else if (self.m_next) {
           return self.m_next->lookup(name, location, evaluate_context);
         } else {
@@ -517,7 +524,7 @@ namespace Psi {
     
     class ScriptContext : public EvaluateContext {
       typedef PSI_STD::vector<ScriptEntryDelayed> EntryList;
-      typedef PSI_STD::map<String, std::size_t> NameMapType;
+      typedef boost::unordered_map<Symbol, std::size_t> NameMapType;
       EntryList m_entries;
       NameMapType m_named_entries;
       TreePtr<EvaluateContext> m_next;
@@ -543,7 +550,7 @@ namespace Psi {
               PSI_ASSERT(named_expr.mode != statement_mode_destroy);
               String s = named_expr.name->str();
               logical_location = location.logical->new_child(s);
-              m_named_entries.insert(std::make_pair(s, m_entries.size()));
+              m_named_entries.insert(std::make_pair(compile_context().symbols().intern(s), m_entries.size()));
             }
             SourceLocation entry_location(named_expr.location, logical_location);
             
@@ -572,7 +579,7 @@ namespace Psi {
         
         PSI_STD::map<String, TreePtr<Term> > result;
         for (NameMapType::const_iterator ii = m_named_entries.begin(), ie = m_named_entries.end(); ii != ie; ++ii)
-          result.insert(std::make_pair(ii->first, m_entries[ii->second].get_checked().value));
+          result.insert(std::make_pair(ii->first.name(), m_entries[ii->second].get_checked().value));
         return result;
       }
 
@@ -583,7 +590,7 @@ namespace Psi {
         ("next", &ScriptContext::m_next);
       }
 
-      static LookupResult<TreePtr<Term> > lookup_impl(const ScriptContext& self, const String& name, const SourceLocation& location, const TreePtr<EvaluateContext>& evaluate_context) {
+      static LookupResult<TreePtr<Term> > lookup_impl(const ScriptContext& self, const Symbol& name, const SourceLocation& location, const TreePtr<EvaluateContext>& evaluate_context) {
         NameMapType::const_iterator it = self.m_named_entries.find(name);
         if (it != self.m_named_entries.end()) {
           return lookup_result_match(self.m_entries[it->second].get(self, &ScriptContext::get_ptr).value);
@@ -71,7 +71,7 @@ namespace Psi {
       if (!(function_arguments_expr = expression_as_token_type(function_arguments, Parser::token_bracket)))
         compile_context.error_throw(location, "Function arguments not enclosed in (...)");
       
-      Parser::FunctionArgumentDeclarations parsed_arguments = Parser::parse_function_argument_declarations(compile_context.error_context(), location.logical, function_arguments_expr->text);
+      Parser::FunctionArgumentDeclarations parsed_arguments = compile_context.parse_cache().function_argument_declarations(location.logical, function_arguments_expr->text);
       FunctionArgumentInfo result;
       std::map<String, TreePtr<Term> > argument_map;
       
@@ -206,7 +206,7 @@ namespace Psi {
       if (!(parameters_expr = Parser::expression_as_token_type(arguments[0], Parser::token_bracket)))
         compile_context.error_throw(location, "Parameters argument to call is not a (...)");
 
-      PSI_STD::vector<SharedPtr<Parser::Expression> > parsed_arguments = Parser::parse_positional_list(compile_context.error_context(), location.logical, parameters_expr->text);
+      PSI_STD::vector<SharedPtr<Parser::Expression> > parsed_arguments = compile_context.parse_cache().positional_list(location.logical, parameters_expr->text);
       
       PSI_STD::vector<TreePtr<Term> > result;
       for (PSI_STD::vector<SharedPtr<Parser::Expression> >::const_iterator ii = parsed_arguments.begin(), ie = parsed_arguments.end(); ii != ie; ++ii)
@@ -394,7 +394,7 @@ namespace Psi {
         if (!params_expr || !body_expr)
           self.compile_context().error_throw(location, "Implementation of interface function was not of the form '(...) [...]'");
 
-        PSI_STD::vector<Parser::TokenExpression> parameter_name_exprs = Parser::parse_identifier_list(self.compile_context().error_context(), location.logical, params_expr->text);
+        PSI_STD::vector<Parser::TokenExpression> parameter_name_exprs = self.compile_context().parse_cache().identifier_list(location.logical, params_expr->text);
         PSI_STD::vector<SourceLocation> parameter_locations;
         for (PSI_STD::vector<Parser::TokenExpression>::const_iterator ii = parameter_name_exprs.begin(), ie = parameter_name_exprs.end(); ii != ie; ++ii)
           parameter_locations.push_back(SourceLocation(ii->location, location.logical->new_child(ii->text.str())));
@@ -3,69 +3,71 @@
 
 #include "Assert.hpp"
 
-namespace Psi {
-  class GCVisitorIncrement {
-  };
-
-  class GCVisitorDecrement {
-  };
+#include <vector>
 
+namespace Psi {
   /**
-   * \brief Garbage collect a set of objects.
+   * \brief Find objects which are only reachable from each other.
+   * 
+   * This uses trial deletion: the references each object holds are
+   * subtracted from the reference counts of their targets, so that an
+   * object with a remaining count is referenced from outside \c objects.
+   * Everything reachable from such an object is live. The remaining
+   * objects are garbage, and are moved from \c objects to \c unreachable.
+   * 
+   * On return all reference counts are as they were on entry. Releasing the
+   * references held by the unreachable objects and destroying them is left
+   * to the caller.
    *
+   * \param objects List of all objects which may be collected.
+   * \param unreachable List which receives unreachable objects. This must be empty.
    * \param accessor Accessor to the objects.
    *
    * This must have the following functions:
    *
    * <dl>
-   * <dt><tt>template&lt;typename Visitor&gt; void visit(T*, Visitor&)</tt></dt><dd></dd>
-   * <dt><tt>T*& next(T*)</tt></dt><dd>Get the next object in the list</dd>
-   * <dt><tt>T*& prev(T*)</tt></dt><dd>Get the previous object in the list</dd>
-   * <dt><tt>void destroy(T*)</tt></dt><dd>Destroy an object. This should not release any references held by the object.</dd></dt>
+   * <dt><tt>std::size_t refcount(T&)</tt></dt><dd>Get the reference count of an object.</dd>
+   * <dt><tt>void decrement(T&)</tt></dt><dd>Decrement the reference count of every object referenced by an object.</dd>
+   * <dt><tt>void increment(T&, std::vector<T*> *revived)</tt></dt><dd>Increment the reference count of every object
+   * referenced by an object. If \c revived is not NULL, objects whose reference count was zero are appended to it.</dd>
    * </dl>
    */
-  template<typename T, typename U>
-  T* garbage_collect(T* objects, const U& accessor) {
-    GCVisitorDecrement dec_visitor;
-    for (T *i = objects; i; i = accessor.next(i))
-      accessor.visit(i, dec_visitor);
-
-    T *reachable_list = 0, *unreachable_list = 0;
-    for (T *cur = objects, *next; cur; cur = next) {
-      next = accessor.next(objects);
-      if (accessor.refcount(cur)) {
-        accessor.next(cur) = reachable_list;
-        reachable_list = cur;
-      } else {
-        accessor.next(cur) = unreachable_list;
-        if (unreachable_list)
-          accessor.prev(unreachable_list) = cur;
-        unreachable_list = cur;
-      }
+  template<typename List, typename Accessor>
+  void garbage_collect(List& objects, List& unreachable, Accessor& accessor) {
+    typedef typename List::value_type T;
+    typedef typename List::iterator iterator;
+    
+    PSI_ASSERT(unreachable.empty());
+    
+    for (iterator ii = objects.begin(), ie = objects.end(); ii != ie; ++ii)
+      accessor.decrement(*ii);
+    
+    std::vector<T*> queue;
+    for (iterator ii = objects.begin(), ie = objects.end(); ii != ie; ++ii) {
+      if (accessor.refcount(*ii))
+        queue.push_back(&*ii);
     }
-
-    if (unreachable_list)
-      accessor.prev(unreachable_list) = 0;
-
-    T *result_list = 0;
-    GCVisitorIncrement inc_visitor(&reachable_list);
-    while (reachable_list) {
-      T *ptr = reachable_list;
-      reachable_list = accessor.next(reachable_list);
-      accessor.visit(ptr, inc_visitor);
-
-      accessor.next(ptr) = result_list;
-      if (result_list)
-        accessor.prev(result_list) = ptr;
-      result_list = ptr;
+    
+    // Restore the counts of references held by live objects, which revives
+    // anything they refer to
+    while (!queue.empty()) {
+      T *ptr = queue.back();
+      queue.pop_back();
+      accessor.increment(*ptr, &queue);
     }
-
-    // Increment the reference counts on nodes to be deleted so that the reference counting
-    // mechanism doesn't perform the deletion
-    for (T *cur = unreachable_list, *next; cur; cur = next) {
-      next = accessor.next(cur);
-      accessor.destroy(cur);
+    
+    for (iterator ii = objects.begin(), ie = objects.end(); ii != ie;) {
+      if (accessor.refcount(*ii)) {
+        ++ii;
+      } else {
+        T& obj = *ii;
+        ii = objects.erase(ii);
+        unreachable.push_back(obj);
+      }
     }
+    
+    for (iterator ii = unreachable.begin(), ie = unreachable.end(); ii != ie; ++ii)
+      accessor.increment(*ii, NULL);
   }
 }
 
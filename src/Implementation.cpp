@@ -69,8 +69,10 @@ TreePtr<Term> implementation_function_finish(const ImplementationSetup& impl_set
   for (PSI_STD::vector<TreePtr<Anonymous> >::const_iterator ii = impl_setup.pattern_parameters.begin(), ie = impl_setup.pattern_parameters.end(); ii != ie; ++ii)
     parameter_types.push_back(FunctionParameterType(parameter_mode_phantom, (*ii)->type->parameterize(setup.location, parameters)));
 
-  for (std::size_t ii = 0, ie = setup.parameters.size(); ii != ie; ++ii)
-    parameter_types.push_back(FunctionParameterType(setup.function_type->parameter_types[ii].mode, setup.parameters[ii]->type->parameterize(setup.location, parameters)));
+  for (std::size_t ii = 0, ie = setup.parameters.size(); ii != ie; ++ii) {
+    const FunctionParameterType& interface_type = setup.function_type->parameter_types[ii];
+    parameter_types.push_back(FunctionParameterType(interface_type.mode, setup.parameters[ii]->type->parameterize(setup.location, parameters), interface_type.flags));
+  }
   
   PSI_STD::vector<TreePtr<InterfaceValue> > function_interfaces;
   PSI_STD::vector<TreePtr<Term> > setup_parameters_term(setup.parameters.begin(), setup.parameters.end());
@@ -18,7 +18,7 @@ PatternArguments parse_pattern_arguments(const TreePtr<EvaluateContext>& evaluat
   PatternArguments result;
 
   PSI_STD::vector<SharedPtr<Parser::FunctionArgument> > generic_parameters_parsed =
-    Parser::parse_type_argument_declarations(evaluate_context->compile_context().error_context(), location.logical, text);
+    evaluate_context->compile_context().parse_cache().type_argument_declarations(location.logical, text);
     
   for (PSI_STD::vector<SharedPtr<Parser::FunctionArgument> >::const_iterator ii = generic_parameters_parsed.begin(), ie = generic_parameters_parsed.end(); ii != ie; ++ii) {
     PSI_ASSERT(*ii && (*ii)->type);
@@ -247,7 +247,7 @@ namespace {
         compile_context.error_throw(m_location.relocate(m_parameters_expression->location), "Parameters to an interface implementation should be declared using (...)");
 
       /// \todo Need to figure out how to implicitly include parameters to generic if they are used
-      Parser::ImplementationArgumentDeclaration args = Parser::parse_implementation_arguments(compile_context.error_context(), m_location.logical, parameters_expression->text);
+      Parser::ImplementationArgumentDeclaration args = compile_context.parse_cache().implementation_arguments(m_location.logical, parameters_expression->text);
       PSI_STD::map<String, TreePtr<Term> > names;
       
       for (PSI_STD::vector<SharedPtr<Parser::FunctionArgument> >::const_iterator ii = args.pattern.begin(), ie = args.pattern.end(); ii != ie; ++ii) {
@@ -331,7 +331,7 @@ namespace {
       ImplementationHelper helper(setup.base, m_location);
 
       PSI_STD::vector<TreePtr<Term> > entry_values(m_metadata->entries.size());
-      PSI_STD::vector<SharedPtr<Parser::Statement> > entries = Parser::parse_namespace(compile_context.error_context(), m_location.logical, body_expression->text);
+      PSI_STD::vector<SharedPtr<Parser::Statement> > entries = compile_context.parse_cache().namespace_(m_location.logical, body_expression->text);
       for (PSI_STD::vector<SharedPtr<Parser::Statement> >::const_iterator ii = entries.begin(), ie = entries.end(); ii != ie; ++ii) {
         if (*ii) {
           const Parser::Statement& stmt = **ii;
@@ -550,7 +550,7 @@ namespace {
       const SourceLocation& location = generic->location();
       
       TreePtr<EvaluateContext> member_context = evaluate_context_dictionary(m_evaluate_context->module(), location, m_arguments.names, m_evaluate_context);        
-      PSI_STD::vector<SharedPtr<Parser::Statement> > members = Parser::parse_namespace(compile_context.error_context(), location.logical, m_text);
+      PSI_STD::vector<SharedPtr<Parser::Statement> > members = compile_context.parse_cache().namespace_(location.logical, m_text);
       
       InterfaceMemberArgument member_argument;
       member_argument.generic = generic;
@@ -671,7 +671,7 @@ namespace {
       
       PSI_STD::vector<TreePtr<Implementation> > result;
 
-      PSI_STD::vector<SharedPtr<Parser::Statement> > statements = Parser::parse_statement_list(compile_context.error_context(), interface->location().logical, m_defs->text);
+      PSI_STD::vector<SharedPtr<Parser::Statement> > statements = compile_context.parse_cache().statement_list(interface->location().logical, m_defs->text);
       for (PSI_STD::vector<SharedPtr<Parser::Statement> >::const_iterator ii = statements.begin(), ie = statements.end(); ii != ie; ++ii) {
         if (*ii) {
           const Parser::Statement& stmt = **ii;
@@ -680,6 +680,11 @@ namespace {
           if (stmt.name)
             compile_context.error_throw(location, "Interface implementations should not be named");
           
+          // Number implementations, otherwise their functions all get the same symbol name
+          std::ostringstream index_ss;
+          index_ss << (ii - statements.begin());
+          location = location.named_child(index_ss.str());
+          
           ImplementationDefineResult overloads = compile_expression<ImplementationDefineResult>(stmt.expression, m_evaluate_context, compile_context.builtins().macro_interface_definition_tag, arg, location.logical);
           for (ImplementationDefineResult::const_iterator ji = overloads.begin(), je = overloads.end(); ji != je; ++ji) {
             if (!*ji)
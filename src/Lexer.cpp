@@ -2,7 +2,173 @@
 
 #include <cstring>
 
+/*
+ * Character class scans used by the lexer have SIMD implementations,
+ * selected at compile time: AVX2 if the compiler is targeting it, then
+ * SSE2, then a portable byte-at-a-time loop. Defining PSI_LEXER_SCALAR
+ * forces the portable version.
+ */
+#if !defined(PSI_LEXER_SCALAR) && defined(__GNUC__)
+#if defined(__AVX2__)
+#define PSI_LEXER_AVX2 1
+#endif
+#if defined(__SSE2__)
+#define PSI_LEXER_SSE2 1
+#include <emmintrin.h>
+#endif
+#if PSI_LEXER_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
 namespace Psi {
+namespace {
+#if PSI_LEXER_SSE2
+  /// \brief Bytes of \c v in the range [\c lo,\c hi]. Only valid for ASCII bounds.
+  inline __m128i sse2_in_range(__m128i v, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), v));
+  }
+  
+  inline __m128i sse2_eq(__m128i v, char c) {
+    return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+  }
+#endif
+  
+#if PSI_LEXER_AVX2
+  inline __m256i avx2_in_range(__m256i v, char lo, char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+  }
+  
+  inline __m256i avx2_eq(__m256i v, char c) {
+    return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+  }
+#endif
+
+  /**
+   * Whitespace accepted by LexerPosition::skip_whitespace.
+   * 
+   * This includes NUL, for compatibility with the original strchr() based test.
+   */
+  struct WhitespaceClass {
+    static bool scalar(char c) {
+      return (c == ' ') || (c == '\0') || ((c >= '\t') && (c <= '\v')) || (c == '\r');
+    }
+    
+#if PSI_LEXER_SSE2
+    static __m128i sse2(__m128i v) {
+      return _mm_or_si128(_mm_or_si128(sse2_eq(v, ' '), sse2_eq(v, '\0')),
+                          _mm_or_si128(sse2_in_range(v, '\t', '\v'), sse2_eq(v, '\r')));
+    }
+#endif
+    
+#if PSI_LEXER_AVX2
+    static __m256i avx2(__m256i v) {
+      return _mm256_or_si256(_mm256_or_si256(avx2_eq(v, ' '), avx2_eq(v, '\0')),
+                             _mm256_or_si256(avx2_in_range(v, '\t', '\v'), avx2_eq(v, '\r')));
+    }
+#endif
+  };
+  
+  /// Alphanumeric characters, plus underscore if \c underscore is set
+  template<bool underscore>
+  struct AlnumClass {
+    static bool scalar(char c) {
+      return c_isalnum(c) || (underscore && (c == '_'));
+    }
+    
+#if PSI_LEXER_SSE2
+    static __m128i sse2(__m128i v) {
+      // Setting bit 5 maps upper case letters onto lower case ones
+      __m128i r = _mm_or_si128(sse2_in_range(v, '0', '9'), sse2_in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z'));
+      return underscore ? _mm_or_si128(r, sse2_eq(v, '_')) : r;
+    }
+#endif
+    
+#if PSI_LEXER_AVX2
+    static __m256i avx2(__m256i v) {
+      __m256i r = _mm256_or_si256(avx2_in_range(v, '0', '9'), avx2_in_range(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z'));
+      return underscore ? _mm256_or_si256(r, avx2_eq(v, '_')) : r;
+    }
+#endif
+  };
+  
+  /// Characters which are significant when scanning a bracket group
+  struct BracketClass {
+    static bool scalar(char c) {
+      switch (c) {
+      case '\\': case '(': case ')': case '[': case ']': case '{': case '}': return true;
+      default: return false;
+      }
+    }
+    
+#if PSI_LEXER_SSE2
+    static __m128i sse2(__m128i v) {
+      return _mm_or_si128(_mm_or_si128(_mm_or_si128(sse2_eq(v, '\\'), sse2_eq(v, '(')), _mm_or_si128(sse2_eq(v, ')'), sse2_eq(v, '['))),
+                          _mm_or_si128(_mm_or_si128(sse2_eq(v, ']'), sse2_eq(v, '{')), sse2_eq(v, '}')));
+    }
+#endif
+    
+#if PSI_LEXER_AVX2
+    static __m256i avx2(__m256i v) {
+      return _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(avx2_eq(v, '\\'), avx2_eq(v, '(')), _mm256_or_si256(avx2_eq(v, ')'), avx2_eq(v, '['))),
+                             _mm256_or_si256(_mm256_or_si256(avx2_eq(v, ']'), avx2_eq(v, '{')), avx2_eq(v, '}')));
+    }
+#endif
+  };
+  
+  /**
+   * \brief Find the first character in [\c p,\c end) for which membership of \c Class is \c match.
+   * 
+   * \return \c end if there is no such character.
+   */
+  template<typename Class, bool match>
+  const char* scan(const char *p, const char *end) {
+#if PSI_LEXER_AVX2
+    while (end - p >= 32) {
+      unsigned mask = _mm256_movemask_epi8(Class::avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+      if (!match)
+        mask = ~mask;
+      if (mask)
+        return p + __builtin_ctz(mask);
+      p += 32;
+    }
+#endif
+#if PSI_LEXER_SSE2
+    while (end - p >= 16) {
+      unsigned mask = _mm_movemask_epi8(Class::sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+      if (!match)
+        mask = ~mask & 0xFFFF;
+      if (mask)
+        return p + __builtin_ctz(mask);
+      p += 16;
+    }
+#endif
+    for (; p != end; ++p) {
+      if (Class::scalar(*p) == match)
+        break;
+    }
+    return p;
+  }
+  
+  /// \brief Count newline characters in [\c p,\c end).
+  std::size_t count_newlines(const char *p, const char *end) {
+    std::size_t count = 0;
+#if PSI_LEXER_AVX2
+    for (; end - p >= 32; p += 32)
+      count += __builtin_popcount(_mm256_movemask_epi8(avx2_eq(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), '\n')));
+#endif
+#if PSI_LEXER_SSE2
+    for (; end - p >= 16; p += 16)
+      count += __builtin_popcount(_mm_movemask_epi8(sse2_eq(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), '\n')));
+#endif
+    for (; p != end; ++p) {
+      if (*p == '\n')
+        ++count;
+    }
+    return count;
+  }
+}
+
 LexerPosition::LexerPosition(CompileErrorContext& error_context, const SourceLocation& loc, const char* start, const char* end)
 : m_error_context(&error_context), m_error_location(loc.logical),
 m_location(loc.physical), m_current(start), m_end(end), m_token_start(start) {
@@ -40,10 +206,48 @@ void LexerPosition::begin() {
   m_token_start = m_current;
 }
 
-/// \brief Set the start of the current token to the current position
+/**
+ * \brief Accept all characters up to \c ptr.
+ * 
+ * Line and column numbers are updated by counting newlines in bulk,
+ * which is considerably cheaper than calling accept() repeatedly.
+ */
+void LexerPosition::accept_to(const char *ptr) {
+  PSI_ASSERT((m_current <= ptr) && (ptr <= m_end));
+  if (std::size_t newlines = count_newlines(m_current, ptr)) {
+    const char *line_start = ptr;
+    while (line_start[-1] != '\n')
+      --line_start;
+    m_location.last_line += newlines;
+    m_location.last_column = 1 + (ptr - line_start);
+  } else {
+    m_location.last_column += ptr - m_current;
+  }
+  m_current = ptr;
+}
+
+/// \brief Skip whitespace and set the start of the current token to the following position
 void LexerPosition::skip_whitespace() {
-  while (!end() && std::strchr(" \t\r\n\v", current()))
-    accept();
+  accept_to(scan<WhitespaceClass, false>(m_current, m_end));
   begin();
 }
+
+/// \brief Accept a run of alphanumeric characters and underscores.
+void LexerPosition::accept_identifier() {
+  accept_to(scan<AlnumClass<true>, false>(m_current, m_end));
+}
+
+/// \brief Accept a run of alphanumeric characters.
+void LexerPosition::accept_alnum() {
+  accept_to(scan<AlnumClass<false>, false>(m_current, m_end));
+}
+
+/**
+ * \brief Accept characters up to the next one which is significant to bracket matching.
+ * 
+ * That is, a bracket, brace, or backslash.
+ */
+void LexerPosition::accept_bracket_text() {
+  accept_to(scan<BracketClass, true>(m_current, m_end));
+}
 }
@@ -24,7 +24,11 @@ public:
   /// \brief Get the position of the token currently being generated
   const PhysicalSourceLocation& location() {return m_location;}
   
+  void accept_to(const char *ptr);
   void skip_whitespace();
+  void accept_identifier();
+  void accept_alnum();
+  void accept_bracket_text();
   
   /// \brief Get a pointer to the start of the current token
   const char *token_start() {return m_token_start;}
@@ -8,7 +8,7 @@
 
 namespace Psi {
   namespace Compiler {
-    const SIVtable Macro::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.Macro", Tree);
+    const SIVtable Macro::vtable = PSI_COMPILER_TREE_ABSTRACT(Macro, "psi.compiler.Macro", Tree);
     
     void Macro::evaluate_impl(const void *PSI_UNUSED(result),
                               const Macro& self,
@@ -49,7 +49,7 @@ namespace Psi {
       err.end_throw();
     }
     
-    const SIVtable MacroMemberCallback::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.MacroMemberCallback", Tree);
+    const SIVtable MacroMemberCallback::vtable = PSI_COMPILER_TREE_ABSTRACT(MacroMemberCallback, "psi.compiler.MacroMemberCallback", Tree);
     
     class DefaultMacro : public Macro {
     public:
@@ -282,7 +282,7 @@ namespace Psi {
         if (!(name = Parser::expression_as_token_type(parameters[0], Parser::token_bracket)))
           self.compile_context().error_throw(location, "Parameter to pointer macro is not a (...)");
         
-        SharedPtr<Parser::Expression> target_expr = Parser::parse_expression(self.compile_context().error_context(), location.logical, name->text);
+        SharedPtr<Parser::Expression> target_expr = self.compile_context().parse_cache().expression(location.logical, name->text);
         TreePtr<Term> target_type = compile_term(target_expr, evaluate_context, location.logical);
         
         return TermBuilder::pointer(target_type, location);
@@ -436,7 +436,7 @@ namespace Psi {
         if (!(name = Parser::expression_as_token_type(parameters[0], Parser::token_square_bracket)))
           self.compile_context().error_throw(location, "Parameter to namespace macro is not a [...]");
         
-        PSI_STD::vector<SharedPtr<Parser::Statement> > statements = Parser::parse_namespace(self.compile_context().error_context(), location.logical, name->text);
+        PSI_STD::vector<SharedPtr<Parser::Statement> > statements = self.compile_context().parse_cache().namespace_(location.logical, name->text);
 
         TreePtr<Namespace> ns = compile_namespace(statements, evaluate_context, location);
 
@@ -477,7 +477,7 @@ namespace Psi {
         if (!(data = Parser::expression_as_token_type(parameters[1], Parser::token_brace)))
           self.compile_context().error_throw(location, "Second parameter to builtin number constant macro is not a {...}");
         
-        TreePtr<Term> type = compile_term(Parser::parse_expression(self.compile_context().error_context(), location.logical, type_expr->text), evaluate_context, location.logical);
+        TreePtr<Term> type = compile_term(self.compile_context().parse_cache().expression(location.logical, type_expr->text), evaluate_context, location.logical);
         TreePtr<NumberType> number_type = term_unwrap_dyn_cast<NumberType>(type);
         if (!number_type)
           self.compile_context().error_throw(location, "First parameter to builtin number constant macro is not a primitive numerical type");
@@ -573,7 +573,7 @@ namespace Psi {
 
       std::map<String, TreePtr<Term> > parameter_dict;
       
-      PSI_STD::vector<Parser::TokenExpression> parameter_names = Parser::parse_identifier_list(compile_context.error_context(), location.logical, parameter_names_cast->text);
+      PSI_STD::vector<Parser::TokenExpression> parameter_names = compile_context.parse_cache().identifier_list(location.logical, parameter_names_cast->text);
       switch (parameter_names.size()) {
       default: compile_context.error_throw(location, "Expected zero, one or two argument names specified for library macro");
       case 2: parameter_dict.insert(std::make_pair(parameter_names[1].text.str(), TreePtr<Term>()));
@@ -618,7 +618,7 @@ namespace Psi {
         if (!(type_text = Parser::expression_as_token_type(parameters[0], Parser::token_bracket)))
           self.compile_context().error_throw(location, "First argument to library symbol macro is not a (...)");
         
-        SharedPtr<Parser::Expression> type_expr = Parser::parse_expression(self.compile_context().error_context(), location.logical, type_text->text);
+        SharedPtr<Parser::Expression> type_expr = self.compile_context().parse_cache().expression(location.logical, type_text->text);
         TreePtr<Term> type = compile_term(type_expr, evaluate_context, location.logical);
         TreePtr<Library> library = metadata_lookup_as<Library>(self.compile_context().builtins().library_tag, evaluate_context, value, location);
 
@@ -845,7 +845,7 @@ namespace Psi {
           self.compile_context().error_throw(location, "Second parameter to macro macro is not a [...]");
 
         PSI_STD::vector<String> arg_names;
-        PSI_STD::vector<Parser::TokenExpression> arg_tokens = Parser::parse_identifier_list(self.compile_context().error_context(), location.logical, args->text);
+        PSI_STD::vector<Parser::TokenExpression> arg_tokens = self.compile_context().parse_cache().identifier_list(location.logical, args->text);
         for (PSI_STD::vector<Parser::TokenExpression>::const_iterator ii = arg_tokens.begin(), ie = arg_tokens.end(); ii != ie; ++ii) {
           if (ii->token_type != Parser::token_identifier)
             self.compile_context().error_throw(location.relocate(ii->location), "Arguments to macro define macro must be identifiers");
@@ -18,11 +18,13 @@
 
 #include <boost/format.hpp>
 #include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include "Parser.hpp"
 #include "Compiler.hpp"
 #include "Tree.hpp"
 #include "TermBuilder.hpp"
+#include "TvmLowering.hpp"
 #include "Platform/Platform.hpp"
 
 #include "Configuration.hpp"
@@ -34,7 +36,10 @@ namespace {
     opt_key_config,
     opt_key_set,
     opt_key_nodefault,
-    opt_key_testprompt
+    opt_key_testprompt,
+    opt_key_server,
+    opt_key_client,
+    opt_key_stats
   };
   
   struct OptionSet {
@@ -43,11 +48,15 @@ namespace {
     boost::optional<std::string> filename;
     std::vector<std::string> arguments;
     bool test_prompt;
+    bool stats;
+    boost::optional<std::string> server_socket;
+    boost::optional<std::string> client_socket;
   };
   
   bool parse_options(int argc, const char **argv, OptionSet& options) {
     options.program_name = Psi::find_program_name(argv[0]);
     options.test_prompt = false;
+    options.stats = false;
     
     std::string help_extra = " [file] [args] ...";
     Psi::OptionsDescription desc;
@@ -58,6 +67,11 @@ namespace {
     desc.opts.push_back(Psi::option_description(opt_key_set, true, 's', "set", "Set a configuration property"));
     desc.opts.push_back(Psi::option_description(opt_key_nodefault, false, '\0', "nodefault", "Disable loading of default configuration files"));
     desc.opts.push_back(Psi::option_description(opt_key_testprompt, false, '\0', "testprompt", "Disable interpreter prompt and print a null character to separate error logs. Used for automated testing."));
+    desc.opts.push_back(Psi::option_description(opt_key_stats, false, '\0', "stats", "Print a histogram of time taken per input line, and JIT, cache, garbage collection and name lookup statistics, when the interpreter exits"));
+#if PSI_WITH_SERVER
+    desc.opts.push_back(Psi::option_description(opt_key_server, true, '\0', "server", "Listen on a local socket and run files sent by clients"));
+    desc.opts.push_back(Psi::option_description(opt_key_client, true, '\0', "client", "Run a file using the server listening on a local socket"));
+#endif
     
     bool read_default = true;
     std::vector<std::string> config_files;
@@ -101,6 +115,18 @@ namespace {
         options.test_prompt = true;
         break;
         
+      case opt_key_stats:
+        options.stats = true;
+        break;
+        
+      case opt_key_server:
+        options.server_socket = val.value;
+        break;
+        
+      case opt_key_client:
+        options.client_socket = val.value;
+        break;
+        
       default: PSI_FAIL("Unexpected option key");
       }
     }
@@ -138,43 +164,20 @@ Psi::Parser::Text url_location(const Psi::String& url, const Psi::SharedPtrHandl
 }
 
 /**
- * Run a file.
+ * Compile a file as the contents of a module and call its \c main function.
+ * 
+ * \param entry_name Symbol name to use for the generated function which calls \c main.
+ * \param isolate Call \c main in a child process, so that it cannot crash or
+ * otherwise change this process. Only supported when built with the server.
+ * 
+ * \return Whether compilation succeeded and, if \c isolate is set, \c main
+ * returned normally.
  */
-int psi_interpreter_run_file(const OptionSet& opts) {
-  Psi::SharedPtr<std::vector<char> > source_text(new std::vector<char>);
-  
-  std::filebuf file_input_buffer;
-  std::streambuf *input_buffer_ptr;
-  if (*opts.filename == "-") {
-    // Read from standard input
-    input_buffer_ptr = std::cin.rdbuf();
-  } else {
-    input_buffer_ptr = file_input_buffer.open(opts.filename->c_str(), std::ios::in);
-    if (!input_buffer_ptr) {
-      std::cerr << boost::format("%s: cannot open %s: %s\n") % opts.program_name % *opts.filename % strerror(errno);
-      return EXIT_FAILURE;
-    }
-  }
-  
-  std::copy(std::istreambuf_iterator<char>(input_buffer_ptr),
-            std::istreambuf_iterator<char>(),
-            std::back_inserter(*source_text));
-  
-  if (file_input_buffer.is_open())
-    file_input_buffer.close();
-  
+bool run_main(Psi::Compiler::CompileContext& compile_context, const Psi::Compiler::TreePtr<Psi::Compiler::Module>& my_module,
+              const Psi::Compiler::TreePtr<Psi::Compiler::EvaluateContext>& root_evaluate_context,
+              const Psi::Parser::Text& file_text, const Psi::String& entry_name, bool isolate=false) {
   using namespace Psi;
   using namespace Psi::Compiler;
-
-  CompileErrorContext error_context(&std::cerr);
-  CompileContext compile_context(&error_context, opts.configuration);
-  TreePtr<Module> global_module = Module::new_(compile_context, "psi", compile_context.root_location().named_child("psi"));
-  TreePtr<Module> my_module = Module::new_(compile_context, "main", compile_context.root_location());
-  TreePtr<EvaluateContext> root_evaluate_context = evaluate_context_root(my_module);
-  TreePtr<EvaluateContext> module_evaluate_context = evaluate_context_module(my_module, root_evaluate_context, my_module->location());
-  Parser::Text file_text = url_location(*opts.filename, source_text, Psi::vector_begin_ptr(*source_text), Psi::vector_end_ptr(*source_text));
-  
-  PSI_STD::vector<SharedPtr<Parser::Statement> > statements = Parser::parse_namespace(error_context, my_module->location().logical, file_text);
   
   // Code used to bootstrap into user program.
   std::string init = "main()";
@@ -182,31 +185,187 @@ int psi_interpreter_run_file(const OptionSet& opts) {
 
   LogicalSourceLocationPtr root_location = compile_context.root_location().logical;
   try {
+    PSI_STD::vector<SharedPtr<Parser::Statement> > statements = Parser::parse_namespace(compile_context.error_context(), my_module->location().logical, file_text);
+    
+    TreePtr<EvaluateContext> module_evaluate_context = evaluate_context_module(my_module, root_evaluate_context, my_module->location());
     TreePtr<Namespace> ns = compile_namespace(statements, module_evaluate_context, SourceLocation(file_text.location, root_location));
     ns->complete();
 
     SourceLocation init_location(init_text.location, root_location);
 
     // Create only statement in main function
-    SharedPtr<Parser::Expression> init_expr = Parser::parse_expression(error_context, compile_context.root_location().logical, init_text);
+    SharedPtr<Parser::Expression> init_expr = Parser::parse_expression(compile_context.error_context(), compile_context.root_location().logical, init_text);
     TreePtr<EvaluateContext> init_evaluate_context = evaluate_context_dictionary(my_module, init_location, ns->members);
     TreePtr<Term> init_tree = compile_term(init_expr, init_evaluate_context, root_location);
     init_tree->complete();
     
     // Create main function
     TreePtr<FunctionType> main_type = TermBuilder::function_type(result_mode_functional, compile_context.builtins().empty_type, default_, default_, init_location);
-    TreePtr<ModuleGlobal> main_function = TermBuilder::function(my_module, main_type, link_public, default_, default_, init_location, init_tree, "_Y_jit_entry");
+    TreePtr<ModuleGlobal> main_function = TermBuilder::function(my_module, main_type, link_public, default_, default_, init_location, init_tree, entry_name);
     
     void (*main_ptr) ();
     *reinterpret_cast<void**>(&main_ptr) = compile_context.jit_compile(main_function);
+#if PSI_WITH_SERVER
+    if (isolate) {
+      int status = Platform::run_in_child(main_ptr);
+      if (status < 0)
+        std::cerr << "main terminated abnormally\n";
+      else if (status > 0)
+        std::cerr << boost::format("main exited with status %d\n") % status;
+      return status == 0;
+    }
+#else
+    PSI_ASSERT(!isolate);
+#endif
     main_ptr();
   } catch (CompileException&) {
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Run a file.
+ */
+int psi_interpreter_run_file(const OptionSet& opts) {
+  Psi::SharedPtr<Psi::Platform::FileData> source_text;
+  try {
+    if (*opts.filename == "-")
+      source_text = Psi::Platform::read_standard_input();
+    else
+      source_text = Psi::Platform::read_file(*opts.filename);
+  } catch (Psi::Platform::PlatformError& ex) {
+    std::cerr << boost::format("%s: %s\n") % opts.program_name % ex.what();
     return EXIT_FAILURE;
   }
+  
+  using namespace Psi;
+  using namespace Psi::Compiler;
 
-  return EXIT_SUCCESS;
+  CompileErrorContext error_context(&std::cerr);
+  CompileContext compile_context(&error_context, opts.configuration);
+  TreePtr<Module> global_module = Module::new_(compile_context, "psi", compile_context.root_location().named_child("psi"));
+  TreePtr<Module> my_module = Module::new_(compile_context, "main", compile_context.root_location());
+  TreePtr<EvaluateContext> root_evaluate_context = evaluate_context_root(my_module);
+  Parser::Text file_text = url_location(*opts.filename, source_text, source_text->begin(), source_text->end());
+  
+  return run_main(compile_context, my_module, root_evaluate_context, file_text, "_Y_jit_entry") ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#if PSI_WITH_SERVER
+/**
+ * Run files sent by clients over a local socket.
+ * 
+ * Each connection carries one request: the client sends the text of a
+ * file and shuts down its side of the connection. The file is compiled
+ * into a module of its own and its \c main function is run with standard
+ * output and standard error sent to the client. The server then sends a
+ * null character followed by the exit status in decimal, and closes the
+ * connection.
+ * 
+ * All requests share one CompileContext, so the builtin types, the JIT
+ * and anything else constructed lazily are only set up once. Names
+ * defined by one request are not visible to any other, so a request which
+ * fails to compile does not affect later requests. Any other exception
+ * raised while compiling is reported to the client as an internal error.
+ * \c main is run in a child process, so a request which crashes or exits
+ * at run time does not affect the server either.
+ */
+int psi_interpreter_server(const OptionSet& opts) {
+  using namespace Psi;
+  using namespace Psi::Compiler;
+  
+  CompileErrorContext error_context(&std::cerr);
+  CompileContext compile_context(&error_context, opts.configuration);
+  TreePtr<Module> global_module = Module::new_(compile_context, "psi", compile_context.root_location().named_child("psi"));
+  TreePtr<EvaluateContext> root_evaluate_context = evaluate_context_root(global_module);
+  
+  boost::scoped_ptr<Platform::LocalServer> server;
+  try {
+    server.reset(new Platform::LocalServer(*opts.server_socket));
+  } catch (Platform::PlatformError& ex) {
+    std::cerr << boost::format("%s: %s\n") % opts.program_name % ex.what();
+    return EXIT_FAILURE;
+  }
+  
+  // Collect garbage once the number of objects has doubled since the last collection
+  std::size_t gc_threshold = 2 * compile_context.object_count();
+  
+  for (unsigned request_no = 1; ; ++request_no) {
+    try {
+      Platform::LocalConnection connection(*server);
+      SharedPtr<Platform::FileData> source_text = connection.read_all();
+      
+      std::ostringstream unique_ss;
+      unique_ss << request_no;
+      std::string unique = unique_ss.str();
+      
+      SourceLocation location = compile_context.root_location().named_child("request_" + unique);
+      TreePtr<Module> my_module = Module::new_(compile_context, "request_" + unique, location);
+      Parser::Text file_text = url_location("(request " + unique + ")", source_text, source_text->begin(), source_text->end());
+      
+      bool success = false;
+      {
+        Platform::RedirectOutput redirect(connection);
+        try {
+          success = run_main(compile_context, my_module, root_evaluate_context, file_text, "_Y_jit_entry_" + unique, true);
+        } catch (std::exception& ex) {
+          std::cerr << boost::format("(request %s): internal error: %s\n") % unique % ex.what();
+        } catch (...) {
+          std::cerr << boost::format("(request %s): internal error\n") % unique;
+        }
+      }
+      
+      char status[] = {'\0', success ? '0' : '1'};
+      connection.write(status, sizeof(status));
+    } catch (Platform::PlatformError& ex) {
+      std::cerr << boost::format("%s: %s\n") % opts.program_name % ex.what();
+    }
+    
+    if (compile_context.object_count() >= gc_threshold) {
+      compile_context.collect_garbage();
+      gc_threshold = 2 * compile_context.object_count();
+    }
+  }
 }
 
+/**
+ * Send a file to a server started with \c --server and copy the output
+ * it produces to standard output.
+ */
+int psi_interpreter_client(const OptionSet& opts) {
+  try {
+    Psi::SharedPtr<Psi::Platform::FileData> source_text;
+    if (*opts.filename == "-")
+      source_text = Psi::Platform::read_standard_input();
+    else
+      source_text = Psi::Platform::read_file(*opts.filename);
+    
+    Psi::Platform::LocalConnection connection(*opts.client_socket);
+    connection.write(source_text->begin(), source_text->size());
+    connection.shutdown_write();
+    Psi::SharedPtr<Psi::Platform::FileData> response = connection.read_all();
+    
+    // The exit status follows the last null character
+    const char *status = response->end();
+    while ((status != response->begin()) && (status[-1] != '\0'))
+      --status;
+    if (status == response->begin()) {
+      std::cerr << boost::format("%s: server closed the connection without reporting a status\n") % opts.program_name;
+      return EXIT_FAILURE;
+    }
+    
+    std::cout.write(response->begin(), status - 1 - response->begin());
+    std::cout.flush();
+    return (std::string(status, response->end()) == "0") ? EXIT_SUCCESS : EXIT_FAILURE;
+  } catch (Psi::Platform::PlatformError& ex) {
+    std::cerr << boost::format("%s: %s\n") % opts.program_name % ex.what();
+    return EXIT_FAILURE;
+  }
+}
+#endif
+
 namespace {
 #if PSI_HAVE_READLINE
   template<typename T>
@@ -299,6 +458,36 @@ namespace {
   }
 }
 
+namespace {
+  /**
+   * \brief Histogram of durations, with bucket boundaries at powers of two microseconds.
+   */
+  class LatencyHistogram {
+    /// Bucket \c i counts durations in [2^(i-1), 2^i) microseconds; bucket 0 counts those under 1us
+    std::vector<std::size_t> m_buckets;
+    
+  public:
+    void add(double seconds) {
+      double bound = 1e-6;
+      std::size_t index = 0;
+      for (; seconds >= bound; bound *= 2)
+        ++index;
+      if (m_buckets.size() <= index)
+        m_buckets.resize(index + 1, 0);
+      ++m_buckets[index];
+    }
+    
+    void print(std::ostream& os) const {
+      for (std::size_t ii = 0, ie = m_buckets.size(); ii != ie; ++ii) {
+        if (!m_buckets[ii])
+          continue;
+        unsigned long lower = ii ? (1ul << (ii - 1)) : 0, upper = 1ul << ii;
+        os << boost::format("  [%uus, %uus): %u\n") % lower % upper % m_buckets[ii];
+      }
+    }
+  };
+}
+
 namespace {  
   using namespace Psi::Compiler;
   
@@ -336,13 +525,21 @@ int psi_interpreter_repl(const OptionSet& opts) {
   TreePtr<Module> global_module = Module::new_(compile_context, "psi", compile_context.root_location().named_child("psi"));
   TreePtr<EvaluateContext> root_evaluate_context = evaluate_context_root(global_module);
   
-  std::map<String, TreePtr<Term> > names;
+  // Names defined by earlier input lines
+  TreePtr<EvaluateContext> scope = root_evaluate_context;
+  
+  // Collect garbage once the number of objects has doubled since the last collection
+  std::size_t gc_threshold = 2 * compile_context.object_count();
+  unsigned gc_collections = 0;
+  std::size_t gc_destroyed = 0;
+  
+  LatencyHistogram latency;
   
   while (true) {
     unsigned start_line = ++line_no;
     boost::optional<std::string> maybe_input = interpreter_read_line(opts.test_prompt, ">>> ");
     if (!maybe_input)
-      return EXIT_SUCCESS;
+      break;
     std::string input = *maybe_input;
     
     while (!input_finished(input)) {
@@ -354,6 +551,7 @@ int psi_interpreter_repl(const OptionSet& opts) {
       input += *continuation;
     }
     
+    double start_time = Platform::monotonic_time();
     try {
       std::ostringstream unique_ss;
       unique_ss << start_line;
@@ -370,25 +568,57 @@ int psi_interpreter_repl(const OptionSet& opts) {
       
       TreePtr<Module> my_module = Module::new_(compile_context, "input_" + unique, location);
 
-      TreePtr<EvaluateContext> evaluate_context = evaluate_context_dictionary(my_module, location, names, root_evaluate_context);
+      TreePtr<EvaluateContext> evaluate_context = evaluate_context_module(my_module, scope, location);
       CompileScriptResult script = compile_script(statements, evaluate_context, EvaluateCallback(statements.size()), location);
 
       // Force immediate compilation and loading
       compile_context.jit_compile_many(script.globals);
 
-      // Only add names to map if they compiled correctly
-      for (PSI_STD::map<String, TreePtr<Term> >::const_iterator ii = script.names.begin(), ie = script.names.end(); ii != ie; ++ii)
-        names[ii->first] = ii->second;
+      // Only add names to scope if they compiled correctly
+      if (!script.names.empty())
+        scope = evaluate_context_extend(my_module, location, script.names, scope);
     } catch (CompileException&) {
       // Error details should already have been printed, so ignore error
+    } catch (std::exception& ex) {
+      std::cerr << boost::format("(input):%d: internal error: %s\n") % start_line % ex.what();
+    } catch (...) {
+      std::cerr << boost::format("(input):%d: internal error\n") % start_line;
+    }
+    
+    if (compile_context.object_count() >= gc_threshold) {
+      gc_destroyed += compile_context.collect_garbage();
+      ++gc_collections;
+      gc_threshold = 2 * compile_context.object_count();
     }
     
+    latency.add(Platform::monotonic_time() - start_time);
+    
     if (opts.test_prompt) {
       std::cout << '\0' << std::flush;
       std::cerr << '\0' << std::flush;
     }
   }
   
+  if (opts.stats) {
+    const TvmJitCompiler::Statistics& jit_stats = compile_context.jit().jit_compiler().statistics();
+    std::cerr << "Time per input line:\n";
+    latency.print(std::cerr);
+    std::cerr << boost::format("JIT: %u globals lowered, %u modules loaded\n") % jit_stats.globals_lowered % jit_stats.modules_loaded;
+    const OverloadLookupCache::Statistics& overload_stats = compile_context.overload_cache().statistics();
+    const Parser::ParseCache::Statistics& parse_stats = compile_context.parse_cache().statistics();
+    std::cerr << boost::format("Caches: overload %u hits, %u misses; parse %u hits, %u misses\n")
+      % overload_stats.hits % overload_stats.misses % parse_stats.hits % parse_stats.misses;
+    std::cerr << boost::format("Garbage collection: %u collections, %u objects destroyed\n") % gc_collections % gc_destroyed;
+    std::cerr << boost::format("Name lookup: %u evaluation contexts searched\n") % compile_context.evaluate_context_lookups();
+    
+    std::vector<Tvm::ProfileCallSite> call_sites = compile_context.jit().jit_compiler().profile().hot_call_sites(10);
+    if (!call_sites.empty()) {
+      std::cerr << "Most frequent calls in profile (candidates for inlining):\n";
+      for (std::vector<Tvm::ProfileCallSite>::const_iterator ii = call_sites.begin(), ie = call_sites.end(); ii != ie; ++ii)
+        std::cerr << boost::format("  %s -> %s: %u calls, %u to callee in total\n") % ii->caller % ii->callee % ii->count % ii->callee_count;
+    }
+  }
+  
   return EXIT_SUCCESS;
 }
 
@@ -397,6 +627,18 @@ int main(int argc, const char **argv) {
   if (!parse_options(argc, argv, opts))
     return EXIT_FAILURE;
   
+#if PSI_WITH_SERVER
+  if (opts.server_socket)
+    return psi_interpreter_server(opts);
+  if (opts.client_socket) {
+    if (!opts.filename) {
+      std::cerr << boost::format("%s: --client requires a file to run\n") % opts.program_name;
+      return EXIT_FAILURE;
+    }
+    return psi_interpreter_client(opts);
+  }
+#endif
+  
   if (opts.filename)
     return psi_interpreter_run_file(opts);
   else
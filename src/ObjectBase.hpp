@@ -4,6 +4,8 @@
 #include <boost/array.hpp>
 #include <boost/intrusive/list.hpp>
 
+#include <vector>
+
 #include "Assert.hpp"
 #include "Visitor.hpp"
 #include "Runtime.hpp"
@@ -21,17 +23,52 @@ namespace Psi {
     template<typename> class TreePtr;
     template<typename, typename> class DelayedValue;
 
+    struct SIVtable;
+
+    /**
+     * \brief Ancestors of a single inheritance vtable.
+     */
+    struct SIDisplay {
+      /// \brief Ancestors of the vtable indexed by depth, ending with the vtable itself.
+      const SIVtable *const *ancestors;
+      /// \brief Number of ancestors of the vtable.
+      std::size_t depth;
+    };
+
     /**
      * \brief Single inheritance dispatch table base.
+     * 
+     * \c display points to SIDisplayHolder<T>::display for the class \c T
+     * which owns this vtable. That is built during dynamic initialization,
+     * while the vtable itself is constant-initialized, so \c display is
+     * always valid but its \c ancestors are NULL until the holder has been
+     * initialized.
      */
     struct SIVtable {
       const SIVtable *super;
       const char *classname;
       bool abstract;
+      const SIDisplay *display;
+    };
+    
+    SIDisplay si_build_display(const SIVtable *vptr);
+
+    /**
+     * \brief Storage for the display of the vtable of \c T.
+     * 
+     * The display is built from the \c super chain, which is constant-initialized,
+     * so the order in which holders are initialized does not matter.
+     */
+    template<typename T>
+    struct SIDisplayHolder {
+      static const SIDisplay display;
     };
+
+    template<typename T>
+    const SIDisplay SIDisplayHolder<T>::display = si_build_display(reinterpret_cast<const SIVtable*>(&T::vtable));
     
-#define PSI_COMPILER_SI(classname,super) {reinterpret_cast<const SIVtable*>(super),classname,false}
-#define PSI_COMPILER_SI_ABSTRACT(classname,super) {reinterpret_cast<const SIVtable*>(super),classname,true}
+#define PSI_COMPILER_SI(derived,classname,super) {reinterpret_cast<const SIVtable*>(super),classname,false,&::Psi::Compiler::SIDisplayHolder<derived >::display}
+#define PSI_COMPILER_SI_ABSTRACT(derived,classname,super) {reinterpret_cast<const SIVtable*>(super),classname,true,&::Psi::Compiler::SIDisplayHolder<derived >::display}
 #define PSI_COMPILER_SI_INIT(vptr) (m_vptr = reinterpret_cast<const SIVtable*>(vptr), PSI_ASSERT(!m_vptr->abstract))
 #define PSI_COMPILER_VPTR_UP(super,vptr) (PSI_ASSERT(si_derived(reinterpret_cast<const SIVtable*>(&super::vtable), reinterpret_cast<const SIVtable*>(vptr))), reinterpret_cast<const super::VtableType*>(vptr))
 
@@ -72,8 +109,23 @@ namespace Psi {
     };
 
     inline const SIVtable* si_vptr(const SIBase *self) {return self->m_vptr;}
-    bool si_is_a(const SIBase*, const SIVtable*);
-    bool si_derived(const SIVtable *base, const SIVtable *derived);
+    bool si_derived_slow(const SIVtable *base, const SIVtable *derived);
+
+    /**
+     * \brief Check whether one vtable is the same as or derived from another.
+     * 
+     * Since \c derived can only derive from \c base if \c base appears in
+     * its display at the depth of \c base, this takes constant time once both
+     * displays have been built.
+     */
+    inline bool si_derived(const SIVtable *base, const SIVtable *derived) {
+      const SIDisplay *base_display = base->display, *derived_display = derived->display;
+      if (!base_display->ancestors || !derived_display->ancestors)
+        return si_derived_slow(base, derived);
+      return (derived_display->depth >= base_display->depth) && (derived_display->ancestors[base_display->depth] == base);
+    }
+
+    inline bool si_is_a(const SIBase *object, const SIVtable *cls) {return si_derived(cls, object->m_vptr);}
 
     inline bool SIType::isa(const SIBase *obj) const {return si_is_a(obj, m_vptr);}
 
@@ -148,7 +200,7 @@ namespace Psi {
     struct ObjectVtable {
       SIVtable base;
       void (*destroy) (Object*);
-      void (*gc_increment) (Object*);
+      void (*gc_increment) (Object*, std::vector<Object*>*);
       void (*gc_decrement) (Object*);
       void (*gc_clear) (Object*);
     };
@@ -295,13 +347,23 @@ namespace Psi {
 
     /**
      * \brief Implements the increment phase of the garbage collector.
+     * 
+     * Objects whose reference count was zero before being incremented
+     * are appended to a list if one is given.
      */
     class GCVisitorIncrement : public ObjectVisitorBase<GCVisitorIncrement> {
+      std::vector<Object*> *m_revived;
+      
     public:
+      GCVisitorIncrement(std::vector<Object*> *revived) : m_revived(revived) {}
+      
       template<typename T>
       void visit_object_ptr(const ObjectPtr<T>& ptr) {
-        if (ptr)
-          ++ptr->m_reference_count;
+        if (ptr) {
+          if (m_revived && !ptr->m_reference_count)
+            m_revived->push_back(const_cast<Object*>(static_cast<const Object*>(ptr.get())));
+          ptr->m_reference_count += PSI_REFERENCE_COUNT_GRANULARITY;
+        }
       }
     };
 
@@ -313,12 +375,12 @@ namespace Psi {
       template<typename T>
       void visit_object_ptr(const ObjectPtr<T>& ptr) {
         if (ptr)
-          --ptr->m_reference_count;
+          ptr->m_reference_count -= PSI_REFERENCE_COUNT_GRANULARITY;
       }
     };
 
     /**
-     * \brief Implements the increment phase of the garbage collector.
+     * \brief Implements the clear phase of the garbage collector.
      */
     class GCVisitorClear : public ObjectVisitorBase<GCVisitorClear> {
     public:
@@ -352,9 +414,9 @@ namespace Psi {
         delete static_cast<Derived*>(self);
       }
 
-      static void gc_increment(Object *self) {
+      static void gc_increment(Object *self, std::vector<Object*> *revived) {
         boost::array<Derived*, 1> a = {{static_cast<Derived*>(self)}};
-        GCVisitorIncrement p;
+        GCVisitorIncrement p(revived);
         visit_members(p, a);
       }
 
@@ -372,7 +434,7 @@ namespace Psi {
     };
 
 #define PSI_COMPILER_OBJECT(derived,name,super) { \
-    PSI_COMPILER_SI(name,&super::vtable), \
+    PSI_COMPILER_SI(derived,name,&super::vtable), \
     &::Psi::Compiler::ObjectWrapper<derived>::destroy, \
     &::Psi::Compiler::ObjectWrapper<derived>::gc_increment, \
     &::Psi::Compiler::ObjectWrapper<derived>::gc_decrement, \
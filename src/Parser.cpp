@@ -194,7 +194,7 @@ LexerImpl::ValueType LexerImpl::lex(LexerPosition& pos) {
           pos.accept();
         }
       } else if (c_isalnum(pos.current())) {
-        pos.accept();
+        pos.accept_alnum();
       } else {
         break;
       }
@@ -206,12 +206,7 @@ LexerImpl::ValueType LexerImpl::lex(LexerPosition& pos) {
     return ValueType(tok_number, pos.location(), expr);
   } else if (c_isalpha(pos.current()) || (pos.current() == '_')) {
     pos.accept();
-    while (!pos.end()) {
-      if (c_isalnum(pos.current()) || (pos.current() == '_'))
-        pos.accept();
-      else
-        break;
-    }
+    pos.accept_identifier();
     
     SharedPtr<TokenExpression> expr(new TokenExpression(pos.location(), token_identifier,
                                                         Text(pos.location(), m_data_handle, pos.token_start(), pos.token_end())));
@@ -341,9 +336,11 @@ LexerImpl::ValueType LexerImpl::lex(LexerPosition& pos) {
                                                             Text(text_location, m_data_handle, pos.token_start() + 1, pos.token_end() - 1)));
 
         return ValueType(token_type, pos.location(), expr);
-      } else if (pos.end()) {
-        pos.error(pos.location(), "Unexpected end-of-stream whilst scanning bracket group");
       }
+      
+      pos.accept_bracket_text();
+      if (pos.end())
+        pos.error(pos.location(), "Unexpected end-of-stream whilst scanning bracket group");
     }
   } else {
     char c = pos.current();
@@ -895,6 +892,101 @@ ImplementationArgumentDeclaration parse_implementation_arguments(CompileErrorCon
   return result;
 }
 
+ParseCache::ParseCache(CompileErrorContext *error_context)
+: m_error_context(error_context),
+m_n_entries(0) {
+  m_statistics.hits = m_statistics.misses = m_statistics.uncached = 0;
+}
+
+ParseCache::~ParseCache() {
+}
+
+template<typename T>
+T ParseCache::lookup(typename Table<T>::type& table, T (*parse) (CompileErrorContext&, const LogicalSourceLocationPtr&, const Text&),
+                     const LogicalSourceLocationPtr& error_loc, const Text& text) {
+  if (!text.data_handle) {
+    ++m_statistics.uncached;
+    return parse(*m_error_context, error_loc, text);
+  }
+  
+  Key key(text.begin, text.end);
+  typename Table<T>::type::const_iterator it = table.find(key);
+  if (it != table.end()) {
+    ++m_statistics.hits;
+    return it->second.value;
+  }
+  
+  if (m_n_entries == max_entries)
+    clear();
+  
+  Entry<T>& entry = table[key];
+  try {
+    entry.value = parse(*m_error_context, error_loc, text);
+  } catch (...) {
+    table.erase(key);
+    throw;
+  }
+  entry.data_handle = text.data_handle;
+  ++m_n_entries;
+  ++m_statistics.misses;
+  return entry.value;
+}
+
+/// \brief Cached version of parse_statement_list()
+PSI_STD::vector<SharedPtr<Statement> > ParseCache::statement_list(const LogicalSourceLocationPtr& error_loc, const Text& text) {
+  return lookup(m_statement_lists, &parse_statement_list, error_loc, text);
+}
+
+/// \brief Cached version of parse_namespace()
+PSI_STD::vector<SharedPtr<Statement> > ParseCache::namespace_(const LogicalSourceLocationPtr& error_loc, const Text& text) {
+  return lookup(m_namespaces, &parse_namespace, error_loc, text);
+}
+
+/// \brief Cached version of parse_expression()
+SharedPtr<Expression> ParseCache::expression(const LogicalSourceLocationPtr& error_loc, const Text& text) {
+  return lookup(m_expressions, &parse_expression, error_loc, text);
+}
+
+/// \brief Cached version of parse_positional_list()
+PSI_STD::vector<SharedPtr<Expression> > ParseCache::positional_list(const LogicalSourceLocationPtr& error_loc, const Text& text) {
+  return lookup(m_positional_lists, &parse_positional_list, error_loc, text);
+}
+
+/// \brief Cached version of parse_identifier_list()
+PSI_STD::vector<TokenExpression> ParseCache::identifier_list(const LogicalSourceLocationPtr& error_loc, const Text& text) {
+  return lookup(m_identifier_lists, &parse_identifier_list, error_loc, text);
+}
+
+/// \brief Cached version of parse_type_argument_declarations()
+PSI_STD::vector<SharedPtr<FunctionArgument> > ParseCache::type_argument_declarations(const LogicalSourceLocationPtr& error_loc, const Text& text) {
+  return lookup(m_type_argument_declarations, &parse_type_argument_declarations, error_loc, text);
+}
+
+/// \brief Cached version of parse_function_argument_declarations()
+FunctionArgumentDeclarations ParseCache::function_argument_declarations(const LogicalSourceLocationPtr& error_loc, const Text& text) {
+  return lookup(m_function_argument_declarations, &parse_function_argument_declarations, error_loc, text);
+}
+
+/// \brief Cached version of parse_implementation_arguments()
+ImplementationArgumentDeclaration ParseCache::implementation_arguments(const LogicalSourceLocationPtr& error_loc, const Text& text) {
+  return lookup(m_implementation_arguments, &parse_implementation_arguments, error_loc, text);
+}
+
+/**
+ * \brief Remove all entries, releasing the source text they refer to.
+ */
+void ParseCache::clear() {
+  m_statement_lists.clear();
+  m_namespaces.clear();
+  m_expressions.clear();
+  m_positional_lists.clear();
+  m_identifier_lists.clear();
+  m_type_argument_declarations.clear();
+  m_function_argument_declarations.clear();
+  m_implementation_arguments.clear();
+  m_n_entries = 0;
+}
+
 /**
  * Check whether an expression is a simple string.
  */
@@ -3,8 +3,10 @@
 
 #include <stdexcept>
 
+#include <boost/noncopyable.hpp>
 #include <boost/optional.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "ErrorContext.hpp"
 #include "SourceLocation.hpp"
@@ -126,6 +128,85 @@ namespace Psi {
     
     ImplementationArgumentDeclaration parse_implementation_arguments(CompileErrorContext& error_context, const LogicalSourceLocationPtr& error_loc, const Text& text);
     
+    /**
+     * \brief Memoizes parsing of source text.
+     * 
+     * Bracketed text is only parsed when it is compiled, and the same text
+     * may be compiled several times, for instance generic bodies, interface
+     * definitions and macro expansions. This caches the result of each
+     * parse entry point by the range of text parsed, so that each range is
+     * only parsed once.
+     * 
+     * Each entry holds the data handle of the text it was parsed from, so
+     * the same addresses cannot be reused for different text while the
+     * entry exists. Text without a data handle is not cached. Parse errors
+     * are not cached either, so the error is reported again if the text is
+     * parsed again.
+     * 
+     * The cache is emptied when it reaches \c max_entries, which bounds the
+     * source text it keeps alive in a long running context.
+     */
+    class PSI_COMPILER_EXPORT ParseCache : public boost::noncopyable {
+    public:
+      /// \brief Usage counts for a ParseCache.
+      struct Statistics {
+        /// \brief Number of parses satisfied from the cache.
+        std::size_t hits;
+        /// \brief Number of parses added to the cache.
+        std::size_t misses;
+        /// \brief Number of parses which could not be cached.
+        std::size_t uncached;
+      };
+      
+      explicit ParseCache(CompileErrorContext *error_context);
+      ~ParseCache();
+      
+      PSI_STD::vector<SharedPtr<Statement> > statement_list(const LogicalSourceLocationPtr& error_loc, const Text& text);
+      PSI_STD::vector<SharedPtr<Statement> > namespace_(const LogicalSourceLocationPtr& error_loc, const Text& text);
+      SharedPtr<Expression> expression(const LogicalSourceLocationPtr& error_loc, const Text& text);
+      PSI_STD::vector<SharedPtr<Expression> > positional_list(const LogicalSourceLocationPtr& error_loc, const Text& text);
+      PSI_STD::vector<TokenExpression> identifier_list(const LogicalSourceLocationPtr& error_loc, const Text& text);
+      PSI_STD::vector<SharedPtr<FunctionArgument> > type_argument_declarations(const LogicalSourceLocationPtr& error_loc, const Text& text);
+      FunctionArgumentDeclarations function_argument_declarations(const LogicalSourceLocationPtr& error_loc, const Text& text);
+      ImplementationArgumentDeclaration implementation_arguments(const LogicalSourceLocationPtr& error_loc, const Text& text);
+      void clear();
+      
+      /// \brief Get usage counts for this cache.
+      const Statistics& statistics() const {return m_statistics;}
+      
+    private:
+      typedef std::pair<const char*, const char*> Key;
+      
+      template<typename T>
+      struct Entry {
+        SharedPtrHandle data_handle;
+        T value;
+      };
+      
+      template<typename T>
+      struct Table {
+        typedef boost::unordered_map<Key, Entry<T> > type;
+      };
+      
+      template<typename T>
+      T lookup(typename Table<T>::type& table, T (*parse) (CompileErrorContext&, const LogicalSourceLocationPtr&, const Text&),
+               const LogicalSourceLocationPtr& error_loc, const Text& text);
+      
+      /// \brief Number of entries at which the cache is emptied.
+      static const std::size_t max_entries = 4096;
+      
+      CompileErrorContext *m_error_context;
+      Statistics m_statistics;
+      std::size_t m_n_entries;
+      Table<PSI_STD::vector<SharedPtr<Statement> > >::type m_statement_lists, m_namespaces;
+      Table<SharedPtr<Expression> >::type m_expressions;
+      Table<PSI_STD::vector<SharedPtr<Expression> > >::type m_positional_lists;
+      Table<PSI_STD::vector<TokenExpression> >::type m_identifier_lists;
+      Table<PSI_STD::vector<SharedPtr<FunctionArgument> > >::type m_type_argument_declarations;
+      Table<FunctionArgumentDeclarations>::type m_function_argument_declarations;
+      Table<ImplementationArgumentDeclaration>::type m_implementation_arguments;
+    };
+    
     bool expression_is_str(const SharedPtr<Expression>& expr, const char *str);
     SharedPtr<TokenExpression> expression_as_token_type(const SharedPtr<Expression>& expr, TokenExpressionType type);
     SharedPtr<Parser::EvaluateExpression> expression_as_evaluate(const SharedPtr<Parser::Expression>& expr);
@@ -20,6 +20,9 @@ const char *PlatformError::what() const throw() {
 PlatformLibrary::~PlatformLibrary() {
 }
 
+FileData::~FileData() {
+}
+
 #if PSI_WITH_EXEC
 /**
  * \brief Execute a command and check it is successful.
@@ -1,6 +1,7 @@
 #ifndef HPP_PSI_PLATFORM
 #define HPP_PSI_PLATFORM
 
+#include <boost/noncopyable.hpp>
 #include <boost/optional.hpp>
 #include <iosfwd>
 
@@ -94,6 +95,65 @@ PSI_COMPILER_COMMON_EXPORT std::ostream& operator << (std::ostream& os, const Pa
 /// \brief Get the current working directory
 PSI_COMPILER_COMMON_EXPORT Path getcwd();
 
+/**
+ * \brief Read a monotonic clock, in seconds.
+ * 
+ * The origin of this clock is unspecified, so only differences between
+ * two readings are meaningful.
+ */
+PSI_COMPILER_COMMON_EXPORT double monotonic_time();
+
+/**
+ * \brief Get the identifier of the current process.
+ */
+PSI_COMPILER_COMMON_EXPORT unsigned long process_id();
+
+/**
+ * \brief Run a function on several threads at once.
+ * 
+ * Starts \c n_threads threads, each of which calls \c callback with
+ * \c arg and its own index, and waits for all of them to finish.
+ */
+PSI_COMPILER_COMMON_EXPORT void run_threads(unsigned n_threads, void (*callback) (void*,unsigned), void *arg);
+
+/**
+ * \brief Get the size of the symbol at a given address in a loaded library.
+ * 
+ * Returns boost::none if the address is not the start of a known symbol or
+ * the platform cannot report symbol sizes.
+ */
+PSI_COMPILER_COMMON_EXPORT boost::optional<std::size_t> symbol_size(const void *address);
+
+/**
+ * \brief Contents of a file loaded into memory.
+ * 
+ * Where possible the file is memory mapped rather than copied, so the
+ * cost of loading it is proportional to the number of pages actually
+ * read. Sources which cannot be mapped, such as pipes, are read into a
+ * buffer instead.
+ */
+class PSI_COMPILER_COMMON_EXPORT FileData : public boost::noncopyable {
+protected:
+  const char *m_begin, *m_end;
+  FileData() : m_begin(NULL), m_end(NULL) {}
+  
+public:
+  virtual ~FileData();
+  const char *begin() const {return m_begin;}
+  const char *end() const {return m_end;}
+  std::size_t size() const {return m_end - m_begin;}
+};
+
+/**
+ * \brief Load the contents of a file.
+ */
+PSI_COMPILER_COMMON_EXPORT SharedPtr<FileData> read_file(const Path& path);
+
+/**
+ * \brief Load everything remaining on standard input.
+ */
+PSI_COMPILER_COMMON_EXPORT SharedPtr<FileData> read_standard_input();
+
 /**
   * \brief Find an executable in the current path.
   */
@@ -145,6 +205,70 @@ PSI_COMPILER_COMMON_EXPORT void exec_communicate_check(const Path& command, cons
 PSI_COMPILER_COMMON_EXPORT void exec_communicate_check(const Path& command, const std::string& input="", std::string *output_out=NULL, std::string *output_err=NULL);
 #endif
 
+#if PSI_WITH_SERVER
+/**
+ * \brief Socket listening for connections from the local machine.
+ * 
+ * The socket file is created on construction and removed on destruction.
+ * A socket file which no server is listening on is replaced.
+ * Writes to connections whose peer has gone away report an error rather
+ * than raising a signal, so constructing a server ignores SIGPIPE for the
+ * whole process.
+ */
+class PSI_COMPILER_COMMON_EXPORT LocalServer : boost::noncopyable {
+  friend class LocalConnection;
+  LocalSocketData m_data;
+  Path m_path;
+  
+public:
+  LocalServer(const Path& path);
+  ~LocalServer();
+};
+
+/**
+ * \brief Stream connection between two processes on the local machine.
+ */
+class PSI_COMPILER_COMMON_EXPORT LocalConnection : boost::noncopyable {
+  friend class RedirectOutput;
+  LocalSocketData m_data;
+  
+public:
+  LocalConnection(LocalServer& server);
+  LocalConnection(const Path& path);
+  ~LocalConnection();
+  
+  SharedPtr<FileData> read_all();
+  void write(const char *data, std::size_t size);
+  void shutdown_write();
+};
+
+/**
+ * \brief Sends standard output and standard error to a connection while in scope.
+ * 
+ * Both C and C++ standard streams are flushed on construction and
+ * destruction, so that output is sent to the right place.
+ */
+class PSI_COMPILER_COMMON_EXPORT RedirectOutput : boost::noncopyable {
+  RedirectOutputData m_data;
+  void restore();
+  
+public:
+  RedirectOutput(LocalConnection& connection);
+  ~RedirectOutput();
+};
+
+/**
+ * \brief Call a function in a child process which is a copy of this one.
+ * 
+ * Nothing the function does affects this process, even if it crashes.
+ * Standard streams are flushed before the child is created and before it exits.
+ * 
+ * \return 0 if \c function returns, the exit status if it calls \c exit,
+ * or -1 if the child process terminates abnormally.
+ */
+PSI_COMPILER_COMMON_EXPORT int run_in_child(void (*function) ());
+#endif
+
 /**
  * Read configuration data from files and update a configuration map.
  */
@@ -7,6 +7,8 @@ namespace Psi {
 namespace Platform {
   struct PathData {std::string path; PathData() {}; PathData(const std::string& path_) : path(path_) {}};
   struct TemporaryPathData {bool deleted;};
+  struct LocalSocketData {int fd;};
+  struct RedirectOutputData {int saved_stdout, saved_stderr;};
 }
 }
 
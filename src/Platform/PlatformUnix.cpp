@@ -4,16 +4,25 @@
 #include <boost/format.hpp>
 #include <boost/make_shared.hpp>
 #include <fstream>
+#include <iostream>
 
 #include <dlfcn.h>
+#include <link.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <sys/wait.h>
+#include <time.h>
 
 namespace Psi {
 namespace Platform {
@@ -491,6 +500,352 @@ void TemporaryPath::delete_() {
 }
 #endif
 
+double monotonic_time() {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+    int errcode = errno;
+    throw PlatformError(boost::str(boost::format("Failed to read monotonic clock: %s") % Unix::error_string(errcode)));
+  }
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+unsigned long process_id() {
+  return getpid();
+}
+
+namespace {
+  struct ThreadStart {
+    void (*callback) (void*,unsigned);
+    void *arg;
+    unsigned index;
+  };
+
+  void* thread_start(void *ptr) {
+    const ThreadStart& start = *static_cast<const ThreadStart*>(ptr);
+    start.callback(start.arg, start.index);
+    return NULL;
+  }
+}
+
+void run_threads(unsigned n_threads, void (*callback) (void*,unsigned), void *arg) {
+  std::vector<ThreadStart> starts(n_threads);
+  std::vector<pthread_t> threads;
+  threads.reserve(n_threads);
+  int errcode = 0;
+  for (unsigned ii = 0; ii != n_threads; ++ii) {
+    starts[ii].callback = callback;
+    starts[ii].arg = arg;
+    starts[ii].index = ii;
+    pthread_t thread;
+    errcode = pthread_create(&thread, NULL, thread_start, &starts[ii]);
+    if (errcode != 0)
+      break;
+    threads.push_back(thread);
+  }
+
+  for (std::vector<pthread_t>::iterator ii = threads.begin(), ie = threads.end(); ii != ie; ++ii)
+    pthread_join(*ii, NULL);
+
+  if (errcode != 0)
+    throw PlatformError(boost::str(boost::format("Failed to start thread: %s") % Unix::error_string(errcode)));
+}
+
+boost::optional<std::size_t> symbol_size(const void *address) {
+#ifdef __GLIBC__
+  Dl_info info;
+  ElfW(Sym) *sym = NULL;
+  if (dladdr1(address, &info, reinterpret_cast<void**>(&sym), RTLD_DL_SYMENT) && sym && (info.dli_saddr == address))
+    return sym->st_size;
+#endif
+  return boost::none;
+}
+
+namespace {
+  /// File data held in a buffer
+  class FileDataBuffer : public FileData {
+    std::vector<char> m_data;
+    
+  public:
+    FileDataBuffer(std::vector<char>& data) {
+      m_data.swap(data);
+      m_begin = vector_begin_ptr(m_data);
+      m_end = vector_end_ptr(m_data);
+    }
+  };
+  
+  /// File data mapped into memory
+  class FileDataMapped : public FileData {
+  public:
+    FileDataMapped(void *ptr, std::size_t size) {
+      m_begin = static_cast<const char*>(ptr);
+      m_end = m_begin + size;
+    }
+    
+    virtual ~FileDataMapped() {
+      munmap(const_cast<char*>(m_begin), m_end - m_begin);
+    }
+  };
+  
+  /// Closes a file descriptor on scope exit
+  class FileDescriptorGuard : boost::noncopyable {
+    int m_fd;
+  public:
+    FileDescriptorGuard(int fd) : m_fd(fd) {}
+    ~FileDescriptorGuard() {if (m_fd >= 0) close(m_fd);}
+    /// Stop this guard from closing the descriptor
+    void release() {m_fd = -1;}
+  };
+  
+  /**
+   * \brief Load the contents of a file descriptor.
+   * 
+   * Non-empty regular files are mapped. Everything else, including files
+   * whose reported size is zero but may have content (such as those in
+   * /proc), is read into a buffer.
+   */
+  SharedPtr<FileData> read_descriptor(int fd, const std::string& name) {
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+      if (S_ISREG(st.st_mode) && (st.st_size > 0)) {
+        void *ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED)
+          return SharedPtr<FileData>(new FileDataMapped(ptr, st.st_size));
+      }
+    }
+    
+    std::vector<char> data;
+    const std::size_t block_size = 65536;
+    while (true) {
+      std::size_t offset = data.size();
+      data.resize(offset + block_size);
+      ssize_t count = read(fd, &data[offset], block_size);
+      if (count < 0) {
+        int errcode = errno;
+        if (errcode == EINTR) {
+          data.resize(offset);
+          continue;
+        }
+        throw PlatformError(boost::str(boost::format("Failed to read %s: %s") % name % Unix::error_string(errcode)));
+      }
+      data.resize(offset + count);
+      if (count == 0)
+        break;
+    }
+    
+    return SharedPtr<FileData>(new FileDataBuffer(data));
+  }
+}
+
+SharedPtr<FileData> read_file(const Path& path) {
+  int fd = open(path.data().path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    int errcode = errno;
+    throw PlatformError(boost::str(boost::format("Cannot open %s: %s") % path.str() % Unix::error_string(errcode)));
+  }
+  FileDescriptorGuard guard(fd);
+  return read_descriptor(fd, path.str());
+}
+
+SharedPtr<FileData> read_standard_input() {
+  return read_descriptor(STDIN_FILENO, "standard input");
+}
+
+#if PSI_WITH_SERVER
+namespace {
+#ifdef MSG_NOSIGNAL
+  /// Flags for send() so that writing to a closed connection reports EPIPE rather than raising SIGPIPE
+  const int local_send_flags = MSG_NOSIGNAL;
+#else
+  // MSG_NOSIGNAL is not available everywhere, e.g. on Apple platforms; SIGPIPE is ignored by LocalServer
+  const int local_send_flags = 0;
+#endif
+  
+  sockaddr_un local_socket_address(const Path& path) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    const std::string& str = path.data().path;
+    if (str.length() >= sizeof(addr.sun_path))
+      throw PlatformError(boost::str(boost::format("Socket path is too long: %s") % str));
+    std::copy(str.begin(), str.end(), addr.sun_path);
+    return addr;
+  }
+  
+  int local_socket_create() {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+      int errcode = errno;
+      throw PlatformError(boost::str(boost::format("Failed to create socket: %s") % Unix::error_string(errcode)));
+    }
+    return fd;
+  }
+}
+
+LocalServer::LocalServer(const Path& path) : m_path(path) {
+  sockaddr_un addr = local_socket_address(path);
+  m_data.fd = local_socket_create();
+  FileDescriptorGuard guard(m_data.fd);
+  
+  int bind_result = bind(m_data.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+  if ((bind_result != 0) && (errno == EADDRINUSE)) {
+    // Replace the socket file if it was left behind by a server which no longer exists
+    int probe = local_socket_create();
+    FileDescriptorGuard probe_guard(probe);
+    if ((connect(probe, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) && (errno == ECONNREFUSED)) {
+      unlink(path.data().path.c_str());
+      bind_result = bind(m_data.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    } else {
+      errno = EADDRINUSE;
+    }
+  }
+  
+  if (bind_result != 0) {
+    int errcode = errno;
+    throw PlatformError(boost::str(boost::format("Cannot bind socket %s: %s") % path.str() % Unix::error_string(errcode)));
+  }
+  
+  if (listen(m_data.fd, SOMAXCONN) != 0) {
+    int errcode = errno;
+    unlink(path.data().path.c_str());
+    throw PlatformError(boost::str(boost::format("Cannot listen on socket %s: %s") % path.str() % Unix::error_string(errcode)));
+  }
+  
+  signal(SIGPIPE, SIG_IGN);
+  guard.release();
+}
+
+LocalServer::~LocalServer() {
+  close(m_data.fd);
+  unlink(m_path.data().path.c_str());
+}
+
+/**
+ * \brief Wait for the next connection to a server.
+ */
+LocalConnection::LocalConnection(LocalServer& server) {
+  while (true) {
+    m_data.fd = accept(server.m_data.fd, NULL, NULL);
+    if (m_data.fd >= 0)
+      break;
+    int errcode = errno;
+    if (errcode != EINTR)
+      throw PlatformError(boost::str(boost::format("Failed to accept connection: %s") % Unix::error_string(errcode)));
+  }
+}
+
+/**
+ * \brief Connect to a server.
+ */
+LocalConnection::LocalConnection(const Path& path) {
+  sockaddr_un addr = local_socket_address(path);
+  m_data.fd = local_socket_create();
+  FileDescriptorGuard guard(m_data.fd);
+  
+  if (connect(m_data.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    int errcode = errno;
+    throw PlatformError(boost::str(boost::format("Cannot connect to %s: %s") % path.str() % Unix::error_string(errcode)));
+  }
+  
+  guard.release();
+}
+
+LocalConnection::~LocalConnection() {
+  close(m_data.fd);
+}
+
+/**
+ * \brief Read everything the peer sends until it shuts down its side of the connection.
+ */
+SharedPtr<FileData> LocalConnection::read_all() {
+  return read_descriptor(m_data.fd, "socket");
+}
+
+void LocalConnection::write(const char *data, std::size_t size) {
+  const char *end = data + size;
+  while (data != end) {
+    ssize_t count = send(m_data.fd, data, end - data, local_send_flags);
+    if (count < 0) {
+      int errcode = errno;
+      if (errcode == EINTR)
+        continue;
+      throw PlatformError(boost::str(boost::format("Failed to write to socket: %s") % Unix::error_string(errcode)));
+    }
+    data += count;
+  }
+}
+
+/**
+ * \brief Signal to the peer that no more data will be written.
+ */
+void LocalConnection::shutdown_write() {
+  if (shutdown(m_data.fd, SHUT_WR) != 0) {
+    int errcode = errno;
+    throw PlatformError(boost::str(boost::format("Failed to shut down socket: %s") % Unix::error_string(errcode)));
+  }
+}
+
+RedirectOutput::RedirectOutput(LocalConnection& connection) {
+  std::cout.flush();
+  std::cerr.flush();
+  fflush(NULL);
+  
+  m_data.saved_stdout = dup(STDOUT_FILENO);
+  m_data.saved_stderr = dup(STDERR_FILENO);
+  if ((m_data.saved_stdout < 0) || (m_data.saved_stderr < 0) ||
+    (dup2(connection.m_data.fd, STDOUT_FILENO) < 0) || (dup2(connection.m_data.fd, STDERR_FILENO) < 0)) {
+    int errcode = errno;
+    restore();
+    throw PlatformError(boost::str(boost::format("Failed to redirect output: %s") % Unix::error_string(errcode)));
+  }
+}
+
+RedirectOutput::~RedirectOutput() {
+  std::cout.flush();
+  std::cerr.flush();
+  fflush(NULL);
+  restore();
+}
+
+void RedirectOutput::restore() {
+  if (m_data.saved_stdout >= 0) {
+    dup2(m_data.saved_stdout, STDOUT_FILENO);
+    close(m_data.saved_stdout);
+  }
+  if (m_data.saved_stderr >= 0) {
+    dup2(m_data.saved_stderr, STDERR_FILENO);
+    close(m_data.saved_stderr);
+  }
+}
+
+int run_in_child(void (*function) ()) {
+  std::cout.flush();
+  std::cerr.flush();
+  fflush(NULL);
+  
+  pid_t child_pid = fork();
+  if (child_pid < 0) {
+    int errcode = errno;
+    throw PlatformError(boost::str(boost::format("Failed to create child process: %s") % Unix::error_string(errcode)));
+  } else if (child_pid == 0) {
+    // In the child
+    function();
+    std::cout.flush();
+    std::cerr.flush();
+    fflush(NULL);
+    _exit(0);
+  }
+  
+  int child_status;
+  while (waitpid(child_pid, &child_status, 0) == -1) {
+    int errcode = errno;
+    if (errcode != EINTR)
+      throw PlatformError(boost::str(boost::format("Could not get child process exit status: %s") % Unix::error_string(errcode)));
+  }
+  
+  return WIFEXITED(child_status) ? WEXITSTATUS(child_status) : -1;
+}
+#endif
+
 boost::shared_ptr<PlatformLibrary> load_library(const Path& path) {
   boost::shared_ptr<Unix::LibraryUnix> lib = boost::make_shared<Unix::LibraryUnix>(1);
   dlerror();
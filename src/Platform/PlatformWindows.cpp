@@ -497,6 +497,63 @@ Path getcwd() {
   }
 }
 
+double monotonic_time() {
+  LARGE_INTEGER frequency, counter;
+  if (!QueryPerformanceFrequency(&frequency) || !QueryPerformanceCounter(&counter))
+    Windows::throw_last_error();
+  return double(counter.QuadPart) / double(frequency.QuadPart);
+}
+
+unsigned long process_id() {
+  return GetCurrentProcessId();
+}
+
+namespace {
+  struct ThreadStart {
+    void (*callback) (void*,unsigned);
+    void *arg;
+    unsigned index;
+  };
+
+  DWORD WINAPI thread_start(LPVOID ptr) {
+    const ThreadStart& start = *static_cast<const ThreadStart*>(ptr);
+    start.callback(start.arg, start.index);
+    return 0;
+  }
+}
+
+void run_threads(unsigned n_threads, void (*callback) (void*,unsigned), void *arg) {
+  std::vector<ThreadStart> starts(n_threads);
+  std::vector<HANDLE> threads;
+  threads.reserve(n_threads);
+  DWORD errcode = 0;
+  for (unsigned ii = 0; ii != n_threads; ++ii) {
+    starts[ii].callback = callback;
+    starts[ii].arg = arg;
+    starts[ii].index = ii;
+    HANDLE thread = CreateThread(NULL, 0, thread_start, &starts[ii], 0, NULL);
+    if (!thread) {
+      errcode = GetLastError();
+      break;
+    }
+    threads.push_back(thread);
+  }
+
+  for (std::vector<HANDLE>::iterator ii = threads.begin(), ie = threads.end(); ii != ie; ++ii) {
+    WaitForSingleObject(*ii, INFINITE);
+    CloseHandle(*ii);
+  }
+
+  if (errcode != 0) {
+    SetLastError(errcode);
+    Windows::throw_last_error();
+  }
+}
+
+boost::optional<std::size_t> symbol_size(const void*) {
+  return boost::none;
+}
+
 boost::optional<Path> find_in_path(const Path& name) {
   if (name.data().find_first_of(L"/\\") != std::string::npos) {
     Path abs_path = name.absolute();
@@ -577,6 +634,61 @@ std::vector<char> load_file(HANDLE hfile) {
     data.resize(data.size()*2);
   }
 }
+
+/// File data held in a buffer
+class FileDataBuffer : public FileData {
+  std::vector<char> m_data;
+
+public:
+  FileDataBuffer(std::vector<char>& data) {
+    m_data.swap(data);
+    m_begin = vector_begin_ptr(m_data);
+    m_end = vector_end_ptr(m_data);
+  }
+};
+
+/// File data mapped into memory
+class FileDataMapped : public FileData {
+public:
+  FileDataMapped(const void *ptr, std::size_t size) {
+    m_begin = static_cast<const char*>(ptr);
+    m_end = m_begin + size;
+  }
+
+  virtual ~FileDataMapped() {
+    UnmapViewOfFile(m_begin);
+  }
+};
+}
+
+SharedPtr<FileData> read_file(const Path& path) {
+  Handle<> file_handle(CreateFileW(path.data().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL));
+  if (file_handle.handle == INVALID_HANDLE_VALUE) {
+    file_handle.handle = NULL;
+    Windows::throw_last_error();
+  }
+
+  LARGE_INTEGER size;
+  if (GetFileType(file_handle.handle) == FILE_TYPE_DISK) {
+    if (!GetFileSizeEx(file_handle.handle, &size))
+      Windows::throw_last_error();
+    if ((size.QuadPart > 0) && (std::size_t(size.QuadPart) == size.QuadPart)) {
+      Handle<> mapping(CreateFileMappingW(file_handle.handle, NULL, PAGE_READONLY, 0, 0, NULL));
+      if (mapping.handle) {
+        // The view keeps the mapping alive once the handles are closed
+        if (const void *ptr = MapViewOfFile(mapping.handle, FILE_MAP_READ, 0, 0, 0))
+          return SharedPtr<FileData>(new FileDataMapped(ptr, size.QuadPart));
+      }
+    }
+  }
+
+  std::vector<char> data = load_file(file_handle.handle);
+  return SharedPtr<FileData>(new FileDataBuffer(data));
+}
+
+SharedPtr<FileData> read_standard_input() {
+  std::vector<char> data = load_file(GetStdHandle(STD_INPUT_HANDLE));
+  return SharedPtr<FileData>(new FileDataBuffer(data));
 }
 
 void read_configuration_files(PropertyValue& pv, const std::string& name) {
@@ -2,8 +2,13 @@
 #define HPP_PSI_SHARED_MAP
 
 #include "Runtime.hpp"
+#include <climits>
+#include <new>
+#include <boost/cstdint.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/iterator/iterator_facade.hpp>
+#include <boost/type_traits/alignment_of.hpp>
 
 namespace Psi {
   template<typename T, typename Comparator=std::less<T> >
@@ -104,7 +109,8 @@ namespace Psi {
       std::pair<bool, violation_type> result(node_insert(m_root, value));
       PSI_ASSERT(m_root.unique());
       m_root->color = black;
-      ++m_size;
+      if (!result.first)
+        ++m_size;
       return result.first;
     }
     
@@ -314,14 +320,451 @@ namespace Psi {
       std::swap(m_size, src.m_size);
       std::swap(m_comparator, src.m_comparator);
       std::swap(m_key_function, src.m_key_function);
-      m_root.swap(src.m_root);
+      std::swap(m_root, src.m_root);
+    }
+  };
+
+  /**
+   * \brief A persistent hash array mapped trie.
+   *
+   * Like SharedRbTree, tries may share nodes so that copying is O(1)
+   * and copy-plus-insert only copies the nodes on the path to the new
+   * value. Each node covers five bits of the key hash and stores its
+   * values and child pointers inline in a single allocation, indexed
+   * by a pair of 32 bit bitmaps, so lookups touch at most
+   * log<sub>32</sub>(n) nodes and perform a single key comparison.
+   *
+   * Nodes carry an intrusive, non-atomic reference count; a node which
+   * is only reachable from one trie is modified in place rather than
+   * copied. Keys whose hashes are entirely equal are stored in a
+   * collision node once all hash bits have been used.
+   *
+   * \tparam KeyType Type of the key -only-; i.e. the type returned by
+   * KeyFunction.
+   *
+   * \tparam ValueType Includes the whole value, including the key.
+   *
+   * \tparam KeyFunction Function to extract the key from the an
+   * instance of ValueType.
+   *
+   * \tparam Hasher Hash function object for KeyType.
+   *
+   * \tparam Equals Equality function object for KeyType.
+   */
+  template<typename KeyType,
+           typename ValueType,
+           typename KeyFunction,
+           typename Hasher,
+           typename Equals>
+  class SharedHashTrie {
+  public:
+    typedef Hasher hasher;
+    typedef Equals key_equal;
+    typedef KeyFunction key_function_type;
+    typedef KeyType key_type;
+    typedef ValueType value_type;
+
+    SharedHashTrie(const hasher& hash=hasher(), const key_equal& equals=key_equal(), const key_function_type& key_function=key_function_type())
+    : m_hasher(hash), m_equals(equals), m_key_function(key_function) {
+    }
+
+    /**
+     * As for SharedRbTree, only const access to values is provided
+     * since nodes may be shared with other tries.
+     */
+    const value_type* lookup(const key_type& key) const {
+      std::size_t hash = key_hash(key);
+      const Node *node = m_root.get();
+      if (!node)
+        return NULL;
+
+      for (unsigned shift = 0; shift < hash_bits; shift += bits_per_level) {
+        bitmap_type bit = slot_bit(hash, shift);
+        if (node->value_map & bit) {
+          const value_type& value = node->values()[slot_index(node->value_map, bit)];
+          return m_equals(key, m_key_function(value)) ? &value : NULL;
+        } else if (node->child_map & bit) {
+          node = node->children()[slot_index(node->child_map, bit)];
+        } else {
+          return NULL;
+        }
+      }
+
+      const value_type *values = node->values();
+      for (unsigned ii = 0, ie = node->n_values; ii != ie; ++ii) {
+        if (m_equals(key, m_key_function(values[ii])))
+          return &values[ii];
+      }
+      return NULL;
+    }
+
+    /// \brief Number of elements in this trie
+    std::size_t size() const {return m_root ? m_root->size : 0;}
+
+    /**
+     * Insert a value into the trie. If there is another value with the
+     * same key, it is replaced.
+     *
+     * \return True if there was a previous value for the same key,
+     * false otherwise.
+     */
+    bool insert(const value_type& value) {
+      bool found;
+      bool unique = m_root && (m_root->refcount == 1);
+      NodePtr root = insert_node(m_root.get(), value, key_hash(m_key_function(value)), 0, unique, true, found);
+      m_root = root;
+      return found;
+    }
+
+    /**
+     * \brief Merge another trie into this one.
+     *
+     * Values in \c src replace values in this trie with the same key.
+     * Subtries which are shared between the two tries are not visited,
+     * so merging tries derived from a common parent costs time
+     * proportional to the number of nodes in which they differ.
+     */
+    void merge(const SharedHashTrie& src) {
+      NodePtr root = merge_node(m_root.get(), src.m_root.get(), 0);
+      m_root = root;
+    }
+
+    friend void swap(SharedHashTrie& a, SharedHashTrie& b) {
+      a.swap(b);
+    }
+
+  private:
+    typedef boost::uint32_t bitmap_type;
+    static const unsigned bits_per_level = 5;
+    static const unsigned slots_per_node = 32;
+    static const unsigned hash_bits = sizeof(std::size_t) * CHAR_BIT;
+
+    /**
+     * Nodes are followed in memory by an array of \c n_children child
+     * pointers and then \c n_values values. Below the last level of
+     * the trie both bitmaps are zero and the values are a list of
+     * keys whose hashes collide.
+     */
+    struct Node {
+      std::size_t refcount;
+      /// \brief Number of values in this subtrie
+      std::size_t size;
+      bitmap_type value_map, child_map;
+      unsigned n_children;
+      /// \brief Number of values constructed so far
+      unsigned n_values;
+
+      static std::size_t values_offset(unsigned n_children) {
+        const std::size_t align = boost::alignment_of<value_type>::value;
+        return (sizeof(Node) + n_children * sizeof(Node*) + align - 1) / align * align;
+      }
+
+      Node** children() {return reinterpret_cast<Node**>(this + 1);}
+      Node *const* children() const {return reinterpret_cast<Node *const*>(this + 1);}
+      value_type* values() {return reinterpret_cast<value_type*>(reinterpret_cast<char*>(this) + values_offset(n_children));}
+      const value_type* values() const {return reinterpret_cast<const value_type*>(reinterpret_cast<const char*>(this) + values_offset(n_children));}
+
+      friend void intrusive_ptr_add_ref(Node *node) {
+        ++node->refcount;
+      }
+
+      friend void intrusive_ptr_release(Node *node) {
+        if (--node->refcount == 0)
+          destroy(node);
+      }
+
+      static void destroy(Node *node) {
+        value_type *values = node->values();
+        for (unsigned ii = 0, ie = node->n_values; ii != ie; ++ii)
+          values[ii].~value_type();
+        Node **children = node->children();
+        for (unsigned ii = 0, ie = node->n_children; ii != ie; ++ii)
+          intrusive_ptr_release(children[ii]);
+        node->~Node();
+        ::operator delete(node);
+      }
+    };
+
+    typedef IntrusivePointer<Node> NodePtr;
+
+    hasher m_hasher;
+    key_equal m_equals;
+    key_function_type m_key_function;
+    NodePtr m_root;
+
+    /**
+     * Pointer hashes have few significant low bits, so spread the hash
+     * over the whole word using Fibonacci hashing before it is used to
+     * index nodes.
+     */
+    std::size_t key_hash(const key_type& key) const {
+      const std::size_t multiplier = (std::size_t(0x9E3779B9u) << 16 << 16) | std::size_t(0x7F4A7C15u);
+      std::size_t hash = m_hasher(key) * multiplier;
+      return hash ^ (hash >> (hash_bits / 2));
+    }
+
+    static bitmap_type slot_bit(std::size_t hash, unsigned shift) {
+      return bitmap_type(1) << ((hash >> shift) & (slots_per_node - 1));
+    }
+
+    static unsigned popcount(bitmap_type x) {
+#if defined(__GNUC__)
+      return __builtin_popcount(x);
+#else
+      x = x - ((x >> 1) & 0x55555555u);
+      x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+      x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+      return (x * 0x01010101u) >> 24;
+#endif
+    }
+
+    /// \brief Index of the entry for \c bit among the entries in \c map.
+    static unsigned slot_index(bitmap_type map, bitmap_type bit) {
+      return popcount(map & (bit - 1));
+    }
+
+    /**
+     * \brief Allocate a node.
+     *
+     * Children are acquired by the new node; values are copied.
+     */
+    static NodePtr make_node(bitmap_type value_map, bitmap_type child_map, unsigned n_values,
+                             const value_type *const *values, Node *const *children, std::size_t size) {
+      unsigned n_children = popcount(child_map);
+      void *ptr = ::operator new(Node::values_offset(n_children) + n_values * sizeof(value_type));
+      Node *node = new (ptr) Node();
+      node->refcount = 0;
+      node->size = size;
+      node->value_map = value_map;
+      node->child_map = child_map;
+      node->n_children = n_children;
+      node->n_values = 0;
+
+      Node **node_children = node->children();
+      for (unsigned ii = 0; ii != n_children; ++ii) {
+        node_children[ii] = children[ii];
+        intrusive_ptr_add_ref(children[ii]);
+      }
+
+      // Values are constructed last so that a throwing copy constructor leaves a node which can be destroyed
+      NodePtr result(node);
+      value_type *node_values = node->values();
+      for (; node->n_values != n_values; ++node->n_values)
+        new (node_values + node->n_values) value_type(*values[node->n_values]);
+
+      return result;
+    }
+
+    /// \brief Build a node containing two values with different keys.
+    NodePtr make_pair_node(const value_type& first, std::size_t first_hash,
+                           const value_type& second, std::size_t second_hash, unsigned shift) const {
+      const value_type *values[2] = {&first, &second};
+      if (shift >= hash_bits)
+        return make_node(0, 0, 2, values, NULL, 2);
+
+      bitmap_type first_bit = slot_bit(first_hash, shift), second_bit = slot_bit(second_hash, shift);
+      if (first_bit == second_bit) {
+        NodePtr child = make_pair_node(first, first_hash, second, second_hash, shift + bits_per_level);
+        Node *children[1] = {child.get()};
+        return make_node(0, first_bit, 0, NULL, children, 2);
+      }
+
+      if (second_bit < first_bit)
+        std::swap(values[0], values[1]);
+      return make_node(first_bit | second_bit, 0, 2, values, NULL, 2);
+    }
+
+    /**
+     * \brief Insert a value into the subtrie rooted at \c node.
+     *
+     * \param unique Whether \c node and every node above it are only
+     * referenced from the trie being modified, in which case \c node
+     * may be updated in place.
+     * \param overwrite Whether an existing value for the same key is
+     * replaced.
+     * \param found Set to whether a value for the key was already
+     * present.
+     *
+     * \return The new root of this subtrie.
+     */
+    NodePtr insert_node(Node *node, const value_type& value, std::size_t hash, unsigned shift,
+                        bool unique, bool overwrite, bool& found) const {
+      found = false;
+      const value_type *value_ptr = &value;
+      if (!node)
+        return make_node(shift < hash_bits ? slot_bit(hash, shift) : 0, 0, 1, &value_ptr, NULL, 1);
+
+      const key_type& key = m_key_function(value);
+      value_type *values = node->values();
+      Node **children = node->children();
+
+      if (shift >= hash_bits) {
+        PSI_STD::vector<const value_type*> new_values;
+        for (unsigned ii = 0, ie = node->n_values; ii != ie; ++ii) {
+          if (!found && m_equals(key, m_key_function(values[ii]))) {
+            found = true;
+            if (!overwrite)
+              return NodePtr(node);
+            if (unique) {
+              values[ii] = value;
+              return NodePtr(node);
+            }
+            new_values.push_back(&value);
+          } else {
+            new_values.push_back(&values[ii]);
+          }
+        }
+        if (!found)
+          new_values.push_back(&value);
+        return make_node(0, 0, new_values.size(), &new_values[0], NULL, new_values.size());
+      }
+
+      const value_type *new_values[slots_per_node];
+      Node *new_children[slots_per_node];
+      bitmap_type bit = slot_bit(hash, shift);
+
+      if (node->value_map & bit) {
+        unsigned index = slot_index(node->value_map, bit);
+        const value_type& existing = values[index];
+        if (m_equals(key, m_key_function(existing))) {
+          found = true;
+          if (!overwrite)
+            return NodePtr(node);
+          if (unique) {
+            values[index] = value;
+            return NodePtr(node);
+          }
+
+          for (unsigned ii = 0, ie = node->n_values; ii != ie; ++ii)
+            new_values[ii] = &values[ii];
+          new_values[index] = &value;
+          return make_node(node->value_map, node->child_map, node->n_values, new_values, children, node->size);
+        }
+
+        // Push the existing value and the new one down into a new child
+        NodePtr child = make_pair_node(existing, key_hash(m_key_function(existing)), value, hash, shift + bits_per_level);
+        unsigned child_index = slot_index(node->child_map, bit);
+        for (unsigned ii = 0; ii != index; ++ii)
+          new_values[ii] = &values[ii];
+        for (unsigned ii = index + 1, ie = node->n_values; ii != ie; ++ii)
+          new_values[ii - 1] = &values[ii];
+        std::copy(children, children + child_index, new_children);
+        new_children[child_index] = child.get();
+        std::copy(children + child_index, children + node->n_children, new_children + child_index + 1);
+        return make_node(node->value_map & ~bit, node->child_map | bit, node->n_values - 1, new_values, new_children, node->size + 1);
+      } else if (node->child_map & bit) {
+        unsigned index = slot_index(node->child_map, bit);
+        Node *child = children[index];
+        NodePtr new_child = insert_node(child, value, hash, shift + bits_per_level, unique && (child->refcount == 1), overwrite, found);
+        if (unique) {
+          if (new_child.get() != child) {
+            children[index] = new_child.release();
+            intrusive_ptr_release(child);
+          }
+          if (!found)
+            ++node->size;
+          return NodePtr(node);
+        } else if (new_child.get() == child) {
+          return NodePtr(node);
+        }
+
+        for (unsigned ii = 0, ie = node->n_values; ii != ie; ++ii)
+          new_values[ii] = &values[ii];
+        std::copy(children, children + node->n_children, new_children);
+        new_children[index] = new_child.get();
+        return make_node(node->value_map, node->child_map, node->n_values, new_values, new_children, node->size + !found);
+      } else {
+        unsigned index = slot_index(node->value_map, bit);
+        for (unsigned ii = 0; ii != index; ++ii)
+          new_values[ii] = &values[ii];
+        new_values[index] = &value;
+        for (unsigned ii = index, ie = node->n_values; ii != ie; ++ii)
+          new_values[ii + 1] = &values[ii];
+        return make_node(node->value_map | bit, node->child_map, node->n_values + 1, new_values, children, node->size + 1);
+      }
+    }
+
+    /**
+     * \brief Merge the subtrie \c src into \c dest.
+     *
+     * Neither subtrie is modified.
+     */
+    NodePtr merge_node(Node *dest, Node *src, unsigned shift) const {
+      if (!src || (dest == src))
+        return NodePtr(dest);
+      if (!dest)
+        return NodePtr(src);
+
+      bool found;
+      if (shift >= hash_bits) {
+        NodePtr result(dest);
+        const value_type *src_values = src->values();
+        for (unsigned ii = 0, ie = src->n_values; ii != ie; ++ii)
+          result = insert_node(result.get(), src_values[ii], 0, shift, false, true, found);
+        return result;
+      }
+
+      const value_type *new_values[slots_per_node];
+      Node *new_children[slots_per_node];
+      // Keeps newly created children alive until they are acquired by the new node
+      NodePtr created[slots_per_node];
+      unsigned n_values = 0, n_children = 0;
+      std::size_t size = 0;
+      bitmap_type child_map = 0;
+
+      bitmap_type used = dest->value_map | dest->child_map | src->value_map | src->child_map;
+      for (bitmap_type remaining = used; remaining; remaining &= remaining - 1) {
+        bitmap_type bit = remaining & ~(remaining - 1);
+        const value_type *dest_value = (dest->value_map & bit) ? &dest->values()[slot_index(dest->value_map, bit)] : NULL;
+        Node *dest_child = (dest->child_map & bit) ? dest->children()[slot_index(dest->child_map, bit)] : NULL;
+        const value_type *src_value = (src->value_map & bit) ? &src->values()[slot_index(src->value_map, bit)] : NULL;
+        Node *src_child = (src->child_map & bit) ? src->children()[slot_index(src->child_map, bit)] : NULL;
+
+        NodePtr& child = created[n_children];
+        if (src_value) {
+          if (dest_value && !m_equals(m_key_function(*dest_value), m_key_function(*src_value))) {
+            child = make_pair_node(*dest_value, key_hash(m_key_function(*dest_value)),
+                                   *src_value, key_hash(m_key_function(*src_value)), shift + bits_per_level);
+          } else if (dest_child) {
+            child = insert_node(dest_child, *src_value, key_hash(m_key_function(*src_value)), shift + bits_per_level, false, true, found);
+          } else {
+            new_values[n_values++] = src_value;
+            ++size;
+            continue;
+          }
+        } else if (src_child) {
+          if (dest_value)
+            child = insert_node(src_child, *dest_value, key_hash(m_key_function(*dest_value)), shift + bits_per_level, false, false, found);
+          else
+            child = merge_node(dest_child, src_child, shift + bits_per_level);
+        } else if (dest_value) {
+          new_values[n_values++] = dest_value;
+          ++size;
+          continue;
+        } else {
+          child.reset(dest_child);
+        }
+
+        new_children[n_children++] = child.get();
+        child_map |= bit;
+        size += child->size;
+      }
+
+      return make_node(used & ~child_map, child_map, n_values, new_values, new_children, size);
+    }
+
+    void swap(SharedHashTrie& src) {
+      std::swap(m_hasher, src.m_hasher);
+      std::swap(m_equals, src.m_equals);
+      std::swap(m_key_function, src.m_key_function);
+      std::swap(m_root, src.m_root);
     }
   };
 
   /**
    * \brief A map which can be duplicated in O(1) by sharing nodes.
    */
-  template<typename K, typename V, typename Cmp=std::less<K> >
+  template<typename K, typename V, typename Hash=boost::hash<K>, typename Equals=std::equal_to<K> >
   class SharedMap {
   public:
     typedef K key_type;
@@ -335,19 +778,21 @@ namespace Psi {
       }
     };
     
-    SharedRbTree<key_type, value_type, Get1st, ThreeWayComparatorAdaptor<key_type, Cmp> > m_tree;
+    SharedHashTrie<key_type, value_type, Get1st, Hash, Equals> m_trie;
     
   public:
-    bool insert(const value_type& value) {return m_tree.insert(value);}
-    bool put(const key_type& key, const mapped_type& value) {return m_tree.insert(value_type(key, value));}
-    const mapped_type* lookup(const key_type& key) const {const value_type *ptr = m_tree.lookup(key); return ptr ? &ptr->second : NULL;}
-    const mapped_type get_default(const key_type& key, const mapped_type& def=mapped_type()) const {const value_type *ptr = m_tree.lookup(key); return ptr ? ptr->second : def;}
+    bool insert(const value_type& value) {return m_trie.insert(value);}
+    bool put(const key_type& key, const mapped_type& value) {return m_trie.insert(value_type(key, value));}
+    const mapped_type* lookup(const key_type& key) const {const value_type *ptr = m_trie.lookup(key); return ptr ? &ptr->second : NULL;}
+    const mapped_type get_default(const key_type& key, const mapped_type& def=mapped_type()) const {const value_type *ptr = m_trie.lookup(key); return ptr ? ptr->second : def;}
+    std::size_t size() const {return m_trie.size();}
+    void merge(const SharedMap& src) {m_trie.merge(src.m_trie);}
   };
   
   /**
    * \brief A set which can be duplicated in O(1) by sharing nodes.
    */
-  template<typename V, typename Cmp=std::less<V> >
+  template<typename V, typename Hash=boost::hash<V>, typename Equals=std::equal_to<V> >
   class SharedSet {
   public:
     typedef V value_type;
@@ -359,12 +804,13 @@ namespace Psi {
       }
     };
     
-    SharedRbTree<value_type, value_type, Forward, ThreeWayComparatorAdaptor<value_type, Cmp> > m_tree;
+    SharedHashTrie<value_type, value_type, Forward, Hash, Equals> m_trie;
 
   public:
-    bool insert(const value_type& v) {return m_tree.insert(v);}
-    bool contains(const value_type& v) {return m_tree.lookup(v);}
-    void merge(const SharedSet& src) {m_tree.merge(src.m_tree);}
+    bool insert(const value_type& v) {return m_trie.insert(v);}
+    bool contains(const value_type& v) {return m_trie.lookup(v);}
+    std::size_t size() const {return m_trie.size();}
+    void merge(const SharedSet& src) {m_trie.merge(src.m_trie);}
   };
   
   /**
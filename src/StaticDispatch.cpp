@@ -4,6 +4,8 @@
 
 #include <boost/format.hpp>
 
+#include <algorithm>
+
 namespace Psi {
   namespace Compiler {
     template<typename V>
@@ -18,13 +20,13 @@ namespace Psi {
       self.values();
     }
     
-    const SIVtable OverloadType::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.OverloadType", Tree);
+    const SIVtable OverloadType::vtable = PSI_COMPILER_TREE_ABSTRACT(OverloadType, "psi.compiler.OverloadType", Tree);
     
     void OverloadValue::local_complete_impl(const OverloadValue& self) {
       self.overload_pattern();
     }
 
-    const SIVtable OverloadValue::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.OverloadValue", Tree);
+    const SIVtable OverloadValue::vtable = PSI_COMPILER_TREE_ABSTRACT(OverloadValue, "psi.compiler.OverloadValue", Tree);
     
     template<typename V>
     void Interface::visit(V& v) {
@@ -68,7 +70,7 @@ namespace Psi {
     
     const TreeVtable MetadataType::vtable = PSI_COMPILER_TREE(MetadataType, "psi.compiler.MetadataType", OverloadType);
     
-    const SIVtable Metadata::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.Metadata", OverloadValue);
+    const SIVtable Metadata::vtable = PSI_COMPILER_TREE_ABSTRACT(Metadata, "psi.compiler.Metadata", OverloadValue);
     
     class ConstantMetadata : public Metadata {
     public:
@@ -178,14 +180,16 @@ namespace Psi {
       }
         
       if (TreePtr<TypeInstance> instance = dyn_treeptr_cast<TypeInstance>(my_term)) {
+        OverloadLookupCache& cache = type->compile_context().overload_cache();
         const PSI_STD::vector<TreePtr<OverloadValue> >& overloads = instance->generic->overloads();
-        for (unsigned ii = 0, ie = overloads.size(); ii != ie; ++ii) {
-          const TreePtr<OverloadValue>& v = overloads[ii];
-          if (v && (type == v->overload_type)) {
-            const OverloadPattern& patt = v->overload_pattern();
-            if (overload_pattern_match(patt.pattern, parameters, patt.n_wildcards, scratch))
-              results.push_back(OverloadLookupResult(v, scratch));
-          }
+        PSI_STD::vector<unsigned> candidates;
+        cache.candidates(type, instance->generic, overloads, parameters, candidates);
+        for (PSI_STD::vector<unsigned>::const_iterator ii = candidates.begin(), ie = candidates.end(); ii != ie; ++ii) {
+          const TreePtr<OverloadValue>& v = overloads[*ii];
+          PSI_ASSERT(v && (type == v->overload_type));
+          const OverloadPattern& patt = v->overload_pattern();
+          if (overload_pattern_match(patt.pattern, parameters, patt.n_wildcards, scratch))
+            results.push_back(OverloadLookupResult(v, scratch));
         }
         
         const PSI_STD::vector<TreePtr<Term> >& parameters = instance->parameters;
@@ -207,20 +211,21 @@ namespace Psi {
     }
     
     /**
-     * \brief Perform a generic overloaded value search.
+     * \brief Search for and select the most specific overload.
      * 
-     * This is the base implementation for both metadata_lookup and implementation_lookup,
-     * and should be used for anything else which subclasses OverloadType.
+     * This is the uncached implementation of overload_lookup().
      */
-    OverloadLookupResult overload_lookup(const TreePtr<OverloadType>& type, const PSI_STD::vector<TreePtr<Term> >& parameters,
-                                         const SourceLocation& location, const PSI_STD::vector<TreePtr<OverloadValue> >& extra) {
+    OverloadLookupResult overload_lookup_uncached(const TreePtr<OverloadType>& type, const PSI_STD::vector<TreePtr<Term> >& parameters,
+                                                  const SourceLocation& location, const PSI_STD::vector<TreePtr<OverloadValue> >& extra) {
       std::vector<OverloadLookupResult> results;
       PSI_STD::vector<TreePtr<Term> > match_scratch;
 
       // Find all possible matching overloads
       const PSI_STD::vector<TreePtr<OverloadValue> >& type_values = type->values();
-      for (unsigned ii = 0, ie = type_values.size(); ii != ie; ++ii) {
-        const TreePtr<OverloadValue>& v = type_values[ii];
+      PSI_STD::vector<unsigned> candidates;
+      type->compile_context().overload_cache().candidates(type, TreePtr<Tree>(), type_values, parameters, candidates);
+      for (PSI_STD::vector<unsigned>::const_iterator ii = candidates.begin(), ie = candidates.end(); ii != ie; ++ii) {
+        const TreePtr<OverloadValue>& v = type_values[*ii];
         PSI_ASSERT(v && (!v->overload_type || (v->overload_type == type)));
         const OverloadPattern& patt = v->overload_pattern();
         if(overload_pattern_match(patt.pattern, parameters, patt.n_wildcards, match_scratch))
@@ -305,6 +310,180 @@ namespace Psi {
       return results[best_idx];
     }
 
+    /**
+     * \brief Perform a generic overloaded value search.
+     * 
+     * This is the base implementation for both metadata_lookup and implementation_lookup,
+     * and should be used for anything else which subclasses OverloadType.
+     * 
+     * Results are memoized in the OverloadLookupCache of the compile context.
+     */
+    OverloadLookupResult overload_lookup(const TreePtr<OverloadType>& type, const PSI_STD::vector<TreePtr<Term> >& parameters,
+                                         const SourceLocation& location, const PSI_STD::vector<TreePtr<OverloadValue> >& extra) {
+      OverloadLookupCache& cache = type->compile_context().overload_cache();
+      if (const OverloadLookupResult *cached = cache.find(type, parameters, extra))
+        return *cached;
+      
+      OverloadLookupResult result = overload_lookup_uncached(type, parameters, location, extra);
+      cache.insert(type, parameters, extra, result);
+      return result;
+    }
+    
+    OverloadLookupCache::OverloadLookupCache() {
+      m_statistics.hits = m_statistics.misses = m_statistics.candidates = 0;
+    }
+    
+    OverloadLookupCache::~OverloadLookupCache() {
+    }
+    
+    std::size_t OverloadLookupCache::KeyHasher::operator () (const Key& key) const {
+      std::size_t h = 0;
+      boost::hash_combine(h, key.type);
+      boost::hash_range(h, key.parameters.begin(), key.parameters.end());
+      boost::hash_range(h, key.extra.begin(), key.extra.end());
+      return h;
+    }
+    
+    /**
+     * \brief Find the result of an earlier lookup.
+     * 
+     * \return The cached result, or NULL if this lookup has not been performed.
+     */
+    const OverloadLookupResult* OverloadLookupCache::find(const TreePtr<OverloadType>& type, const PSI_STD::vector<TreePtr<Term> >& parameters,
+                                                          const PSI_STD::vector<TreePtr<OverloadValue> >& extra) {
+      // Reuse the storage of m_scratch to avoid allocating a key for every lookup
+      m_scratch.type = type;
+      m_scratch.parameters.assign(parameters.begin(), parameters.end());
+      m_scratch.extra.assign(extra.begin(), extra.end());
+      MapType::const_iterator it = m_entries.find(m_scratch);
+      
+      // Do not hold references beyond this call
+      m_scratch.type.reset();
+      m_scratch.parameters.clear();
+      m_scratch.extra.clear();
+      
+      if (it == m_entries.end())
+        return NULL;
+      ++m_statistics.hits;
+      return &it->second;
+    }
+    
+    /**
+     * \brief Record the result of a lookup.
+     */
+    void OverloadLookupCache::insert(const TreePtr<OverloadType>& type, const PSI_STD::vector<TreePtr<Term> >& parameters,
+                                     const PSI_STD::vector<TreePtr<OverloadValue> >& extra, const OverloadLookupResult& result) {
+      Key key;
+      key.type = type;
+      key.parameters = parameters;
+      key.extra = extra;
+      if (m_entries.insert(std::make_pair(key, result)).second)
+        ++m_statistics.misses;
+    }
+    
+    /**
+     * \brief Find the entries of a list of overload candidates which may match a set of parameters.
+     * 
+     * The list is indexed the first time it is searched.
+     * 
+     * \param type Overload type being looked up.
+     * \param owner Tree which \c values belongs to: either NULL, in which case
+     * \c values is <tt>type->values()</tt>, or a GenericType, in which case \c values
+     * is the generic's overload list and only entries for \c type are considered.
+     * \param result Receives indices into \c values.
+     */
+    void OverloadLookupCache::candidates(const TreePtr<OverloadType>& type, const TreePtr<Tree>& owner, const PSI_STD::vector<TreePtr<OverloadValue> >& values,
+                                         const PSI_STD::vector<TreePtr<Term> >& parameters, PSI_STD::vector<unsigned>& result) {
+      std::pair<TreePtr<OverloadType>, TreePtr<Tree> > key(type, owner);
+      IndexMapType::iterator it = m_indices.find(key);
+      if (it == m_indices.end())
+        it = m_indices.insert(std::make_pair(key, OverloadIndex(values, owner ? type : TreePtr<OverloadType>()))).first;
+      it->second.candidates(parameters, result);
+      m_statistics.candidates += result.size();
+    }
+    
+    /**
+     * \brief Remove all entries, releasing the trees they refer to.
+     */
+    void OverloadLookupCache::clear() {
+      m_entries.clear();
+      m_indices.clear();
+    }
+    
+    /**
+     * \brief Index a list of overload candidates.
+     * 
+     * \param type If not NULL, only entries in \c values for this overload type are indexed.
+     */
+    OverloadIndex::OverloadIndex(const PSI_STD::vector<TreePtr<OverloadValue> >& values, const TreePtr<OverloadType>& type)
+    : m_n_positions(0) {
+      for (unsigned ii = 0, ie = values.size(); ii != ie; ++ii) {
+        const TreePtr<OverloadValue>& v = values[ii];
+        if (type && (!v || (v->overload_type != type)))
+          continue;
+        
+        const PSI_STD::vector<TreePtr<Term> >& pattern = v->overload_pattern().pattern;
+        Head h;
+        unsigned position = 0;
+        for (unsigned je = pattern.size(); position != je; ++position) {
+          if (head(pattern[position], h))
+            break;
+        }
+        
+        if (position == pattern.size()) {
+          m_unkeyed.push_back(ii);
+        } else {
+          m_keyed[Key(position, h)].push_back(ii);
+          m_n_positions = std::max(m_n_positions, position + 1);
+        }
+      }
+    }
+    
+    /**
+     * \brief Get the head of a term for indexing.
+     * 
+     * Mirrors the cases in which pattern matching requires both sides to
+     * be the same kind of tree.
+     * 
+     * \return False if \c term may be matched by, or as a pattern may match,
+     * a term with a different head: NULL, wildcards, impure terms and
+     * UpwardReferenceNull.
+     */
+    bool OverloadIndex::head(const TreePtr<Term>& term, Head& result) {
+      TreePtr<Term> unwrapped = term_unwrap(term);
+      if (!unwrapped || !unwrapped->pure || tree_isa<Parameter>(unwrapped) || tree_isa<UpwardReferenceNull>(unwrapped))
+        return false;
+      
+      result.first = si_vptr(unwrapped.get());
+      if (TreePtr<TypeInstance> instance = dyn_treeptr_cast<TypeInstance>(unwrapped))
+        result.second = instance->generic.get();
+      else
+        result.second = NULL;
+      return true;
+    }
+    
+    /**
+     * \brief Get the indices of candidates which may match a set of parameters.
+     * 
+     * Indices are returned in the order of the original list, so the
+     * candidates are tried in the same order as an unindexed search.
+     */
+    void OverloadIndex::candidates(const PSI_STD::vector<TreePtr<Term> >& parameters, PSI_STD::vector<unsigned>& result) const {
+      result.assign(m_unkeyed.begin(), m_unkeyed.end());
+      
+      Head h;
+      for (unsigned ii = 0, ie = std::min<std::size_t>(m_n_positions, parameters.size()); ii != ie; ++ii) {
+        if (!head(parameters[ii], h))
+          continue;
+        
+        boost::unordered_map<Key, PSI_STD::vector<unsigned> >::const_iterator it = m_keyed.find(Key(ii, h));
+        if (it != m_keyed.end())
+          result.insert(result.end(), it->second.begin(), it->second.end());
+      }
+      
+      std::sort(result.begin(), result.end());
+    }
+
     /**
      * \brief Locate an interface implementation for a given set of parameters.
      *
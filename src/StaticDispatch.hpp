@@ -3,6 +3,8 @@
 
 #include "Term.hpp"
 
+#include <boost/unordered_map.hpp>
+
 namespace Psi {
   namespace Compiler {
     class OverloadValue;
@@ -439,6 +441,96 @@ namespace Psi {
     
     OverloadLookupResult overload_lookup(const TreePtr<OverloadType>& type, const PSI_STD::vector<TreePtr<Term> >& parameters,
                                          const SourceLocation& location, const PSI_STD::vector<TreePtr<OverloadValue> >& extra);
+
+    /**
+     * \brief Index of overload candidates by the head of each pattern argument.
+     * 
+     * A pattern argument which is not a wildcard can only match a term of the
+     * same tree type, and in the case of TypeInstance only an instance of the
+     * same generic. Each candidate is filed under the position and head of its
+     * first such argument, so a lookup only needs to pattern-match candidates
+     * filed under the heads of its actual parameters, plus those whose pattern
+     * is entirely wildcards.
+     */
+    class OverloadIndex {
+    public:
+      OverloadIndex(const PSI_STD::vector<TreePtr<OverloadValue> >& values, const TreePtr<OverloadType>& type);
+      void candidates(const PSI_STD::vector<TreePtr<Term> >& parameters, PSI_STD::vector<unsigned>& result) const;
+      
+    private:
+      typedef std::pair<const SIVtable*, const Tree*> Head;
+      typedef std::pair<unsigned, Head> Key;
+      
+      static bool head(const TreePtr<Term>& term, Head& result);
+      
+      boost::unordered_map<Key, PSI_STD::vector<unsigned> > m_keyed;
+      PSI_STD::vector<unsigned> m_unkeyed;
+      unsigned m_n_positions;
+    };
+    
+    /**
+     * \brief Memoizes overload_lookup.
+     * 
+     * The same lookup is repeated many times, particularly during lowering.
+     * Since the candidate lists of an overload type and of generic types
+     * never change once built, and functional terms are hash-consed, the
+     * result of a lookup depends only on the identity of the overload type,
+     * the parameters and the extra candidates, so results are cached by those
+     * pointers.
+     * 
+     * Each entry holds references to the trees in its key, so the addresses
+     * cannot be reused while the entry exists. Failed lookups are not cached.
+     * 
+     * This also holds the OverloadIndex of each candidate list searched,
+     * which is used to narrow the search when the cache misses.
+     */
+    class PSI_COMPILER_EXPORT OverloadLookupCache : public boost::noncopyable {
+    public:
+      /// \brief Usage counts for an OverloadLookupCache.
+      struct Statistics {
+        /// \brief Number of lookups satisfied from the cache.
+        std::size_t hits;
+        /// \brief Number of lookups added to the cache.
+        std::size_t misses;
+        /// \brief Number of indexed candidates pattern-matched by lookups which missed the cache.
+        std::size_t candidates;
+      };
+      
+      OverloadLookupCache();
+      ~OverloadLookupCache();
+      
+      const OverloadLookupResult* find(const TreePtr<OverloadType>& type, const PSI_STD::vector<TreePtr<Term> >& parameters,
+                                       const PSI_STD::vector<TreePtr<OverloadValue> >& extra);
+      void insert(const TreePtr<OverloadType>& type, const PSI_STD::vector<TreePtr<Term> >& parameters,
+                  const PSI_STD::vector<TreePtr<OverloadValue> >& extra, const OverloadLookupResult& result);
+      void candidates(const TreePtr<OverloadType>& type, const TreePtr<Tree>& owner, const PSI_STD::vector<TreePtr<OverloadValue> >& values,
+                      const PSI_STD::vector<TreePtr<Term> >& parameters, PSI_STD::vector<unsigned>& result);
+      void clear();
+      
+      /// \brief Get usage counts for this cache.
+      const Statistics& statistics() const {return m_statistics;}
+      
+    private:
+      struct Key {
+        TreePtr<OverloadType> type;
+        PSI_STD::vector<TreePtr<Term> > parameters;
+        PSI_STD::vector<TreePtr<OverloadValue> > extra;
+        
+        bool operator == (const Key& other) const {return (type == other.type) && (parameters == other.parameters) && (extra == other.extra);}
+      };
+      
+      struct KeyHasher {
+        std::size_t operator () (const Key& key) const;
+      };
+      
+      typedef boost::unordered_map<Key, OverloadLookupResult, KeyHasher> MapType;
+      typedef boost::unordered_map<std::pair<TreePtr<OverloadType>, TreePtr<Tree> >, OverloadIndex> IndexMapType;
+      
+      Statistics m_statistics;
+      MapType m_entries;
+      IndexMapType m_indices;
+      Key m_scratch;
+    };
     
     TreePtr<> metadata_lookup(const TreePtr<MetadataType>& interface, const TreePtr<EvaluateContext>& context,
                               const PSI_STD::vector<TreePtr<Term> >& parameters, const SourceLocation& location);
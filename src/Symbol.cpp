@@ -0,0 +1,55 @@
+#include "Symbol.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Psi {
+  namespace Compiler {
+    namespace {
+      /// A range of characters which can be compared against a String without copying it
+      struct SymbolText {
+        const char *begin, *end;
+        SymbolText(const char *begin_, const char *end_) : begin(begin_), end(end_) {}
+      };
+      
+      struct SymbolTextHash {
+        std::size_t operator () (const SymbolText& text) const {
+          // Must agree with hash_value(const String&)
+          return (text.begin == text.end) ? 0 : boost::hash_range(text.begin, text.end);
+        }
+      };
+      
+      struct SymbolTextEquals {
+        bool operator () (const SymbolText& lhs, const String& rhs) const {
+          std::size_t n = lhs.end - lhs.begin;
+          return (n == rhs.length()) && std::equal(lhs.begin, lhs.end, rhs.c_str());
+        }
+      };
+    }
+    
+    /**
+     * \brief Get the symbol for a name, adding it to the table if necessary.
+     */
+    Symbol SymbolTable::intern(const String& name) {
+      return Symbol(&*m_names.insert(name).first);
+    }
+
+    /// \copydoc SymbolTable::intern(const String&)
+    Symbol SymbolTable::intern(const char *begin, const char *end) {
+      if (Symbol s = find(begin, end))
+        return s;
+      return intern(String(begin, end));
+    }
+    
+    /**
+     * \brief Get the symbol for a name if it has been interned.
+     * 
+     * \return The symbol for this name, or a null symbol if this name has
+     * never been passed to intern().
+     */
+    Symbol SymbolTable::find(const char *begin, const char *end) const {
+      SetType::const_iterator it = m_names.find(SymbolText(begin, end), SymbolTextHash(), SymbolTextEquals());
+      return (it != m_names.end()) ? Symbol(&*it) : Symbol();
+    }
+  }
+}
@@ -0,0 +1,69 @@
+#ifndef HPP_PSI_SYMBOL
+#define HPP_PSI_SYMBOL
+
+#include <boost/functional/hash.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_set.hpp>
+
+#include "Export.hpp"
+#include "Runtime.hpp"
+#include "Visitor.hpp"
+
+namespace Psi {
+  namespace Compiler {
+    /**
+     * \brief An interned identifier.
+     * 
+     * Symbols belonging to the same SymbolTable are equal if and only if
+     * their names are equal, so comparison and hashing only look at the
+     * address of the name. A default constructed symbol is null, and is
+     * not equal to any symbol in a table.
+     */
+    class Symbol {
+      const String *m_name;
+      
+      typedef void (Symbol::*safe_bool_type) () const;
+      void safe_bool_true() const {}
+      
+    public:
+      Symbol() : m_name(NULL) {}
+      explicit Symbol(const String *name) : m_name(name) {}
+      
+      /// \brief Get the text of this symbol.
+      const String& name() const {PSI_ASSERT(m_name); return *m_name;}
+      
+      bool operator == (const Symbol& other) const {return m_name == other.m_name;}
+      bool operator != (const Symbol& other) const {return m_name != other.m_name;}
+      bool operator < (const Symbol& other) const {return m_name < other.m_name;}
+      
+      bool operator ! () const {return !m_name;}
+      operator safe_bool_type () const {return m_name ? &Symbol::safe_bool_true : 0;}
+      
+      friend std::size_t hash_value(const Symbol& s) {return boost::hash_value(s.m_name);}
+    };
+    
+    PSI_VISIT_SIMPLE(Symbol)
+    
+    /**
+     * \brief Table of interned identifiers.
+     * 
+     * Names are stored once per table, so lookups of a name in a scope
+     * only need to compare addresses. Finding a name which has not been
+     * interned does not allocate, so looking up a name which is not
+     * defined anywhere is also cheap.
+     */
+    class PSI_COMPILER_EXPORT SymbolTable : public boost::noncopyable {
+      typedef boost::unordered_set<String> SetType;
+      SetType m_names;
+      
+    public:
+      Symbol intern(const String& name);
+      Symbol intern(const char *begin, const char *end);
+      Symbol find(const char *begin, const char *end) const;
+      /// \brief Number of distinct names in this table.
+      std::size_t size() const {return m_names.size();}
+    };
+  }
+}
+
+#endif
@@ -7,10 +7,10 @@
 
 namespace Psi {
   namespace Compiler {
-    const SIVtable TermVisitor::vtable = PSI_COMPILER_SI_ABSTRACT("psi.compiler.TermVisitor", NULL);
-    const SIVtable TermRewriter::vtable = PSI_COMPILER_SI_ABSTRACT("psi.compiler.TermRewriter", NULL);
-    const SIVtable TermBinaryRewriter::vtable = PSI_COMPILER_SI_ABSTRACT("psi.compiler.TermBinaryRewriter", NULL);
-    const SIVtable TermComparator::vtable = PSI_COMPILER_SI_ABSTRACT("psi.compiler.TermComparator", NULL);
+    const SIVtable TermVisitor::vtable = PSI_COMPILER_SI_ABSTRACT(TermVisitor, "psi.compiler.TermVisitor", NULL);
+    const SIVtable TermRewriter::vtable = PSI_COMPILER_SI_ABSTRACT(TermRewriter, "psi.compiler.TermRewriter", NULL);
+    const SIVtable TermBinaryRewriter::vtable = PSI_COMPILER_SI_ABSTRACT(TermBinaryRewriter, "psi.compiler.TermBinaryRewriter", NULL);
+    const SIVtable TermComparator::vtable = PSI_COMPILER_SI_ABSTRACT(TermComparator, "psi.compiler.TermComparator", NULL);
 
     Term::Term(const TermVtable *vptr)
     : Tree(PSI_COMPILER_VPTR_UP(Tree, vptr)),
@@ -329,9 +329,11 @@ namespace Psi {
             PSI_STD::vector<FunctionParameterType> arg_types;
             for (std::size_t ii = 0, ie = lhs_ftype->parameter_types.size(); ii != ie; ++ii) {
               FunctionParameterType arg;
-              if (lhs_ftype->parameter_types[ii].mode != rhs_ftype->parameter_types[ii].mode)
+              if ((lhs_ftype->parameter_types[ii].mode != rhs_ftype->parameter_types[ii].mode) ||
+                (lhs_ftype->parameter_types[ii].flags != rhs_ftype->parameter_types[ii].flags))
                 return maybe_none;
               arg.mode = lhs_ftype->parameter_types[ii].mode;
+              arg.flags = lhs_ftype->parameter_types[ii].flags;
               Maybe<TreePtr<Term> > arg_type = self.binary_rewrite(lhs_ftype->parameter_types[ii].type, rhs_ftype->parameter_types[ii].type, location);
               if (!arg_type)
                 return maybe_none;
@@ -490,7 +492,8 @@ namespace Psi {
             }
             MatchComparator arg_child = self.make_child(self.m_depth + 1, reverse_upref_mode);
             for (std::size_t ii = 0, ie = lhs_ftype->parameter_types.size(); ii != ie; ++ii) {
-              if (lhs_ftype->parameter_types[ii].mode != rhs_ftype->parameter_types[ii].mode)
+              if ((lhs_ftype->parameter_types[ii].mode != rhs_ftype->parameter_types[ii].mode) ||
+                (lhs_ftype->parameter_types[ii].flags != rhs_ftype->parameter_types[ii].flags))
                 return false;
               if (!arg_child.compare(lhs_ftype->parameter_types[ii].type, rhs_ftype->parameter_types[ii].type))
                 return false;
@@ -571,7 +574,7 @@ namespace Psi {
       }
     }
 
-    const SIVtable Term::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.Term", Tree);
+    const SIVtable Term::vtable = PSI_COMPILER_TREE_ABSTRACT(Term, "psi.compiler.Term", Tree);
 
     Metatype::Metatype()
     : Functional(&vtable) {
@@ -602,7 +605,7 @@ namespace Psi {
     : Functional(vptr) {
     }
 
-    const SIVtable Type::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.Type", Functional);
+    const SIVtable Type::vtable = PSI_COMPILER_TREE_ABSTRACT(Type, "psi.compiler.Type", Functional);
 
     Anonymous::Anonymous(const TreePtr<Term>& type, TermMode mode_, const SourceLocation& location)
     : Term(&vtable, TermResultInfo(type, mode_, true), location),
@@ -40,7 +40,7 @@ namespace Psi {
     };
     
 #define PSI_COMPILER_TERM_VISITOR(cls,name,base) { \
-      PSI_COMPILER_SI(name,&base::vtable), \
+      PSI_COMPILER_SI(cls,name,&base::vtable), \
       &::Psi::Compiler::TermVisitorWrapper<cls>::visit \
     }
     
@@ -71,7 +71,7 @@ namespace Psi {
     };
     
 #define PSI_COMPILER_TERM_COMPARATOR(cls,name,base) { \
-      PSI_COMPILER_SI(name,&base::vtable), \
+      PSI_COMPILER_SI(cls,name,&base::vtable), \
       &::Psi::Compiler::TermComparatorWrapper<cls>::compare \
     }
     
@@ -104,7 +104,7 @@ namespace Psi {
     };
 
 #define PSI_COMPILER_TERM_REWRITER(cls,name,base) { \
-    PSI_COMPILER_SI(name,&base::vtable), \
+    PSI_COMPILER_SI(cls,name,&base::vtable), \
     &::Psi::Compiler::TermRewriterWrapper<cls>::rewrite \
   }
     
@@ -143,7 +143,7 @@ namespace Psi {
     };
 
 #define PSI_COMPILER_TERM_BINARY_REWRITER(cls,name,base) { \
-    PSI_COMPILER_SI(name,&base::vtable), \
+    PSI_COMPILER_SI(cls,name,&base::vtable), \
     &::Psi::Compiler::TermBinaryRewriterWrapper<cls>::rewrite \
   }
     
@@ -39,7 +39,7 @@ namespace Psi {
       virtual void except(const std::string& what) = 0;
     };
     
-    class StreamLogger : public TestLogger {
+    class PSI_TEST_EXPORT StreamLogger : public TestLogger {
       std::ostream *os;
       std::string name;
       unsigned error_count;
@@ -143,7 +143,7 @@ namespace Psi {
 #endif
     
     const TestSuite* test_suite_list();
-    void set_test_logger(TestLogger *logger);
+    PSI_TEST_EXPORT void set_test_logger(TestLogger *logger);
     std::string test_case_name(const TestCaseBase *tc);
     bool glob(const std::string& s, const std::string& pattern);
   }
@@ -82,7 +82,7 @@ namespace Psi {
       return rs;
     }
     
-    const SIVtable EvaluateContext::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.EvaluateContext", Tree);
+    const SIVtable EvaluateContext::vtable = PSI_COMPILER_TREE_ABSTRACT(EvaluateContext, "psi.compiler.EvaluateContext", Tree);
 
     Functional::Functional(const VtableType *vptr)
     : Term(PSI_COMPILER_VPTR_UP(Term, vptr)) {
@@ -95,19 +95,19 @@ namespace Psi {
       }
     }
     
-    const SIVtable Functional::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.Functional", Term);
+    const SIVtable Functional::vtable = PSI_COMPILER_TREE_ABSTRACT(Functional, "psi.compiler.Functional", Term);
 
     Constructor::Constructor(const VtableType* vtable)
     : Functional(vtable) {
     }
     
-    const SIVtable Constructor::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.Constructor", Functional);
+    const SIVtable Constructor::vtable = PSI_COMPILER_TREE_ABSTRACT(Constructor, "psi.compiler.Constructor", Functional);
 
     Constant::Constant(const VtableType *vptr)
     : Constructor(vptr) {
     }
     
-    const SIVtable Constant::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.Constant", Constructor);
+    const SIVtable Constant::vtable = PSI_COMPILER_TREE_ABSTRACT(Constant, "psi.compiler.Constant", Constructor);
 
     GlobalStatement::GlobalStatement(const TreePtr<Module>& module, const TreePtr<Term>& value_, StatementMode mode_, const SourceLocation& location)
     : ModuleGlobal(&vtable, module,
@@ -173,7 +173,7 @@ namespace Psi {
       visit_base<Term>(v);
     }
 
-    const SIVtable Global::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.Global", Term);
+    const SIVtable Global::vtable = PSI_COMPILER_TREE_ABSTRACT(Global, "psi.compiler.Global", Term);
 
     ModuleGlobal::ModuleGlobal(const VtableType *vptr, const TreePtr<Module>& module_, const String& symbol_name_, const TreePtr<Term>& type, Linkage linkage_, const SourceLocation& location)
     : Global(vptr, type, location),
@@ -195,7 +195,7 @@ namespace Psi {
       ("linkage", &ModuleGlobal::linkage);
     }
 
-    const SIVtable ModuleGlobal::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.ModuleGlobal", Global);
+    const SIVtable ModuleGlobal::vtable = PSI_COMPILER_TREE_ABSTRACT(ModuleGlobal, "psi.compiler.ModuleGlobal", Global);
 
     ExternalGlobal::ExternalGlobal(const TreePtr<Module>& module, const String& symbol_name, const TreePtr<Term>& type, const SourceLocation& location)
     : ModuleGlobal(&vtable, module, symbol_name, type, link_public, location) {
@@ -229,7 +229,7 @@ namespace Psi {
     : Type(vptr) {
     }
     
-    const SIVtable ParameterizedType::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.ParameterizedType", Type);
+    const SIVtable ParameterizedType::vtable = PSI_COMPILER_TREE_ABSTRACT(ParameterizedType, "psi.compiler.ParameterizedType", Type);
 
     Exists::Exists(const TreePtr<Term>& result_, const PSI_STD::vector<TreePtr<Term> >& parameter_types_, const SourceLocation& location)
     : ParameterizedType(&vtable),
@@ -1389,11 +1389,12 @@ namespace Psi {
 
     const FunctionalVtable TypeInstanceValue::vtable = PSI_COMPILER_FUNCTIONAL(TypeInstanceValue, "psi.compiler.TypeInstanceValue", Constructor);
 
-    IfThenElse::IfThenElse(const TreePtr<Term>& condition_, const TreePtr<Term>& true_value_, const TreePtr<Term>& false_value_)
+    IfThenElse::IfThenElse(const TreePtr<Term>& condition_, const TreePtr<Term>& true_value_, const TreePtr<Term>& false_value_, BranchHint hint_)
     : Functional(&vtable),
     condition(condition_),
     true_value(true_value_),
-    false_value(false_value_) {
+    false_value(false_value_),
+    hint(hint_) {
     }
     
     TermResultInfo IfThenElse::check_type_impl(const IfThenElse& self) {
@@ -1416,7 +1417,8 @@ namespace Psi {
       visit_base<Functional>(v);
       v("condition", &IfThenElse::condition)
       ("true_value", &IfThenElse::true_value)
-      ("false_value", &IfThenElse::false_value);
+      ("false_value", &IfThenElse::false_value)
+      ("hint", &IfThenElse::hint);
     }
 
     const FunctionalVtable IfThenElse::vtable = PSI_COMPILER_FUNCTIONAL(IfThenElse, "psi.compiler.IfThenElse", Functional);
@@ -1752,7 +1754,7 @@ namespace Psi {
     : Tree(PSI_COMPILER_VPTR_UP(Tree, vtable), compile_context, location) {
     }
     
-    const SIVtable TargetCallback::vtable = PSI_COMPILER_TREE_ABSTRACT("psi.compiler.TargetCallback", Tree);
+    const SIVtable TargetCallback::vtable = PSI_COMPILER_TREE_ABSTRACT(TargetCallback, "psi.compiler.TargetCallback", Tree);
     
     Namespace::Namespace(CompileContext& compile_context, const PSI_STD::map<String, TreePtr<Term> >& members_, const SourceLocation& location)
     : Tree(&vtable, compile_context, location),
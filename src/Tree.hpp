@@ -649,26 +649,30 @@ namespace Psi {
     struct FunctionParameterType {
       ParameterMode mode;
       TreePtr<Term> type;
+      /// \brief Combination of ParameterFlags.
+      unsigned flags;
       
-      FunctionParameterType() {}
-      FunctionParameterType(ParameterMode mode_, const TreePtr<Term>& type_) : mode(mode_), type(type_) {}
+      FunctionParameterType() : flags(0) {}
+      FunctionParameterType(ParameterMode mode_, const TreePtr<Term>& type_, unsigned flags_=0) : mode(mode_), type(type_), flags(flags_) {}
       
       template<typename V>
       static void visit(V& v) {
         v("mode", &FunctionParameterType::mode)
-        ("type", &FunctionParameterType::type);
+        ("type", &FunctionParameterType::type)
+        ("flags", &FunctionParameterType::flags);
       }
       
       friend std::size_t hash_value(const FunctionParameterType& self) {
         std::size_t h = 0;
         boost::hash_combine(h, self.mode);
         boost::hash_combine(h, self.type);
+        boost::hash_combine(h, self.flags);
         return h;
       }
     };
     
     inline bool operator == (const FunctionParameterType& lhs, const FunctionParameterType& rhs) {
-      return (lhs.mode == rhs.mode) && (lhs.type == rhs.type);
+      return (lhs.mode == rhs.mode) && (lhs.type == rhs.type) && (lhs.flags == rhs.flags);
     }
     
     class ParameterizedType : public Type {
@@ -886,7 +890,7 @@ namespace Psi {
     public:
       PSI_COMPILER_EXPORT static const VtableType vtable;
       
-      IfThenElse(const TreePtr<Term>& condition, const TreePtr<Term>& true_value, const TreePtr<Term>& false_value);
+      IfThenElse(const TreePtr<Term>& condition, const TreePtr<Term>& true_value, const TreePtr<Term>& false_value, BranchHint hint);
       template<typename Visitor> static void visit(Visitor& v);
       static TermResultInfo check_type_impl(const IfThenElse& self);
       static TermTypeInfo type_info_impl(const IfThenElse& self);
@@ -894,6 +898,8 @@ namespace Psi {
       TreePtr<Term> condition;
       TreePtr<Term> true_value;
       TreePtr<Term> false_value;
+      /// Which branch is expected to be taken, passed on to the code generator
+      BranchHint hint;
     };
     
     /**
@@ -119,7 +119,7 @@ namespace Psi {
         m_compile_context->m_gc_list.erase(m_compile_context->m_gc_list.iterator_to(*this));
     }
     
-    const SIVtable Object::vtable = PSI_COMPILER_SI_ABSTRACT("psi.compiler.Object", NULL);
+    const SIVtable Object::vtable = PSI_COMPILER_SI_ABSTRACT(Object, "psi.compiler.Object", NULL);
 
     /// \copydoc Object::Object(const ObjectVtable*)
     Tree::Tree(const TreeVtable *vptr)
@@ -145,6 +145,6 @@ namespace Psi {
       }
     }
 
-    const SIVtable Tree::vtable = PSI_COMPILER_SI_ABSTRACT("psi.compiler.Tree", &Object::vtable);
+    const SIVtable Tree::vtable = PSI_COMPILER_SI_ABSTRACT(Tree, "psi.compiler.Tree", &Object::vtable);
   }
 }
@@ -166,7 +166,7 @@ namespace Psi {
     &::Psi::Compiler::TreeWrapper<derived>::complete \
   }
 
-#define PSI_COMPILER_TREE_ABSTRACT(name,super) PSI_COMPILER_SI_ABSTRACT(name,&super::vtable)
+#define PSI_COMPILER_TREE_ABSTRACT(derived,name,super) PSI_COMPILER_SI_ABSTRACT(derived,name,&super::vtable)
 
     class DelayedEvaluation;
     
@@ -248,7 +248,7 @@ namespace Psi {
     };
     
     template<typename T>
-    const SIVtable DelayedEvaluationCallback<T>::vtable = PSI_COMPILER_SI_ABSTRACT("psi.compiler.DelayedEvaluationCallback", &DelayedEvaluation::vtable);
+    const SIVtable DelayedEvaluationCallback<T>::vtable = PSI_COMPILER_SI_ABSTRACT(DelayedEvaluationCallback<T>, "psi.compiler.DelayedEvaluationCallback", &DelayedEvaluation::vtable);
     
     template<typename BaseArgs_, typename FunctionType_>
     struct DelayedEvaluationImplArgs {
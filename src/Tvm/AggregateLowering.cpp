@@ -14,12 +14,26 @@ namespace Psi {
     }
     
     namespace {
+      /**
+       * \brief Get the attributes of a parameter which survive lowering.
+       * 
+       * Aliasing attributes describe the pointer value, which lowering does not change.
+       * Target specific flags such as llvm_byval are dropped.
+       */
+      ParameterAttributes lower_parameter_attributes(const ParameterAttributes& attributes) {
+        ParameterAttributes result(attributes.flags & (ParameterAttributes::noalias|ParameterAttributes::nocapture|ParameterAttributes::readonly));
+        result.dereferenceable = attributes.dereferenceable;
+        return result;
+      }
+      
       ValuePtr<FunctionType> lower_function_type(AggregateLoweringPass::AggregateLoweringRewriter& rewriter, const ValuePtr<FunctionType>& ftype) {
         unsigned n_phantom = ftype->n_phantom();
         std::vector<ParameterType> parameter_types;
-        for (std::size_t ii = 0, ie = ftype->parameter_types().size() - n_phantom; ii != ie; ++ii)
-          parameter_types.push_back(rewriter.rewrite_type(ftype->parameter_types()[ii + n_phantom].value).register_type());
-        ValuePtr<> result_type = rewriter.rewrite_type(ftype->result_type().value).register_type();
+        for (std::size_t ii = 0, ie = ftype->parameter_types().size() - n_phantom; ii != ie; ++ii) {
+          const ParameterType& param = ftype->parameter_types()[ii + n_phantom];
+          parameter_types.push_back(ParameterType(rewriter.rewrite_type(param.value).register_type(), lower_parameter_attributes(param.attributes)));
+        }
+        ParameterType result_type(rewriter.rewrite_type(ftype->result_type().value).register_type(), lower_parameter_attributes(ftype->result_type().attributes));
         return FunctionalBuilder::function_type(ftype->calling_convention(), result_type, parameter_types, 0, ftype->sret(), ftype->location());
       }
     }
@@ -846,7 +860,10 @@ namespace Psi {
     remove_unions(false),
     pointer_arithmetic_to_bytes(false),
     flatten_globals(false),
-    memcpy_to_bytes(false) {
+    memcpy_to_bytes(false),
+    inline_memcpy_limit(0),
+    inline_memzero_limit(0),
+    scalarize_vectors(false) {
     }
     
     AggregateLoweringPass::~AggregateLoweringPass() {
@@ -875,6 +892,59 @@ namespace Psi {
       }
     }
     
+    /**
+     * \brief Get the size and alignment of a type in a lowered module.
+     *
+     * Structs are laid out with each member aligned in turn, as the
+     * back-ends do, and the sizes of primitive types come from \c target_callback.
+     *
+     * \return False if the size is not constant, in which case \c result is not modified.
+     */
+    bool AggregateLoweringPass::lowered_type_size_alignment(TargetCallback *target_callback, const ValuePtr<>& type, TypeSizeAlignment& result) {
+      if (ValuePtr<StructType> st = dyn_cast<StructType>(type)) {
+        TypeSizeAlignment layout(0, 1);
+        for (unsigned ii = 0, ie = st->n_members(); ii != ie; ++ii) {
+          TypeSizeAlignment member;
+          if (!lowered_type_size_alignment(target_callback, st->member_type(ii), member))
+            return false;
+          layout.size = align_to(layout.size, member.alignment) + member.size;
+          layout.alignment = std::max(layout.alignment, member.alignment);
+        }
+        result = TypeSizeAlignment(align_to(layout.size, layout.alignment), layout.alignment);
+        return true;
+      } else if (ValuePtr<ArrayType> arr = dyn_cast<ArrayType>(type)) {
+        ValuePtr<IntegerValue> length_val = dyn_cast<IntegerValue>(arr->length());
+        if (!length_val)
+          return false;
+        boost::optional<unsigned> length = length_val->value().unsigned_value();
+        TypeSizeAlignment element;
+        if (!length || !lowered_type_size_alignment(target_callback, arr->element_type(), element))
+          return false;
+        result = TypeSizeAlignment(element.size * *length, element.alignment);
+        return true;
+      } else if (ValuePtr<UnionType> un = dyn_cast<UnionType>(type)) {
+        TypeSizeAlignment layout(0, 1);
+        for (unsigned ii = 0, ie = un->n_members(); ii != ie; ++ii) {
+          TypeSizeAlignment member;
+          if (!lowered_type_size_alignment(target_callback, un->member_type(ii), member))
+            return false;
+          layout.size = std::max(layout.size, member.size);
+          layout.alignment = std::max(layout.alignment, member.alignment);
+        }
+        result = TypeSizeAlignment(align_to(layout.size, layout.alignment), layout.alignment);
+        return true;
+      } else if (isa<EmptyType>(type)) {
+        result = TypeSizeAlignment(0, 1);
+        return true;
+      } else if (isa<IntegerType>(type) || isa<FloatType>(type) || isa<PointerType>(type) ||
+        isa<ByteType>(type) || isa<BooleanType>(type) || isa<VectorType>(type)) {
+        result = target_callback->type_size_alignment(type, type->location());
+        return true;
+      } else {
+        return false;
+      }
+    }
+
     /// \brief Type to use for sizes
     const LoweredType& AggregateLoweringPass::size_type() {
       if (m_size_type.empty())
@@ -977,6 +1047,7 @@ namespace Psi {
           ValuePtr<GlobalVariable> new_var = target_module()->new_global_variable(old_var->name(), type_alignment.first, term->location());
           new_var->set_constant(old_var->constant());
           new_var->set_merge(old_var->merge());
+          new_var->set_thread_local(old_var->is_thread_local());
           new_var->set_linkage(old_var->linkage());
           
           if (old_var->alignment()) {
@@ -996,6 +1067,7 @@ namespace Psi {
           ValuePtr<> cast_ptr = FunctionalBuilder::pointer_cast(runner->new_function(), byte_type, term->location());
           runner->new_function()->set_linkage(old_function->linkage());
           runner->new_function()->set_alignment(old_function->alignment());
+          runner->new_function()->set_hotness(old_function->hotness());
           global_rewriter().m_value_map.insert(std::make_pair(old_function, LoweredValue::register_(pointer_type(), true, cast_ptr)));
           rewrite_functions.push_back(std::make_pair(old_function, runner));
         }
@@ -525,6 +525,7 @@ namespace Psi {
       const LoweredType& block_type();
       
       std::size_t lowered_type_alignment(const ValuePtr<>& alignment);
+      static bool lowered_type_size_alignment(TargetCallback *target_callback, const ValuePtr<>& type, TypeSizeAlignment& result);
 
       /**
        * Callback used to rewrite function types and function calls
@@ -570,6 +571,24 @@ namespace Psi {
        * backend does not have to adjust for type size.
        */
       bool memcpy_to_bytes;
+      
+      /**
+       * \brief Largest memcpy, in bytes, which is replaced by loads and stores.
+       * 
+       * Only applies when memcpy_to_bytes is set, and only to copies
+       * whose size and alignment are constant. Zero disables this.
+       */
+      std::size_t inline_memcpy_limit;
+      
+      /// \brief Largest memzero, in bytes, which is replaced by stores; see inline_memcpy_limit.
+      std::size_t inline_memzero_limit;
+      
+      /**
+       * Lower vector types to a split sequence of lanes, and vector
+       * operations to the equivalent operation on each lane, for
+       * back-ends with no native vector support.
+       */
+      bool scalarize_vectors;
     };
   }
 }
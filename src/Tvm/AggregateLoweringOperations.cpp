@@ -52,6 +52,9 @@ namespace Psi {
           alignment = FunctionalBuilder::max(alignment, member_type.alignment(), term->location());
         }
         
+        // Include tail padding so that arrays of this type are correctly aligned
+        size = FunctionalBuilder::align_to(size, alignment, term->location());
+        
         if (!rewriter.pass().split_structs && all_register) {
           ValuePtr<> register_type = FunctionalBuilder::struct_type(rewriter.context(), register_members, term->location());
           return LoweredType::register_(term, size, alignment, register_type);
@@ -83,6 +86,8 @@ namespace Psi {
           alignment = FunctionalBuilder::max(alignment, member_type.alignment(), term->location());
         }
         
+        size = FunctionalBuilder::align_to(size, alignment, term->location());
+        
         if (all_register && !rewriter.pass().remove_unions) {
           ValuePtr<> register_type = FunctionalBuilder::union_type(rewriter.context(), register_members, term->location());
           return LoweredType::register_(term, size, alignment, register_type);
@@ -168,6 +173,18 @@ namespace Psi {
         rewriter.error_context().error_throw(term->location(), "Upward reference types should not be encountered during lowering");
       }
       
+      static LoweredType vector_type_rewrite(AggregateLoweringRewriter& rewriter, const ValuePtr<VectorType>& term) {
+        LoweredType element_type = rewriter.rewrite_type(term->element_type());
+        if (rewriter.pass().scalarize_vectors) {
+          ValuePtr<> size = FunctionalBuilder::mul(element_type.size(), FunctionalBuilder::size_value(rewriter.context(), term->length(), term->location()), term->location());
+          LoweredType::EntryVector entries(term->length(), element_type);
+          return LoweredType::split(term, size, size, entries);
+        } else {
+          ValuePtr<> register_type = FunctionalBuilder::vector_type(element_type.register_type(), term->length(), term->location());
+          return simple_type_helper(rewriter, term, register_type, term->location());
+        }
+      }
+      
       static LoweredType parameter_type_rewrite(AggregateLoweringRewriter& rewriter, const ValuePtr<>& type) {
         ValuePtr<> size, alignment;
         LoweredValue rewritten = rewriter.rewrite_value(type);
@@ -200,6 +217,7 @@ namespace Psi {
           .add<EmptyType>(primitive_type_rewrite)
           .add<FloatType>(primitive_type_rewrite)
           .add<IntegerType>(primitive_type_rewrite)
+          .add<VectorType>(vector_type_rewrite)
           .add<ConstantType>(constant_type_rewrite)
           .add<UpwardReferenceType>(upref_type_rewrite);
       }
@@ -287,6 +305,167 @@ namespace Psi {
         }
       }
       
+      static LoweredValue vector_value_rewrite(AggregateLoweringRewriter& rewriter, const ValuePtr<VectorValue>& term) {
+        bool global = true;
+        LoweredType vec_type = rewriter.rewrite_type(term->type()), el_type = rewriter.rewrite_type(term->element_type());
+        LoweredValue::EntryVector entries;
+        for (std::size_t ii = 0, ie = term->length(); ii != ie; ++ii) {
+          LoweredValue c = rewriter.rewrite_value(term->value(ii));
+          entries.push_back(c);
+          global = global && c.global();
+        }
+        
+        if (vec_type.mode() == LoweredType::mode_register) {
+          std::vector<ValuePtr<> > values;
+          for (LoweredValue::EntryVector::const_iterator ii = entries.begin(), ie = entries.end(); ii != ie; ++ii)
+            values.push_back(ii->register_value());
+          return LoweredValue::register_(vec_type, global, FunctionalBuilder::vector_value(el_type.register_type(), values, term->location()));
+        } else {
+          return LoweredValue::split(vec_type, entries);
+        }
+      }
+      
+      /**
+       * Rewrite an operation which acts lane-wise on vectors. When vectors are
+       * being scalarized, the operation is applied to each lane separately,
+       * with scalar operands (such as a shift count) shared between lanes.
+       */
+      static LoweredValue lanewise_rewrite(AggregateLoweringRewriter& rewriter, const ValuePtr<HashableValue>& term) {
+        if (!rewriter.pass().scalarize_vectors || !isa<VectorType>(term->type()))
+          return default_rewrite(rewriter, term);
+        
+        class PSI_LOCAL LaneCallback : public RewriteCallback {
+          AggregateLoweringRewriter *m_rewriter;
+          unsigned m_lane;
+          bool m_global;
+          
+        public:
+          LaneCallback(AggregateLoweringRewriter& rewriter, unsigned lane)
+          : RewriteCallback(rewriter.context()),
+          m_rewriter(&rewriter),
+          m_lane(lane),
+          m_global(true) {
+          }
+
+          virtual ValuePtr<> rewrite(const ValuePtr<>& value) {
+            if (isa<VectorType>(value->type())) {
+              LoweredValue x = m_rewriter->rewrite_value(value);
+              const LoweredValue& lane = x.split_entries()[m_lane];
+              m_global = m_global && lane.global();
+              return lane.register_value();
+            } else {
+              LoweredValueSimple x = m_rewriter->rewrite_value_register(value);
+              m_global = m_global && x.global;
+              return x.value;
+            }
+          }
+          
+          bool global() const {return m_global;}
+        };
+        
+        LoweredType type = rewriter.rewrite_type(term->type());
+        LoweredValue::EntryVector lanes;
+        for (unsigned ii = 0, ie = type.split_entries().size(); ii != ie; ++ii) {
+          LaneCallback callback(rewriter, ii);
+          ValuePtr<> lane = term->rewrite(callback);
+          lanes.push_back(LoweredValue::register_(type.split_entries()[ii], callback.global(), lane));
+        }
+        return LoweredValue::split(type, lanes);
+      }
+      
+      static LoweredValue vector_element_rewrite(AggregateLoweringRewriter& rewriter, const ValuePtr<VectorElement>& term) {
+        if (!rewriter.pass().scalarize_vectors)
+          return default_rewrite(rewriter, term);
+        
+        LoweredValue vector = rewriter.rewrite_value(term->vector());
+        LoweredValueSimple index = rewriter.rewrite_value_register(term->index());
+        if (isa<IntegerValue>(index.value))
+          return vector.split_entries()[size_to_unsigned(index.value)];
+        return array_element_rewrite_split(rewriter, index, vector.split_entries(), term->location());
+      }
+      
+      static LoweredValue vector_insert_rewrite(AggregateLoweringRewriter& rewriter, const ValuePtr<VectorInsert>& term) {
+        if (!rewriter.pass().scalarize_vectors)
+          return default_rewrite(rewriter, term);
+
+        LoweredType type = rewriter.rewrite_type(term->type());
+        LoweredValue vector = rewriter.rewrite_value(term->vector());
+        LoweredValueSimple index = rewriter.rewrite_value_register(term->index());
+        LoweredValue value = rewriter.rewrite_value(term->value());
+        LoweredValue::EntryVector lanes;
+        for (unsigned ii = 0, ie = vector.split_entries().size(); ii != ie; ++ii) {
+          const LoweredValue& lane = vector.split_entries()[ii];
+          if (isa<IntegerValue>(index.value)) {
+            lanes.push_back((size_to_unsigned(index.value) == ii) ? value : lane);
+          } else {
+            ValuePtr<> cmp = FunctionalBuilder::cmp_eq(index.value, FunctionalBuilder::size_value(rewriter.context(), ii, term->location()), term->location());
+            lanes.push_back(build_select(rewriter, LoweredValueSimple(index.global, cmp), value, lane, term->location()));
+          }
+        }
+        return LoweredValue::split(type, lanes);
+      }
+      
+      static LoweredValue vector_shuffle_rewrite(AggregateLoweringRewriter& rewriter, const ValuePtr<VectorShuffle>& term) {
+        if (!rewriter.pass().scalarize_vectors)
+          return default_rewrite(rewriter, term);
+        
+        LoweredType type = rewriter.rewrite_type(term->type());
+        LoweredValue lhs = rewriter.rewrite_value(term->lhs());
+        LoweredValue rhs = rewriter.rewrite_value(term->rhs());
+        const std::size_t length = lhs.split_entries().size();
+        LoweredValue::EntryVector lanes;
+        for (std::vector<unsigned>::const_iterator ii = term->mask().begin(), ie = term->mask().end(); ii != ie; ++ii)
+          lanes.push_back((*ii < length) ? lhs.split_entries()[*ii] : rhs.split_entries()[*ii - length]);
+        return LoweredValue::split(type, lanes);
+      }
+      
+      /**
+       * Combine the lanes of a scalarized vector pairwise using \c op.
+       */
+      template<typename Op>
+      static LoweredValue vector_reduce_helper(AggregateLoweringRewriter& rewriter, const ValuePtr<VectorReduceOp>& term, Op op) {
+        if (!rewriter.pass().scalarize_vectors)
+          return default_rewrite(rewriter, term);
+        
+        LoweredType type = rewriter.rewrite_type(term->type());
+        LoweredValue vector = rewriter.rewrite_value(term->parameter());
+        bool global = true;
+        ValuePtr<> result;
+        for (LoweredValue::EntryVector::const_iterator ii = vector.split_entries().begin(), ie = vector.split_entries().end(); ii != ie; ++ii) {
+          global = global && ii->global();
+          result = result ? op(result, ii->register_value(), term->location()) : ii->register_value();
+        }
+        return LoweredValue::register_(type, global, result);
+      }
+      
+      static ValuePtr<> reduce_add_op(const ValuePtr<>& lhs, const ValuePtr<>& rhs, const SourceLocation& location) {
+        return FunctionalBuilder::add(lhs, rhs, location);
+      }
+      
+      static ValuePtr<> reduce_and_op(const ValuePtr<>& lhs, const ValuePtr<>& rhs, const SourceLocation& location) {
+        if (isa<BooleanType>(lhs->type()))
+          return FunctionalBuilder::select(lhs, rhs, FunctionalBuilder::bool_value(lhs->context(), false, location), location);
+        return FunctionalBuilder::bit_and(lhs, rhs, location);
+      }
+      
+      static ValuePtr<> reduce_or_op(const ValuePtr<>& lhs, const ValuePtr<>& rhs, const SourceLocation& location) {
+        if (isa<BooleanType>(lhs->type()))
+          return FunctionalBuilder::select(lhs, FunctionalBuilder::bool_value(lhs->context(), true, location), rhs, location);
+        return FunctionalBuilder::bit_or(lhs, rhs, location);
+      }
+      
+      static LoweredValue vector_reduce_add_rewrite(AggregateLoweringRewriter& rewriter, const ValuePtr<VectorReduceAdd>& term) {
+        return vector_reduce_helper(rewriter, term, reduce_add_op);
+      }
+      
+      static LoweredValue vector_reduce_and_rewrite(AggregateLoweringRewriter& rewriter, const ValuePtr<VectorReduceAnd>& term) {
+        return vector_reduce_helper(rewriter, term, reduce_and_op);
+      }
+      
+      static LoweredValue vector_reduce_or_rewrite(AggregateLoweringRewriter& rewriter, const ValuePtr<VectorReduceOr>& term) {
+        return vector_reduce_helper(rewriter, term, reduce_or_op);
+      }
+      
       static LoweredValue struct_value_rewrite(AggregateLoweringRewriter& rewriter, const ValuePtr<StructValue>& term) {
         bool global = true;
         LoweredType st_type = rewriter.rewrite_type(term->type());
@@ -626,6 +805,13 @@ namespace Psi {
         return rewriter.rewrite_value(term->pointer());
       }
       
+      /// The target type must be lowered as a type rather than as a metatype value
+      static LoweredValue bit_cast_rewrite(AggregateLoweringRewriter& rewriter, const ValuePtr<BitCast>& term) {
+        LoweredType ty = rewriter.rewrite_type(term->target_type());
+        LoweredValueSimple value = rewriter.rewrite_value_register(term->value());
+        return LoweredValue::register_(ty, value.global, FunctionalBuilder::bit_cast(value.value, ty.register_type(), term->location()));
+      }
+      
       static LoweredValue unwrap_rewrite(AggregateLoweringRewriter& rewriter, const ValuePtr<Unwrap>& term) {
         return rewriter.rewrite_value(term->value());
       }
@@ -688,6 +874,9 @@ namespace Psi {
       }
       
       static LoweredValue select_rewrite(AggregateLoweringRewriter& rewriter, const ValuePtr<Select>& select) {
+        if (isa<VectorType>(select->condition()->type()))
+          return lanewise_rewrite(rewriter, select);
+        
         LoweredType ty = rewriter.rewrite_type(select->type());
         LoweredValueSimple cond = rewriter.rewrite_value_register(select->condition());
         LoweredValue true_val = rewriter.rewrite_value(select->true_value());
@@ -755,11 +944,36 @@ namespace Psi {
           .add<MetatypeAlignment>(metatype_alignment_rewrite)
           .add<PointerOffset>(pointer_offset_rewrite)
           .add<PointerCast>(pointer_cast_rewrite)
+          .add<BitCast>(bit_cast_rewrite)
           .add<Unwrap>(unwrap_rewrite)
           .add<IntroduceExists>(introduce_exists_rewrite)
           .add<ElementValue>(element_value_rewrite)
           .add<ElementPtr>(element_ptr_rewrite)
           .add<Select>(select_rewrite)
+          .add<VectorType>(type_rewrite)
+          .add<VectorValue>(vector_value_rewrite)
+          .add<VectorElement>(vector_element_rewrite)
+          .add<VectorInsert>(vector_insert_rewrite)
+          .add<VectorShuffle>(vector_shuffle_rewrite)
+          .add<VectorReduceAdd>(vector_reduce_add_rewrite)
+          .add<VectorReduceAnd>(vector_reduce_and_rewrite)
+          .add<VectorReduceOr>(vector_reduce_or_rewrite)
+          .add<IntegerAdd>(lanewise_rewrite)
+          .add<IntegerMultiply>(lanewise_rewrite)
+          .add<IntegerDivide>(lanewise_rewrite)
+          .add<BitAnd>(lanewise_rewrite)
+          .add<BitOr>(lanewise_rewrite)
+          .add<BitXor>(lanewise_rewrite)
+          .add<IntegerNegative>(lanewise_rewrite)
+          .add<BitNot>(lanewise_rewrite)
+          .add<IntegerCompareEq>(lanewise_rewrite)
+          .add<IntegerCompareNe>(lanewise_rewrite)
+          .add<IntegerCompareGt>(lanewise_rewrite)
+          .add<IntegerCompareGe>(lanewise_rewrite)
+          .add<IntegerCompareLt>(lanewise_rewrite)
+          .add<IntegerCompareLe>(lanewise_rewrite)
+          .add<ShiftLeft>(lanewise_rewrite)
+          .add<ShiftRight>(lanewise_rewrite)
           .add<ZeroValue>(zero_value_rewrite)
           .add<UndefinedValue>(undefined_value_rewrite);
       }
@@ -780,7 +994,19 @@ namespace Psi {
       static LoweredValue return_rewrite(FunctionRunner& runner, const ValuePtr<Return>& term) {
         // Clean up all remaining allocas()
         runner.alloca_free(ValuePtr<>(), term->location());
-        runner.pass().target_callback->lower_return(runner, term->value, term->location());
+        ValuePtr<Instruction> lowered = runner.pass().target_callback->lower_return(runner, term->value, term->location());
+        
+        // A tail call survives lowering only if nothing has been inserted between it and the return
+        if (ValuePtr<Call> call = term->preceding_call()) {
+          if (call->tail != tail_call_none) {
+            ValuePtr<Return> lowered_return = dyn_cast<Return>(lowered);
+            if (ValuePtr<Call> lowered_call = lowered_return ? lowered_return->preceding_call() : ValuePtr<Call>())
+              lowered_call->tail = call->tail;
+            else if (call->tail == tail_call_required)
+              term->error_context().error_throw(call->location(), "musttail call cannot be lowered because its arguments or result are not passed in registers, or the caller has stack allocations");
+          }
+        }
+        
         return LoweredValue();
       }
 
@@ -794,7 +1020,7 @@ namespace Psi {
         ValuePtr<> cond = runner.rewrite_value_register(term->condition).value;
         ValuePtr<Block> true_target = runner.prepare_cond_jump(term->block(), term->true_target, term->location());
         ValuePtr<Block> false_target = runner.prepare_cond_jump(term->block(), term->false_target, term->location());
-        runner.builder().cond_br(cond, true_target, false_target, term->location());
+        runner.builder().cond_br(cond, true_target, false_target, term->true_weight, term->false_weight, term->location());
         return LoweredValue();
       }
       
@@ -869,27 +1095,117 @@ namespace Psi {
       static LoweredValue load_rewrite(FunctionRunner& runner, const ValuePtr<Load>& term) {
         LoweredType ty = runner.rewrite_type(term->type());
         LoweredValueSimple ptr = runner.rewrite_value_register(term->target);
+        if (term->ordering != atomic_none) {
+          // Atomic operations are only allowed on primitive types, so must be a single load
+          PSI_ASSERT(ty.mode() == LoweredType::mode_register);
+          ValuePtr<> cast_ptr = FunctionalBuilder::pointer_cast(ptr.value, ty.register_type(), term->location());
+          ValuePtr<> load_insn = runner.builder().load(cast_ptr, term->ordering, term->location());
+          return LoweredValue::register_(ty, false, load_insn);
+        }
         return runner.load_value(ty, ptr.value, term->location());
       }
       
       static LoweredValue store_rewrite(FunctionRunner& runner, const ValuePtr<Store>& term) {
         ValuePtr<> ptr = runner.rewrite_value_register(term->target).value;
+        if (term->ordering != atomic_none) {
+          ValuePtr<> val = runner.rewrite_value_register(term->value).value;
+          ValuePtr<> cast_ptr = FunctionalBuilder::pointer_cast(ptr, val->type(), term->location());
+          runner.builder().store(val, cast_ptr, term->ordering, term->location());
+          return LoweredValue();
+        }
         LoweredValue val = runner.rewrite_value(term->value);
         runner.store_value(val, ptr, term->location());
         return LoweredValue();
       }
       
+      static LoweredValue atomic_rmw_rewrite(FunctionRunner& runner, const ValuePtr<AtomicRMW>& term) {
+        ValuePtr<> ptr = runner.rewrite_value_register(term->target).value;
+        LoweredValueSimple val = runner.rewrite_value_register(term->value);
+        ValuePtr<> cast_ptr = FunctionalBuilder::pointer_cast(ptr, val.value->type(), term->location());
+        ValuePtr<> insn = runner.builder().atomic_rmw(term->op, cast_ptr, val.value, term->ordering, term->location());
+        return LoweredValue::register_(runner.rewrite_type(term->type()), false, insn);
+      }
+      
+      static LoweredValue cmpxchg_rewrite(FunctionRunner& runner, const ValuePtr<CmpXchg>& term) {
+        ValuePtr<> ptr = runner.rewrite_value_register(term->target).value;
+        ValuePtr<> expected = runner.rewrite_value_register(term->expected).value;
+        ValuePtr<> val = runner.rewrite_value_register(term->value).value;
+        ValuePtr<> cast_ptr = FunctionalBuilder::pointer_cast(ptr, val->type(), term->location());
+        ValuePtr<> insn = runner.builder().cmpxchg(cast_ptr, expected, val, term->success_ordering, term->failure_ordering, term->location());
+        return LoweredValue::register_(runner.rewrite_type(term->type()), false, insn);
+      }
+      
+      static LoweredValue fence_rewrite(FunctionRunner& runner, const ValuePtr<Fence>& term) {
+        runner.builder().fence(term->ordering, term->location());
+        return LoweredValue();
+      }
+      
+      /// Most loads or stores a single memcpy or memzero may be replaced by
+      static const std::size_t max_inline_memory_accesses = 8;
+      
+      /**
+       * \brief Copy or zero a small block of memory using loads and stores.
+       * 
+       * \param src Source pointer, or NULL to zero \c dest.
+       * \param limit Largest number of bytes to inline.
+       * 
+       * \return Whether the operation was inlined; it is not if the size
+       * or alignment are not constant or the block is too large.
+       */
+      static bool inline_memory_operation(FunctionRunner& runner, const ValuePtr<>& dest, const ValuePtr<>& src,
+                                          const ValuePtr<>& bytes, const ValuePtr<>& alignment, std::size_t limit, const SourceLocation& location) {
+        ValuePtr<IntegerValue> bytes_value = dyn_cast<IntegerValue>(bytes), alignment_value = dyn_cast<IntegerValue>(alignment);
+        if (!bytes_value || !alignment_value)
+          return false;
+        boost::optional<unsigned> size = bytes_value->value().unsigned_value(), align = alignment_value->value().unsigned_value();
+        if (!size || !align || (*size > limit))
+          return false;
+        
+        // Largest power of two access which the alignment allows
+        std::size_t unit = 1;
+        while ((unit < 8) && (*align % (unit * 2) == 0))
+          unit *= 2;
+        
+        std::size_t n_accesses = 0;
+        for (std::size_t offset = 0, width = unit; offset != *size; offset += width, ++n_accesses) {
+          while (offset + width > *size)
+            width /= 2;
+        }
+        if (n_accesses > max_inline_memory_accesses)
+          return false;
+        
+        // Each access is aligned since widths only decrease and every offset is a multiple of the current width
+        for (std::size_t offset = 0, width = unit; offset != *size; offset += width) {
+          while (offset + width > *size)
+            width /= 2;
+          ValuePtr<> type = runner.pass().target_callback->type_from_size(runner.context(), width, location).first;
+          ValuePtr<> dest_ptr = FunctionalBuilder::pointer_cast(offset ? FunctionalBuilder::pointer_offset(dest, offset, location) : dest, type, location);
+          ValuePtr<> value;
+          if (src) {
+            ValuePtr<> src_ptr = FunctionalBuilder::pointer_cast(offset ? FunctionalBuilder::pointer_offset(src, offset, location) : src, type, location);
+            value = runner.builder().load(src_ptr, location);
+          } else {
+            value = FunctionalBuilder::zero(type, location);
+          }
+          runner.builder().store(value, dest_ptr, location);
+        }
+        
+        return true;
+      }
+      
       static LoweredValue memcpy_rewrite(FunctionRunner& runner, const ValuePtr<MemCpy>& term) {
         ValuePtr<> dest = runner.rewrite_value_register(term->dest).value;
         ValuePtr<> src = runner.rewrite_value_register(term->src).value;
         ValuePtr<> count = runner.rewrite_value_register(term->count).value;
-        ValuePtr<> alignment = runner.rewrite_value_register(term->alignment).value;
+        ValuePtr<> alignment;
+        if (term->alignment)
+          alignment = runner.rewrite_value_register(term->alignment).value;
         
         ValuePtr<> original_element_type = value_cast<PointerType>(term->dest->type())->target_type();
         LoweredType element_type = runner.rewrite_type(original_element_type);
         if (!runner.pass().memcpy_to_bytes && (element_type.mode() == LoweredType::mode_register)) {
           ValuePtr<> dest_cast = FunctionalBuilder::pointer_cast(dest, element_type.register_type(), term->location());
-          ValuePtr<> src_cast = FunctionalBuilder::pointer_cast(dest, element_type.register_type(), term->location());
+          ValuePtr<> src_cast = FunctionalBuilder::pointer_cast(src, element_type.register_type(), term->location());
           runner.builder().memcpy(dest_cast, src_cast, count, alignment, term->location());
           return LoweredValue();
         } else {
@@ -897,8 +1213,9 @@ namespace Psi {
           ValuePtr<> type_size = runner.rewrite_value_register(FunctionalBuilder::type_size(original_element_type, term->location())).value;
           ValuePtr<> type_alignment = runner.rewrite_value_register(FunctionalBuilder::type_alignment(original_element_type, term->location())).value;
           ValuePtr<> bytes = FunctionalBuilder::mul(count, type_size, term->location());
-          ValuePtr<> max_alignment = FunctionalBuilder::max(alignment, type_alignment, term->location());
-          runner.builder().memcpy(dest, src, bytes, max_alignment, term->location());
+          ValuePtr<> max_alignment = alignment ? FunctionalBuilder::max(alignment, type_alignment, term->location()) : type_alignment;
+          if (!inline_memory_operation(runner, dest, src, bytes, max_alignment, runner.pass().inline_memcpy_limit, term->location()))
+            runner.builder().memcpy(dest, src, bytes, max_alignment, term->location());
           return LoweredValue();
         }
       }
@@ -906,7 +1223,9 @@ namespace Psi {
       static LoweredValue memzero_rewrite(FunctionRunner& runner, const ValuePtr<MemZero>& term) {
         ValuePtr<> ptr = runner.rewrite_value_register(term->dest).value;
         ValuePtr<> count = runner.rewrite_value_register(term->count).value;
-        ValuePtr<> alignment = runner.rewrite_value_register(term->alignment).value;
+        ValuePtr<> alignment;
+        if (term->alignment)
+          alignment = runner.rewrite_value_register(term->alignment).value;
         
         ValuePtr<> original_element_type = value_cast<PointerType>(term->dest->type())->target_type();
         LoweredType element_type = runner.rewrite_type(original_element_type);
@@ -919,8 +1238,9 @@ namespace Psi {
           ValuePtr<> type_size = runner.rewrite_value_register(FunctionalBuilder::type_size(original_element_type, term->location())).value;
           ValuePtr<> type_alignment = runner.rewrite_value_register(FunctionalBuilder::type_alignment(original_element_type, term->location())).value;
           ValuePtr<> bytes = FunctionalBuilder::mul(count, type_size, term->location());
-          ValuePtr<> max_alignment = FunctionalBuilder::max(alignment, type_alignment, term->location());
-          runner.builder().memzero(ptr, bytes, max_alignment, term->location());
+          ValuePtr<> max_alignment = alignment ? FunctionalBuilder::max(alignment, type_alignment, term->location()) : type_alignment;
+          if (!inline_memory_operation(runner, ptr, ValuePtr<>(), bytes, max_alignment, runner.pass().inline_memzero_limit, term->location()))
+            runner.builder().memzero(ptr, bytes, max_alignment, term->location());
           return LoweredValue();
         }
       }
@@ -947,6 +1267,9 @@ namespace Psi {
           .add<Evaluate>(eval_rewrite)
           .add<Store>(store_rewrite)
           .add<Load>(load_rewrite)
+          .add<AtomicRMW>(atomic_rmw_rewrite)
+          .add<CmpXchg>(cmpxchg_rewrite)
+          .add<Fence>(fence_rewrite)
           .add<MemCpy>(memcpy_rewrite)
           .add<MemZero>(memzero_rewrite)
           .add<Solidify>(solidify_rewrite);
@@ -343,6 +343,7 @@ namespace Psi {
           ValuePtr<> global_type = Assembler::build_expression(asmct, *var.type, location);
           ValuePtr<GlobalVariable> global_var = module.new_global_variable(it->name.text, global_type, SourceLocation(var.location, location));
           global_var->set_constant(var.constant);
+          global_var->set_thread_local(var.is_thread_local);
           global_var->set_linkage(var.linkage);
           asmct.put(it->name.text, global_var);
           result[it->name.text] = global_var;
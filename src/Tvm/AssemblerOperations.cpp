@@ -56,6 +56,17 @@ namespace Psi {
         }
       };
       
+      struct TernaryOpCallback {
+        typedef ValuePtr<> (*GetterType) (const ValuePtr<>&,const ValuePtr<>&,const ValuePtr<>&,const SourceLocation&);
+        GetterType getter;
+        TernaryOpCallback(GetterType getter_) : getter(getter_) {}
+        ValuePtr<> operator () (const std::string& name, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) {
+          check_n_terms(name, context, 3, expression, location);
+          std::vector<ValuePtr<> > parameters = default_parameter_setup(context, expression, location);
+          return getter(parameters[0], parameters[1], parameters[2], SourceLocation(expression.location, location));
+        }
+      };
+      
       struct UnaryOrBinaryCallback {
         typedef UnaryOpCallback::GetterType UnaryGetterType;
         typedef BinaryOpCallback::GetterType BinaryGetterType;
@@ -122,6 +133,27 @@ namespace Psi {
         }
       };
       
+      struct VectorShuffleCallback {
+        ValuePtr<> operator () (const std::string& name, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) {
+          SourceLocation source_location(expression.location, location);
+          if (expression.terms.size() < 3)
+            context.error_context().error_throw(source_location, boost::format("%s: two vectors and at least one lane index expected") % name);
+          
+          ValuePtr<> lhs = build_expression(context, *expression.terms[0], location);
+          ValuePtr<> rhs = build_expression(context, *expression.terms[1], location);
+          
+          std::vector<unsigned> mask;
+          for (PSI_STD::vector<Parser::ExpressionRef>::const_iterator ii = expression.terms.begin() + 2, ie = expression.terms.end(); ii != ie; ++ii) {
+            if ((*ii)->expression_type != Parser::expression_literal)
+              context.error_context().error_throw(source_location, boost::format("%s: lane indices must be integer literals") % name);
+            const Parser::IntegerLiteralExpression& index_literal = checked_cast<const Parser::IntegerLiteralExpression&>(**ii);
+            mask.push_back(index_literal.value.unsigned_value_checked(CompileErrorPair(context.error_context(), source_location), false));
+          }
+          
+          return FunctionalBuilder::vector_shuffle(lhs, rhs, mask, source_location);
+        }
+      };
+      
       struct UprefCallback {
         ValuePtr<> operator () (const std::string& name, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) {
           if (expression.terms.empty())
@@ -254,10 +286,19 @@ namespace Psi {
         ("bitcast", BinaryOpCallback(&FunctionalBuilder::bit_cast))
         ("shl", BinaryOpCallback(&FunctionalBuilder::bit_shl))
         ("shr", BinaryOpCallback(&FunctionalBuilder::bit_shr))
+        ("select", TernaryOpCallback(&FunctionalBuilder::select))
         ("undef", UnaryOpCallback(&FunctionalBuilder::undef))
         ("zero", UnaryOpCallback(&FunctionalBuilder::zero))
         ("array", BinaryOpCallback(&FunctionalBuilder::array_type))
         ("array_v", TermPlusArrayCallback(&FunctionalBuilder::array_value))
+        ("vector", TermPlusIndexCallback(&FunctionalBuilder::vector_type))
+        ("vector_v", TermPlusArrayCallback(&FunctionalBuilder::vector_value))
+        ("vector_element", BinaryOpCallback(&FunctionalBuilder::vector_element))
+        ("vector_insert", TernaryOpCallback(&FunctionalBuilder::vector_insert))
+        ("vector_shuffle", VectorShuffleCallback())
+        ("vector_reduce_add", UnaryOpCallback(&FunctionalBuilder::vector_reduce_add))
+        ("vector_reduce_and", UnaryOpCallback(&FunctionalBuilder::vector_reduce_and))
+        ("vector_reduce_or", UnaryOpCallback(&FunctionalBuilder::vector_reduce_or))
         ("struct", ContextArrayCallback(&FunctionalBuilder::struct_type))
         ("struct_v", ContextArrayCallback(&FunctionalBuilder::struct_value))
         ("union", ContextArrayCallback(&FunctionalBuilder::union_type))
@@ -294,29 +335,6 @@ namespace Psi {
         }
       };
 
-      struct BinaryInstructionCallback {
-        typedef ValuePtr<Instruction> (InstructionBuilder::*Callback) (const ValuePtr<>&, const ValuePtr<>&, const SourceLocation&);
-        Callback callback;
-        BinaryInstructionCallback(Callback callback_) : callback(callback_) {}
-        ValuePtr<Instruction> operator () (const std::string& name, InstructionBuilder& builder, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) const {
-          check_n_terms(name, context, 2, expression, location);
-          std::vector<ValuePtr<> > parameters = default_parameter_setup(context, expression, location);
-          return (builder.*callback)(parameters[0], parameters[1], SourceLocation(expression.location, location));
-        }
-      };
-
-      struct CallCallback {
-        ValuePtr<Instruction> operator () (const std::string& name, InstructionBuilder& builder, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) const {
-          std::vector<ValuePtr<> > parameters = default_parameter_setup(context, expression, location);
-          if (parameters.empty())
-            context.error_context().error_throw(SourceLocation(expression.location, location),
-                                                boost::format("%s: at least one parameter expected") % name);
-          ValuePtr<> target = parameters.front();
-          parameters.erase(parameters.begin());
-          return builder.call(target, parameters, SourceLocation(expression.location, location));
-        }
-      };
-      
       namespace {
         ValuePtr<Block> as_block(const std::string& name, AssemblerContext& context, const ValuePtr<>& ptr, const SourceLocation& location) {
           ValuePtr<Block> bl = dyn_cast<Block>(ptr);
@@ -335,28 +353,241 @@ namespace Psi {
         }
       };
 
+      struct AllocaCallback {
+        ValuePtr<Instruction> operator () (const std::string&, InstructionBuilder& builder, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) const {
+          std::vector<ValuePtr<> > parameters = default_parameter_setup(context, expression, location);
+          SourceLocation loc(expression.location, location);
+          switch (parameters.size()) {
+          case 1: return builder.alloca_(parameters[0], loc);
+          case 2: return builder.alloca_(parameters[0], parameters[1], loc);
+          case 3: return builder.alloca_(parameters[0], parameters[1], parameters[2], loc);
+          default: context.error_context().error_throw(SourceLocation(expression.location, location), "alloca expects 1, 2 or 3 parameters");
+          }
+        }
+      };
+
+      struct MemCpyCallback {
+        ValuePtr<Instruction> operator () (const std::string&, InstructionBuilder& builder, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) const {
+          std::vector<ValuePtr<> > parameters = default_parameter_setup(context, expression, location);
+          SourceLocation loc(expression.location, location);
+          switch (parameters.size()) {
+          case 3: return builder.memcpy(parameters[0], parameters[1], parameters[2], loc);
+          case 4: return builder.memcpy(parameters[0], parameters[1], parameters[2], parameters[3], loc);
+          default: context.error_context().error_throw(loc, "memcpy expects 3 or 4 parameters");
+          }
+        }
+      };
+
+      struct MemZeroCallback {
+        ValuePtr<Instruction> operator () (const std::string&, InstructionBuilder& builder, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) const {
+          std::vector<ValuePtr<> > parameters = default_parameter_setup(context, expression, location);
+          SourceLocation loc(expression.location, location);
+          switch (parameters.size()) {
+          case 2: return builder.memzero(parameters[0], parameters[1], loc);
+          case 3: return builder.memzero(parameters[0], parameters[1], parameters[2], loc);
+          default: context.error_context().error_throw(loc, "memzero expects 2 or 3 parameters");
+          }
+        }
+      };
+
+      namespace {
+        const boost::unordered_map<std::string, AtomicOrdering> atomic_orderings =
+          boost::assign::map_list_of<std::string, AtomicOrdering>
+          ("relaxed", atomic_relaxed)
+          ("acquire", atomic_acquire)
+          ("release", atomic_release)
+          ("acq_rel", atomic_acq_rel)
+          ("seq_cst", atomic_seq_cst);
+        
+        const boost::unordered_map<std::string, AtomicRMWOperation> atomic_rmw_ops =
+          boost::assign::map_list_of<std::string, AtomicRMWOperation>
+          ("add", atomic_rmw_add)
+          ("sub", atomic_rmw_sub)
+          ("and", atomic_rmw_and)
+          ("or", atomic_rmw_or)
+          ("xor", atomic_rmw_xor)
+          ("xchg", atomic_rmw_xchg)
+          ("min", atomic_rmw_min)
+          ("max", atomic_rmw_max);
+        
+        /**
+         * Get the text of a bare keyword such as a memory ordering, which the parser
+         * sees as an operation with no arguments.
+         */
+        const std::string* keyword_text(const Parser::Expression& expression) {
+          if (expression.expression_type != Parser::expression_call)
+            return NULL;
+          const Parser::CallExpression& call = checked_cast<const Parser::CallExpression&>(expression);
+          if (!call.terms.empty())
+            return NULL;
+          return &call.target.text;
+        }
+        
+        template<typename T>
+        T parse_keyword(const std::string& name, AssemblerContext& context, const boost::unordered_map<std::string, T>& keywords,
+                        const char *what, const Parser::Expression& expression, const SourceLocation& location) {
+          if (const std::string *text = keyword_text(expression)) {
+            typename boost::unordered_map<std::string, T>::const_iterator it = keywords.find(*text);
+            if (it != keywords.end())
+              return it->second;
+          }
+          context.error_context().error_throw(location, boost::format("%s: %s expected") % name % what);
+        }
+        
+        AtomicOrdering parse_ordering(const std::string& name, AssemblerContext& context, const Parser::Expression& expression, const SourceLocation& location) {
+          return parse_keyword(name, context, atomic_orderings, "memory ordering", expression, location);
+        }
+        
+        /**
+         * Build parameters of an instruction which has \c n_values value
+         * parameters followed by up to \c max_orderings memory orderings.
+         */
+        std::vector<ValuePtr<> > atomic_parameter_setup(const std::string& name, AssemblerContext& context, std::size_t n_values, std::size_t max_orderings,
+                                                        std::vector<AtomicOrdering>& orderings, const Parser::CallExpression& expression,
+                                                        std::size_t first, const LogicalSourceLocationPtr& location) {
+          SourceLocation loc(expression.location, location);
+          if ((expression.terms.size() < first + n_values) || (expression.terms.size() > first + n_values + max_orderings))
+            context.error_context().error_throw(loc, boost::format("%s: %d parameters and up to %d memory orderings expected") % name % n_values % max_orderings);
+          
+          std::vector<ValuePtr<> > parameters;
+          for (std::size_t ii = first, ie = first + n_values; ii != ie; ++ii)
+            parameters.push_back(build_expression(context, *expression.terms[ii], location));
+          for (std::size_t ii = first + n_values, ie = expression.terms.size(); ii != ie; ++ii)
+            orderings.push_back(parse_ordering(name, context, *expression.terms[ii], loc));
+          return parameters;
+        }
+        
+        /// Strongest failure ordering allowed for a given compare-exchange success ordering
+        AtomicOrdering cmpxchg_failure_ordering(AtomicOrdering success) {
+          switch (success) {
+          case atomic_acq_rel: return atomic_acquire;
+          case atomic_release: return atomic_relaxed;
+          default: return success;
+          }
+        }
+      }
+      
+      /**
+       * \c cond_br takes a condition and two blocks, optionally followed by
+       * either \c likely, \c unlikely or a pair of integer branch weights.
+       */
       struct ConditionalBranchCallback {
         ValuePtr<Instruction> operator () (const std::string& name, InstructionBuilder& builder, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) const {
-          check_n_terms(name, context, 3, expression, location);
-          std::vector<ValuePtr<> > parameters = default_parameter_setup(context, expression, location);
           SourceLocation result_location(expression.location, location);
+          std::size_t n_terms = expression.terms.size();
+          if ((n_terms < 3) || (n_terms > 5))
+            context.error_context().error_throw(result_location, boost::format("%s: condition, two blocks and optional branch weights expected") % name);
+          
+          std::vector<ValuePtr<> > parameters;
+          for (std::size_t ii = 0; ii != 3; ++ii)
+            parameters.push_back(build_expression(context, *expression.terms[ii], location));
+          
+          unsigned true_weight = 0, false_weight = 0;
+          if (n_terms == 4) {
+            const std::string *hint = keyword_text(*expression.terms[3]);
+            if (hint && (*hint == "likely")) {
+              true_weight = ConditionalBranch::likely_weight;
+              false_weight = ConditionalBranch::unlikely_weight;
+            } else if (hint && (*hint == "unlikely")) {
+              true_weight = ConditionalBranch::unlikely_weight;
+              false_weight = ConditionalBranch::likely_weight;
+            } else {
+              context.error_context().error_throw(result_location, boost::format("%s: likely or unlikely expected") % name);
+            }
+          } else if (n_terms == 5) {
+            unsigned weights[2];
+            for (std::size_t ii = 0; ii != 2; ++ii) {
+              const Parser::Expression& weight = *expression.terms[3 + ii];
+              if (weight.expression_type != Parser::expression_literal)
+                context.error_context().error_throw(result_location, boost::format("%s: branch weights must be integer literals") % name);
+              const Parser::IntegerLiteralExpression& weight_literal = checked_cast<const Parser::IntegerLiteralExpression&>(weight);
+              weights[ii] = weight_literal.value.unsigned_value_checked(CompileErrorPair(context.error_context(), result_location), false);
+            }
+            true_weight = weights[0];
+            false_weight = weights[1];
+          }
+          
           return builder.cond_br(parameters[0],
                                  as_block(name, context, parameters[1], result_location),
                                  as_block(name, context, parameters[2], result_location),
-                                 result_location);
+                                 true_weight, false_weight, result_location);
         }
       };
       
-      struct AllocaCallback {
-        ValuePtr<Instruction> operator () (const std::string&, InstructionBuilder& builder, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) const {
-          std::vector<ValuePtr<> > parameters = default_parameter_setup(context, expression, location);
+      struct LoadCallback {
+        ValuePtr<Instruction> operator () (const std::string& name, InstructionBuilder& builder, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) const {
+          std::vector<AtomicOrdering> orderings;
+          std::vector<ValuePtr<> > parameters = atomic_parameter_setup(name, context, 1, 1, orderings, expression, 0, location);
+          return builder.load(parameters[0], orderings.empty() ? atomic_none : orderings[0], SourceLocation(expression.location, location));
+        }
+      };
+      
+      struct StoreCallback {
+        ValuePtr<Instruction> operator () (const std::string& name, InstructionBuilder& builder, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) const {
+          std::vector<AtomicOrdering> orderings;
+          std::vector<ValuePtr<> > parameters = atomic_parameter_setup(name, context, 2, 1, orderings, expression, 0, location);
+          return builder.store(parameters[0], parameters[1], orderings.empty() ? atomic_none : orderings[0], SourceLocation(expression.location, location));
+        }
+      };
+      
+      struct AtomicRMWCallback {
+        ValuePtr<Instruction> operator () (const std::string& name, InstructionBuilder& builder, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) const {
           SourceLocation loc(expression.location, location);
-          switch (parameters.size()) {
-          case 1: return builder.alloca_(parameters[0], loc);
-          case 2: return builder.alloca_(parameters[0], parameters[1], loc);
-          case 3: return builder.alloca_(parameters[0], parameters[1], parameters[2], loc);
-          default: context.error_context().error_throw(SourceLocation(expression.location, location), "alloca expects 1, 2 or 3 parameters");
+          if (expression.terms.empty())
+            context.error_context().error_throw(loc, boost::format("%s: operation expected") % name);
+          AtomicRMWOperation op = parse_keyword(name, context, atomic_rmw_ops, "atomic operation", *expression.terms.front(), loc);
+          std::vector<AtomicOrdering> orderings;
+          std::vector<ValuePtr<> > parameters = atomic_parameter_setup(name, context, 2, 1, orderings, expression, 1, location);
+          return builder.atomic_rmw(op, parameters[0], parameters[1], orderings.empty() ? atomic_seq_cst : orderings[0], loc);
+        }
+      };
+      
+      struct CmpXchgCallback {
+        ValuePtr<Instruction> operator () (const std::string& name, InstructionBuilder& builder, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) const {
+          std::vector<AtomicOrdering> orderings;
+          std::vector<ValuePtr<> > parameters = atomic_parameter_setup(name, context, 3, 2, orderings, expression, 0, location);
+          AtomicOrdering success = orderings.empty() ? atomic_seq_cst : orderings[0];
+          AtomicOrdering failure = (orderings.size() < 2) ? cmpxchg_failure_ordering(success) : orderings[1];
+          return builder.cmpxchg(parameters[0], parameters[1], parameters[2], success, failure, SourceLocation(expression.location, location));
+        }
+      };
+      
+      struct FenceCallback {
+        ValuePtr<Instruction> operator () (const std::string& name, InstructionBuilder& builder, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) const {
+          SourceLocation loc(expression.location, location);
+          check_n_terms(name, context, 1, expression, location);
+          return builder.fence(parse_ordering(name, context, *expression.terms.front(), loc), loc);
+        }
+      };
+
+      /**
+       * \c call takes the target function followed by its parameters, optionally
+       * preceded by \c tail or \c musttail.
+       */
+      struct CallCallback {
+        ValuePtr<Instruction> operator () (const std::string& name, InstructionBuilder& builder, AssemblerContext& context, const Parser::CallExpression& expression, const LogicalSourceLocationPtr& location) const {
+          SourceLocation loc(expression.location, location);
+          TailCallMode tail = tail_call_none;
+          std::size_t first = 0;
+          if (!expression.terms.empty()) {
+            if (const std::string *text = keyword_text(*expression.terms.front())) {
+              if (*text == "tail")
+                tail = tail_call_allowed;
+              else if (*text == "musttail")
+                tail = tail_call_required;
+              if (tail != tail_call_none)
+                first = 1;
+            }
           }
+          
+          if (expression.terms.size() == first)
+            context.error_context().error_throw(loc, boost::format("%s: at least one parameter expected") % name);
+          
+          ValuePtr<> target = build_expression(context, *expression.terms[first], location);
+          std::vector<ValuePtr<> > parameters;
+          for (std::size_t ii = first + 1, ie = expression.terms.size(); ii != ie; ++ii)
+            parameters.push_back(build_expression(context, *expression.terms[ii], location));
+          return builder.call(target, parameters, tail, loc);
         }
       };
 
@@ -369,9 +600,14 @@ namespace Psi {
         ("alloca", AllocaCallback())
         ("alloca_const", UnaryInstructionCallback(&InstructionBuilder::alloca_const))
         ("freea", UnaryInstructionCallback(&InstructionBuilder::freea))
+        ("memcpy", MemCpyCallback())
+        ("memzero", MemZeroCallback())
         ("eval", UnaryInstructionCallback(&InstructionBuilder::eval))
-        ("load", UnaryInstructionCallback(&InstructionBuilder::load))
-        ("store", BinaryInstructionCallback(&InstructionBuilder::store))
+        ("load", LoadCallback())
+        ("store", StoreCallback())
+        ("atomic_rmw", AtomicRMWCallback())
+        ("cmpxchg", CmpXchgCallback())
+        ("fence", FenceCallback())
         ("solidify", UnaryInstructionCallback(&InstructionBuilder::solidify));
     }
   }
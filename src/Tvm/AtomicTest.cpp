@@ -0,0 +1,235 @@
+#include "Test.hpp"
+
+#include "Jit.hpp"
+#include "../Platform/Platform.hpp"
+
+#include <vector>
+
+namespace Psi {
+  namespace Tvm {
+    PSI_TEST_SUITE_FIXTURE(AtomicTest, Test::ContextFixture)
+
+    PSI_TEST_CASE(LoadStoreTest) {
+      const char *src =
+        "%f = export function (%a : pointer i32, %b : pointer i32) > i32 {\n"
+        "  %x = load %a acquire;\n"
+        "  store (add %x #i1) %b release;\n"
+        "  fence seq_cst;\n"
+        "  %y = load %b seq_cst;\n"
+        "  return %y;\n"
+        "};\n";
+
+      typedef Jit::Int32 (*FunctionType) (Jit::Int32*, Jit::Int32*);
+      FunctionType f = reinterpret_cast<FunctionType>(jit_single("f", src));
+
+      Jit::Int32 a = 4012, b = 0;
+      PSI_TEST_CHECK_EQUAL(f(&a, &b), 4013);
+      PSI_TEST_CHECK_EQUAL(b, 4013);
+    }
+
+    PSI_TEST_CASE(RMWTest) {
+      const char *src =
+        "%f = export function (%p : pointer (array i32 #up7), %x : i32) > i32 {\n"
+        "  %a = atomic_rmw add (gep %p #up0) %x;\n"
+        "  %b = atomic_rmw sub (gep %p #up1) %x acq_rel;\n"
+        "  %c = atomic_rmw and (gep %p #up2) %x relaxed;\n"
+        "  %d = atomic_rmw or (gep %p #up3) %x release;\n"
+        "  %e = atomic_rmw xor (gep %p #up4) %x acquire;\n"
+        "  %g = atomic_rmw min (gep %p #up5) %x;\n"
+        "  %h = atomic_rmw max (gep %p #up6) %x;\n"
+        "  return (add (add (add %a %b) (add %c %d)) (add (add %e %g) %h));\n"
+        "};\n";
+
+      typedef Jit::Int32 (*FunctionType) (Jit::Int32*, Jit::Int32);
+      FunctionType f = reinterpret_cast<FunctionType>(jit_single("f", src));
+
+      Jit::Int32 values[7] = {10, 20, 12, 3, 6, 7, -2};
+      PSI_TEST_CHECK_EQUAL(f(values, 5), 10 + 20 + 12 + 3 + 6 + 7 - 2);
+      PSI_TEST_CHECK_EQUAL(values[0], 15);
+      PSI_TEST_CHECK_EQUAL(values[1], 15);
+      PSI_TEST_CHECK_EQUAL(values[2], 4);
+      PSI_TEST_CHECK_EQUAL(values[3], 7);
+      PSI_TEST_CHECK_EQUAL(values[4], 3);
+      PSI_TEST_CHECK_EQUAL(values[5], 5);
+      PSI_TEST_CHECK_EQUAL(values[6], 5);
+    }
+
+    PSI_TEST_CASE(UnsignedMinMaxTest) {
+      const char *src =
+        "%f = export function (%p : pointer (array ui32 #up2), %x : ui32) > empty {\n"
+        "  atomic_rmw min (gep %p #up0) %x;\n"
+        "  atomic_rmw max (gep %p #up1) %x;\n"
+        "  return empty_v;\n"
+        "};\n";
+
+      typedef void (*FunctionType) (Jit::UInt32*, Jit::UInt32);
+      FunctionType f = reinterpret_cast<FunctionType>(jit_single("f", src));
+
+      Jit::UInt32 values[2] = {7, 7};
+      f(values, 0x80000000u);
+      PSI_TEST_CHECK_EQUAL(values[0], 7u);
+      PSI_TEST_CHECK_EQUAL(values[1], 0x80000000u);
+    }
+
+    PSI_TEST_CASE(CmpXchgTest) {
+      const char *src =
+        "%f = export function (%p : pointer i32, %expected : i32, %x : i32) > i32 {\n"
+        "  %old = cmpxchg %p %expected %x acq_rel acquire;\n"
+        "  return %old;\n"
+        "};\n";
+
+      typedef Jit::Int32 (*FunctionType) (Jit::Int32*, Jit::Int32, Jit::Int32);
+      FunctionType f = reinterpret_cast<FunctionType>(jit_single("f", src));
+
+      Jit::Int32 value = 18;
+      PSI_TEST_CHECK_EQUAL(f(&value, 17, 40), 18);
+      PSI_TEST_CHECK_EQUAL(value, 18);
+      PSI_TEST_CHECK_EQUAL(f(&value, 18, 40), 18);
+      PSI_TEST_CHECK_EQUAL(value, 40);
+    }
+
+    namespace {
+      typedef void (*CounterFunction) (Jit::Int32*, Jit::UIntPtr);
+
+      struct CounterThreadData {
+        CounterFunction f;
+        Jit::Int32 *counter;
+        Jit::UIntPtr n;
+      };
+
+      void counter_thread(void *arg, unsigned) {
+        CounterThreadData *data = static_cast<CounterThreadData*>(arg);
+        data->f(data->counter, data->n);
+      }
+    }
+
+    /*
+     * Several threads incrementing a shared counter must not lose updates.
+     */
+    PSI_TEST_CASE(ThreadedCounterTest) {
+      const char *src =
+        "%f = export function (%p : pointer i32, %n : uiptr) > empty {\n"
+        "  br %entry;\n"
+        "block %entry:\n"
+        "  %idx = phi uiptr: > #up0, %body > (add %idx #up1);\n"
+        "  cond_br (cmp_lt %idx %n) %body %exit;\n"
+        "block %body(%entry):\n"
+        "  atomic_rmw add %p #i1 seq_cst;\n"
+        "  br %entry;\n"
+        "block %exit:\n"
+        "  return empty_v;\n"
+        "};\n";
+
+      Jit::Int32 counter = 0;
+      CounterThreadData data;
+      data.f = reinterpret_cast<CounterFunction>(jit_single("f", src));
+      data.counter = &counter;
+      data.n = 100000;
+
+      const unsigned n_threads = 4;
+      Platform::run_threads(n_threads, counter_thread, &data);
+      PSI_TEST_CHECK_EQUAL(counter, Jit::Int32(n_threads * data.n));
+    }
+
+    namespace {
+      struct TreiberNode {
+        TreiberNode *next;
+        Jit::UInt32 value;
+      };
+
+      typedef Jit::UInt32 (*TreiberFunction) (TreiberNode**, TreiberNode*, Jit::UIntPtr);
+
+      struct TreiberThreadData {
+        TreiberFunction f;
+        TreiberNode *head;
+        std::vector<TreiberNode> nodes;
+        std::vector<Jit::UInt32> sums;
+        Jit::UIntPtr n;
+      };
+
+      void treiber_thread(void *arg, unsigned index) {
+        TreiberThreadData *data = static_cast<TreiberThreadData*>(arg);
+        data->sums[index] = data->f(&data->head, &data->nodes[index * data->n], data->n);
+      }
+    }
+
+    /*
+     * A lock-free stack: each thread pushes its own nodes and then pops
+     * the same number of nodes, which may have been pushed by any thread.
+     *
+     * Nodes are never pushed twice, so the ABA problem cannot arise and
+     * every pop is guaranteed to find a non-empty stack.
+     */
+    PSI_TEST_CASE(TreiberStackTest) {
+      const char *src =
+        "%node = define struct (pointer i8) ui32;\n"
+        "\n"
+        "%push = function (%head : pointer (pointer i8), %nd : pointer %node) > empty {\n"
+        "  br %retry;\n"
+        "block %retry:\n"
+        "  %old = load %head relaxed;\n"
+        "  store %old (gep %nd #up0);\n"
+        "  %seen = cmpxchg %head %old (pointer_cast %nd i8) release relaxed;\n"
+        "  cond_br (cmp_eq (bitcast %seen uiptr) (bitcast %old uiptr)) %done %retry;\n"
+        "block %done:\n"
+        "  return empty_v;\n"
+        "};\n"
+        "\n"
+        "%pop = function (%head : pointer (pointer i8)) > ui32 {\n"
+        "  br %retry;\n"
+        "block %retry:\n"
+        "  %old = load %head acquire;\n"
+        "  %nd = pointer_cast %old %node;\n"
+        "  %next = load (gep %nd #up0);\n"
+        "  %seen = cmpxchg %head %old %next acquire acquire;\n"
+        "  cond_br (cmp_eq (bitcast %seen uiptr) (bitcast %old uiptr)) %done %retry;\n"
+        "block %done(%retry):\n"
+        "  %value = load (gep %nd #up1);\n"
+        "  return %value;\n"
+        "};\n"
+        "\n"
+        "%f = export function (%head : pointer (pointer i8), %nodes : pointer %node, %n : uiptr) > ui32 {\n"
+        "  br %push_loop;\n"
+        "block %push_loop:\n"
+        "  %i = phi uiptr: > #up0, %push_body > (add %i #up1);\n"
+        "  cond_br (cmp_lt %i %n) %push_body %pop_loop;\n"
+        "block %push_body(%push_loop):\n"
+        "  call %push %head (pointer_offset %nodes %i);\n"
+        "  br %push_loop;\n"
+        "block %pop_loop:\n"
+        "  %j = phi uiptr: %push_loop > #up0, %pop_body > (add %j #up1);\n"
+        "  %sum = phi ui32: %push_loop > #ui0, %pop_body > (add %sum %v);\n"
+        "  cond_br (cmp_lt %j %n) %pop_body %exit;\n"
+        "block %pop_body(%pop_loop):\n"
+        "  %v = call %pop %head;\n"
+        "  br %pop_loop;\n"
+        "block %exit(%pop_loop):\n"
+        "  return %sum;\n"
+        "};\n";
+
+      const unsigned n_threads = 4;
+      TreiberThreadData data;
+      data.f = reinterpret_cast<TreiberFunction>(jit_single("f", src));
+      data.head = NULL;
+      data.n = 20000;
+      data.nodes.resize(n_threads * data.n);
+      data.sums.resize(n_threads);
+      Jit::UInt32 expected = 0;
+      for (std::size_t ii = 0, ie = data.nodes.size(); ii != ie; ++ii) {
+        data.nodes[ii].next = NULL;
+        data.nodes[ii].value = Jit::UInt32(ii);
+        expected += Jit::UInt32(ii);
+      }
+
+      Platform::run_threads(n_threads, treiber_thread, &data);
+
+      Jit::UInt32 total = 0;
+      for (unsigned ii = 0; ii != n_threads; ++ii)
+        total += data.sums[ii];
+      PSI_TEST_CHECK_EQUAL(total, expected);
+      PSI_TEST_CHECK(data.head == NULL);
+    }
+
+    PSI_TEST_SUITE_END()
+  }
+}
@@ -298,7 +298,8 @@ namespace Psi {
     GlobalVariable::GlobalVariable(Context& context, const ValuePtr<>& type, const std::string& name, Module *module, const SourceLocation& location)
     : Global(context, term_global_variable, type, name, module, location),
       m_constant(false),
-      m_merge(false) {
+      m_merge(false),
+      m_thread_local(false) {
     }
 
     void GlobalVariable::set_value(const ValuePtr<>& value) {
@@ -516,6 +517,8 @@ namespace Psi {
     ParameterAttributes combine_attributes(const ParameterAttributes& lhs, const ParameterAttributes& rhs) {
       ParameterAttributes result;
       result.flags = lhs.flags | rhs.flags;
+      result.alignment = std::max(lhs.alignment, rhs.alignment);
+      result.dereferenceable = std::max(lhs.dereferenceable, rhs.dereferenceable);
       return result;
     }
     
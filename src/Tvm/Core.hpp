@@ -647,6 +647,15 @@ namespace Psi {
       bool merge() const {return m_merge;}
       void set_merge(bool m) {m_merge = m;}
       
+      /**
+       * \brief Whether each thread has its own copy of this variable
+       * 
+       * Each copy starts out with the initial value of this global.
+       */
+      bool is_thread_local() const {return m_thread_local;}
+      /// \brief Set whether each thread has its own copy of this variable
+      void set_thread_local(bool tls) {m_thread_local = tls;}
+      
       template<typename V> static void visit(V& v);
       static bool isa_impl(const Value& v) {return v.term_type() == term_global_variable;}
       
@@ -655,6 +664,7 @@ namespace Psi {
 
       bool m_constant;
       bool m_merge;
+      bool m_thread_local;
       ValuePtr<> m_value;
     };
 
@@ -728,29 +738,42 @@ namespace Psi {
     struct ParameterAttributes {
       enum Flags {
         llvm_byval=0x1,
-        llvm_inreg=0x2
+        llvm_inreg=0x2,
+        /// \brief Memory accessed through this pointer is not accessed through any other pointer during the call.
+        noalias=0x4,
+        /// \brief The callee does not keep a copy of this pointer beyond the call.
+        nocapture=0x8,
+        /// \brief The callee does not write through this pointer.
+        readonly=0x10
       };
       
       unsigned flags;
       unsigned alignment;
+      /// \brief Number of bytes known to be dereferenceable through this pointer, or zero if unknown.
+      unsigned dereferenceable;
       
-      ParameterAttributes() : flags(0), alignment(0) {}
-      explicit ParameterAttributes(unsigned flags_) : flags(flags_), alignment(0) {}
+      ParameterAttributes() : flags(0), alignment(0), dereferenceable(0) {}
+      explicit ParameterAttributes(unsigned flags_) : flags(flags_), alignment(0), dereferenceable(0) {}
       
       friend std::size_t hash_value(const ParameterAttributes& self) {
         std::size_t h = 0;
         boost::hash_combine(h, self.flags);
+        boost::hash_combine(h, self.alignment);
+        boost::hash_combine(h, self.dereferenceable);
         return h;
       }
       
       template<typename V>
       static void visit(V& v) {
         v("flags", &ParameterAttributes::flags)
-        ("alignment", &ParameterAttributes::alignment);
+        ("alignment", &ParameterAttributes::alignment)
+        ("dereferenceable", &ParameterAttributes::dereferenceable);
       }
     };
     
-    inline bool operator == (const ParameterAttributes& lhs, const ParameterAttributes& rhs) {return lhs.flags == rhs.flags;}
+    inline bool operator == (const ParameterAttributes& lhs, const ParameterAttributes& rhs) {
+      return (lhs.flags == rhs.flags) && (lhs.alignment == rhs.alignment) && (lhs.dereferenceable == rhs.dereferenceable);
+    }
     inline bool operator != (const ParameterAttributes& lhs, const ParameterAttributes& rhs) {return !(lhs == rhs);}
     ParameterAttributes combine_attributes(const ParameterAttributes& lhs, const ParameterAttributes& rhs);
 
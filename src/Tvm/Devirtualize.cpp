@@ -0,0 +1,88 @@
+#include "Devirtualize.hpp"
+#include "Aggregate.hpp"
+#include "Instructions.hpp"
+#include "Number.hpp"
+
+namespace Psi {
+  namespace Tvm {
+    namespace {
+      /// \brief Get the first element of a constant aggregate, which is at the same address as the aggregate.
+      ValuePtr<> first_element(const ValuePtr<>& value) {
+        if (ValuePtr<StructValue> struct_val = dyn_cast<StructValue>(value))
+          return struct_val->n_members() ? struct_val->member_value(0) : ValuePtr<>();
+        else if (ValuePtr<ArrayValue> array_val = dyn_cast<ArrayValue>(value))
+          return array_val->length() ? array_val->value(0) : ValuePtr<>();
+        return ValuePtr<>();
+      }
+
+      /**
+       * \brief Get the value a pointer points to, if it is inside
+       * a constant global variable.
+       */
+      ValuePtr<> constant_target(const ValuePtr<>& ptr) {
+        if (ValuePtr<GlobalVariable> gvar = dyn_cast<GlobalVariable>(ptr)) {
+          return gvar->constant() ? gvar->value() : ValuePtr<>();
+        } else if (ValuePtr<ElementPtr> element_ptr = dyn_cast<ElementPtr>(ptr)) {
+          ValuePtr<IntegerValue> index = dyn_cast<IntegerValue>(element_ptr->index());
+          if (!index)
+            return ValuePtr<>();
+          boost::optional<unsigned> idx = index->value().unsigned_value();
+          ValuePtr<> base = constant_target(element_ptr->aggregate_ptr());
+          if (!idx || !base)
+            return ValuePtr<>();
+          if (ValuePtr<StructValue> struct_val = dyn_cast<StructValue>(base))
+            return (*idx < struct_val->n_members()) ? struct_val->member_value(*idx) : ValuePtr<>();
+          else if (ValuePtr<ArrayValue> array_val = dyn_cast<ArrayValue>(base))
+            return (*idx < array_val->length()) ? array_val->value(*idx) : ValuePtr<>();
+          return ValuePtr<>();
+        } else if (ValuePtr<PointerCast> cast = dyn_cast<PointerCast>(ptr)) {
+          ValuePtr<> value = constant_target(cast->pointer());
+          while (value && (value->type() != cast->target_type()))
+            value = first_element(value);
+          return value;
+        }
+        return ValuePtr<>();
+      }
+
+      bool is_function_pointer(const ValuePtr<>& value) {
+        ValuePtr<> base = value;
+        while (ValuePtr<PointerCast> cast = dyn_cast<PointerCast>(base))
+          base = cast->pointer();
+        return isa<Function>(base);
+      }
+    }
+
+    void DevirtualizePass::run(Module& module) {
+      for (Module::ModuleMemberList::iterator ii = module.members().begin(), ie = module.members().end(); ii != ie; ++ii) {
+        if (ValuePtr<Function> function = dyn_cast<Function>(ii->second)) {
+          if (!function->blocks().empty())
+            run_function(function);
+        }
+      }
+    }
+
+    void DevirtualizePass::run_function(const ValuePtr<Function>& function) {
+      Function::ValueReplacementMap folded;
+      for (Function::BlockList::iterator ii = function->blocks().begin(), ie = function->blocks().end(); ii != ie; ++ii) {
+        for (Block::InstructionList::iterator ji = (*ii)->instructions().begin(), je = (*ii)->instructions().end(); ji != je; ++ji) {
+          if (ValuePtr<Load> load = dyn_cast<Load>(*ji)) {
+            if (load->ordering != atomic_none)
+              continue;
+            ValuePtr<> value = constant_target(load->target);
+            if (value && (value->type() == load->type()) && is_function_pointer(value))
+              folded.insert(std::make_pair(load, value));
+          }
+        }
+      }
+
+      if (folded.empty())
+        return;
+
+      // Pointer casts of the loaded value are simplified, so that calls through it become direct calls
+      function->replace_values(folded);
+
+      for (Function::ValueReplacementMap::const_iterator ii = folded.begin(), ie = folded.end(); ii != ie; ++ii)
+        value_cast<Instruction>(ii->first)->remove();
+    }
+  }
+}
@@ -0,0 +1,40 @@
+#ifndef HPP_PSI_TVM_DEVIRTUALIZE
+#define HPP_PSI_TVM_DEVIRTUALIZE
+
+#include "Function.hpp"
+
+/**
+ * \file
+ *
+ * Devirtualization: replacing calls through function pointers loaded
+ * from constant tables with direct calls.
+ */
+
+namespace Psi {
+  namespace Tvm {
+    /**
+     * \brief Replaces loads of function pointers from constant global
+     * variables by the function being loaded.
+     *
+     * Interface implementations are constant global variables holding
+     * tables of function pointers, and lifecycle operations and interface
+     * methods are called by loading a pointer from such a table. Where the
+     * table is known, this pass replaces the load by the function it
+     * would produce, so that the call which uses it becomes a direct call.
+     *
+     * Pointers into a table are followed through ElementPtr and
+     * PointerCast, so this is intended to run on the output of
+     * AggregateLoweringPass, where implementation tables are ordinary
+     * structures. Atomic loads and loads of anything other than a
+     * function pointer are left alone.
+     */
+    class PSI_TVM_EXPORT DevirtualizePass : public boost::noncopyable {
+      void run_function(const ValuePtr<Function>& function);
+
+    public:
+      void run(Module& module);
+    };
+  }
+}
+
+#endif
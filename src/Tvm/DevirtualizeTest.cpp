@@ -0,0 +1,97 @@
+#include "Test.hpp"
+
+#include "Assembler.hpp"
+#include "Devirtualize.hpp"
+#include "Instructions.hpp"
+#include "Jit.hpp"
+
+namespace Psi {
+  namespace Tvm {
+    PSI_TEST_SUITE_FIXTURE(DevirtualizeTest, Test::ContextFixture)
+
+    namespace {
+      typedef Jit::Int32 (*TableFunction) (Jit::Int32);
+
+      /// Count calls and loads in a function
+      void count_instructions(const ValuePtr<Function>& function, std::size_t& n_direct, std::size_t& n_indirect, std::size_t& n_loads) {
+        n_direct = n_indirect = n_loads = 0;
+        for (Function::BlockList::const_iterator ii = function->blocks().begin(), ie = function->blocks().end(); ii != ie; ++ii) {
+          for (Block::InstructionList::const_iterator ji = (*ii)->instructions().begin(), je = (*ii)->instructions().end(); ji != je; ++ji) {
+            if (ValuePtr<Call> call = dyn_cast<Call>(*ji))
+              ++(isa<Function>(call->target) ? n_direct : n_indirect);
+            else if (isa<Load>(*ji))
+              ++n_loads;
+          }
+        }
+      }
+    }
+
+    /*
+     * Functions loaded from a constant table are called directly.
+     */
+    PSI_TEST_CASE(ConstantTableTest) {
+      const char *src =
+        "%op = define pointer (function (i32) > i32);\n"
+        "%twice = function (%x : i32) > i32 {\n"
+        "  return (add %x %x);\n"
+        "};\n"
+        "%square = function (%x : i32) > i32 {\n"
+        "  return (mul %x %x);\n"
+        "};\n"
+        "%table = global const (struct %op (array %op #up1)) (struct_v %twice (array_v %op %square));\n"
+        "%f = export function (%x : i32) > i32 {\n"
+        "  %a = load (gep %table #up0);\n"
+        "  %b = load (gep (gep %table #up1) #up0);\n"
+        "  %y = call %a %x;\n"
+        "  %z = call %b %y;\n"
+        "  return %z;\n"
+        "};\n";
+
+      AssemblerResult r = parse_and_build(module, location.physical, src);
+      DevirtualizePass pass;
+      pass.run(module);
+
+      std::size_t n_direct, n_indirect, n_loads;
+      count_instructions(value_cast<Function>(r["f"]), n_direct, n_indirect, n_loads);
+      PSI_TEST_CHECK_EQUAL(n_direct, 2u);
+      PSI_TEST_CHECK_EQUAL(n_indirect, 0u);
+      PSI_TEST_CHECK_EQUAL(n_loads, 0u);
+
+      jit().add_module(&module);
+      TableFunction f = reinterpret_cast<TableFunction>(jit().get_symbol(value_cast<Global>(r["f"])));
+      PSI_TEST_CHECK_EQUAL(f(3), 36);
+    }
+
+    /*
+     * A table which may be modified is still called through.
+     */
+    PSI_TEST_CASE(MutableTableTest) {
+      const char *src =
+        "%op = define pointer (function (i32) > i32);\n"
+        "%twice = function (%x : i32) > i32 {\n"
+        "  return (add %x %x);\n"
+        "};\n"
+        "%table = global (struct %op) (struct_v %twice);\n"
+        "%f = export function (%x : i32) > i32 {\n"
+        "  %a = load (gep %table #up0);\n"
+        "  %y = call %a %x;\n"
+        "  return %y;\n"
+        "};\n";
+
+      AssemblerResult r = parse_and_build(module, location.physical, src);
+      DevirtualizePass pass;
+      pass.run(module);
+
+      std::size_t n_direct, n_indirect, n_loads;
+      count_instructions(value_cast<Function>(r["f"]), n_direct, n_indirect, n_loads);
+      PSI_TEST_CHECK_EQUAL(n_indirect, 1u);
+      PSI_TEST_CHECK_EQUAL(n_loads, 1u);
+
+      jit().add_module(&module);
+      TableFunction f = reinterpret_cast<TableFunction>(jit().get_symbol(value_cast<Global>(r["f"])));
+      PSI_TEST_CHECK_EQUAL(f(3), 6);
+    }
+
+    PSI_TEST_SUITE_END()
+  }
+}
@@ -545,6 +545,8 @@ namespace Psi {
         *m_output << "global ";
         if (gvar->constant())
           *m_output << "const ";
+        if (gvar->is_thread_local())
+          *m_output << "thread_local ";
         print_term(gvar->value_type(), true);
         if (gvar->value()) {
           *m_output << ' ';
@@ -753,6 +755,25 @@ namespace Psi {
           print_term(resolved_param->type(), false);
           *m_output << "]";
         }
+      } else if (ValuePtr<VectorType> vector_type = dyn_cast<VectorType>(term)) {
+        if (bracket)
+          *m_output << '(';
+        *m_output << "vector ";
+        print_term(vector_type->element_type(), true);
+        *m_output << " #i" << vector_type->length();
+        if (bracket)
+          *m_output << ')';
+      } else if (ValuePtr<VectorShuffle> shuffle = dyn_cast<VectorShuffle>(term)) {
+        if (bracket)
+          *m_output << '(';
+        *m_output << "vector_shuffle ";
+        print_term(shuffle->lhs(), true);
+        *m_output << ' ';
+        print_term(shuffle->rhs(), true);
+        for (std::vector<unsigned>::const_iterator ii = shuffle->mask().begin(), ie = shuffle->mask().end(); ii != ie; ++ii)
+          *m_output << " #i" << *ii;
+        if (bracket)
+          *m_output << ')';
       } else if (ValuePtr<UnwrapParameter> unwrap_param = dyn_cast<UnwrapParameter>(term)) {
         *m_output << "unwrap_param ";
         print_term(unwrap_param->value(), true);
@@ -811,6 +832,12 @@ namespace Psi {
 
     void DisassemblerContext::print_instruction_term(const ValuePtr<Instruction>& term) {
       *m_output << term->operation_name();
+      if (ValuePtr<AtomicRMW> rmw = dyn_cast<AtomicRMW>(term)) {
+        *m_output << ' ' << atomic_rmw_name(rmw->op);
+      } else if (ValuePtr<Call> call = dyn_cast<Call>(term)) {
+        if (call->tail != tail_call_none)
+          *m_output << ' ' << tail_call_name(call->tail);
+      }
       
       class MyVisitor : public InstructionVisitor {
         DisassemblerContext *m_self;
@@ -826,6 +853,25 @@ namespace Psi {
       
       MyVisitor my_visitor(this);
       term->instruction_visit(my_visitor);
+      
+      // Memory orderings and branch weights are not values so are not seen by the visitor
+      if (ValuePtr<Load> load = dyn_cast<Load>(term)) {
+        if (load->ordering != atomic_none)
+          *m_output << ' ' << atomic_ordering_name(load->ordering);
+      } else if (ValuePtr<Store> store = dyn_cast<Store>(term)) {
+        if (store->ordering != atomic_none)
+          *m_output << ' ' << atomic_ordering_name(store->ordering);
+      } else if (ValuePtr<AtomicRMW> rmw = dyn_cast<AtomicRMW>(term)) {
+        *m_output << ' ' << atomic_ordering_name(rmw->ordering);
+      } else if (ValuePtr<CmpXchg> cmpxchg = dyn_cast<CmpXchg>(term)) {
+        *m_output << ' ' << atomic_ordering_name(cmpxchg->success_ordering) << ' ' << atomic_ordering_name(cmpxchg->failure_ordering);
+      } else if (ValuePtr<Fence> fence = dyn_cast<Fence>(term)) {
+        *m_output << ' ' << atomic_ordering_name(fence->ordering);
+      } else if (ValuePtr<ConditionalBranch> cond_br = dyn_cast<ConditionalBranch>(term)) {
+        if (cond_br->has_weights())
+          *m_output << " #up" << cond_br->true_weight << " #up" << cond_br->false_weight;
+      }
+      
       *m_output << ";\n";
     }
     
@@ -897,6 +943,10 @@ namespace Psi {
     void DisassemblerContext::print_parameter_attributes(const ParameterAttributes& attr) {
       if (attr.flags & ParameterAttributes::llvm_byval) *m_output << " llvm_byval";
       if (attr.flags & ParameterAttributes::llvm_inreg) *m_output << " llvm_inreg";
+      if (attr.flags & ParameterAttributes::noalias) *m_output << " noalias";
+      if (attr.flags & ParameterAttributes::nocapture) *m_output << " nocapture";
+      if (attr.flags & ParameterAttributes::readonly) *m_output << " readonly";
+      if (attr.dereferenceable) *m_output << " dereferenceable #up" << attr.dereferenceable;
     }
     
     void DisassemblerContext::print_definitions(const TermDefinitionList& definitions, const char *line_prefix, bool global) {
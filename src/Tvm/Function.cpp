@@ -538,6 +538,18 @@ namespace Psi {
           error_context().error_throw(insn->location(), "terminating instruction cannot be inserted other than at the end of a block");
       }
       
+      InstructionList::const_iterator previous = insert_before ? m_instructions.iterator_to(insert_before) : m_instructions.end();
+      if (previous != m_instructions.begin()) {
+        --previous;
+        if (ValuePtr<Call> call = dyn_cast<Call>(*previous)) {
+          if (call->tail != tail_call_none) {
+            ValuePtr<Return> ret = dyn_cast<Return>(insn);
+            if (!ret || !ret->returns_result_of(call))
+              error_context().error_throw(insn->location(), "tail call must be immediately followed by a return of its result");
+          }
+        }
+      }
+      
       m_instructions.insert(insert_before, *insn);
       insn->m_block = this;
       insn->type_check();
@@ -621,6 +633,18 @@ namespace Psi {
       error_context().error_throw(location(), "Incoming block not found in PHI node");
     }
     
+    /**
+     * \brief Replace each incoming value with the result of \c callback.
+     * 
+     * The replacement values must have the same type as the originals.
+     */
+    void Phi::rewrite_edges(RewriteCallback& callback) {
+      for (std::vector<PhiEdge>::iterator ii = m_edges.begin(), ie = m_edges.end(); ii != ie; ++ii) {
+        ii->value = callback.rewrite(ii->value);
+        PSI_ASSERT(ii->value->type() == type());
+      }
+    }
+    
     /**
      * \brief Remove from its block.
      */
@@ -780,7 +804,8 @@ namespace Psi {
     }
     
     Function::Function(Context& context, const ValuePtr<FunctionType>& type, const std::string& name, Module* module, const SourceLocation& location)
-    : Global(context, term_function, type, name, module, location) {
+    : Global(context, term_function, type, name, module, location),
+    m_hotness(hotness_normal) {
 
       std::vector<ValuePtr<> > previous;
       unsigned n_phantom = type->n_phantom();
@@ -828,12 +853,65 @@ namespace Psi {
       m_name_map.insert(std::make_pair(term, name));
     }
 
+    namespace {
+      class ValueReplacementCallback : public RewriteCallback {
+        Function::ValueReplacementMap m_map;
+
+      public:
+        ValueReplacementCallback(Context& context, const Function::ValueReplacementMap& replacements)
+        : RewriteCallback(context), m_map(replacements) {}
+
+        virtual ValuePtr<> rewrite(const ValuePtr<>& value) {
+          if (!value)
+            return value;
+
+          Function::ValueReplacementMap::const_iterator it = m_map.find(value);
+          if (it != m_map.end())
+            return it->second;
+
+          ValuePtr<> result = value;
+          // Rebuild pointer casts through FunctionalBuilder so that casts of replaced values are simplified
+          if (ValuePtr<PointerCast> cast = dyn_cast<PointerCast>(value))
+            result = FunctionalBuilder::pointer_cast(rewrite(cast->pointer()), cast->target_type(), rewrite(cast->upref()), cast->location());
+          else if (ValuePtr<HashableValue> hashable = dyn_cast<HashableValue>(value))
+            result = hashable->rewrite(*this);
+          m_map.insert(std::make_pair(value, result));
+          return result;
+        }
+      };
+
+      class InstructionRewriteVisitor : public InstructionVisitor {
+        RewriteCallback *m_callback;
+      public:
+        InstructionRewriteVisitor(RewriteCallback *callback) : m_callback(callback) {}
+        virtual void next(ValuePtr<>& ptr) {ptr = m_callback->rewrite(ptr);}
+      };
+    }
+
+    /**
+     * \brief Replace values in every instruction and phi node of this function.
+     *
+     * Values which use a replaced value, such as pointer casts of it,
+     * are rebuilt. The replaced values themselves are not removed.
+     */
+    void Function::replace_values(const ValueReplacementMap& replacements) {
+      ValueReplacementCallback rewriter(context(), replacements);
+      InstructionRewriteVisitor visitor(&rewriter);
+      for (BlockList::iterator ii = m_blocks.begin(), ie = m_blocks.end(); ii != ie; ++ii) {
+        for (Block::PhiList::iterator ji = (*ii)->phi_nodes().begin(), je = (*ii)->phi_nodes().end(); ji != je; ++ji)
+          (*ji)->rewrite_edges(rewriter);
+        for (Block::InstructionList::iterator ji = (*ii)->instructions().begin(), je = (*ii)->instructions().end(); ji != je; ++ji)
+          (*ji)->instruction_visit(visitor);
+      }
+    }
+
     template<typename V>
     void Function::visit(V& v) {
       visit_base<Global>(v);
       v("parameters", &Function::m_parameters)
       ("result_type", &Function::m_result_type)
       ("exception_personality", &Function::m_exception_personality)
+      ("hotness", &Function::m_hotness)
       ("name_map", &Function::m_name_map)
       ("blocks", &Function::m_blocks);
     }
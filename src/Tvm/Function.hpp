@@ -169,6 +169,7 @@ namespace Psi {
       
       /// \brief Get the value from a specific source block.
       PSI_TVM_EXPORT ValuePtr<> incoming_value_from(const ValuePtr<Block>& block);
+      PSI_TVM_EXPORT void rewrite_edges(RewriteCallback& callback);
 
       void remove();
 
@@ -283,6 +284,20 @@ namespace Psi {
       template<typename T, boost::intrusive::list_member_hook<> T::*> friend class ValueList;
     };
 
+    /**
+     * \brief How often a function is expected to be called.
+     */
+    enum FunctionHotness {
+      /// \brief Nothing is known about how often the function is called
+      hotness_normal,
+      /// \brief Called often, so worth optimizing aggressively
+      hotness_hot,
+      /// \brief Rarely or never called, so optimize for size and keep it out of the way
+      hotness_cold
+    };
+    
+    PSI_VISIT_SIMPLE(FunctionHotness);
+
     /**
      * \brief Function.
      */
@@ -322,6 +337,9 @@ namespace Psi {
 
       void add_term_name(const ValuePtr<>& term, const std::string& name);
       const TermNameMap& term_name_map() {return m_name_map;}
+
+      typedef boost::unordered_map<ValuePtr<>, ValuePtr<> > ValueReplacementMap;
+      PSI_TVM_EXPORT void replace_values(const ValueReplacementMap& replacements);
       
       /**
        * \brief Get the exception handling personality of this function.
@@ -337,6 +355,15 @@ namespace Psi {
        * \see exception_personality()
        */
       void exception_personality(const std::string& v) {m_exception_personality = v;}
+      
+      /**
+       * \brief Get how often this function is expected to be called.
+       * 
+       * This is a hint to the backend, usually derived from a profile.
+       */
+      FunctionHotness hotness() const {return m_hotness;}
+      /// \brief Set how often this function is expected to be called.
+      void set_hotness(FunctionHotness hotness) {m_hotness = hotness;}
 
       template<typename V> static void visit(V& v);
       static bool isa_impl(const Value& v) {return v.term_type() == term_function;}
@@ -347,6 +374,7 @@ namespace Psi {
 
       TermNameMap m_name_map;
       std::string m_exception_personality;
+      FunctionHotness m_hotness;
       ValuePtr<> m_result_type;
       ParameterList m_parameters;
       BlockList m_blocks;
@@ -49,6 +49,34 @@ namespace Psi {
       PSI_TEST_CHECK_EQUAL(f(return_2,&x,&y), &y);
     }
 
+    /*
+     * Aliasing attributes reach the backend and do not change
+     * the behaviour of a correct program.
+     */
+    PSI_TEST_CASE(NoAliasTest) {
+      const char *src =
+        "%add = function (%a : noalias nocapture pointer i32, %b : noalias readonly dereferenceable #up4 pointer i32) > empty {\n"
+        "  %x = load %a;\n"
+        "  %y = load %b;\n"
+        "  store (add %x %y) %a;\n"
+        "  %z = load %b;\n"
+        "  store (add (add %x %y) %z) %a;\n"
+        "  return empty_v;\n"
+        "};\n"
+        "\n"
+        "%f = export function (%a : pointer i32, %b : pointer i32) > empty {\n"
+        "  call %add %a %b;\n"
+        "  return empty_v;\n"
+        "};\n";
+
+      typedef void (*FuncType) (Jit::Int32*, Jit::Int32*);
+      FuncType f = reinterpret_cast<FuncType>(jit_single("f", src));
+      Jit::Int32 a = 10, b = 3;
+      f(&a, &b);
+      PSI_TEST_CHECK_EQUAL(a, 16);
+      PSI_TEST_CHECK_EQUAL(b, 3);
+    }
+
     PSI_TEST_CASE(PhiTest) {
       const char *src =
         "%f = export function (%a: bool, %b: i32, %c: i32) > i32 {\n"
@@ -89,6 +117,28 @@ namespace Psi {
       PSI_TEST_CHECK_EQUAL(f(false, 15, 30), 30);
     }
 
+    /*
+     * Locals named like globals, in several functions, must get C names
+     * distinct from the globals and from each other.
+     */
+    PSI_TEST_CASE(LocalNameTest) {
+      const char *src =
+        "%x = global i32 #i5;\n"
+        "%y = function (%x1 : i32) > i32 {\n"
+        "  %x = load %x;\n"
+        "  return (add %x %x1);\n"
+        "};\n"
+        "%f = export function (%y1 : i32) > i32 {\n"
+        "  %x = call %y %y1;\n"
+        "  %y = call %y %x;\n"
+        "  return %y;\n"
+        "};\n";
+
+      typedef Jit::Int32 (*FunctionType) (Jit::Int32);
+      FunctionType f = reinterpret_cast<FunctionType>(jit_single("f", src));
+      PSI_TEST_CHECK_EQUAL(f(1), 11);
+    }
+
     PSI_TEST_SUITE_END()
  }
 }
@@ -655,13 +655,13 @@ namespace Psi {
       ValuePtr<> int_binary_undef(const char *op, const ValuePtr<>& lhs, const ValuePtr<>& rhs, const SourceLocation& location) {
         if (lhs->type() != rhs->type())
           lhs->error_context().error_throw(location, boost::format("type mismatch on parameter to %s") % op);
-        else if (!isa<IntegerType>(lhs->type()))
+        else if (!isa<IntegerType>(lane_type(lhs->type())))
           lhs->error_context().error_throw(location, boost::format("parameters to %s are not integers") % op);
         return FunctionalBuilder::undef(lhs->type(), location);
       }
       
       ValuePtr<> int_unary_undef(const char *op, const ValuePtr<>& parameter, const SourceLocation& location) {
-        if (!isa<IntegerType>(parameter->type()))
+        if (!isa<IntegerType>(lane_type(parameter->type())))
           parameter->error_context().error_throw(location, boost::format("parameters to %s are not integers") % op);
         return FunctionalBuilder::undef(parameter->type(), location);
       }
@@ -884,6 +884,12 @@ namespace Psi {
                         const SourceLocation& location) {
         if (lhs->type() != rhs->type())
           lhs->error_context().error_throw(location, boost::format("type mismatch on parameters to %s operation") % Op::operation);
+        // Lane-wise comparisons are not folded
+        if (ValuePtr<VectorType> vec_ty = dyn_cast<VectorType>(lhs->type())) {
+          if (!isa<IntegerType>(vec_ty->element_type()))
+            lhs->error_context().error_throw(location, boost::format("parameters to %s are not integers") % Op::operation);
+          return lhs->context().get_functional(Op(lhs, rhs, location));
+        }
         ValuePtr<IntegerType> int_ty = dyn_cast<IntegerType>(lhs->type());
         if (!int_ty)
           lhs->error_context().error_throw(location, boost::format("parameters to %s are not integers") % Op::operation);
@@ -1037,6 +1043,90 @@ namespace Psi {
       return context.get_functional(FloatType(context, width, location));
     }
     
+    /**
+     * \brief Get a vector type.
+     * 
+     * \param element_type Lane type, which must be a boolean, integer or float type.
+     * 
+     * \param length Number of lanes, which must be a power of two.
+     */
+    ValuePtr<> FunctionalBuilder::vector_type(const ValuePtr<>& element_type, unsigned length, const SourceLocation& location) {
+      return element_type->context().get_functional(VectorType(element_type, length, location));
+    }
+    
+    /**
+     * \brief Get a constant vector, or build a vector from values.
+     */
+    ValuePtr<> FunctionalBuilder::vector_value(const ValuePtr<>& element_type, const std::vector<ValuePtr<> >& elements, const SourceLocation& location) {
+      return element_type->context().get_functional(VectorValue(element_type, elements, location));
+    }
+    
+    /**
+     * \brief Get the value of a single vector lane.
+     */
+    ValuePtr<> FunctionalBuilder::vector_element(const ValuePtr<>& vector, const ValuePtr<>& index, const SourceLocation& location) {
+      if (ValuePtr<IntegerValue> index_val = dyn_cast<IntegerValue>(index)) {
+        if (boost::optional<unsigned> index_int = index_val->value().unsigned_value()) {
+          if (ValuePtr<VectorValue> vec_val = dyn_cast<VectorValue>(vector)) {
+            if (*index_int < vec_val->length())
+              return vec_val->value(*index_int);
+          } else if (ValuePtr<VectorInsert> insert = dyn_cast<VectorInsert>(vector)) {
+            if (insert->index() == index)
+              return insert->value();
+          }
+        }
+      }
+      
+      return vector->context().get_functional(VectorElement(vector, index, location));
+    }
+
+    /// \copydoc FunctionalBuilder::vector_element(const ValuePtr<>&,const ValuePtr<>&,const SourceLocation&)
+    ValuePtr<> FunctionalBuilder::vector_element(const ValuePtr<>& vector, unsigned index, const SourceLocation& location) {
+      return vector_element(vector, size_value(vector->context(), index, location), location);
+    }
+    
+    /**
+     * \brief Get a copy of a vector with one lane replaced.
+     */
+    ValuePtr<> FunctionalBuilder::vector_insert(const ValuePtr<>& vector, const ValuePtr<>& index, const ValuePtr<>& value, const SourceLocation& location) {
+      return vector->context().get_functional(VectorInsert(vector, index, value, location));
+    }
+    
+    /**
+     * \brief Rearrange the lanes of two vectors.
+     * 
+     * \param mask Lane selectors. See VectorShuffle for details.
+     */
+    ValuePtr<> FunctionalBuilder::vector_shuffle(const ValuePtr<>& lhs, const ValuePtr<>& rhs, const std::vector<unsigned>& mask, const SourceLocation& location) {
+      if (ValuePtr<VectorType> vec_ty = dyn_cast<VectorType>(lhs->type())) {
+        // Identity shuffle
+        if ((mask.size() == vec_ty->length()) && (lhs->type() == rhs->type())) {
+          bool identity = true;
+          for (unsigned ii = 0, ie = mask.size(); ii != ie; ++ii)
+            identity = identity && (mask[ii] == ii);
+          if (identity)
+            return lhs;
+        }
+      }
+      
+      return lhs->context().get_functional(VectorShuffle(lhs, rhs, mask, location));
+    }
+    
+    /// \brief Get the sum of all lanes of an integer vector.
+    ValuePtr<> FunctionalBuilder::vector_reduce_add(const ValuePtr<>& vector, const SourceLocation& location) {
+      return vector->context().get_functional(VectorReduceAdd(vector, location));
+    }
+    
+    /// \brief Get the bitwise and of all lanes of an integer or boolean vector.
+    ValuePtr<> FunctionalBuilder::vector_reduce_and(const ValuePtr<>& vector, const SourceLocation& location) {
+      return vector->context().get_functional(VectorReduceAnd(vector, location));
+    }
+    
+    /// \brief Get the bitwise or of all lanes of an integer or boolean vector.
+    ValuePtr<> FunctionalBuilder::vector_reduce_or(const ValuePtr<>& vector, const SourceLocation& location) {
+      return vector->context().get_functional(VectorReduceOr(vector, location));
+    }
+    
     /**
      * \brief Get an Exists term.
      */
@@ -163,6 +163,19 @@ namespace Psi {
       
       static ValuePtr<> float_type(Context&, FloatType::Width, const SourceLocation& location);
       
+      /// \name Vector operations
+      //@{
+      static ValuePtr<> vector_type(const ValuePtr<>& element_type, unsigned length, const SourceLocation& location);
+      static ValuePtr<> vector_value(const ValuePtr<>& element_type, const std::vector<ValuePtr<> >& elements, const SourceLocation& location);
+      static ValuePtr<> vector_element(const ValuePtr<>& vector, const ValuePtr<>& index, const SourceLocation& location);
+      static ValuePtr<> vector_element(const ValuePtr<>& vector, unsigned index, const SourceLocation& location);
+      static ValuePtr<> vector_insert(const ValuePtr<>& vector, const ValuePtr<>& index, const ValuePtr<>& value, const SourceLocation& location);
+      static ValuePtr<> vector_shuffle(const ValuePtr<>& lhs, const ValuePtr<>& rhs, const std::vector<unsigned>& mask, const SourceLocation& location);
+      static ValuePtr<> vector_reduce_add(const ValuePtr<>& vector, const SourceLocation& location);
+      static ValuePtr<> vector_reduce_and(const ValuePtr<>& vector, const SourceLocation& location);
+      static ValuePtr<> vector_reduce_or(const ValuePtr<>& vector, const SourceLocation& location);
+      //@}
+      
       static ValuePtr<> bit_cast(const ValuePtr<>& value, const ValuePtr<>& type, const SourceLocation& location);
       static ValuePtr<> select(const ValuePtr<>&, const ValuePtr<>&, const ValuePtr<>&, const SourceLocation& location);
       static ValuePtr<> specialize(const ValuePtr<>&, const std::vector<ValuePtr<> >&, const SourceLocation& location);
@@ -107,7 +107,20 @@ namespace Psi {
      * \param if_false Block to jump to if \c condition is false.
      */
     ValuePtr<Instruction> InstructionBuilder::cond_br(const ValuePtr<>& condition, const ValuePtr<Block>& if_true, const ValuePtr<Block>& if_false, const SourceLocation& location) {
-      ValuePtr<Instruction> insn(::new ConditionalBranch(condition, if_true, if_false, location));
+      return cond_br(condition, if_true, if_false, 0, 0, location);
+    }
+    
+    /**
+     * \brief Conditionally jump to one of two blocks, with a hint as to which is more likely.
+     * 
+     * \param true_weight Relative probability of jumping to \c if_true.
+     * 
+     * \param false_weight Relative probability of jumping to \c if_false.
+     * If both weights are zero then no hint is given.
+     */
+    ValuePtr<Instruction> InstructionBuilder::cond_br(const ValuePtr<>& condition, const ValuePtr<Block>& if_true, const ValuePtr<Block>& if_false,
+                                                      unsigned true_weight, unsigned false_weight, const SourceLocation& location) {
+      ValuePtr<Instruction> insn(::new ConditionalBranch(condition, if_true, if_false, true_weight, false_weight, location));
       m_insert_point.insert(insn);
       return insn;
     }
@@ -120,7 +133,17 @@ namespace Psi {
      * \param parameters Parameters to the function.
      */
     ValuePtr<Instruction> InstructionBuilder::call(const ValuePtr<>& target, const std::vector<ValuePtr<> >& parameters, const SourceLocation& location) {
-      ValuePtr<Instruction> insn(::new Call(target, parameters, location));
+      return call(target, parameters, tail_call_none, location);
+    }
+    
+    /**
+     * \brief Call a function, possibly as a tail call.
+     * 
+     * \param tail Whether this is a tail call. If so, the next instruction
+     * inserted must return the result of this call.
+     */
+    ValuePtr<Instruction> InstructionBuilder::call(const ValuePtr<>& target, const std::vector<ValuePtr<> >& parameters, TailCallMode tail, const SourceLocation& location) {
+      ValuePtr<Instruction> insn(::new Call(target, parameters, tail, location));
       m_insert_point.insert(insn);
       return insn;
     }
@@ -250,7 +273,18 @@ namespace Psi {
      * \param ptr Pointer to value.
      */
     ValuePtr<Instruction> InstructionBuilder::load(const ValuePtr<>& ptr, const SourceLocation& location) {
-      ValuePtr<Instruction> insn(::new Load(ptr, location));
+      return load(ptr, atomic_none, location);
+    }
+    
+    /**
+     * \brief Load a value from memory, possibly atomically.
+     * 
+     * \param ptr Pointer to value.
+     * 
+     * \param ordering Memory ordering, or \c atomic_none for an ordinary load.
+     */
+    ValuePtr<Instruction> InstructionBuilder::load(const ValuePtr<>& ptr, AtomicOrdering ordering, const SourceLocation& location) {
+      ValuePtr<Instruction> insn(::new Load(ptr, ordering, location));
       m_insert_point.insert(insn);
       return insn;
     }
@@ -263,7 +297,66 @@ namespace Psi {
      * \param ptr Pointer to store \c value to.
      */
     ValuePtr<Instruction> InstructionBuilder::store(const ValuePtr<>& value, const ValuePtr<>& ptr, const SourceLocation& location) {
-      ValuePtr<Instruction> insn(::new Store(value, ptr, location));
+      return store(value, ptr, atomic_none, location);
+    }
+    
+    /**
+     * \brief Store a value to memory, possibly atomically.
+     * 
+     * \param value Value to store.
+     * 
+     * \param ptr Pointer to store \c value to.
+     * 
+     * \param ordering Memory ordering, or \c atomic_none for an ordinary store.
+     */
+    ValuePtr<Instruction> InstructionBuilder::store(const ValuePtr<>& value, const ValuePtr<>& ptr, AtomicOrdering ordering, const SourceLocation& location) {
+      ValuePtr<Instruction> insn(::new Store(value, ptr, ordering, location));
+      m_insert_point.insert(insn);
+      return insn;
+    }
+    
+    /**
+     * \brief Create an atomic read-modify-write instruction.
+     * 
+     * \param op Operation to perform.
+     * 
+     * \param ptr Pointer to value being modified.
+     * 
+     * \param value Second operand to \c op.
+     * 
+     * \param ordering Memory ordering.
+     */
+    ValuePtr<Instruction> InstructionBuilder::atomic_rmw(AtomicRMWOperation op, const ValuePtr<>& ptr, const ValuePtr<>& value, AtomicOrdering ordering, const SourceLocation& location) {
+      ValuePtr<Instruction> insn(::new AtomicRMW(op, ptr, value, ordering, location));
+      m_insert_point.insert(insn);
+      return insn;
+    }
+    
+    /**
+     * \brief Create an atomic compare and exchange instruction.
+     * 
+     * \param ptr Pointer to value being modified.
+     * 
+     * \param expected Value \c ptr must point to for the exchange to happen.
+     * 
+     * \param value Value to store.
+     * 
+     * \param success_ordering Memory ordering if the exchange happens.
+     * 
+     * \param failure_ordering Memory ordering if it does not.
+     */
+    ValuePtr<Instruction> InstructionBuilder::cmpxchg(const ValuePtr<>& ptr, const ValuePtr<>& expected, const ValuePtr<>& value,
+                                                      AtomicOrdering success_ordering, AtomicOrdering failure_ordering, const SourceLocation& location) {
+      ValuePtr<Instruction> insn(::new CmpXchg(ptr, expected, value, success_ordering, failure_ordering, location));
+      m_insert_point.insert(insn);
+      return insn;
+    }
+    
+    /**
+     * \brief Create a memory fence.
+     */
+    ValuePtr<Instruction> InstructionBuilder::fence(AtomicOrdering ordering, const SourceLocation& location) {
+      ValuePtr<Instruction> insn(::new Fence(m_insert_point.block()->context(), ordering, location));
       m_insert_point.insert(insn);
       return insn;
     }
@@ -2,6 +2,7 @@
 #define HPP_PSI_TVM_INSTRUCTIONBUILDER
 
 #include "Function.hpp"
+#include "Instructions.hpp"
 
 namespace Psi {
   namespace Tvm {
@@ -43,7 +44,10 @@ namespace Psi {
       ValuePtr<Instruction> return_void(const SourceLocation& location);
       ValuePtr<Instruction> br(const ValuePtr<Block>& target, const SourceLocation& location);
       ValuePtr<Instruction> cond_br(const ValuePtr<>& condition, const ValuePtr<Block>& true_target, const ValuePtr<Block>& false_target, const SourceLocation& location);
+      ValuePtr<Instruction> cond_br(const ValuePtr<>& condition, const ValuePtr<Block>& true_target, const ValuePtr<Block>& false_target,
+                                    unsigned true_weight, unsigned false_weight, const SourceLocation& location);
       ValuePtr<Instruction> call(const ValuePtr<>& target, const std::vector<ValuePtr<> >& parameters, const SourceLocation& location);
+      ValuePtr<Instruction> call(const ValuePtr<>& target, const std::vector<ValuePtr<> >& parameters, TailCallMode tail, const SourceLocation& location);
 
       ValuePtr<Instruction> call0(const ValuePtr<>& target, const SourceLocation& location);
       ValuePtr<Instruction> call1(const ValuePtr<>& target, const ValuePtr<>& p1, const SourceLocation& location);
@@ -69,6 +73,16 @@ namespace Psi {
       ValuePtr<Instruction> memzero(const ValuePtr<>& dest, const ValuePtr<>& count, const SourceLocation& location);
       ///@}
       
+      /// \name Atomic operations
+      ///@{
+      ValuePtr<Instruction> load(const ValuePtr<>& src, AtomicOrdering ordering, const SourceLocation& location);
+      ValuePtr<Instruction> store(const ValuePtr<>& value, const ValuePtr<>& dest, AtomicOrdering ordering, const SourceLocation& location);
+      ValuePtr<Instruction> atomic_rmw(AtomicRMWOperation op, const ValuePtr<>& dest, const ValuePtr<>& value, AtomicOrdering ordering, const SourceLocation& location);
+      ValuePtr<Instruction> cmpxchg(const ValuePtr<>& dest, const ValuePtr<>& expected, const ValuePtr<>& value,
+                                    AtomicOrdering success_ordering, AtomicOrdering failure_ordering, const SourceLocation& location);
+      ValuePtr<Instruction> fence(AtomicOrdering ordering, const SourceLocation& location);
+      ///@}
+      
       ValuePtr<Instruction> eval(const ValuePtr<>& value, const SourceLocation& location);
       ValuePtr<Instruction> unreachable(const SourceLocation& location);
       ValuePtr<Instruction> solidify(const ValuePtr<>& value, const SourceLocation& location);
@@ -1,7 +1,10 @@
 #include "Test.hpp"
 
+#include "AggregateLowering.hpp"
+#include "Assembler.hpp"
 #include "Instructions.hpp"
 #include "Jit.hpp"
+#include "Number.hpp"
 
 #if PSI_HAVE_UCONTEXT
 #include <signal.h>
@@ -66,6 +69,34 @@ namespace Psi {
       PSI_TEST_CHECK_EQUAL(f(false), -102);
     }
 
+    /*
+     * Branch hints must not change behaviour, however blocks end up being laid out.
+     */
+    PSI_TEST_CASE(BranchHintTest) {
+      const char *src =
+        "%f = export function (%a:bool, %b:bool) > i32 {\n"
+        "  cond_br %a %cold %hot unlikely;\n"
+        "block %cold:\n"
+        "  return #i7;\n"
+        "block %hot:\n"
+        "  cond_br %b %left %right #up3 #up1000;\n"
+        "block %left:\n"
+        "  br %merge;\n"
+        "block %right:\n"
+        "  br %merge;\n"
+        "block %merge:\n"
+        "  %x = phi i32: %left > #i11, %right > #i13;\n"
+        "  return %x;\n"
+        "};\n";
+
+      typedef Jit::Int32 (*CallbackType) (Jit::Boolean, Jit::Boolean);
+      CallbackType f = reinterpret_cast<CallbackType>(jit_single("f", src));
+
+      PSI_TEST_CHECK_EQUAL(f(true, false), 7);
+      PSI_TEST_CHECK_EQUAL(f(false, true), 11);
+      PSI_TEST_CHECK_EQUAL(f(false, false), 13);
+    }
+
     PSI_TEST_CASE(RecursiveCall) {
       const char *src =
         "%inner = function () > i32 {\n"
@@ -404,6 +435,171 @@ namespace Psi {
     }
 #endif
 
+    PSI_TEST_CASE(CompareTest) {
+      const char *src =
+        "%f = export function(%a : i32, %b : i32) > (struct bool bool bool bool) {\n"
+        "  return (struct_v (cmp_lt %a %b) (cmp_le %a %b) (cmp_gt %a %b) (cmp_ge %a %b));\n"
+        "};\n";
+
+      struct ResultType {Jit::Boolean lt, le, gt, ge;};
+      typedef ResultType (*func_type) (Jit::Int32, Jit::Int32);
+      func_type f = reinterpret_cast<func_type>(jit_single("f", src));
+
+      ResultType r1 = f(1, 2), r2 = f(2, 2), r3 = f(3, 2);
+      PSI_TEST_CHECK(r1.lt && r1.le && !r1.gt && !r1.ge);
+      PSI_TEST_CHECK(!r2.lt && r2.le && !r2.gt && r2.ge);
+      PSI_TEST_CHECK(!r3.lt && !r3.le && r3.gt && r3.ge);
+    }
+
+    PSI_TEST_CASE(MemCpyTest) {
+      const char *src =
+        "%s = define struct i32 i64 i16;\n"
+        "%f = export function(%dest : pointer %s, %src : pointer %s, %n : uiptr) > empty {\n"
+        "  memcpy %dest %src %n;\n"
+        "  return empty_v;\n"
+        "};\n";
+
+      struct TestStruct {Jit::Int32 a; Jit::Int64 b; Jit::Int16 c;};
+      typedef void (*func_type) (TestStruct*, const TestStruct*, Jit::UIntPtr);
+      func_type f = reinterpret_cast<func_type>(jit_single("f", src));
+
+      TestStruct from[2] = {{1, -2, 3}, {-4, 5, -6}}, to[2] = {{0, 0, 0}, {0, 0, 0}};
+      f(to, from, 2);
+      PSI_TEST_CHECK_EQUAL(to[0].a, 1);
+      PSI_TEST_CHECK_EQUAL(to[0].b, -2);
+      PSI_TEST_CHECK_EQUAL(to[1].b, 5);
+      PSI_TEST_CHECK_EQUAL(to[1].c, -6);
+    }
+
+    PSI_TEST_CASE(MemZeroTest) {
+      const char *src =
+        "%f = export function(%dest : pointer byte, %n : uiptr) > empty {\n"
+        "  memzero %dest %n;\n"
+        "  return empty_v;\n"
+        "};\n";
+
+      typedef void (*func_type) (void*, Jit::UIntPtr);
+      func_type f = reinterpret_cast<func_type>(jit_single("f", src));
+
+      Jit::Int32 values[3] = {7, 8, 9};
+      f(values, 2 * sizeof(Jit::Int32));
+      PSI_TEST_CHECK_EQUAL(values[0], 0);
+      PSI_TEST_CHECK_EQUAL(values[1], 0);
+      PSI_TEST_CHECK_EQUAL(values[2], 9);
+    }
+
+    namespace {
+      /// Sizes of the primitive types used by the memory operation tests, as on a 64-bit target
+      class MemoryTargetCallback : public AggregateLoweringPass::TargetCallback {
+      public:
+        virtual TypeSizeAlignment type_size_alignment(const ValuePtr<>& type, const SourceLocation&) {
+          if (ValuePtr<IntegerType> int_type = dyn_cast<IntegerType>(type)) {
+            switch (int_type->width()) {
+            case IntegerType::i8: return TypeSizeAlignment(1, 1);
+            case IntegerType::i16: return TypeSizeAlignment(2, 2);
+            case IntegerType::i32: return TypeSizeAlignment(4, 4);
+            default: return TypeSizeAlignment(8, 8);
+            }
+          } else if (isa<ByteType>(type) || isa<BooleanType>(type)) {
+            return TypeSizeAlignment(1, 1);
+          }
+          return TypeSizeAlignment(8, 8);
+        }
+      };
+
+      /**
+       * Lower a module with the given inline limits and count the MemCpy
+       * and MemZero instructions left in one of its functions.
+       */
+      std::size_t count_lowered_memory_operations(Test::ContextFixture& fixture, const char *src, const char *name,
+                                                  std::size_t memcpy_limit, std::size_t memzero_limit) {
+        Module module(&fixture.context, "lowering_module", fixture.location);
+        AssemblerResult r = parse_and_build(module, fixture.location.physical, src);
+        MemoryTargetCallback callback;
+        AggregateLoweringPass pass(&module, &callback);
+        pass.memcpy_to_bytes = true;
+        pass.inline_memcpy_limit = memcpy_limit;
+        pass.inline_memzero_limit = memzero_limit;
+        pass.update();
+
+        std::size_t n = 0;
+        ValuePtr<Function> function = value_cast<Function>(pass.target_symbol(value_cast<Global>(r[name])));
+        for (Function::BlockList::const_iterator ii = function->blocks().begin(), ie = function->blocks().end(); ii != ie; ++ii) {
+          for (Block::InstructionList::const_iterator ji = (*ii)->instructions().begin(), je = (*ii)->instructions().end(); ji != je; ++ji) {
+            if (isa<MemCpy>(*ji) || isa<MemZero>(*ji))
+              ++n;
+          }
+        }
+        return n;
+      }
+    }
+
+    /*
+     * A memcpy with constant size, which back-ends may replace with
+     * loads and stores.
+     */
+    PSI_TEST_CASE(MemCpyConstantTest) {
+      const char *src =
+        "%s = define struct i32 i16 i64;\n"
+        "%f = export function(%dest : pointer %s, %src : pointer %s) > empty {\n"
+        "  memcpy %dest %src #up1;\n"
+        "  return empty_v;\n"
+        "};\n";
+
+      struct TestStruct {Jit::Int32 a; Jit::Int16 b; Jit::Int64 c;};
+      typedef void (*func_type) (TestStruct*, const TestStruct*);
+      func_type f = reinterpret_cast<func_type>(jit_single("f", src));
+
+      TestStruct from[2] = {{1, -2, 3}, {-4, 5, -6}}, to[2] = {{0, 0, 0}, {0, 0, 0}};
+      f(to, from);
+      PSI_TEST_CHECK_EQUAL(to[0].a, 1);
+      PSI_TEST_CHECK_EQUAL(to[0].b, -2);
+      PSI_TEST_CHECK_EQUAL(to[0].c, 3);
+      PSI_TEST_CHECK_EQUAL(to[1].a, 0);
+
+      // 16 bytes at 8 byte alignment is two accesses, so only the limit decides
+      PSI_TEST_CHECK_EQUAL(count_lowered_memory_operations(*this, src, "f", 16, 0), 0u);
+      PSI_TEST_CHECK_EQUAL(count_lowered_memory_operations(*this, src, "f", 15, 0), 1u);
+    }
+
+    /*
+     * A constant size memzero whose size is not a multiple of its
+     * alignment.
+     */
+    PSI_TEST_CASE(MemZeroConstantTest) {
+      const char *src =
+        "%f = export function(%dest : pointer byte) > empty {\n"
+        "  memzero %dest #up7 #up4;\n"
+        "  return empty_v;\n"
+        "};\n";
+
+      typedef void (*func_type) (void*);
+      func_type f = reinterpret_cast<func_type>(jit_single("f", src));
+
+      Jit::Int32 values[3] = {-1, -1, -1};
+      f(values);
+      PSI_TEST_CHECK_EQUAL(values[0], 0);
+      PSI_TEST_CHECK_EQUAL(reinterpret_cast<unsigned char*>(values)[6], 0);
+      PSI_TEST_CHECK_EQUAL(reinterpret_cast<unsigned char*>(values)[7], 0xFF);
+      PSI_TEST_CHECK_EQUAL(values[2], -1);
+
+      PSI_TEST_CHECK_EQUAL(count_lowered_memory_operations(*this, src, "f", 0, 7), 0u);
+      PSI_TEST_CHECK_EQUAL(count_lowered_memory_operations(*this, src, "f", 0, 6), 1u);
+
+      // Byte aligned blocks within the limit are only expanded up to eight accesses
+      const char *src_bytes =
+        "%eight = export function(%dest : pointer byte) > empty {\n"
+        "  memzero %dest #up8 #up1;\n"
+        "  return empty_v;\n"
+        "};\n"
+        "%nine = export function(%dest : pointer byte) > empty {\n"
+        "  memzero %dest #up9 #up1;\n"
+        "  return empty_v;\n"
+        "};\n";
+      PSI_TEST_CHECK_EQUAL(count_lowered_memory_operations(*this, src_bytes, "eight", 0, 32), 0u);
+      PSI_TEST_CHECK_EQUAL(count_lowered_memory_operations(*this, src_bytes, "nine", 0, 32), 1u);
+    }
+
     PSI_TEST_SUITE_END()    
   }
 }
@@ -1,8 +1,10 @@
 #include "Aggregate.hpp"
 #include "Instructions.hpp"
 #include "FunctionalBuilder.hpp"
+#include "Number.hpp"
 
 #include <boost/assign/list_of.hpp>
+#include <boost/format.hpp>
 
 namespace Psi {
   namespace Tvm {
@@ -22,6 +24,28 @@ namespace Psi {
       return std::vector<ValuePtr<Block> >();
     }
     
+    /**
+     * \brief Check whether this instruction returns the result of \c insn.
+     * 
+     * Empty values are all equivalent, so a function returning an empty value
+     * returns the result of any instruction of empty type.
+     */
+    bool Return::returns_result_of(const ValuePtr<Instruction>& insn) {
+      return (value == insn) || (isa<EmptyType>(insn->type()) && isa<EmptyType>(value->type()));
+    }
+    
+    /**
+     * \brief Get the call immediately before this instruction, if it
+     * exists and this instruction returns its result.
+     */
+    ValuePtr<Call> Return::preceding_call() {
+      Block::InstructionList::const_iterator it = block()->instructions().iterator_to(ValuePtr<Instruction>(this));
+      if (it == block()->instructions().begin())
+        return ValuePtr<Call>();
+      ValuePtr<Call> call = dyn_cast<Call>(*--it);
+      return (call && returns_result_of(call)) ? call : ValuePtr<Call>();
+    }
+
     template<typename V>
     void Return::visit(V& v) {
       visit_base<TerminatorInstruction>(v);
@@ -34,11 +58,14 @@ namespace Psi {
 
     PSI_TVM_INSTRUCTION_IMPL(Return, TerminatorInstruction, return);
 
-    ConditionalBranch::ConditionalBranch(const ValuePtr<>& condition_, const ValuePtr<Block>& true_target_, const ValuePtr<Block>& false_target_, const SourceLocation& location)
+    ConditionalBranch::ConditionalBranch(const ValuePtr<>& condition_, const ValuePtr<Block>& true_target_, const ValuePtr<Block>& false_target_,
+                                         unsigned true_weight_, unsigned false_weight_, const SourceLocation& location)
     : TerminatorInstruction(condition_->context(), operation, location),
     condition(condition_),
     true_target(true_target_),
-    false_target(false_target_) {
+    false_target(false_target_),
+    true_weight(true_weight_),
+    false_weight(false_weight_) {
     }
     
     /**
@@ -65,13 +92,41 @@ namespace Psi {
       r.push_back(false_target);
       return r;
     }
+    
+    /**
+     * \brief Whether \c target is rarely reached through this branch.
+     * 
+     * This is true when the weight of the edge to \c target is less than a
+     * fifth of the weight of the other edge, which is strong enough bias for
+     * backends to move \c target out of line.
+     */
+    bool ConditionalBranch::is_unlikely(const ValuePtr<Block>& target) const {
+      if (true_target == false_target)
+        return false;
+      
+      // Widen so that large profile counts do not overflow
+      boost::uint64_t weight, other_weight;
+      if (target == true_target) {
+        weight = true_weight;
+        other_weight = false_weight;
+      } else if (target == false_target) {
+        weight = false_weight;
+        other_weight = true_weight;
+      } else {
+        return false;
+      }
+      
+      return weight * 5 < other_weight;
+    }
 
     template<typename V>
     void ConditionalBranch::visit(V& v) {
       visit_base<TerminatorInstruction>(v);
       v("condition", &ConditionalBranch::condition)
       ("true_target", &ConditionalBranch::true_target)
-      ("false_target", &ConditionalBranch::false_target);
+      ("false_target", &ConditionalBranch::false_target)
+      ("true_weight", &ConditionalBranch::true_weight)
+      ("false_weight", &ConditionalBranch::false_weight);
     }
 
     void ConditionalBranch::check_source_hook(CheckSourceParameter&) {
@@ -173,10 +228,11 @@ namespace Psi {
       }
     }
     
-    Call::Call(const ValuePtr<>& target_, const std::vector<ValuePtr<> >& parameters_, const SourceLocation& location)
+    Call::Call(const ValuePtr<>& target_, const std::vector<ValuePtr<> >& parameters_, TailCallMode tail_, const SourceLocation& location)
     : Instruction(call_type(target_, parameters_, location), operation, location),
     target(target_),
-    parameters(parameters_) {
+    parameters(parameters_),
+    tail(tail_) {
     }
 
     void Call::type_check() {
@@ -187,17 +243,74 @@ namespace Psi {
 
       for (std::size_t ii = target_function_type()->n_phantom(), ie = parameters.size(); ii < ie; ++ii)
         require_available(parameters[ii]);
+      
+      if (tail != tail_call_none) {
+        Block::InstructionList::const_iterator next = block()->instructions().iterator_to(ValuePtr<Instruction>(this));
+        if (++next != block()->instructions().end())
+          error_context().error_throw(location(), "tail call must be immediately followed by a return of its result");
+        
+        ValuePtr<FunctionType> caller_type = function()->function_type(), callee_type = target_function_type();
+        if (callee_type->calling_convention() != caller_type->calling_convention())
+          error_context().error_throw(location(), "tail call target must use the same calling convention as the caller");
+        if (!function()->result_type()->match(type()))
+          error_context().error_throw(location(), "tail call result type differs from the caller's result type");
+        
+        if (tail == tail_call_required) {
+          if ((callee_type->parameter_types().size() - callee_type->n_phantom() != caller_type->parameter_types().size() - caller_type->n_phantom())
+            || (callee_type->sret() != caller_type->sret()))
+            error_context().error_throw(location(), "musttail call target must have the same number of parameters as the caller");
+        }
+      }
     }
 
     template<typename V>
     void Call::visit(V& v) {
       visit_base<Instruction>(v);
       v("target", &Call::target)
-      ("parameters", &Call::parameters);
+      ("parameters", &Call::parameters)
+      ("tail", &Call::tail);
     }
     
     PSI_TVM_INSTRUCTION_IMPL(Call, Instruction, call);
 
+    const char* atomic_ordering_name(AtomicOrdering ordering) {
+      switch (ordering) {
+      case atomic_none: return "none";
+      case atomic_relaxed: return "relaxed";
+      case atomic_acquire: return "acquire";
+      case atomic_release: return "release";
+      case atomic_acq_rel: return "acq_rel";
+      case atomic_seq_cst: return "seq_cst";
+      default: PSI_FAIL("unknown atomic ordering");
+      }
+    }
+    
+    /**
+     * \brief Get the keyword used for a tail call mode in TVM assembler.
+     */
+    const char* tail_call_name(TailCallMode mode) {
+      switch (mode) {
+      case tail_call_none: return "none";
+      case tail_call_allowed: return "tail";
+      case tail_call_required: return "musttail";
+      default: PSI_FAIL("unknown tail call mode");
+      }
+    }
+    
+    const char* atomic_rmw_name(AtomicRMWOperation op) {
+      switch (op) {
+      case atomic_rmw_add: return "add";
+      case atomic_rmw_sub: return "sub";
+      case atomic_rmw_and: return "and";
+      case atomic_rmw_or: return "or";
+      case atomic_rmw_xor: return "xor";
+      case atomic_rmw_xchg: return "xchg";
+      case atomic_rmw_min: return "min";
+      case atomic_rmw_max: return "max";
+      default: PSI_FAIL("unknown atomic operation");
+      }
+    }
+
     namespace {
       /**
        * Get the pointed-to type from a pointer.
@@ -208,12 +321,25 @@ namespace Psi {
           ptr->error_context().error_throw(location, "memory operation target is not a pointer type");
         return target_ptr_type->target_type();
       }
+      
+      /**
+       * Check that atomic operations are supported on a type.
+       */
+      void check_atomic_type(const Instruction& insn, const ValuePtr<>& type, bool allow_pointer) {
+        if (isa<IntegerType>(type))
+          return;
+        if (allow_pointer && isa<PointerType>(type))
+          return;
+        insn.error_context().error_throw(insn.location(), boost::format("%s operand must have %s type")
+                                         % insn.operation_name() % (allow_pointer ? "integer or pointer" : "integer"));
+      }
     }
 
-    Store::Store(const ValuePtr<>& value_, const ValuePtr<>& target_, const SourceLocation& location)
+    Store::Store(const ValuePtr<>& value_, const ValuePtr<>& target_, AtomicOrdering ordering_, const SourceLocation& location)
     : Instruction(FunctionalBuilder::empty_type(value_->context(), location), operation, location),
     value(value_),
-    target(target_) {
+    target(target_),
+    ordering(ordering_) {
     }
     
     void Store::type_check() {
@@ -222,13 +348,20 @@ namespace Psi {
       
       if (!pointer_target_type(target, location())->match(value->type()))
         error_context().error_throw(location(), "store target type is not a pointer to the type of value");
+      
+      if (ordering != atomic_none) {
+        if ((ordering == atomic_acquire) || (ordering == atomic_acq_rel))
+          error_context().error_throw(location(), boost::format("%s ordering is not valid for store") % atomic_ordering_name(ordering));
+        check_atomic_type(*this, value->type(), true);
+      }
     }
 
     template<typename V>
     void Store::visit(V& v) {
       visit_base<Instruction>(v);
       v("value", &Store::value)
-      ("target", &Store::target);
+      ("target", &Store::target)
+      ("ordering", &Store::ordering);
     }
 
     void Store::check_source_hook(CheckSourceParameter&) {
@@ -237,9 +370,10 @@ namespace Psi {
 
     PSI_TVM_INSTRUCTION_IMPL(Store, Instruction, store);
 
-    Load::Load(const ValuePtr<>& target_, const SourceLocation& location)
+    Load::Load(const ValuePtr<>& target_, AtomicOrdering ordering_, const SourceLocation& location)
     : Instruction(pointer_target_type(target_, location), operation, location),
-    target(target_) {
+    target(target_),
+    ordering(ordering_) {
     }
 
     void Load::type_check() {
@@ -247,15 +381,122 @@ namespace Psi {
       
       if (!type()->match(pointer_target_type(target, location())))
         error_context().error_throw(location(), "load target type has changed since instruction creation");
+      
+      if (ordering != atomic_none) {
+        if ((ordering == atomic_release) || (ordering == atomic_acq_rel))
+          error_context().error_throw(location(), boost::format("%s ordering is not valid for load") % atomic_ordering_name(ordering));
+        check_atomic_type(*this, type(), true);
+      }
     }
 
     template<typename V>
     void Load::visit(V& v) {
       visit_base<Instruction>(v);
-      v("target", &Load::target);
+      v("target", &Load::target)
+      ("ordering", &Load::ordering);
     }
 
     PSI_TVM_INSTRUCTION_IMPL(Load, Instruction, load);
+    
+    AtomicRMW::AtomicRMW(AtomicRMWOperation op_, const ValuePtr<>& target_, const ValuePtr<>& value_, AtomicOrdering ordering_, const SourceLocation& location)
+    : Instruction(value_->type(), operation, location),
+    op(op_),
+    target(target_),
+    value(value_),
+    ordering(ordering_) {
+    }
+    
+    void AtomicRMW::type_check() {
+      require_available(target);
+      require_available(value);
+      
+      if (!pointer_target_type(target, location())->match(value->type()))
+        error_context().error_throw(location(), "atomic_rmw target type is not a pointer to the type of value");
+      check_atomic_type(*this, value->type(), op == atomic_rmw_xchg);
+      if (ordering == atomic_none)
+        error_context().error_throw(location(), "atomic_rmw requires a memory ordering");
+    }
+    
+    template<typename V>
+    void AtomicRMW::visit(V& v) {
+      visit_base<Instruction>(v);
+      v("op", &AtomicRMW::op)
+      ("target", &AtomicRMW::target)
+      ("value", &AtomicRMW::value)
+      ("ordering", &AtomicRMW::ordering);
+    }
+    
+    PSI_TVM_INSTRUCTION_IMPL(AtomicRMW, Instruction, atomic_rmw);
+    
+    CmpXchg::CmpXchg(const ValuePtr<>& target_, const ValuePtr<>& expected_, const ValuePtr<>& value_,
+                     AtomicOrdering success_ordering_, AtomicOrdering failure_ordering_, const SourceLocation& location)
+    : Instruction(value_->type(), operation, location),
+    target(target_),
+    expected(expected_),
+    value(value_),
+    success_ordering(success_ordering_),
+    failure_ordering(failure_ordering_) {
+    }
+    
+    void CmpXchg::type_check() {
+      require_available(target);
+      require_available(expected);
+      require_available(value);
+      
+      if (!pointer_target_type(target, location())->match(value->type()))
+        error_context().error_throw(location(), "cmpxchg target type is not a pointer to the type of value");
+      if (expected->type() != value->type())
+        error_context().error_throw(location(), "cmpxchg expected and new values have different types");
+      check_atomic_type(*this, value->type(), true);
+      
+      if (success_ordering == atomic_none)
+        error_context().error_throw(location(), "cmpxchg requires a memory ordering");
+      
+      bool failure_ok;
+      switch (failure_ordering) {
+      case atomic_relaxed: failure_ok = true; break;
+      case atomic_acquire: failure_ok = (success_ordering == atomic_acquire) || (success_ordering == atomic_acq_rel) || (success_ordering == atomic_seq_cst); break;
+      case atomic_seq_cst: failure_ok = (success_ordering == atomic_seq_cst); break;
+      default: failure_ok = false; break;
+      }
+      if (!failure_ok)
+        error_context().error_throw(location(), boost::format("cmpxchg failure ordering %s is not valid with success ordering %s")
+                                    % atomic_ordering_name(failure_ordering) % atomic_ordering_name(success_ordering));
+    }
+    
+    template<typename V>
+    void CmpXchg::visit(V& v) {
+      visit_base<Instruction>(v);
+      v("target", &CmpXchg::target)
+      ("expected", &CmpXchg::expected)
+      ("value", &CmpXchg::value)
+      ("success_ordering", &CmpXchg::success_ordering)
+      ("failure_ordering", &CmpXchg::failure_ordering);
+    }
+    
+    PSI_TVM_INSTRUCTION_IMPL(CmpXchg, Instruction, cmpxchg);
+    
+    Fence::Fence(Context& context, AtomicOrdering ordering_, const SourceLocation& location)
+    : Instruction(FunctionalBuilder::empty_type(context, location), operation, location),
+    ordering(ordering_) {
+    }
+    
+    void Fence::type_check() {
+      if ((ordering == atomic_none) || (ordering == atomic_relaxed))
+        error_context().error_throw(location(), boost::format("%s ordering is not valid for fence") % atomic_ordering_name(ordering));
+    }
+    
+    template<typename V>
+    void Fence::visit(V& v) {
+      visit_base<Instruction>(v);
+      v("ordering", &Fence::ordering);
+    }
+    
+    void Fence::check_source_hook(CheckSourceParameter&) {
+      error_context().error_throw(location(), "Result of fence instruction should not be used");
+    }
+    
+    PSI_TVM_INSTRUCTION_IMPL(Fence, Instruction, fence);
 
     Alloca::Alloca(const ValuePtr<>& element_type_, const ValuePtr<>& count_, const ValuePtr<>& alignment_, const SourceLocation& location)
     : Instruction(FunctionalBuilder::pointer_type(element_type_, location), operation, location),
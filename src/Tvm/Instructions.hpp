@@ -6,6 +6,69 @@
 
 namespace Psi {
   namespace Tvm {
+    /**
+     * \brief Memory ordering constraints on atomic operations.
+     * 
+     * These follow the C11 memory model.
+     */
+    enum AtomicOrdering {
+      /// \brief Not an atomic operation
+      atomic_none,
+      /// \brief Atomic, but imposes no ordering on other memory operations
+      atomic_relaxed,
+      /// \brief Later memory operations may not be moved before this one
+      atomic_acquire,
+      /// \brief Earlier memory operations may not be moved after this one
+      atomic_release,
+      /// \brief Both \c atomic_acquire and \c atomic_release
+      atomic_acq_rel,
+      /// \brief As \c atomic_acq_rel, and all such operations have a single total order
+      atomic_seq_cst
+    };
+    
+    PSI_VISIT_SIMPLE(AtomicOrdering);
+    
+    PSI_TVM_EXPORT const char* atomic_ordering_name(AtomicOrdering ordering);
+    
+    /**
+     * \brief Operations performed by AtomicRMW.
+     */
+    enum AtomicRMWOperation {
+      atomic_rmw_add,
+      atomic_rmw_sub,
+      atomic_rmw_and,
+      atomic_rmw_or,
+      atomic_rmw_xor,
+      /// \brief Replace the stored value
+      atomic_rmw_xchg,
+      /// \brief Signed or unsigned minimum, according to the type of the value
+      atomic_rmw_min,
+      /// \brief Signed or unsigned maximum, according to the type of the value
+      atomic_rmw_max
+    };
+    
+    PSI_VISIT_SIMPLE(AtomicRMWOperation);
+    
+    PSI_TVM_EXPORT const char* atomic_rmw_name(AtomicRMWOperation op);
+    
+    /**
+     * \brief Whether a function call reuses the caller's stack frame.
+     */
+    enum TailCallMode {
+      /// \brief An ordinary call
+      tail_call_none,
+      /// \brief The call may reuse the caller's stack frame if the backend is able to
+      tail_call_allowed,
+      /// \brief The call must reuse the caller's stack frame, so that unbounded recursion cannot overflow the stack
+      tail_call_required
+    };
+    
+    PSI_VISIT_SIMPLE(TailCallMode);
+    
+    PSI_TVM_EXPORT const char* tail_call_name(TailCallMode mode);
+
+    class Call;
+    
     class PSI_TVM_EXPORT_DEBUG Return : public TerminatorInstruction {
       PSI_TVM_INSTRUCTION_DECL(Return)
     private:
@@ -14,6 +77,9 @@ namespace Psi {
       Return(const ValuePtr<>& value, const SourceLocation& location);
       virtual std::vector<ValuePtr<Block> > successors();
       
+      PSI_TVM_EXPORT bool returns_result_of(const ValuePtr<Instruction>& insn);
+      PSI_TVM_EXPORT ValuePtr<Call> preceding_call();
+      
       /// \brief The value returned to the caller.
       ValuePtr<> value;
     };
@@ -23,15 +89,34 @@ namespace Psi {
     private:
       virtual void check_source_hook(CheckSourceParameter& parameter);
     public:
-      ConditionalBranch(const ValuePtr<>& condition, const ValuePtr<Block>& true_target, const ValuePtr<Block>& false_target, const SourceLocation& location);
+      ConditionalBranch(const ValuePtr<>& condition, const ValuePtr<Block>& true_target, const ValuePtr<Block>& false_target,
+                        unsigned true_weight, unsigned false_weight, const SourceLocation& location);
       virtual std::vector<ValuePtr<Block> > successors();
       
+      /// \brief Weight given to the more probable target by a \c likely or \c unlikely hint.
+      static const unsigned likely_weight = 2000;
+      /// \brief Weight given to the less probable target by a \c likely or \c unlikely hint.
+      static const unsigned unlikely_weight = 1;
+      
+      /// \brief Whether anything is known about the probability of each branch.
+      bool has_weights() const {return true_weight || false_weight;}
+      PSI_TVM_EXPORT bool is_unlikely(const ValuePtr<Block>& target) const;
+      
       /// \brief The value used to choose the branch taken.
       ValuePtr<> condition;
       /// \brief The block jumped to if \c condition is true.
       ValuePtr<Block> true_target;
       /// \brief The block jumped to if \c condition is false.
       ValuePtr<Block> false_target;
+      /**
+       * \brief Relative probability of jumping to \c true_target.
+       * 
+       * If both this and \c false_weight are zero, nothing is known
+       * about which branch is likely to be taken.
+       */
+      unsigned true_weight;
+      /// \brief Relative probability of jumping to \c false_target.
+      unsigned false_weight;
     };
     
     class PSI_TVM_EXPORT_DEBUG UnconditionalBranch : public TerminatorInstruction {
@@ -89,12 +174,22 @@ namespace Psi {
       PSI_TVM_INSTRUCTION_DECL(Call)
       
     public:
-      Call(const ValuePtr<>& target, const std::vector<ValuePtr<> >& parameters, const SourceLocation& location);
+      Call(const ValuePtr<>& target, const std::vector<ValuePtr<> >& parameters, TailCallMode tail, const SourceLocation& location);
       
       /// \brief The function being called.
       ValuePtr<> target;
       /// \brief Parameters applied to the target function.
       std::vector<ValuePtr<> > parameters;
+      /**
+       * \brief Whether this is a tail call.
+       * 
+       * A tail call must be immediately followed by a Return of its result,
+       * the target must use the same calling convention as the caller, and the
+       * target must not access memory allocated by Alloca in the caller.
+       * If this is \c tail_call_required, the target must also take the same
+       * number of parameters as the caller.
+       */
+      TailCallMode tail;
       
       /// \brief Get the function type of the function being called.
       ValuePtr<FunctionType> target_function_type() const {return value_cast<FunctionType>(value_cast<PointerType>(target->type())->target_type());}
@@ -105,22 +200,103 @@ namespace Psi {
     private:
       virtual void check_source_hook(CheckSourceParameter& parameter);
     public:
-      Store(const ValuePtr<>& value, const ValuePtr<>& target, const SourceLocation& location);
+      Store(const ValuePtr<>& value, const ValuePtr<>& target, AtomicOrdering ordering, const SourceLocation& location);
       
       /// \brief The value to be stored
       ValuePtr<> value;
       /// \brief The memory address which is to be written to
       ValuePtr<> target;
+      /**
+       * \brief Ordering of this store if it is atomic.
+       * 
+       * May be \c atomic_none, \c atomic_relaxed, \c atomic_release or \c atomic_seq_cst.
+       */
+      AtomicOrdering ordering;
     };
     
     class PSI_TVM_EXPORT_DEBUG Load : public Instruction {
       PSI_TVM_INSTRUCTION_DECL(Load)
       
     public:
-      Load(const ValuePtr<>& target, const SourceLocation& location);
+      Load(const ValuePtr<>& target, AtomicOrdering ordering, const SourceLocation& location);
       
       /// \brief The pointer being read from
       ValuePtr<> target;
+      /**
+       * \brief Ordering of this load if it is atomic.
+       * 
+       * May be \c atomic_none, \c atomic_relaxed, \c atomic_acquire or \c atomic_seq_cst.
+       */
+      AtomicOrdering ordering;
+    };
+    
+    /**
+     * \brief Atomic read-modify-write instruction.
+     * 
+     * Atomically combines \c value with the integer stored at \c target
+     * and returns the value previously stored there. \c atomic_rmw_xchg
+     * also accepts pointers.
+     */
+    class PSI_TVM_EXPORT_DEBUG AtomicRMW : public Instruction {
+      PSI_TVM_INSTRUCTION_DECL(AtomicRMW)
+      
+    public:
+      AtomicRMW(AtomicRMWOperation op, const ValuePtr<>& target, const ValuePtr<>& value, AtomicOrdering ordering, const SourceLocation& location);
+      
+      /// \brief Operation to perform
+      AtomicRMWOperation op;
+      /// \brief The memory address being modified
+      ValuePtr<> target;
+      /// \brief Second operand of \c op
+      ValuePtr<> value;
+      /// \brief Memory ordering; may not be \c atomic_none
+      AtomicOrdering ordering;
+    };
+    
+    /**
+     * \brief Atomic compare and exchange instruction.
+     * 
+     * If the value at \c target is equal to \c expected, \c value is
+     * written to it. In either case the value previously at \c target is
+     * returned, so the exchange succeeded if and only if the result is
+     * equal to \c expected. Integers and pointers are supported.
+     */
+    class PSI_TVM_EXPORT_DEBUG CmpXchg : public Instruction {
+      PSI_TVM_INSTRUCTION_DECL(CmpXchg)
+      
+    public:
+      CmpXchg(const ValuePtr<>& target, const ValuePtr<>& expected, const ValuePtr<>& value,
+              AtomicOrdering success_ordering, AtomicOrdering failure_ordering, const SourceLocation& location);
+      
+      /// \brief The memory address being modified
+      ValuePtr<> target;
+      /// \brief Value \c target must hold for the exchange to happen
+      ValuePtr<> expected;
+      /// \brief Value to store
+      ValuePtr<> value;
+      /// \brief Memory ordering if the exchange happens
+      AtomicOrdering success_ordering;
+      /**
+       * \brief Memory ordering if the exchange does not happen.
+       * 
+       * This cannot be \c atomic_release or \c atomic_acq_rel, and cannot
+       * be stronger than \c success_ordering.
+       */
+      AtomicOrdering failure_ordering;
+    };
+    
+    /**
+     * \brief Memory fence.
+     */
+    class PSI_TVM_EXPORT_DEBUG Fence : public Instruction {
+      PSI_TVM_INSTRUCTION_DECL(Fence)
+    private:
+      virtual void check_source_hook(CheckSourceParameter& parameter);
+    public:
+      Fence(Context& context, AtomicOrdering ordering, const SourceLocation& location);
+      
+      /// \brief Ordering imposed; must be acquire, release, acq_rel or seq_cst.
+      AtomicOrdering ordering;
     };
 
     /**
@@ -10,6 +10,52 @@ namespace Psi {
     Jit::~Jit() {
     }
     
+    JitPerfMap::JitPerfMap() : m_file(NULL) {
+    }
+    
+    JitPerfMap::~JitPerfMap() {
+      if (m_file)
+        std::fclose(m_file);
+    }
+    
+    /**
+     * \brief Get the process-wide perf map.
+     * 
+     * \param config Configuration of the JIT which wants to write symbols.
+     * 
+     * \return NULL unless \c perf_map is set in \c config.
+     */
+    JitPerfMap* JitPerfMap::get(const PropertyValue& config) {
+      if (!config.path_bool("perf_map"))
+        return NULL;
+      
+      static JitPerfMap instance;
+      return &instance;
+    }
+    
+    /// \brief Record functions which have been loaded.
+    void JitPerfMap::add(const SymbolList& symbols) {
+      write(symbols, "");
+    }
+    
+    /// \brief Mark functions which are about to be unloaded.
+    void JitPerfMap::remove(const SymbolList& symbols) {
+      write(symbols, "[unloaded] ");
+    }
+    
+    void JitPerfMap::write(const SymbolList& symbols, const char *prefix) {
+      if (!m_file) {
+        std::string path = boost::str(boost::format("/tmp/perf-%d.map") % Platform::process_id());
+        m_file = std::fopen(path.c_str(), "w");
+        if (!m_file)
+          return;
+      }
+      
+      for (SymbolList::const_iterator ii = symbols.begin(), ie = symbols.end(); ii != ie; ++ii)
+        std::fprintf(m_file, "%lx %lx %s%s\n", (unsigned long)ii->start, (unsigned long)ii->size, prefix, ii->name.c_str());
+      std::fflush(m_file);
+    }
+    
     JitFactory::JitFactory(const CompileErrorPair& error_handler)
     : m_error_handler(error_handler) {
     }
@@ -4,8 +4,12 @@
 #include "Core.hpp"
 #include "../PropertyValue.hpp"
 
+#include <cstdio>
+#include <vector>
+
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/noncopyable.hpp>
 
 /**
  * \file
@@ -77,6 +81,44 @@ namespace Psi {
       virtual void destroy() = 0;
     };
     
+    /**
+     * \brief Writes symbols of JIT compiled functions to <tt>/tmp/perf-<pid>.map</tt>.
+     * 
+     * perf reads this file to name samples in code it otherwise cannot
+     * attribute. It is enabled by setting \c perf_map to true in the configuration
+     * of a JIT, and all JITs in a process share the same file.
+     * 
+     * perf has no way to remove entries, so when a module is unloaded its
+     * functions are written again with an <tt>[unloaded]</tt> prefix.
+     * 
+     * The LLVM JIT lists every function in the code it emits. The C JIT
+     * can only find functions by symbol name in the compiled library, so
+     * it lists exported functions only; private and local functions have
+     * hidden visibility and samples in them remain unattributed.
+     */
+    class PSI_TVM_EXPORT JitPerfMap : public boost::noncopyable {
+    public:
+      struct Symbol {
+        const void *start;
+        std::size_t size;
+        std::string name;
+      };
+      
+      typedef std::vector<Symbol> SymbolList;
+      
+      static JitPerfMap* get(const PropertyValue& config);
+      
+      void add(const SymbolList& symbols);
+      void remove(const SymbolList& symbols);
+      
+    private:
+      std::FILE *m_file;
+
+      JitPerfMap();
+      ~JitPerfMap();
+      void write(const SymbolList& symbols, const char *prefix);
+    };
+    
     /**
      * \brief Factory object for Jit instances.
      * 
@@ -6,6 +6,8 @@
 
 #include <limits>
 
+#include <boost/format.hpp>
+
 namespace Psi {
   namespace Tvm {
     /**
@@ -43,6 +45,19 @@ namespace Psi {
       return (*val_int == c);
     }
 
+    /**
+     * \brief Get the lane type of a type.
+     * 
+     * For a VectorType this is the vector element type; any other type is
+     * returned unchanged, so that scalar and vector operands can be checked
+     * the same way.
+     */
+    ValuePtr<> lane_type(const ValuePtr<>& type) {
+      if (ValuePtr<VectorType> vec_ty = dyn_cast<VectorType>(type))
+        return vec_ty->element_type();
+      return type;
+    }
+
     BooleanType::BooleanType(Context& context, const SourceLocation& location)
     : Type(context, location) {
     }
@@ -212,7 +227,7 @@ namespace Psi {
     }
     
     ValuePtr<> IntegerUnaryOp::check_type() const {
-      if (!isa<IntegerType>(parameter()->type()))
+      if (!isa<IntegerType>(lane_type(parameter()->type())))
         error_context().error_throw(location(), "Argument to integer unary operation must have integer type");
       return parameter()->type();
     }
@@ -227,7 +242,7 @@ namespace Psi {
     }
     
     ValuePtr<> IntegerBinaryOp::check_type() const {
-      if (!isa<IntegerType>(lhs()->type()))
+      if (!isa<IntegerType>(lane_type(lhs()->type())))
         error_context().error_throw(location(), "Argument to integer binary operation must have integer type");
       if (lhs()->type() != rhs()->type())
         error_context().error_throw(location(), "Both parameters to integer binary operation must have the same type");
@@ -244,11 +259,14 @@ namespace Psi {
     }
     
     ValuePtr<> IntegerCompareOp::check_type() const {
-      if (!isa<IntegerType>(lhs()->type()))
+      if (!isa<IntegerType>(lane_type(lhs()->type())))
         error_context().error_throw(location(), "Argument to integer compare operation must have integer type");
       if (lhs()->type() != rhs()->type())
         error_context().error_throw(location(), "Both parameters to integer compare operation must have the same type");
-      return FunctionalBuilder::bool_type(context(), location());
+      ValuePtr<> bool_ty = FunctionalBuilder::bool_type(context(), location());
+      if (ValuePtr<VectorType> vec_ty = dyn_cast<VectorType>(lhs()->type()))
+        return FunctionalBuilder::vector_type(bool_ty, vec_ty->length(), location());
+      return bool_ty;
     }
     
     template<typename V>
@@ -288,7 +306,7 @@ namespace Psi {
     }
     
     ValuePtr<> IntegerShiftOp::check_type() const {
-      if (!isa<IntegerType>(lhs()->type()))
+      if (!isa<IntegerType>(lane_type(lhs()->type())))
         error_context().error_throw(location(), "bit_shift only works on integer types");
       ValuePtr<IntegerType> shift_type = dyn_cast<IntegerType>(rhs()->type());
       if (!shift_type || shift_type->is_signed() || (shift_type->width() != IntegerType::i32))
@@ -354,13 +372,200 @@ namespace Psi {
     }
     
     ValuePtr<> Select::check_type() const {
-      if (!isa<BooleanType>(m_condition->type()))
-        error_context().error_throw(location(), "Condition parameter to select must be a boolean");
       if (m_true_value->type() != m_false_value->type())
         error_context().error_throw(location(), "Second and third parameters to select must have the same type");
+      if (ValuePtr<VectorType> cond_ty = dyn_cast<VectorType>(m_condition->type())) {
+        // Lane-wise select
+        ValuePtr<VectorType> value_ty = dyn_cast<VectorType>(m_true_value->type());
+        if (!isa<BooleanType>(cond_ty->element_type()) || !value_ty || (value_ty->length() != cond_ty->length()))
+          error_context().error_throw(location(), "Vector condition parameter to select must be a boolean vector with as many lanes as the selected values");
+      } else if (!isa<BooleanType>(m_condition->type())) {
+        error_context().error_throw(location(), "Condition parameter to select must be a boolean");
+      }
       return m_true_value->type();
     }
     
     PSI_TVM_FUNCTIONAL_IMPL(Select, FunctionalValue, select);
+
+    namespace {
+      bool is_power_of_two(unsigned n) {
+        return n && !(n & (n - 1));
+      }
+    }
+    
+    VectorType::VectorType(const ValuePtr<>& element_type, unsigned length, const SourceLocation& location)
+    : Type(element_type->context(), location),
+    m_element_type(element_type),
+    m_length(length) {
+    }
+    
+    template<typename V>
+    void VectorType::visit(V& v) {
+      visit_base<Type>(v);
+      v("element_type", &VectorType::m_element_type)
+      ("length", &VectorType::m_length);
+    }
+    
+    ValuePtr<> VectorType::check_type() const {
+      if (!isa<BooleanType>(m_element_type) && !isa<IntegerType>(m_element_type) && !isa<FloatType>(m_element_type))
+        error_context().error_throw(location(), "Vector element type must be a boolean, integer or floating point type");
+      if (!is_power_of_two(m_length))
+        error_context().error_throw(location(), "Vector length must be a power of two");
+      return FunctionalBuilder::type_type(context(), location());
+    }
+    
+    bool VectorType::match_impl(const FunctionalValue& child, std::vector<ValuePtr<> >& parameters, unsigned depth, UprefMatchMode upref_mode) const {
+      const VectorType& child_vec = checked_cast<const VectorType&>(child);
+      if (length() != child_vec.length())
+        return false;
+      return element_type()->match(child_vec.element_type(), parameters, depth, upref_mode);
+    }
+    
+    PSI_TVM_FUNCTIONAL_IMPL(VectorType, Type, vector)
+    
+    VectorValue::VectorValue(const ValuePtr<>& element_type, const std::vector<ValuePtr<> >& elements, const SourceLocation& location)
+    : Constructor(element_type->context(), location),
+    m_element_type(element_type),
+    m_elements(elements) {
+    }
+    
+    template<typename V>
+    void VectorValue::visit(V& v) {
+      visit_base<Constructor>(v);
+      v("element_type", &VectorValue::m_element_type)
+      ("elements", &VectorValue::m_elements);
+    }
+    
+    ValuePtr<> VectorValue::check_type() const {
+      for (std::vector<ValuePtr<> >::const_iterator ii = m_elements.begin(), ie = m_elements.end(); ii != ie; ++ii) {
+        if ((*ii)->type() != m_element_type)
+          error_context().error_throw(location(), "vector value element is of the wrong type");
+      }
+      
+      return FunctionalBuilder::vector_type(m_element_type, m_elements.size(), location());
+    }
+    
+    PSI_TVM_FUNCTIONAL_IMPL(VectorValue, Constructor, vector_v)
+    
+    namespace {
+      /**
+       * \brief Check the vector and index arguments of a lane access, and return the vector type.
+       */
+      ValuePtr<VectorType> check_vector_lane(const FunctionalValue& self, const char *op, const ValuePtr<>& vector, const ValuePtr<>& index) {
+        ValuePtr<VectorType> vec_ty = dyn_cast<VectorType>(vector->type());
+        if (!vec_ty)
+          self.error_context().error_throw(self.location(), boost::format("first parameter to %s is not a vector") % op);
+        if (index->type() != FunctionalBuilder::size_type(self.context(), self.location()))
+          self.error_context().error_throw(self.location(), boost::format("lane index parameter to %s is not an intptr") % op);
+        if (ValuePtr<IntegerValue> index_val = dyn_cast<IntegerValue>(index)) {
+          boost::optional<unsigned> index_int = index_val->value().unsigned_value();
+          if (!index_int || (*index_int >= vec_ty->length()))
+            self.error_context().error_throw(self.location(), boost::format("lane index parameter to %s is out of range") % op);
+        }
+        return vec_ty;
+      }
+    }
+    
+    VectorElement::VectorElement(const ValuePtr<>& vector, const ValuePtr<>& index, const SourceLocation& location)
+    : FunctionalValue(vector->context(), location),
+    m_vector(vector),
+    m_index(index) {
+    }
+    
+    template<typename V>
+    void VectorElement::visit(V& v) {
+      visit_base<FunctionalValue>(v);
+      v("vector", &VectorElement::m_vector)
+      ("index", &VectorElement::m_index);
+    }
+    
+    ValuePtr<> VectorElement::check_type() const {
+      return check_vector_lane(*this, operation, m_vector, m_index)->element_type();
+    }
+    
+    PSI_TVM_FUNCTIONAL_IMPL(VectorElement, FunctionalValue, vector_element)
+    
+    VectorInsert::VectorInsert(const ValuePtr<>& vector, const ValuePtr<>& index, const ValuePtr<>& value, const SourceLocation& location)
+    : FunctionalValue(vector->context(), location),
+    m_vector(vector),
+    m_index(index),
+    m_value(value) {
+    }
+    
+    template<typename V>
+    void VectorInsert::visit(V& v) {
+      visit_base<FunctionalValue>(v);
+      v("vector", &VectorInsert::m_vector)
+      ("index", &VectorInsert::m_index)
+      ("value", &VectorInsert::m_value);
+    }
+    
+    ValuePtr<> VectorInsert::check_type() const {
+      ValuePtr<VectorType> vec_ty = check_vector_lane(*this, operation, m_vector, m_index);
+      if (m_value->type() != vec_ty->element_type())
+        error_context().error_throw(location(), "value parameter to vector_insert does not match the vector element type");
+      return vec_ty;
+    }
+    
+    PSI_TVM_FUNCTIONAL_IMPL(VectorInsert, FunctionalValue, vector_insert)
+    
+    VectorShuffle::VectorShuffle(const ValuePtr<>& lhs, const ValuePtr<>& rhs, const std::vector<unsigned>& mask, const SourceLocation& location)
+    : FunctionalValue(lhs->context(), location),
+    m_lhs(lhs),
+    m_rhs(rhs),
+    m_mask(mask) {
+    }
+    
+    template<typename V>
+    void VectorShuffle::visit(V& v) {
+      visit_base<FunctionalValue>(v);
+      v("lhs", &VectorShuffle::m_lhs)
+      ("rhs", &VectorShuffle::m_rhs)
+      ("mask", &VectorShuffle::m_mask);
+    }
+    
+    ValuePtr<> VectorShuffle::check_type() const {
+      ValuePtr<VectorType> vec_ty = dyn_cast<VectorType>(m_lhs->type());
+      if (!vec_ty)
+        error_context().error_throw(location(), "parameters to vector_shuffle must be vectors");
+      if (m_lhs->type() != m_rhs->type())
+        error_context().error_throw(location(), "both vector parameters to vector_shuffle must have the same type");
+      for (std::vector<unsigned>::const_iterator ii = m_mask.begin(), ie = m_mask.end(); ii != ie; ++ii) {
+        if (*ii >= 2 * vec_ty->length())
+          error_context().error_throw(location(), "vector_shuffle mask entry is out of range");
+      }
+      return FunctionalBuilder::vector_type(vec_ty->element_type(), m_mask.size(), location());
+    }
+    
+    PSI_TVM_FUNCTIONAL_IMPL(VectorShuffle, FunctionalValue, vector_shuffle)
+    
+    VectorReduceOp::VectorReduceOp(const ValuePtr<>& arg, const SourceLocation& location)
+    : UnaryOp(arg, location) {
+    }
+    
+    ValuePtr<> VectorReduceOp::check_type() const {
+      ValuePtr<VectorType> vec_ty = dyn_cast<VectorType>(parameter()->type());
+      if (!vec_ty || !(isa<IntegerType>(vec_ty->element_type()) || isa<BooleanType>(vec_ty->element_type())))
+        error_context().error_throw(location(), "Argument to vector reduction must be an integer or boolean vector");
+      return vec_ty->element_type();
+    }
+    
+    template<typename V>
+    void VectorReduceOp::visit(V& v) {
+      visit_base<UnaryOp>(v);
+    }
+    
+    ValuePtr<> VectorReduceAdd::check_type() const {
+      ValuePtr<> result = VectorReduceOp::check_type();
+      if (!isa<IntegerType>(result))
+        error_context().error_throw(location(), "Argument to vector_reduce_add must be an integer vector");
+      return result;
+    }
+    
+    PSI_TVM_UNARY_OP_IMPL(VectorReduceAdd, VectorReduceOp, vector_reduce_add)
+    ValuePtr<> VectorReduceAnd::check_type() const {return VectorReduceOp::check_type();}
+    PSI_TVM_UNARY_OP_IMPL(VectorReduceAnd, VectorReduceOp, vector_reduce_and)
+    ValuePtr<> VectorReduceOr::check_type() const {return VectorReduceOp::check_type();}
+    PSI_TVM_UNARY_OP_IMPL(VectorReduceOr, VectorReduceOp, vector_reduce_or)
   }
 }
@@ -133,7 +133,7 @@ namespace Psi {
     };
     
     /**
-     * \brief Unary operations on integers.
+     * \brief Unary operations on integers or integer vectors.
      */
     class PSI_TVM_EXPORT_DEBUG IntegerUnaryOp : public UnaryOp {
     protected:
@@ -147,7 +147,7 @@ namespace Psi {
     PSI_TVM_UNARY_OP_DECL(BitNot, IntegerUnaryOp)
 
     /**
-     * \brief Binary operations on two integers of the same width.
+     * \brief Binary operations on two integers, or integer vectors, of the same type.
      */
     class IntegerBinaryOp : public BinaryOp {
     protected:
@@ -225,6 +225,141 @@ namespace Psi {
       ValuePtr<> m_false_value;
     };
     
+    /**
+     * \brief A SIMD vector of booleans, integers or floating point numbers.
+     * 
+     * The number of lanes must be a power of two. Integer operations,
+     * comparisons and select act lane-wise when applied to vectors.
+     */
+    class PSI_TVM_EXPORT_DEBUG VectorType : public Type {
+      PSI_TVM_FUNCTIONAL_DECL(VectorType)
+      
+    public:
+      VectorType(const ValuePtr<>& element_type, unsigned length, const SourceLocation& location);
+      
+      /// \brief Get the type of each lane.
+      const ValuePtr<>& element_type() const {return m_element_type;}
+      /// \brief Get the number of lanes.
+      unsigned length() const {return m_length;}
+      
+    private:
+      ValuePtr<> m_element_type;
+      unsigned m_length;
+      
+      virtual bool match_impl(const FunctionalValue& other, std::vector<ValuePtr<> >& parameters, unsigned depth, UprefMatchMode upref_mode) const;
+    };
+    
+    /**
+     * \brief Constructs a vector from a list of lane values.
+     */
+    class PSI_TVM_EXPORT_DEBUG VectorValue : public Constructor {
+      PSI_TVM_FUNCTIONAL_DECL(VectorValue)
+      
+    public:
+      VectorValue(const ValuePtr<>& element_type, const std::vector<ValuePtr<> >& elements, const SourceLocation& location);
+      
+      /// \brief Get the lane type.
+      const ValuePtr<>& element_type() const {return m_element_type;}
+      /// \brief Get the number of lanes.
+      unsigned length() const {return m_elements.size();}
+      /// \brief Get the value of the specified lane.
+      const ValuePtr<>& value(std::size_t n) const {return m_elements[n];}
+      /// \brief Get the type of this value (overloaded to return a VectorType).
+      ValuePtr<VectorType> type() const {return value_cast<VectorType>(Value::type());}
+      
+    private:
+      ValuePtr<> m_element_type;
+      std::vector<ValuePtr<> > m_elements;
+    };
+    
+    /**
+     * \brief Get the value of one lane of a vector.
+     * 
+     * The index need not be constant.
+     */
+    class PSI_TVM_EXPORT_DEBUG VectorElement : public FunctionalValue {
+      PSI_TVM_FUNCTIONAL_DECL(VectorElement)
+      
+    public:
+      VectorElement(const ValuePtr<>& vector, const ValuePtr<>& index, const SourceLocation& location);
+      
+      /// \brief Get the vector being accessed.
+      const ValuePtr<>& vector() const {return m_vector;}
+      /// \brief Get the lane index.
+      const ValuePtr<>& index() const {return m_index;}
+      
+    private:
+      ValuePtr<> m_vector;
+      ValuePtr<> m_index;
+    };
+    
+    /**
+     * \brief Get a copy of a vector with one lane replaced.
+     */
+    class PSI_TVM_EXPORT_DEBUG VectorInsert : public FunctionalValue {
+      PSI_TVM_FUNCTIONAL_DECL(VectorInsert)
+      
+    public:
+      VectorInsert(const ValuePtr<>& vector, const ValuePtr<>& index, const ValuePtr<>& value, const SourceLocation& location);
+      
+      /// \brief Get the original vector.
+      const ValuePtr<>& vector() const {return m_vector;}
+      /// \brief Get the index of the lane being replaced.
+      const ValuePtr<>& index() const {return m_index;}
+      /// \brief Get the new lane value.
+      const ValuePtr<>& value() const {return m_value;}
+      
+    private:
+      ValuePtr<> m_vector;
+      ValuePtr<> m_index;
+      ValuePtr<> m_value;
+    };
+    
+    /**
+     * \brief Build a vector from lanes of two vectors of the same type.
+     * 
+     * Each mask entry selects a lane from the concatenation of \c lhs and
+     * \c rhs, so entry \c i refers to lane \c i of \c lhs if it is less
+     * than the vector length and to lane <tt>i - length</tt> of \c rhs
+     * otherwise. The mask is constant, and its length is the length of
+     * the result.
+     */
+    class PSI_TVM_EXPORT_DEBUG VectorShuffle : public FunctionalValue {
+      PSI_TVM_FUNCTIONAL_DECL(VectorShuffle)
+      
+    public:
+      VectorShuffle(const ValuePtr<>& lhs, const ValuePtr<>& rhs, const std::vector<unsigned>& mask, const SourceLocation& location);
+      
+      /// \brief Get the first source vector.
+      const ValuePtr<>& lhs() const {return m_lhs;}
+      /// \brief Get the second source vector.
+      const ValuePtr<>& rhs() const {return m_rhs;}
+      /// \brief Get the lane selection mask.
+      const std::vector<unsigned>& mask() const {return m_mask;}
+      
+    private:
+      ValuePtr<> m_lhs;
+      ValuePtr<> m_rhs;
+      std::vector<unsigned> m_mask;
+    };
+    
+    /**
+     * \brief Horizontal reductions which combine all lanes of a vector.
+     */
+    class PSI_TVM_EXPORT_DEBUG VectorReduceOp : public UnaryOp {
+    protected:
+      VectorReduceOp(const ValuePtr<>& arg, const SourceLocation& location);
+      virtual ValuePtr<> check_type() const;
+    public:
+      template<typename V> static void visit(V& v);
+    };
+    
+    PSI_TVM_UNARY_OP_DECL(VectorReduceAdd, VectorReduceOp)
+    PSI_TVM_UNARY_OP_DECL(VectorReduceAnd, VectorReduceOp)
+    PSI_TVM_UNARY_OP_DECL(VectorReduceOr, VectorReduceOp)
+    
+    PSI_TVM_EXPORT ValuePtr<> lane_type(const ValuePtr<>& type);
+    
     PSI_TVM_EXPORT unsigned size_to_unsigned(const ValuePtr<>& value);
     PSI_TVM_EXPORT bool size_equals_constant(const ValuePtr<>& value, unsigned c);
   }
@@ -114,6 +114,37 @@ namespace Psi {
       PSI_TEST_CHECK_EQUAL(r3.b, 0x3FFFFFFDu);
     }
 
+    PSI_TEST_CASE(VectorLanewise) {
+      const char *src =
+        "%vmax = export function (%a:i32, %b:i32, %c:i32, %d:i32) > i32 {\n"
+        "  return (vector_reduce_add (select\n"
+        "    (cmp_gt (vector_v i32 %a %b %c %d) (vector_v i32 %d %c %b %a))\n"
+        "    (shl (vector_v i32 %a %b %c %d) #ui1)\n"
+        "    (vector_v i32 %d %c %b %a)));\n"
+        "};\n";
+
+      typedef Jit::Int32 (*FuncType) (Jit::Int32, Jit::Int32, Jit::Int32, Jit::Int32);
+      FuncType f = reinterpret_cast<FuncType>(jit_single("vmax", src));
+      PSI_TEST_CHECK_EQUAL(f(1, 2, 3, 4), 4 + 3 + 6 + 8);
+      PSI_TEST_CHECK_EQUAL(f(-5, 7, 2, 0), 0 + 14 + 7 + 0);
+    }
+    
+    PSI_TEST_CASE(VectorShuffle) {
+      const char *src =
+        "%vshuffle = export function (%a:i32, %b:i32, %n:uiptr) > i32 {\n"
+        "  return (vector_element\n"
+        "    (vector_shuffle (vector_v i32 %a %b) (vector_insert (vector_v i32 %a %b) #up0 #i10) #i3 #i2 #i1 #i0)\n"
+        "    %n);\n"
+        "};\n";
+
+      typedef Jit::Int32 (*FuncType) (Jit::Int32, Jit::Int32, Jit::UIntPtr);
+      FuncType f = reinterpret_cast<FuncType>(jit_single("vshuffle", src));
+      PSI_TEST_CHECK_EQUAL(f(5, 6, 0), 6);
+      PSI_TEST_CHECK_EQUAL(f(5, 6, 1), 10);
+      PSI_TEST_CHECK_EQUAL(f(5, 6, 2), 6);
+      PSI_TEST_CHECK_EQUAL(f(5, 6, 3), 5);
+    }
+
     PSI_TEST_SUITE_END()
   }
 }
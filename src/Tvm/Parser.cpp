@@ -171,21 +171,25 @@ GlobalElement* Function::clone() const {
 
 GlobalVariable::GlobalVariable(const PhysicalSourceLocation& location_,
                                bool constant_,
+                               bool thread_local_,
                                Linkage linkage_,
                                ExpressionRef type_)
 : GlobalElement(location_, global_variable),
 constant(constant_),
+is_thread_local(thread_local_),
 linkage(linkage_),
 type(move(type_)) {
 }
 
 GlobalVariable::GlobalVariable(const PhysicalSourceLocation& location_,
                                bool constant_,
+                               bool thread_local_,
                                Linkage linkage_,
                                ExpressionRef type_,
                                ExpressionRef value_)
 : GlobalElement(location_, global_variable),
 constant(constant_),
+is_thread_local(thread_local_),
 linkage(linkage_),
 type(move(type_)),
 value(move(value_)) {
@@ -242,12 +246,17 @@ enum LongToken {
   tok_landing_pad,
   tok_extern,
   tok_const,
+  tok_thread_local,
 
   // Function attributes
   tok_cc_c,
   tok_sret,
   tok_llvm_byval,
   tok_llvm_inreg,
+  tok_noalias,
+  tok_nocapture,
+  tok_readonly,
+  tok_dereferenceable,
   
   // Linkage types
   tok_local,
@@ -330,7 +339,7 @@ public:
     int token;
   };
   
-  static const std::size_t n_keywords = 18;
+  static const std::size_t n_keywords = 23;
   static const KeywordTokenPair keywords[n_keywords];
   
   typedef LexerValue<int, LexerImplValue> ValueType;
@@ -353,6 +362,7 @@ const LexerImpl::KeywordTokenPair LexerImpl::keywords[LexerImpl::n_keywords] = {
   {"cc_c", tok_cc_c},
   {"const", tok_const},
   {"define", tok_define},
+  {"dereferenceable", tok_dereferenceable},
   {"exists", tok_exists},
   {"export", tok_export},
   {"extern", tok_extern},
@@ -362,11 +372,15 @@ const LexerImpl::KeywordTokenPair LexerImpl::keywords[LexerImpl::n_keywords] = {
   {"llvm_byval", tok_llvm_byval},
   {"llvm_inreg", tok_llvm_inreg},
   {"local", tok_local},
+  {"noalias", tok_noalias},
+  {"nocapture", tok_nocapture},
   {"odr", tok_odr},
   {"phi", tok_phi},
   {"private", tok_private},
+  {"readonly", tok_readonly},
   {"recursive", tok_recursive},
   {"sret", tok_sret},
+  {"thread_local", tok_thread_local},
 };
 
 std::string LexerImpl::error_name(int tok) {
@@ -667,13 +681,14 @@ GlobalElementRef ParserImpl::parse_global_element() {
   if (lex().accept(tok_global)) {
     // Global variable
     bool is_const = lex().accept(tok_const);
+    bool is_thread_local = lex().accept(tok_thread_local);
     Linkage linkage = parse_linkage();
     ExpressionRef type, value;
     type = parse_expression();
     if (lex().reject(';'))
       value = parse_expression();
     lex().loc_end(loc);
-    return GlobalElementRef(new GlobalVariable(loc, is_const, linkage, type, value));
+    return GlobalElementRef(new GlobalVariable(loc, is_const, is_thread_local, linkage, type, value));
   } else if (lex().accept(tok_define)) {
     // Constant def
     ExpressionRef value = parse_root_expression();
@@ -740,7 +755,17 @@ ParameterAttributes ParserImpl::parse_attribute_list() {
       attrs.flags |= ParameterAttributes::llvm_byval;
     else if (lex().accept(tok_llvm_inreg))
       attrs.flags |= ParameterAttributes::llvm_inreg;
-    else
+    else if (lex().accept(tok_noalias))
+      attrs.flags |= ParameterAttributes::noalias;
+    else if (lex().accept(tok_nocapture))
+      attrs.flags |= ParameterAttributes::nocapture;
+    else if (lex().accept(tok_readonly))
+      attrs.flags |= ParameterAttributes::readonly;
+    else if (lex().accept(tok_dereferenceable)) {
+      lex().expect(tok_number);
+      const IntegerLiteralExpression& size = checked_cast<const IntegerLiteralExpression&>(*lex().value().value().expression());
+      attrs.dereferenceable = size.value.unsigned_value_checked(lex().error_loc(lex().value().location()));
+    } else
       break;
   }
   return attrs;
@@ -200,16 +200,19 @@ namespace Psi {
       struct GlobalVariable : GlobalElement {
         GlobalVariable(const PhysicalSourceLocation& location_,
                        bool constant_,
+                       bool thread_local_,
                        Linkage linkage_,
                        ExpressionRef type_);
         GlobalVariable(const PhysicalSourceLocation& location_,
                        bool constant_,
+                       bool thread_local_,
                        Linkage linkage_,
                        ExpressionRef type_,
                        ExpressionRef value_);
         virtual GlobalElement* clone() const;
 
         bool constant;
+        bool is_thread_local;
         Linkage linkage;
         ExpressionRef type;
         ExpressionRef value;
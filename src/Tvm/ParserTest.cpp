@@ -36,6 +36,19 @@ namespace Psi {
         PSI_TEST_CHECK_EQUAL(result.front().value->global_type, global_variable);
       }
 
+      PSI_TEST_CASE(GlobalVariableThreadLocal) {
+        const char *src = "%x = global thread_local export i32 #i0;";
+
+        PSI_STD::vector<NamedGlobalElement> result = parse(error_context, location, src);
+
+        PSI_TEST_CHECK_EQUAL(result.size(), 1u);
+        PSI_TEST_CHECK_EQUAL(result.front().value->global_type, global_variable);
+        const Parser::GlobalVariable& var = checked_cast<const Parser::GlobalVariable&>(*result.front().value);
+        PSI_TEST_CHECK(var.is_thread_local);
+        PSI_TEST_CHECK(!var.constant);
+        PSI_TEST_CHECK_EQUAL(var.linkage, link_export);
+      }
+
       PSI_TEST_CASE(FunctionExtern) {
         const char *src = "%x = function (i32, i64) > i16;";
 
@@ -57,6 +70,22 @@ namespace Psi {
         PSI_TEST_CHECK_EQUAL(result.front().value->global_type, global_function);
       }
 
+      PSI_TEST_CASE(FunctionParameterAttributes) {
+        const char *src = "%x = function (%a : noalias nocapture pointer i32, %b : readonly dereferenceable #up8 pointer i64) > noalias (pointer i8);";
+
+        PSI_STD::vector<NamedGlobalElement> result = parse(error_context, location, src);
+
+        PSI_TEST_CHECK_EQUAL(result.size(), 1u);
+        PSI_TEST_REQUIRE(result.front().value->global_type == global_function);
+        const Parser::Function& func = checked_cast<const Parser::Function&>(*result.front().value);
+        PSI_TEST_REQUIRE(func.type.parameters.size() == 2);
+        PSI_TEST_CHECK_EQUAL(func.type.parameters[0].attributes.flags, unsigned(ParameterAttributes::noalias|ParameterAttributes::nocapture));
+        PSI_TEST_CHECK_EQUAL(func.type.parameters[0].attributes.dereferenceable, 0u);
+        PSI_TEST_CHECK_EQUAL(func.type.parameters[1].attributes.flags, unsigned(ParameterAttributes::readonly));
+        PSI_TEST_CHECK_EQUAL(func.type.parameters[1].attributes.dereferenceable, 8u);
+        PSI_TEST_CHECK_EQUAL(func.type.result_attributes.flags, unsigned(ParameterAttributes::noalias));
+      }
+
       PSI_TEST_SUITE_END()
     }
   }
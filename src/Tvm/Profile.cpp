@@ -0,0 +1,347 @@
+#include "Profile.hpp"
+#include "FunctionalBuilder.hpp"
+#include "InstructionBuilder.hpp"
+#include "Instructions.hpp"
+#include "Jit.hpp"
+
+#include <algorithm>
+#include <istream>
+#include <limits>
+#include <ostream>
+
+namespace Psi {
+  namespace Tvm {
+    /// \brief Get the profile of a function, or NULL if it was not profiled.
+    const FunctionProfile* ProfileData::lookup(const std::string& name) const {
+      FunctionMap::const_iterator it = m_functions.find(name);
+      return (it != m_functions.end()) ? &it->second : NULL;
+    }
+
+    /// \brief Get the profile of a function, creating an empty one if necessary.
+    FunctionProfile& ProfileData::get(const std::string& name) {
+      return m_functions[name];
+    }
+
+    /**
+     * \brief Add the counts from another profile to this one.
+     *
+     * Where a function appears in both profiles but with a different number
+     * of blocks or calls, the function has changed and the counts from
+     * \c other replace those in this profile.
+     */
+    void ProfileData::merge(const ProfileData& other) {
+      for (FunctionMap::const_iterator ii = other.m_functions.begin(), ie = other.m_functions.end(); ii != ie; ++ii) {
+        FunctionProfile& target = m_functions[ii->first];
+        const FunctionProfile& source = ii->second;
+        if ((target.block_counts.size() != source.block_counts.size()) || (target.call_counts.size() != source.call_counts.size())) {
+          target = source;
+          continue;
+        }
+
+        for (std::size_t ji = 0, je = source.block_counts.size(); ji != je; ++ji)
+          target.block_counts[ji] += source.block_counts[ji];
+        for (std::size_t ji = 0, je = source.call_counts.size(); ji != je; ++ji)
+          target.call_counts[ji] += source.call_counts[ji];
+        target.call_targets = source.call_targets;
+      }
+    }
+
+    /**
+     * \brief Write this profile in a line based text format.
+     *
+     * Each function starts with a <tt>function <name></tt> line,
+     * followed by one <tt>block <count></tt> line per block and
+     * then one <tt>call <count> <callee></tt> line per call site,
+     * where \c callee is \c - for indirect calls.
+     */
+    void ProfileData::write(std::ostream& os) const {
+      for (FunctionMap::const_iterator ii = m_functions.begin(), ie = m_functions.end(); ii != ie; ++ii) {
+        const FunctionProfile& fp = ii->second;
+        PSI_ASSERT(fp.call_counts.size() == fp.call_targets.size());
+        os << "function " << ii->first << '\n';
+        for (std::vector<uint64_t>::const_iterator ji = fp.block_counts.begin(), je = fp.block_counts.end(); ji != je; ++ji)
+          os << "block " << *ji << '\n';
+        for (std::size_t ji = 0, je = fp.call_counts.size(); ji != je; ++ji)
+          os << "call " << fp.call_counts[ji] << ' ' << (fp.call_targets[ji].empty() ? "-" : fp.call_targets[ji]) << '\n';
+      }
+    }
+
+    /**
+     * \brief Read a profile written by write(), and merge it into this one.
+     *
+     * \return Whether the profile was read successfully. If not, this
+     * profile is unchanged.
+     */
+    bool ProfileData::read(std::istream& is) {
+      ProfileData result;
+      FunctionProfile *current = NULL;
+      std::string keyword;
+      while (is >> keyword) {
+        if (keyword == "function") {
+          std::string name;
+          if (!(is >> name))
+            return false;
+          current = &result.get(name);
+        } else if (keyword == "block") {
+          uint64_t count;
+          if (!current || !current->call_counts.empty() || !(is >> count))
+            return false;
+          current->block_counts.push_back(count);
+        } else if (keyword == "call") {
+          uint64_t count;
+          std::string target;
+          if (!current || !(is >> count >> target))
+            return false;
+          current->call_counts.push_back(count);
+          current->call_targets.push_back((target == "-") ? std::string() : target);
+        } else {
+          return false;
+        }
+      }
+
+      if (!is.eof())
+        return false;
+
+      merge(result);
+      return true;
+    }
+
+    uint64_t ProfileData::max_entry_count() const {
+      uint64_t result = 0;
+      for (FunctionMap::const_iterator ii = m_functions.begin(), ie = m_functions.end(); ii != ie; ++ii)
+        result = std::max(result, ii->second.entry_count());
+      return result;
+    }
+
+    FunctionHotness ProfileData::hotness(const FunctionProfile& profile, uint64_t max_count) {
+      uint64_t count = profile.entry_count();
+      if (count == 0)
+        return hotness_cold;
+      else if (count >= max_count / hot_fraction)
+        return hotness_hot;
+      else
+        return hotness_normal;
+    }
+
+    /**
+     * \brief Classify a function by how often it was called.
+     *
+     * Functions which were never called are cold, and functions called
+     * at least <tt>1/hot_fraction</tt> as often as the most frequently called
+     * function are hot. Functions missing from the profile are neither.
+     */
+    FunctionHotness ProfileData::hotness(const std::string& name) const {
+      const FunctionProfile *fp = lookup(name);
+      if (!fp || fp->block_counts.empty())
+        return hotness_normal;
+      return hotness(*fp, max_entry_count());
+    }
+
+    /**
+     * \brief Set the weights of conditional branches from block counts.
+     *
+     * Only block counts are recorded, so the number of times each edge was
+     * taken has to be estimated. When a target has no other predecessor, the
+     * target's count is exact and the other edge gets the remainder of the
+     * source block's count; otherwise the target block counts are used as they are.
+     */
+    void ProfileData::apply_branch_weights(Function& function, const FunctionProfile& profile) const {
+      std::map<Block*, uint64_t> counts;
+      std::map<Block*, unsigned> n_predecessors;
+      std::size_t index = 0;
+      for (Function::BlockList::const_iterator ii = function.blocks().begin(), ie = function.blocks().end(); ii != ie; ++ii, ++index) {
+        counts[ii->get()] = profile.block_counts[index];
+        std::vector<ValuePtr<Block> > successors = (*ii)->successors();
+        for (std::vector<ValuePtr<Block> >::const_iterator ji = successors.begin(), je = successors.end(); ji != je; ++ji)
+          ++n_predecessors[ji->get()];
+      }
+
+      for (Function::BlockList::const_iterator ii = function.blocks().begin(), ie = function.blocks().end(); ii != ie; ++ii) {
+        if ((*ii)->instructions().empty())
+          continue;
+        ValuePtr<ConditionalBranch> br = dyn_cast<ConditionalBranch>((*ii)->instructions().back());
+        if (!br)
+          continue;
+
+        uint64_t source_count = counts[ii->get()];
+        uint64_t true_count = counts[br->true_target.get()], false_count = counts[br->false_target.get()];
+        if (br->true_target == br->false_target) {
+          continue;
+        } else if ((n_predecessors[br->true_target.get()] == 1) && (true_count <= source_count)) {
+          false_count = source_count - true_count;
+        } else if ((n_predecessors[br->false_target.get()] == 1) && (false_count <= source_count)) {
+          true_count = source_count - false_count;
+        }
+
+        // Leave any hint from the source in place if this branch never ran
+        if (!true_count && !false_count)
+          continue;
+
+        uint64_t scale = std::max(true_count, false_count) / std::numeric_limits<unsigned>::max() + 1;
+        br->true_weight = unsigned(true_count / scale);
+        br->false_weight = unsigned(false_count / scale);
+      }
+    }
+
+    /**
+     * \brief Annotate a module using this profile.
+     *
+     * Sets the hotness of each profiled function and the weights of its
+     * conditional branches. Functions whose shape does not match the
+     * profile are left alone.
+     */
+    void ProfileData::apply(Module& module) const {
+      uint64_t max_count = max_entry_count();
+      for (Module::ModuleMemberList::iterator ii = module.members().begin(), ie = module.members().end(); ii != ie; ++ii) {
+        ValuePtr<Function> function = dyn_cast<Function>(ii->second);
+        if (!function || function->blocks().empty())
+          continue;
+
+        const FunctionProfile *fp = lookup(function->name());
+        if (!fp || (fp->block_counts.size() != function->blocks().size()))
+          continue;
+
+        function->set_hotness(hotness(*fp, max_count));
+        apply_branch_weights(*function, *fp);
+      }
+    }
+
+    namespace {
+      struct CallSiteCountGreater {
+        bool operator () (const ProfileCallSite& lhs, const ProfileCallSite& rhs) const {
+          return lhs.count > rhs.count;
+        }
+      };
+    }
+
+    /**
+     * \brief Get the most frequently executed direct call sites.
+     *
+     * These are the best candidates for inlining or specialization.
+     *
+     * \param limit Maximum number of call sites to return.
+     */
+    std::vector<ProfileCallSite> ProfileData::hot_call_sites(std::size_t limit) const {
+      std::vector<ProfileCallSite> result;
+      for (FunctionMap::const_iterator ii = m_functions.begin(), ie = m_functions.end(); ii != ie; ++ii) {
+        const FunctionProfile& fp = ii->second;
+        for (std::size_t ji = 0, je = fp.call_counts.size(); ji != je; ++ji) {
+          if (!fp.call_counts[ji] || fp.call_targets[ji].empty())
+            continue;
+
+          ProfileCallSite site;
+          site.caller = ii->first;
+          site.callee = fp.call_targets[ji];
+          site.index = ji;
+          site.count = fp.call_counts[ji];
+          const FunctionProfile *callee = lookup(site.callee);
+          site.callee_count = callee ? callee->entry_count() : 0;
+          result.push_back(site);
+        }
+      }
+
+      std::stable_sort(result.begin(), result.end(), CallSiteCountGreater());
+      if (result.size() > limit)
+        result.resize(limit);
+      return result;
+    }
+
+    namespace {
+      void profile_increment(InstructionBuilder& builder, const ValuePtr<>& counters, std::size_t index, const ValuePtr<>& one, const SourceLocation& location) {
+        ValuePtr<> ptr = FunctionalBuilder::element_ptr(counters, index, location);
+        ValuePtr<> old = builder.load(ptr, location);
+        builder.store(FunctionalBuilder::add(old, one, location), ptr, location);
+      }
+    }
+
+    void ProfileInstrumentation::instrument_function(const ValuePtr<Function>& function) {
+      const SourceLocation& location = function->location();
+
+      std::vector<ValuePtr<Block> > blocks;
+      std::vector<ValuePtr<Call> > calls;
+      for (Function::BlockList::const_iterator ii = function->blocks().begin(), ie = function->blocks().end(); ii != ie; ++ii) {
+        blocks.push_back(*ii);
+        for (Block::InstructionList::const_iterator ji = (*ii)->instructions().begin(), je = (*ii)->instructions().end(); ji != je; ++ji) {
+          if (ValuePtr<Call> call = dyn_cast<Call>(*ji))
+            calls.push_back(call);
+        }
+      }
+
+      FunctionCounters fc;
+      fc.name = function->name();
+      fc.n_blocks = blocks.size();
+
+      ValuePtr<IntegerType> counter_type = FunctionalBuilder::int_type(function->context(), IntegerType::i64, false, location);
+      ValuePtr<> counters_type = FunctionalBuilder::array_type(counter_type, blocks.size() + calls.size(), location);
+      fc.counters = function->module()->new_global_variable_set("__psi_profile_" + function->name(), FunctionalBuilder::zero(counters_type, location), location);
+      fc.counters->set_linkage(link_export);
+      ValuePtr<> one = FunctionalBuilder::int_value(counter_type, 1, location);
+
+      InstructionBuilder builder;
+      for (std::size_t ii = 0, ie = blocks.size(); ii != ie; ++ii) {
+        PSI_ASSERT(!blocks[ii]->instructions().empty());
+        builder.set_insert_point(blocks[ii]->instructions().front());
+        profile_increment(builder, fc.counters, ii, one, blocks[ii]->location());
+      }
+
+      for (std::size_t ii = 0, ie = calls.size(); ii != ie; ++ii) {
+        builder.set_insert_point(ValuePtr<Instruction>(calls[ii]));
+        profile_increment(builder, fc.counters, blocks.size() + ii, one, calls[ii]->location());
+        ValuePtr<Function> target = dyn_cast<Function>(calls[ii]->target);
+        fc.call_targets.push_back(target ? target->name() : std::string());
+      }
+
+      m_functions.push_back(fc);
+    }
+
+    /**
+     * \brief Add counters to every function defined in a module.
+     *
+     * This must be run before the module is passed to a Jit.
+     */
+    void ProfileInstrumentation::instrument(Module& module) {
+      std::vector<ValuePtr<Function> > functions;
+      for (Module::ModuleMemberList::iterator ii = module.members().begin(), ie = module.members().end(); ii != ie; ++ii) {
+        ValuePtr<Function> function = dyn_cast<Function>(ii->second);
+        if (function && !function->blocks().empty())
+          functions.push_back(function);
+      }
+
+      // Counters are module members, so they must not be created while iterating over members
+      for (std::vector<ValuePtr<Function> >::const_iterator ii = functions.begin(), ie = functions.end(); ii != ie; ++ii)
+        instrument_function(*ii);
+    }
+
+    /**
+     * \brief Forget the counters added to a module.
+     *
+     * This must be called if an instrumented module could not be loaded,
+     * since collect() requires every module to be loaded.
+     */
+    void ProfileInstrumentation::discard(const Module& module) {
+      std::vector<FunctionCounters> kept;
+      for (std::vector<FunctionCounters>::const_iterator ii = m_functions.begin(), ie = m_functions.end(); ii != ie; ++ii) {
+        if (ii->counters->module() != &module)
+          kept.push_back(*ii);
+      }
+      m_functions.swap(kept);
+    }
+
+    /**
+     * \brief Add the current values of all counters to a profile.
+     *
+     * \param jit JIT which all instrumented modules have been loaded into.
+     */
+    void ProfileInstrumentation::collect(Jit& jit, ProfileData& profile) const {
+      ProfileData collected;
+      for (std::vector<FunctionCounters>::const_iterator ii = m_functions.begin(), ie = m_functions.end(); ii != ie; ++ii) {
+        const Jit::UInt64 *counters = static_cast<const Jit::UInt64*>(jit.get_symbol(ii->counters));
+        FunctionProfile& fp = collected.get(ii->name);
+        fp.block_counts.assign(counters, counters + ii->n_blocks);
+        fp.call_counts.assign(counters + ii->n_blocks, counters + ii->n_blocks + ii->call_targets.size());
+        fp.call_targets = ii->call_targets;
+      }
+      profile.merge(collected);
+    }
+  }
+}
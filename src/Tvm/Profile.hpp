@@ -0,0 +1,134 @@
+#ifndef HPP_PSI_TVM_PROFILE
+#define HPP_PSI_TVM_PROFILE
+
+#include "Core.hpp"
+#include "Function.hpp"
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+/**
+ * \file
+ *
+ * Profile guided optimization: counting how often blocks and call
+ * sites are executed, and feeding those counts back into TVM.
+ */
+
+namespace Psi {
+  namespace Tvm {
+    class Jit;
+
+    /**
+     * \brief Execution counts collected for one function.
+     */
+    struct FunctionProfile {
+      /// \brief Number of times each block was entered, in Function::blocks() order.
+      std::vector<uint64_t> block_counts;
+      /// \brief Number of times each call instruction was executed, in the order they appear in the function.
+      std::vector<uint64_t> call_counts;
+      /// \brief Name of the function called by each call instruction, or an empty string for indirect calls.
+      std::vector<std::string> call_targets;
+
+      /// \brief Number of times this function was called.
+      uint64_t entry_count() const {return block_counts.empty() ? 0 : block_counts.front();}
+    };
+
+    /**
+     * \brief A call site, ranked by how often it was executed.
+     *
+     * A call site executed often is worth inlining; if it also accounts
+     * for most calls to \c callee, specializing \c callee for this site
+     * costs little code size.
+     */
+    struct ProfileCallSite {
+      /// \brief Name of the calling function.
+      std::string caller;
+      /// \brief Name of the called function.
+      std::string callee;
+      /// \brief Index of the call instruction within \c caller.
+      std::size_t index;
+      /// \brief Number of times this call was executed.
+      uint64_t count;
+      /// \brief Number of times \c callee was called from anywhere, or zero if \c callee was not profiled.
+      uint64_t callee_count;
+    };
+
+    /**
+     * \brief Execution counts for a set of functions, keyed by symbol name.
+     *
+     * Symbols are identified by name rather than by object so that a profile
+     * can be written at the end of one run and read at the start of the next;
+     * the Psi compiler names symbols deterministically (see TvmSymbolNaming.cpp)
+     * so the same source produces the same names.
+     *
+     * Blocks and call sites are identified by their position in the function.
+     * When a function no longer has the same number of blocks as in the
+     * profile, the profile is out of date and is ignored for that function.
+     */
+    class PSI_TVM_EXPORT ProfileData {
+    public:
+      typedef std::map<std::string, FunctionProfile> FunctionMap;
+
+      /**
+       * \brief Fraction of the most frequently called function's calls a
+       * function must receive to be considered hot.
+       */
+      static const unsigned hot_fraction = 10;
+
+      /// \brief Get all functions in this profile.
+      const FunctionMap& functions() const {return m_functions;}
+      const FunctionProfile* lookup(const std::string& name) const;
+      FunctionProfile& get(const std::string& name);
+
+      void merge(const ProfileData& other);
+      void write(std::ostream& os) const;
+      bool read(std::istream& is);
+
+      FunctionHotness hotness(const std::string& name) const;
+      void apply(Module& module) const;
+      std::vector<ProfileCallSite> hot_call_sites(std::size_t limit) const;
+
+    private:
+      FunctionMap m_functions;
+
+      uint64_t max_entry_count() const;
+      static FunctionHotness hotness(const FunctionProfile& profile, uint64_t max_count);
+      void apply_branch_weights(Function& function, const FunctionProfile& profile) const;
+    };
+
+    /**
+     * \brief Inserts execution counters into TVM modules.
+     *
+     * Each function with a body gets a global array of 64-bit counters, with
+     * one entry per block followed by one entry per call instruction.
+     * The counters are incremented non-atomically, as the occasional lost
+     * update in multithreaded code does not matter for optimization.
+     *
+     * Modules passed to instrument() must stay alive until after the last
+     * call to collect().
+     */
+    class PSI_TVM_EXPORT ProfileInstrumentation : public boost::noncopyable {
+      struct FunctionCounters {
+        std::string name;
+        ValuePtr<GlobalVariable> counters;
+        std::size_t n_blocks;
+        std::vector<std::string> call_targets;
+      };
+
+      std::vector<FunctionCounters> m_functions;
+
+      void instrument_function(const ValuePtr<Function>& function);
+
+    public:
+      void instrument(Module& module);
+      void discard(const Module& module);
+      void collect(Jit& jit, ProfileData& profile) const;
+    };
+  }
+}
+
+#endif
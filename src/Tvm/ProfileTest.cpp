@@ -0,0 +1,137 @@
+#include "Test.hpp"
+
+#include "Assembler.hpp"
+#include "Instructions.hpp"
+#include "Jit.hpp"
+#include "Profile.hpp"
+
+#include <sstream>
+
+namespace Psi {
+  namespace Tvm {
+    PSI_TEST_SUITE_FIXTURE(ProfileTest, Test::ContextFixture)
+
+    namespace {
+      const char *profile_src =
+        "%callee = function (%x : i32) > i32 {\n"
+        "  return (add %x #i1);\n"
+        "};\n"
+        "\n"
+        "%never = export function (%x : i32) > i32 {\n"
+        "  %y = call %callee %x;\n"
+        "  return %y;\n"
+        "};\n"
+        "\n"
+        "%f = export function (%n : i32) > i32 {\n"
+        "  br %loop;\n"
+        "block %loop:\n"
+        "  %i = phi i32: > #i0, %body > (add %i #i1);\n"
+        "  %acc = phi i32: > #i0, %body > %next;\n"
+        "  cond_br (cmp_lt %i %n) %body %exit;\n"
+        "block %body(%loop):\n"
+        "  %next = call %callee %acc;\n"
+        "  br %loop;\n"
+        "block %exit(%loop):\n"
+        "  return %acc;\n"
+        "};\n";
+
+      typedef Jit::Int32 (*ProfileFunction) (Jit::Int32);
+    }
+
+    /*
+     * Counters are incremented once per block entry and call, and
+     * survive a write/read round trip.
+     */
+    PSI_TEST_CASE(InstrumentTest) {
+      AssemblerResult r = parse_and_build(module, location.physical, profile_src);
+      ProfileInstrumentation instrumentation;
+      instrumentation.instrument(module);
+      jit().add_module(&module);
+
+      ProfileFunction f = reinterpret_cast<ProfileFunction>(jit().get_symbol(value_cast<Global>(r["f"])));
+      PSI_TEST_CHECK_EQUAL(f(100), 100);
+      PSI_TEST_CHECK_EQUAL(f(5), 5);
+
+      ProfileData profile;
+      instrumentation.collect(jit(), profile);
+
+      const FunctionProfile *fp = profile.lookup("f");
+      PSI_TEST_REQUIRE(fp);
+      PSI_TEST_REQUIRE(fp->block_counts.size() == 4);
+      PSI_TEST_CHECK_EQUAL(fp->block_counts[0], 2u);
+      PSI_TEST_CHECK_EQUAL(fp->block_counts[1], 107u);
+      PSI_TEST_CHECK_EQUAL(fp->block_counts[2], 105u);
+      PSI_TEST_CHECK_EQUAL(fp->block_counts[3], 2u);
+      PSI_TEST_REQUIRE(fp->call_counts.size() == 1);
+      PSI_TEST_CHECK_EQUAL(fp->call_counts[0], 105u);
+      PSI_TEST_CHECK_EQUAL(fp->call_targets[0], "callee");
+      PSI_TEST_CHECK_EQUAL(profile.lookup("callee")->entry_count(), 105u);
+      PSI_TEST_CHECK_EQUAL(profile.lookup("never")->entry_count(), 0u);
+
+      std::stringstream ss;
+      profile.write(ss);
+      ProfileData copy;
+      PSI_TEST_REQUIRE(copy.read(ss));
+      PSI_TEST_CHECK(copy.lookup("f")->block_counts == fp->block_counts);
+      PSI_TEST_CHECK(copy.lookup("never")->call_targets == profile.lookup("never")->call_targets);
+
+      // Reading the same profile again accumulates counts
+      std::stringstream ss2(ss.str());
+      PSI_TEST_REQUIRE(copy.read(ss2));
+      PSI_TEST_CHECK_EQUAL(copy.lookup("f")->call_counts[0], 210u);
+
+      std::istringstream bad("function f\nblock x\n");
+      PSI_TEST_CHECK(!copy.read(bad));
+    }
+
+    /*
+     * A profile sets branch weights and function hotness, and
+     * ranks call sites by how often they ran.
+     */
+    PSI_TEST_CASE(ApplyTest) {
+      ProfileData profile;
+      FunctionProfile& f = profile.get("f");
+      f.block_counts.push_back(1);
+      f.block_counts.push_back(101);
+      f.block_counts.push_back(100);
+      f.block_counts.push_back(1);
+      f.call_counts.push_back(100);
+      f.call_targets.push_back("callee");
+      FunctionProfile& callee = profile.get("callee");
+      callee.block_counts.push_back(100);
+      FunctionProfile& never = profile.get("never");
+      never.block_counts.push_back(0);
+      never.call_counts.push_back(0);
+      never.call_targets.push_back("callee");
+
+      AssemblerResult r = parse_and_build(module, location.physical, profile_src);
+      profile.apply(module);
+
+      PSI_TEST_CHECK_EQUAL(value_cast<Function>(r["callee"])->hotness(), hotness_hot);
+      PSI_TEST_CHECK_EQUAL(value_cast<Function>(r["never"])->hotness(), hotness_cold);
+      PSI_TEST_CHECK_EQUAL(value_cast<Function>(r["f"])->hotness(), hotness_normal);
+
+      ValuePtr<Function> f_tvm = value_cast<Function>(r["f"]);
+      Function::BlockList::const_iterator loop = f_tvm->blocks().begin();
+      ++loop;
+      ValuePtr<ConditionalBranch> br = value_cast<ConditionalBranch>((*loop)->instructions().back());
+      PSI_TEST_CHECK_EQUAL(br->true_weight, 100u);
+      PSI_TEST_CHECK_EQUAL(br->false_weight, 1u);
+      PSI_TEST_CHECK(br->is_unlikely(br->false_target));
+
+      std::vector<ProfileCallSite> sites = profile.hot_call_sites(10);
+      PSI_TEST_REQUIRE(sites.size() == 1);
+      PSI_TEST_CHECK_EQUAL(sites[0].caller, "f");
+      PSI_TEST_CHECK_EQUAL(sites[0].callee, "callee");
+      PSI_TEST_CHECK_EQUAL(sites[0].count, 100u);
+      PSI_TEST_CHECK_EQUAL(sites[0].callee_count, 100u);
+
+      // The profiled module still compiles and runs
+      jit().add_module(&module);
+      ProfileFunction fn = reinterpret_cast<ProfileFunction>(jit().get_symbol(f_tvm));
+      PSI_TEST_CHECK_EQUAL(fn(3), 3);
+    }
+
+    PSI_TEST_SUITE_END()
+  }
+}
@@ -0,0 +1,204 @@
+#include "Test.hpp"
+
+#include "Assembler.hpp"
+#include "Instructions.hpp"
+#include "Jit.hpp"
+#include "Number.hpp"
+#include "StackSlots.hpp"
+
+namespace Psi {
+  namespace Tvm {
+    PSI_TEST_SUITE_FIXTURE(StackSlotTest, Test::ContextFixture)
+
+    namespace {
+      /// Sizes of the primitive types used in these tests
+      class TestTargetCallback : public AggregateLoweringPass::TargetCallback {
+      public:
+        virtual TypeSizeAlignment type_size_alignment(const ValuePtr<>& type, const SourceLocation&) {
+          if (ValuePtr<IntegerType> int_type = dyn_cast<IntegerType>(type)) {
+            std::size_t size = (int_type->width() == IntegerType::i8) ? 1 : 4;
+            return TypeSizeAlignment(size, size);
+          } else if (isa<ByteType>(type)) {
+            return TypeSizeAlignment(1, 1);
+          }
+          return TypeSizeAlignment(8, 8);
+        }
+      };
+
+      typedef Jit::Int32 (*SlotFunction) (Jit::Int32);
+
+      std::size_t count_entry_allocas(const ValuePtr<Function>& function) {
+        std::size_t n = 0;
+        const ValuePtr<Block>& entry = function->blocks().front();
+        for (Block::InstructionList::const_iterator ii = entry->instructions().begin(), ie = entry->instructions().end(); ii != ie; ++ii) {
+          if (isa<Alloca>(*ii))
+            ++n;
+        }
+        return n;
+      }
+    }
+
+    /*
+     * Allocas used one after the other inside a loop share one slot
+     * at the start of the function.
+     */
+    PSI_TEST_CASE(DisjointTest) {
+      const char *src =
+        "%f = export function (%n : i32) > i32 {\n"
+        "  br %loop;\n"
+        "block %loop:\n"
+        "  %i = phi i32: > #i0, %body > (add %i #i1);\n"
+        "  %acc = phi i32: > #i0, %body > (add %x %y);\n"
+        "  cond_br (cmp_lt %i %n) %body %exit;\n"
+        "block %body(%loop):\n"
+        "  %a = alloca i32;\n"
+        "  store %acc %a;\n"
+        "  %x = load %a;\n"
+        "  freea %a;\n"
+        "  %b = alloca i32 #up4;\n"
+        "  store %i (pointer_offset %b #up3);\n"
+        "  %y = load (pointer_offset %b #up3);\n"
+        "  freea %b;\n"
+        "  br %loop;\n"
+        "block %exit(%loop):\n"
+        "  return %acc;\n"
+        "};\n";
+
+      AssemblerResult r = parse_and_build(module, location.physical, src);
+      TestTargetCallback callback;
+      StackSlotPass pass(&callback);
+      pass.run(module);
+
+      PSI_TEST_REQUIRE(pass.reports().size() == 1);
+      const StackFrameReport& report = pass.reports().front();
+      PSI_TEST_CHECK_EQUAL(report.n_allocas, 2u);
+      PSI_TEST_CHECK_EQUAL(report.n_slots, 1u);
+      PSI_TEST_CHECK_EQUAL(report.size_before, 20u);
+      PSI_TEST_CHECK_EQUAL(report.size_after, 16u);
+      PSI_TEST_CHECK_EQUAL(count_entry_allocas(value_cast<Function>(r["f"])), 1u);
+
+      jit().add_module(&module);
+      SlotFunction f = reinterpret_cast<SlotFunction>(jit().get_symbol(value_cast<Global>(r["f"])));
+      PSI_TEST_CHECK_EQUAL(f(5), 0 + 1 + 2 + 3 + 4);
+    }
+
+    /*
+     * Nested allocas are both live at once, so keep separate slots,
+     * but are still moved out of the loop.
+     */
+    PSI_TEST_CASE(OverlapTest) {
+      const char *src =
+        "%f = export function (%n : i32) > i32 {\n"
+        "  br %loop;\n"
+        "block %loop:\n"
+        "  %i = phi i32: > #i0, %body > (add %i #i1);\n"
+        "  %acc = phi i32: > #i0, %body > (add %x %y);\n"
+        "  cond_br (cmp_lt %i %n) %body %exit;\n"
+        "block %body(%loop):\n"
+        "  %a = alloca i32;\n"
+        "  %b = alloca i32;\n"
+        "  store %acc %a;\n"
+        "  store %i %b;\n"
+        "  %x = load %a;\n"
+        "  %y = load %b;\n"
+        "  freea %b;\n"
+        "  freea %a;\n"
+        "  br %loop;\n"
+        "block %exit(%loop):\n"
+        "  return %acc;\n"
+        "};\n";
+
+      AssemblerResult r = parse_and_build(module, location.physical, src);
+      TestTargetCallback callback;
+      StackSlotPass pass(&callback);
+      pass.run(module);
+
+      PSI_TEST_REQUIRE(pass.reports().size() == 1);
+      const StackFrameReport& report = pass.reports().front();
+      PSI_TEST_CHECK_EQUAL(report.n_slots, 2u);
+      PSI_TEST_CHECK_EQUAL(report.size_after, 8u);
+      PSI_TEST_CHECK_EQUAL(count_entry_allocas(value_cast<Function>(r["f"])), 2u);
+
+      jit().add_module(&module);
+      SlotFunction f = reinterpret_cast<SlotFunction>(jit().get_symbol(value_cast<Global>(r["f"])));
+      PSI_TEST_CHECK_EQUAL(f(5), 0 + 1 + 2 + 3 + 4);
+    }
+
+    /*
+     * Struct and byte array allocas are sized from their layout, so
+     * can share a slot in the same way as primitive allocas.
+     */
+    PSI_TEST_CASE(AggregateTest) {
+      const char *src =
+        "%s = define struct i32 i8 i32;\n"
+        "%f = export function (%n : i32) > i32 {\n"
+        "  br %loop;\n"
+        "block %loop:\n"
+        "  %i = phi i32: > #i0, %body > (add %i #i1);\n"
+        "  %acc = phi i32: > #i0, %body > (add %x %y);\n"
+        "  cond_br (cmp_lt %i %n) %body %exit;\n"
+        "block %body(%loop):\n"
+        "  %a = alloca %s;\n"
+        "  store %acc (gep %a #up0);\n"
+        "  store %i (gep %a #up2);\n"
+        "  %x = load (gep %a #up0);\n"
+        "  freea %a;\n"
+        "  %b = alloca byte #up8;\n"
+        "  store %i (pointer_cast %b i32);\n"
+        "  %y = load (pointer_cast %b i32);\n"
+        "  freea %b;\n"
+        "  br %loop;\n"
+        "block %exit(%loop):\n"
+        "  return %acc;\n"
+        "};\n";
+
+      AssemblerResult r = parse_and_build(module, location.physical, src);
+      TestTargetCallback callback;
+      StackSlotPass pass(&callback);
+      pass.run(module);
+
+      PSI_TEST_REQUIRE(pass.reports().size() == 1);
+      const StackFrameReport& report = pass.reports().front();
+      PSI_TEST_CHECK_EQUAL(report.n_allocas, 2u);
+      PSI_TEST_CHECK_EQUAL(report.n_slots, 1u);
+      PSI_TEST_CHECK_EQUAL(report.size_before, 20u);
+      PSI_TEST_CHECK_EQUAL(report.size_after, 12u);
+      PSI_TEST_CHECK_EQUAL(count_entry_allocas(value_cast<Function>(r["f"])), 1u);
+
+      jit().add_module(&module);
+      SlotFunction f = reinterpret_cast<SlotFunction>(jit().get_symbol(value_cast<Global>(r["f"])));
+      PSI_TEST_CHECK_EQUAL(f(5), 0 + 1 + 2 + 3 + 4);
+    }
+
+    /*
+     * An alloca which is not freed before it runs again needs new
+     * storage each time, so stays where it is.
+     */
+    PSI_TEST_CASE(UnfreedTest) {
+      const char *src =
+        "%f = export function (%n : i32) > i32 {\n"
+        "  br %loop;\n"
+        "block %loop:\n"
+        "  %i = phi i32: > #i0, %body > (add %i #i1);\n"
+        "  cond_br (cmp_lt %i %n) %body %exit;\n"
+        "block %body(%loop):\n"
+        "  %a = alloca i32;\n"
+        "  store %i %a;\n"
+        "  br %loop;\n"
+        "block %exit(%loop):\n"
+        "  return %i;\n"
+        "};\n";
+
+      AssemblerResult r = parse_and_build(module, location.physical, src);
+      TestTargetCallback callback;
+      StackSlotPass pass(&callback);
+      pass.run(module);
+
+      PSI_TEST_REQUIRE(pass.reports().size() == 1);
+      PSI_TEST_CHECK_EQUAL(pass.reports().front().size_before, pass.reports().front().size_after);
+      PSI_TEST_CHECK_EQUAL(count_entry_allocas(value_cast<Function>(r["f"])), 0u);
+    }
+
+    PSI_TEST_SUITE_END()
+  }
+}
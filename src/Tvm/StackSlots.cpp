@@ -0,0 +1,266 @@
+#include "StackSlots.hpp"
+#include "FunctionalBuilder.hpp"
+#include "InstructionBuilder.hpp"
+#include "Instructions.hpp"
+
+#include <algorithm>
+#include <ostream>
+
+#include <boost/format.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
+namespace Psi {
+  namespace Tvm {
+    struct StackSlotPass::AllocaInfo {
+      ValuePtr<Alloca> insn;
+      std::size_t size;
+      std::size_t alignment;
+      /// \brief Whether this alloca can be moved to the entry block
+      bool movable;
+      /// \brief Indices of allocas which execute while this one is live
+      std::vector<std::size_t> live_at;
+      /// \brief FreeAlloca instructions which release this alloca
+      std::vector<ValuePtr<Instruction> > frees;
+    };
+
+    struct StackSlotPass::Slot {
+      std::size_t size;
+      std::size_t alignment;
+      std::vector<std::size_t> members;
+    };
+
+    namespace {
+      bool constant_unsigned(const ValuePtr<>& value, std::size_t& result) {
+        ValuePtr<IntegerValue> int_val = dyn_cast<IntegerValue>(value);
+        if (!int_val)
+          return false;
+        boost::optional<unsigned> x = int_val->value().unsigned_value();
+        if (!x)
+          return false;
+        result = *x;
+        return true;
+      }
+
+      std::size_t padded_size(std::size_t size, std::size_t alignment) {
+        return alignment ? (size + alignment - 1) / alignment * alignment : size;
+      }
+
+      bool slot_size_greater(const std::pair<std::size_t, std::size_t>& lhs, const std::pair<std::size_t, std::size_t>& rhs) {
+        return lhs.first > rhs.first;
+      }
+    }
+
+    /**
+     * \param target_callback Used to get the size and alignment of
+     * primitive types. This should be the same callback used by the
+     * AggregateLoweringPass which generated the module.
+     */
+    StackSlotPass::StackSlotPass(AggregateLoweringPass::TargetCallback *target_callback)
+    : m_target_callback(target_callback) {
+    }
+
+    /**
+     * \brief Get the size and alignment of an alloca, if they are constant.
+     *
+     * Aggregate element types are laid out by AggregateLoweringPass::lowered_type_size_alignment.
+     */
+    bool StackSlotPass::fixed_size(const ValuePtr<Alloca>& alloca, AllocaInfo& info) {
+      std::size_t count = 1, alignment = 1;
+      if (alloca->count && !constant_unsigned(alloca->count, count))
+        return false;
+      if (alloca->alignment && !constant_unsigned(alloca->alignment, alignment))
+        return false;
+
+      TypeSizeAlignment tsa;
+      if (!AggregateLoweringPass::lowered_type_size_alignment(m_target_callback, alloca->element_type, tsa))
+        return false;
+      info.insn = alloca;
+      info.size = tsa.size * count;
+      info.alignment = std::max(tsa.alignment, alignment);
+      info.movable = true;
+      return info.size > 0;
+    }
+
+    /**
+     * \brief Run this pass on every function defined in a module.
+     */
+    void StackSlotPass::run(Module& module) {
+      for (Module::ModuleMemberList::iterator ii = module.members().begin(), ie = module.members().end(); ii != ie; ++ii) {
+        if (ValuePtr<Function> function = dyn_cast<Function>(ii->second)) {
+          if (!function->blocks().empty())
+            run_function(function);
+        }
+      }
+    }
+
+    void StackSlotPass::run_function(const ValuePtr<Function>& function) {
+      std::vector<AllocaInfo> allocas;
+      boost::unordered_map<ValuePtr<Instruction>, std::size_t> alloca_index;
+      for (Function::BlockList::iterator ii = function->blocks().begin(), ie = function->blocks().end(); ii != ie; ++ii) {
+        for (Block::InstructionList::iterator ji = (*ii)->instructions().begin(), je = (*ii)->instructions().end(); ji != je; ++ji) {
+          if (ValuePtr<Alloca> alloca = dyn_cast<Alloca>(*ji)) {
+            AllocaInfo info;
+            if (fixed_size(alloca, info)) {
+              alloca_index.insert(std::make_pair(alloca, allocas.size()));
+              allocas.push_back(info);
+            }
+          }
+        }
+      }
+
+      for (Function::BlockList::iterator ii = function->blocks().begin(), ie = function->blocks().end(); ii != ie; ++ii) {
+        for (Block::InstructionList::iterator ji = (*ii)->instructions().begin(), je = (*ii)->instructions().end(); ji != je; ++ji) {
+          if (ValuePtr<FreeAlloca> free_insn = dyn_cast<FreeAlloca>(*ji)) {
+            boost::unordered_map<ValuePtr<Instruction>, std::size_t>::const_iterator it = alloca_index.find(value_cast<Instruction>(free_insn->value));
+            if (it != alloca_index.end())
+              allocas[it->second].frees.push_back(free_insn);
+          }
+        }
+      }
+
+      // Find where each alloca is live by following control flow until it is freed
+      for (std::size_t ii = 0, ie = allocas.size(); ii != ie; ++ii) {
+        AllocaInfo& info = allocas[ii];
+        boost::unordered_set<ValuePtr<Instruction> > frees(info.frees.begin(), info.frees.end());
+        boost::unordered_set<ValuePtr<Block> > visited;
+        std::vector<std::pair<ValuePtr<Block>, Block::InstructionList::iterator> > queue;
+        ValuePtr<Block> start_block = info.insn->block();
+        queue.push_back(std::make_pair(start_block, ++start_block->instructions().iterator_to(ValuePtr<Instruction>(info.insn))));
+
+        while (!queue.empty() && info.movable) {
+          ValuePtr<Block> block = queue.back().first;
+          Block::InstructionList::iterator ji = queue.back().second, je = block->instructions().end();
+          queue.pop_back();
+
+          bool freed = false;
+          for (; ji != je; ++ji) {
+            const ValuePtr<Instruction>& insn = *ji;
+            if (frees.count(insn)) {
+              freed = true;
+              break;
+            } else if (insn == info.insn) {
+              // Executed again before being freed, so each execution needs its own storage
+              info.movable = false;
+              break;
+            }
+
+            boost::unordered_map<ValuePtr<Instruction>, std::size_t>::const_iterator it = alloca_index.find(insn);
+            if (it != alloca_index.end())
+              info.live_at.push_back(it->second);
+          }
+
+          if (freed || !info.movable)
+            continue;
+
+          std::vector<ValuePtr<Block> > successors = block->successors();
+          for (std::vector<ValuePtr<Block> >::const_iterator ki = successors.begin(), ke = successors.end(); ki != ke; ++ki) {
+            if (visited.insert(*ki).second)
+              queue.push_back(std::make_pair(*ki, (*ki)->instructions().begin()));
+          }
+        }
+      }
+
+      std::vector<std::vector<char> > conflicts(allocas.size(), std::vector<char>(allocas.size(), 0));
+      for (std::size_t ii = 0, ie = allocas.size(); ii != ie; ++ii) {
+        for (std::vector<std::size_t>::const_iterator ji = allocas[ii].live_at.begin(), je = allocas[ii].live_at.end(); ji != je; ++ji)
+          conflicts[ii][*ji] = conflicts[*ji][ii] = 1;
+      }
+
+      // Assign slots largest first, so that the first member of each slot is its largest
+      std::vector<std::pair<std::size_t, std::size_t> > order;
+      StackFrameReport report;
+      report.function = function->name();
+      report.n_allocas = allocas.size();
+      report.size_before = report.size_after = 0;
+      report.n_slots = 0;
+      for (std::size_t ii = 0, ie = allocas.size(); ii != ie; ++ii) {
+        std::size_t padded = padded_size(allocas[ii].size, allocas[ii].alignment);
+        report.size_before += padded;
+        if (allocas[ii].movable) {
+          order.push_back(std::make_pair(padded, ii));
+        } else {
+          report.size_after += padded;
+          ++report.n_slots;
+        }
+      }
+      std::stable_sort(order.begin(), order.end(), slot_size_greater);
+
+      std::vector<Slot> slots;
+      for (std::vector<std::pair<std::size_t, std::size_t> >::const_iterator ii = order.begin(), ie = order.end(); ii != ie; ++ii) {
+        const AllocaInfo& info = allocas[ii->second];
+        std::vector<Slot>::iterator ji = slots.begin(), je = slots.end();
+        for (; ji != je; ++ji) {
+          bool conflict = false;
+          for (std::vector<std::size_t>::const_iterator ki = ji->members.begin(), ke = ji->members.end(); ki != ke; ++ki) {
+            if (conflicts[ii->second][*ki]) {
+              conflict = true;
+              break;
+            }
+          }
+          if (!conflict)
+            break;
+        }
+
+        if (ji == je) {
+          slots.push_back(Slot());
+          ji = slots.end() - 1;
+          ji->size = ji->alignment = 0;
+        }
+        ji->size = std::max(ji->size, info.size);
+        ji->alignment = std::max(ji->alignment, info.alignment);
+        ji->members.push_back(ii->second);
+      }
+
+      ValuePtr<Block> entry = function->blocks().front();
+      // Remove allocas from their current position before finding the insertion point
+      for (std::vector<Slot>::const_iterator ii = slots.begin(), ie = slots.end(); ii != ie; ++ii) {
+        for (std::vector<std::size_t>::const_iterator ji = ii->members.begin(), je = ii->members.end(); ji != je; ++ji) {
+          AllocaInfo& info = allocas[*ji];
+          for (std::vector<ValuePtr<Instruction> >::const_iterator ki = info.frees.begin(), ke = info.frees.end(); ki != ke; ++ki)
+            (*ki)->remove();
+          info.insn->remove();
+        }
+      }
+
+      InstructionBuilder builder(entry->instructions().front());
+      Function::ValueReplacementMap slot_pointers;
+      for (std::vector<Slot>::const_iterator ii = slots.begin(), ie = slots.end(); ii != ie; ++ii) {
+        report.size_after += padded_size(ii->size, ii->alignment);
+        ++report.n_slots;
+
+        if (ii->members.size() == 1) {
+          const ValuePtr<Alloca>& alloca = allocas[ii->members.front()].insn;
+          entry->insert_instruction(alloca, entry->instructions().front());
+          continue;
+        }
+
+        const SourceLocation& location = allocas[ii->members.front()].insn->location();
+        ValuePtr<> slot = builder.alloca_(FunctionalBuilder::byte_type(function->context(), location),
+                                          FunctionalBuilder::size_value(function->context(), ii->size, location),
+                                          FunctionalBuilder::size_value(function->context(), ii->alignment, location),
+                                          location);
+        for (std::vector<std::size_t>::const_iterator ji = ii->members.begin(), je = ii->members.end(); ji != je; ++ji) {
+          const ValuePtr<Alloca>& alloca = allocas[*ji].insn;
+          slot_pointers.insert(std::make_pair(alloca, FunctionalBuilder::pointer_cast(slot, alloca->element_type, alloca->location())));
+        }
+      }
+
+      if (!slot_pointers.empty())
+        function->replace_values(slot_pointers);
+
+      m_reports.push_back(report);
+    }
+
+    /**
+     * \brief Write one line per function giving its stack usage before and after this pass.
+     */
+    void StackSlotPass::write_report(std::ostream& os) const {
+      for (std::vector<StackFrameReport>::const_iterator ii = m_reports.begin(), ie = m_reports.end(); ii != ie; ++ii) {
+        if (ii->n_allocas)
+          os << boost::format("%s: %u allocas in %u slots, frame %u -> %u bytes\n")
+            % ii->function % ii->n_allocas % ii->n_slots % ii->size_before % ii->size_after;
+      }
+    }
+  }
+}
@@ -0,0 +1,81 @@
+#ifndef HPP_PSI_TVM_STACKSLOTS
+#define HPP_PSI_TVM_STACKSLOTS
+
+#include "AggregateLowering.hpp"
+#include "Function.hpp"
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/**
+ * \file
+ *
+ * Stack slot allocation: moving fixed size allocas to the start of
+ * a function and sharing storage between allocas whose lifetimes
+ * do not overlap.
+ */
+
+namespace Psi {
+  namespace Tvm {
+    class Alloca;
+
+    /**
+     * \brief Stack usage of one function before and after StackSlotPass.
+     *
+     * Only fixed size allocas are counted. Sizes include padding
+     * to each allocation's alignment.
+     */
+    struct StackFrameReport {
+      /// \brief Function name.
+      std::string function;
+      /// \brief Number of fixed size allocas.
+      std::size_t n_allocas;
+      /// \brief Number of allocas remaining after slots were shared.
+      std::size_t n_slots;
+      /// \brief Bytes allocated by fixed size allocas before this pass.
+      std::size_t size_before;
+      /// \brief Bytes allocated by fixed size allocas after this pass.
+      std::size_t size_after;
+    };
+
+    /**
+     * \brief Hoists fixed size allocas to the entry block and shares
+     * storage between those with disjoint lifetimes.
+     *
+     * Allocas are created where they are used and released by FreeAlloca,
+     * so an alloca inside a loop adjusts the stack on every iteration and
+     * every alloca gets its own storage. This pass runs on the output of
+     * AggregateLoweringPass; allocas there may still have struct, array or
+     * byte element types, and are included as long as their size is constant.
+     *
+     * An alloca is live from the point it executes until a FreeAlloca of
+     * it; an alloca which can be reached again before being freed is left
+     * where it is. Two allocas conflict if either is live where the other
+     * executes; each group of allocas which do not conflict is replaced by
+     * a single byte array at the start of the function, and the FreeAlloca
+     * instructions which released them are removed.
+     */
+    class PSI_TVM_EXPORT StackSlotPass : public boost::noncopyable {
+      struct AllocaInfo;
+      struct Slot;
+
+      AggregateLoweringPass::TargetCallback *m_target_callback;
+      std::vector<StackFrameReport> m_reports;
+
+      bool fixed_size(const ValuePtr<Alloca>& alloca, AllocaInfo& info);
+      void run_function(const ValuePtr<Function>& function);
+
+    public:
+      StackSlotPass(AggregateLoweringPass::TargetCallback *target_callback);
+
+      void run(Module& module);
+
+      /// \brief Get the stack usage of each function processed so far.
+      const std::vector<StackFrameReport>& reports() const {return m_reports;}
+      void write_report(std::ostream& os) const;
+    };
+  }
+}
+
+#endif
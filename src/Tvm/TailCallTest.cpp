@@ -0,0 +1,170 @@
+#include "Test.hpp"
+
+#include "Assembler.hpp"
+#include "Jit.hpp"
+
+namespace Psi {
+  namespace Tvm {
+    PSI_TEST_SUITE_FIXTURE(TailCallTest, Test::ContextFixture)
+
+    namespace {
+      /// Deep enough to overflow the stack if every call used a new frame
+      const Jit::UInt32 recursion_depth = 1000000;
+
+      Jit::UInt32 fibonacci(Jit::UInt32 n) {
+        Jit::UInt32 a = 0, b = 1;
+        for (; n; --n) {
+          Jit::UInt32 c = a + b;
+          a = b;
+          b = c;
+        }
+        return a;
+      }
+    }
+
+    /*
+     * Self recursion where the arguments of the recursive call depend on
+     * each other's old values.
+     */
+    PSI_TEST_CASE(SelfRecursionTest) {
+      const char *src =
+        "%fib = export function (%n : ui32, %a : ui32, %b : ui32) > ui32 {\n"
+        "  cond_br (cmp_eq %n #ui0) %done %recurse;\n"
+        "block %done:\n"
+        "  return %a;\n"
+        "block %recurse:\n"
+        "  %r = call tail %fib (sub %n #ui1) %b (add %a %b);\n"
+        "  return %r;\n"
+        "};\n";
+
+      typedef Jit::UInt32 (*FunctionType) (Jit::UInt32, Jit::UInt32, Jit::UInt32);
+      FunctionType f = reinterpret_cast<FunctionType>(jit_single("fib", src));
+      PSI_TEST_CHECK_EQUAL(f(10, 0, 1), 55u);
+      PSI_TEST_CHECK_EQUAL(f(recursion_depth, 0, 1), fibonacci(recursion_depth));
+    }
+
+    PSI_TEST_CASE(MustTailTest) {
+      const char *src =
+        "%count = export function (%n : ui32, %acc : ui32) > ui32 {\n"
+        "  cond_br (cmp_eq %n #ui0) %done %recurse;\n"
+        "block %done:\n"
+        "  return %acc;\n"
+        "block %recurse:\n"
+        "  %r = call musttail %count (sub %n #ui1) (add %acc #ui2);\n"
+        "  return %r;\n"
+        "};\n";
+
+      typedef Jit::UInt32 (*FunctionType) (Jit::UInt32, Jit::UInt32);
+      FunctionType f = reinterpret_cast<FunctionType>(jit_single("count", src));
+      PSI_TEST_CHECK_EQUAL(f(recursion_depth, 1), 2 * recursion_depth + 1);
+    }
+
+    /*
+     * A tail call returning nothing, where the result is not passed
+     * directly to the return instruction.
+     */
+    PSI_TEST_CASE(EmptyResultTest) {
+      const char *src =
+        "%fill = export function (%p : pointer ui32, %n : ui32) > empty {\n"
+        "  cond_br (cmp_eq %n #ui0) %done %recurse;\n"
+        "block %done:\n"
+        "  return empty_v;\n"
+        "block %recurse:\n"
+        "  %x = load %p;\n"
+        "  store (add %x %n) %p;\n"
+        "  call musttail %fill %p (sub %n #ui1);\n"
+        "  return empty_v;\n"
+        "};\n";
+
+      typedef void (*FunctionType) (Jit::UInt32*, Jit::UInt32);
+      FunctionType f = reinterpret_cast<FunctionType>(jit_single("fill", src));
+      Jit::UInt32 x = 0;
+      f(&x, recursion_depth);
+      PSI_TEST_CHECK_EQUAL(x, Jit::UInt32(recursion_depth / 2 * (recursion_depth + 1)));
+    }
+
+    /*
+     * Tail calls between different functions are only guaranteed by some
+     * backends, so this only checks the result at a modest depth.
+     */
+    PSI_TEST_CASE(MutualRecursionTest) {
+      const char *src =
+        "%even = export function (%n : ui32) > ui32 {\n"
+        "  cond_br (cmp_eq %n #ui0) %done %recurse;\n"
+        "block %done:\n"
+        "  return #ui1;\n"
+        "block %recurse:\n"
+        "  %r = call tail %odd (sub %n #ui1);\n"
+        "  return %r;\n"
+        "};\n"
+        "%odd = function (%n : ui32) > ui32 {\n"
+        "  cond_br (cmp_eq %n #ui0) %done %recurse;\n"
+        "block %done:\n"
+        "  return #ui0;\n"
+        "block %recurse:\n"
+        "  %r = call tail %even (sub %n #ui1);\n"
+        "  return %r;\n"
+        "};\n";
+
+      typedef Jit::UInt32 (*FunctionType) (Jit::UInt32);
+      FunctionType f = reinterpret_cast<FunctionType>(jit_single("even", src));
+      PSI_TEST_CHECK_EQUAL(f(1000), 1u);
+      PSI_TEST_CHECK_EQUAL(f(1001), 0u);
+    }
+
+    /*
+     * A required tail call to another function which returns nothing, so
+     * the return instruction does not use the result of the call.
+     */
+    PSI_TEST_CASE(EmptyResultMutualRecursionTest) {
+      const char *src =
+        "%count_even = export function (%p : pointer ui32, %n : ui32) > empty {\n"
+        "  cond_br (cmp_eq %n #ui0) %done %recurse;\n"
+        "block %done:\n"
+        "  return empty_v;\n"
+        "block %recurse:\n"
+        "  %x = load %p;\n"
+        "  store (add %x #ui2) %p;\n"
+        "  call musttail %count_odd %p (sub %n #ui1);\n"
+        "  return empty_v;\n"
+        "};\n"
+        "%count_odd = function (%p : pointer ui32, %n : ui32) > empty {\n"
+        "  cond_br (cmp_eq %n #ui0) %done %recurse;\n"
+        "block %done:\n"
+        "  return empty_v;\n"
+        "block %recurse:\n"
+        "  %x = load %p;\n"
+        "  store (add %x #ui1) %p;\n"
+        "  call musttail %count_even %p (sub %n #ui1);\n"
+        "  return empty_v;\n"
+        "};\n";
+
+      typedef void (*FunctionType) (Jit::UInt32*, Jit::UInt32);
+      FunctionType f = reinterpret_cast<FunctionType>(jit_single("count_even", src));
+      Jit::UInt32 x = 0;
+      f(&x, 1001);
+      PSI_TEST_CHECK_EQUAL(x, 1502u);
+    }
+
+    /*
+     * A tail call must be followed by a return of its result.
+     */
+    PSI_TEST_CASE(ValidationTest) {
+      const char *src =
+        "%f = function (%n : ui32) > ui32 {\n"
+        "  %r = call tail %f %n;\n"
+        "  return (add %r #ui1);\n"
+        "};\n";
+
+      bool failed = false;
+      try {
+        parse_and_build(module, location.physical, src);
+      } catch (CompileException&) {
+        failed = true;
+      }
+      PSI_TEST_CHECK(failed);
+    }
+
+    PSI_TEST_SUITE_END()
+  }
+}
@@ -27,7 +27,14 @@ namespace {
     }
   };
 
-  JitLoader jit_loader;
+  /**
+   * Load the default JIT on first use, so that programs which pick
+   * their own JIT do not need a working default configuration.
+   */
+  const boost::shared_ptr<Psi::Tvm::JitFactory>& default_jit_factory() {
+    static JitLoader jit_loader;
+    return jit_loader.jit_factory;
+  }
 }
 
 namespace Psi {
@@ -51,7 +58,18 @@ namespace Psi {
       error_context(&std::cerr),
       context(&error_context),
       module(&context, "test_module", location),
-      m_jit(jit_loader.jit_factory->create_jit()) {
+      m_jit(default_jit_factory()->create_jit()) {
+      }
+
+      /**
+       * Construct a fixture which compiles using a specific JIT.
+       */
+      ContextFixture::ContextFixture(const boost::shared_ptr<JitFactory>& jit_factory)
+      : location(module_location()),
+      error_context(&std::cerr),
+      context(&error_context),
+      module(&context, "test_module", location),
+      m_jit(jit_factory->create_jit()) {
       }
 
       ContextFixture::~ContextFixture() {
@@ -19,9 +19,12 @@ namespace Psi {
         Module module;
 
         ContextFixture();
+        explicit ContextFixture(const boost::shared_ptr<JitFactory>& jit_factory);
         ~ContextFixture();
 
         void* jit_single(const char *name, const char *src);
+        /// \brief JIT used by jit_single().
+        Jit& jit() {return *m_jit;}
 
       private:
         class DebugListener;
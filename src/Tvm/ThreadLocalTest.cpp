@@ -0,0 +1,63 @@
+#include "Test.hpp"
+
+#include "Jit.hpp"
+#include "../Platform/Platform.hpp"
+
+#include <vector>
+
+namespace Psi {
+  namespace Tvm {
+    PSI_TEST_SUITE_FIXTURE(ThreadLocalTest, Test::ContextFixture)
+
+    namespace {
+      typedef Jit::Int32 (*ThreadLocalFunction) (Jit::Int32);
+
+      struct ThreadLocalThreadData {
+        ThreadLocalFunction f;
+        std::vector<Jit::Int32> results;
+      };
+
+      void thread_local_thread(void *arg, unsigned index) {
+        ThreadLocalThreadData *data = static_cast<ThreadLocalThreadData*>(arg);
+        Jit::Int32 result = 0;
+        for (unsigned ii = 0; ii != 10000; ++ii)
+          result = data->f(index + 1);
+        data->results[index] = result;
+      }
+    }
+
+    /*
+     * Each thread sees its own copy of a thread local global,
+     * starting from the initial value.
+     */
+    PSI_TEST_CASE(PerThreadCopyTest) {
+      const char *src =
+        "%counter = global thread_local i32 #i5;\n"
+        "%f = export function (%n : i32) > i32 {\n"
+        "  %old = load %counter;\n"
+        "  %new = add %old %n;\n"
+        "  store %new %counter;\n"
+        "  return %new;\n"
+        "};\n";
+
+      const unsigned n_threads = 4;
+      ThreadLocalThreadData data;
+      try {
+        data.f = reinterpret_cast<ThreadLocalFunction>(jit_single("f", src));
+      } catch (CompileException&) {
+        // The LLVM JIT and TCC reject thread local globals rather than miscompile them
+        return;
+      }
+      data.results.resize(n_threads);
+
+      Platform::run_threads(n_threads, thread_local_thread, &data);
+
+      for (unsigned ii = 0; ii != n_threads; ++ii)
+        PSI_TEST_CHECK_EQUAL(data.results[ii], Jit::Int32(5 + 10000 * (ii + 1)));
+      // The calling thread's copy is untouched
+      PSI_TEST_CHECK_EQUAL(data.f(0), 5);
+    }
+
+    PSI_TEST_SUITE_END()
+  }
+}
@@ -2,9 +2,14 @@
 #include "CModule.hpp"
 
 #include "../AggregateLowering.hpp"
+#include "../Devirtualize.hpp"
 #include "../FunctionalBuilder.hpp"
+#include "../Instructions.hpp"
+#include "../StackSlots.hpp"
 
+#include <algorithm>
 #include <list>
+#include <set>
 #include <iostream>
 #include <sstream>
 #include <boost/format.hpp>
@@ -19,7 +24,7 @@ class CModuleCallback : public AggregateLoweringPass::TargetCallback {
 public:
   CModuleCallback(CCompiler *c_compiler) : m_c_compiler(c_compiler) {}
   
-  virtual TypeSizeAlignment type_size_alignment(const ValuePtr<>& type, const SourceLocation& PSI_UNUSED(location)) {
+  virtual TypeSizeAlignment type_size_alignment(const ValuePtr<>& type, const SourceLocation& location) {
     const PrimitiveType *pt;
     if (ValuePtr<IntegerType> int_type = dyn_cast<IntegerType>(type)) {
       pt = &m_c_compiler->primitive_types.int_types[int_type->width()];
@@ -27,6 +32,11 @@ public:
       pt = &m_c_compiler->primitive_types.float_types[float_type->width()];
     } else if (isa<ByteType>(type) || isa<BooleanType>(type)) {
       return TypeSizeAlignment(1,1);
+    } else if (ValuePtr<VectorType> vector_type = dyn_cast<VectorType>(type)) {
+      // GCC vector types are aligned to their size
+      TypeSizeAlignment element = type_size_alignment(vector_type->element_type(), location);
+      unsigned size = element.size * vector_type->length();
+      return TypeSizeAlignment(size, size);
     } else if (isa<PointerType>(type)) {
       return TypeSizeAlignment(m_c_compiler->primitive_types.pointer_size, m_c_compiler->primitive_types.pointer_alignment);
     } else if (isa<EmptyType>(type)) {
@@ -47,7 +57,12 @@ CModuleBuilder::CModuleBuilder(CCompiler* c_compiler, Module& module)
 m_module(&module),
 m_c_module(m_c_compiler, &module.context().error_context(), module.location()),
 m_type_builder(&m_c_module),
-m_global_value_builder(&m_type_builder) {
+m_global_value_builder(&m_type_builder),
+devirtualize(true),
+stack_slots(true),
+stack_slot_report(false),
+inline_memcpy_limit(16),
+inline_memzero_limit(32) {
 }
 
 std::string CModuleBuilder::run() {
@@ -55,8 +70,21 @@ std::string CModuleBuilder::run() {
   AggregateLoweringPass aggregate_lowering_pass(m_module, &lowering_callback);
   aggregate_lowering_pass.remove_unions = false;
   aggregate_lowering_pass.memcpy_to_bytes = true;
+  aggregate_lowering_pass.inline_memcpy_limit = inline_memcpy_limit;
+  aggregate_lowering_pass.inline_memzero_limit = inline_memzero_limit;
+  aggregate_lowering_pass.scalarize_vectors = !m_c_compiler->has_vector_extensions;
   aggregate_lowering_pass.update();
   
+  if (devirtualize)
+    DevirtualizePass().run(*aggregate_lowering_pass.target_module());
+  
+  if (stack_slots) {
+    StackSlotPass stack_slot_pass(&lowering_callback);
+    stack_slot_pass.run(*aggregate_lowering_pass.target_module());
+    if (stack_slot_report)
+      stack_slot_pass.write_report(std::cerr);
+  }
+  
   std::map<ValuePtr<Global>, unsigned> constructor_priorities(m_module->constructors().begin(), m_module->constructors().end());
   std::map<ValuePtr<Global>, unsigned> destructor_priorities(m_module->destructors().begin(), m_module->destructors().end());
 
@@ -81,6 +109,7 @@ std::string CModuleBuilder::run() {
     case term_function: {
       ValuePtr<Function> func = value_cast<Function>(rewritten_term);
       CFunction *c_func = m_c_module.new_function(&term->location(), type, name);
+      c_func->hotness = func->hotness();
 
       std::map<ValuePtr<Global>, unsigned>::const_iterator jt = constructor_priorities.find(term);
       if (jt != constructor_priorities.end())
@@ -105,6 +134,9 @@ std::string CModuleBuilder::run() {
     CGlobalVariable* c_gv = ii->second;
     c_gv->value = m_global_value_builder.build(gv->value());
     c_gv->is_const = gv->constant();
+    c_gv->is_thread_local = gv->is_thread_local();
+    if (gv->is_thread_local() && !m_c_compiler->has_thread_local)
+      m_module->context().error_context().error_throw(gv->location(), "C compiler does not support thread local variables");
     c_gv->linkage = gv->linkage();
     if (gv->alignment()) {
       ValuePtr<IntegerValue> int_alignment = dyn_cast<IntegerValue>(gv->alignment());
@@ -147,15 +179,47 @@ namespace {
   }
   
   typedef std::multimap<ValuePtr<Block>, ValuePtr<Block> > BlockDominatorMap;
+  typedef std::set<ValuePtr<Block> > BlockSet;
   
+  /**
+   * Emit blocks in depth first order of the dominator tree. Children of each
+   * block which are only reached on unlikely paths are emitted after their
+   * siblings, which moves them out of line without breaking the dominator
+   * order required by C scoping.
+   */
   void depth_first_block_order(std::vector<ValuePtr<Block> >& order,
                                const ValuePtr<Block>& block,
-                               const BlockDominatorMap& blocks_by_dominator) {
+                               const BlockDominatorMap& blocks_by_dominator,
+                               const BlockSet& cold_blocks) {
     std::pair<BlockDominatorMap::const_iterator, BlockDominatorMap::const_iterator> range = blocks_by_dominator.equal_range(block);
-    for (BlockDominatorMap::const_iterator ii = range.first; ii != range.second; ++ii) {
-      order.push_back(ii->second);
-      depth_first_block_order(order, ii->second, blocks_by_dominator);
+    for (unsigned cold = 0; cold != 2; ++cold) {
+      for (BlockDominatorMap::const_iterator ii = range.first; ii != range.second; ++ii) {
+        if (bool(cold) == bool(cold_blocks.count(ii->second))) {
+          order.push_back(ii->second);
+          depth_first_block_order(order, ii->second, blocks_by_dominator, cold_blocks);
+        }
+      }
+    }
+  }
+  
+  /// Find blocks which are only ever entered through unlikely edges of conditional branches
+  void find_cold_blocks(BlockSet& cold_blocks, const ValuePtr<Function>& function) {
+    BlockSet hot_blocks;
+    for (Function::BlockList::iterator ii = function->blocks().begin(), ie = function->blocks().end(); ii != ie; ++ii) {
+      const ValuePtr<Block>& block = *ii;
+      if (block->instructions().empty())
+        continue;
+      const ValuePtr<Instruction>& terminator = block->instructions().back();
+      if (ValuePtr<ConditionalBranch> cond_br = dyn_cast<ConditionalBranch>(terminator)) {
+        (cond_br->is_unlikely(cond_br->true_target) ? cold_blocks : hot_blocks).insert(cond_br->true_target);
+        (cond_br->is_unlikely(cond_br->false_target) ? cold_blocks : hot_blocks).insert(cond_br->false_target);
+      } else if (ValuePtr<UnconditionalBranch> br = dyn_cast<UnconditionalBranch>(terminator)) {
+        hot_blocks.insert(br->target);
+      }
     }
+    
+    for (BlockSet::const_iterator ii = hot_blocks.begin(), ie = hot_blocks.end(); ii != ie; ++ii)
+      cold_blocks.erase(*ii);
   }
 }
 
@@ -172,8 +236,11 @@ void CModuleBuilder::build_function_body(const ValuePtr<Function>& function, CFu
     blocks_by_dominator.insert(std::make_pair(block->dominator(), block));
   }
   
+  BlockSet cold_blocks;
+  find_cold_blocks(cold_blocks, function);
+  
   std::vector<ValuePtr<Block> > block_order;
-  depth_first_block_order(block_order, ValuePtr<Block>(), blocks_by_dominator);
+  depth_first_block_order(block_order, ValuePtr<Block>(), blocks_by_dominator, cold_blocks);
   PSI_ASSERT(block_order.size() == function->blocks().size());
   
   // Insert function parameters into builder
@@ -227,6 +294,8 @@ void CModuleBuilder::build_function_body(const ValuePtr<Function>& function, CFu
         CType *type = m_type_builder.build(phi->type());
         CExpression *temporary_value = block_builder.phi_get(*ji);
         CExpression *phi_value = block_builder.c_builder().declare(&phi->location(), type, c_op_declare, temporary_value, 0);
+        // The variable holds the value of the PHI node, not an object the value points to
+        phi_value->lvalue = false;
         block_builder.put(*ji, phi_value);
       }
     }
@@ -242,6 +311,16 @@ void CModuleBuilder::build_function_body(const ValuePtr<Function>& function, CFu
 CJit::CJit(CompileErrorContext& error_context, const boost::shared_ptr<CCompiler>& compiler, const Psi::PropertyValue& configuration)
 : m_error_context(&error_context), m_compiler(compiler) {
   m_dump_code = configuration.path_bool("jit_dump");
+  const PropertyValue *devirtualize = configuration.path_value_ptr("devirtualize");
+  m_devirtualize = !devirtualize || devirtualize->path_bool("");
+  const PropertyValue *stack_slots = configuration.path_value_ptr("stack_slots");
+  m_stack_slots = !stack_slots || stack_slots->path_bool("");
+  m_stack_slot_report = configuration.path_bool("stack_slot_report");
+  boost::optional<int> inline_memcpy_limit = configuration.path_int("inline_memcpy_limit");
+  m_inline_memcpy_limit = inline_memcpy_limit ? std::max(*inline_memcpy_limit, 0) : 16;
+  boost::optional<int> inline_memzero_limit = configuration.path_int("inline_memzero_limit");
+  m_inline_memzero_limit = inline_memzero_limit ? std::max(*inline_memzero_limit, 0) : 32;
+  m_perf_map = JitPerfMap::get(configuration);
 }
 
 CJit::~CJit() {
@@ -252,11 +331,23 @@ void CJit::destroy() {
 }
 
 void CJit::add_module(Module *module) {
-  std::string source = CModuleBuilder(m_compiler.get(), *module).run();
+  CModuleBuilder builder(m_compiler.get(), *module);
+  builder.devirtualize = m_devirtualize;
+  builder.stack_slots = m_stack_slots;
+  builder.stack_slot_report = m_stack_slot_report;
+  builder.inline_memcpy_limit = m_inline_memcpy_limit;
+  builder.inline_memzero_limit = m_inline_memzero_limit;
+  std::string source = builder.run();
   if (m_dump_code)
     std::cerr << source;
   boost::shared_ptr<Platform::PlatformLibrary> lib = m_compiler->compile_load_library(error_context().bind(module->location()), source);
   m_modules.insert(std::make_pair(module, lib));
+  
+  if (m_perf_map) {
+    JitPerfMap::SymbolList& symbols = m_perf_symbols[module];
+    symbols = perf_symbols(module, *lib);
+    m_perf_map->add(symbols);
+  }
 }
 
 void CJit::remove_module(Module *module) {
@@ -264,6 +355,60 @@ void CJit::remove_module(Module *module) {
   if (it == m_modules.end())
     error_context().error_throw(module->location(), "Module cannot be removed from this JIT because it has not been added");
   m_modules.erase(it);
+  
+  PerfSymbolMap::iterator jt = m_perf_symbols.find(module);
+  if (jt != m_perf_symbols.end()) {
+    m_perf_map->remove(jt->second);
+    m_perf_symbols.erase(jt);
+  }
+}
+
+namespace {
+  bool symbol_start_less(const JitPerfMap::Symbol& lhs, const JitPerfMap::Symbol& rhs) {
+    return lhs.start < rhs.start;
+  }
+}
+
+/**
+ * \brief Find the address and size of each function in a compiled module.
+ * 
+ * Functions are found by symbol lookup, so only exported functions are
+ * listed; private and local functions are compiled with hidden visibility.
+ * 
+ * Where the platform cannot report symbol sizes (for instance, code
+ * compiled in memory by tcclib) they are estimated from the distance to
+ * the next function.
+ */
+JitPerfMap::SymbolList CJit::perf_symbols(Module *module, Platform::PlatformLibrary& library) {
+  // Size assumed for the last function in a module when no better estimate is available
+  const std::size_t default_size = 256;
+  
+  JitPerfMap::SymbolList result;
+  for (Module::ModuleMemberList::iterator ii = module->members().begin(), ie = module->members().end(); ii != ie; ++ii) {
+    if (!isa<Function>(ii->second) || (ii->second->linkage() == link_import))
+      continue;
+    boost::optional<void*> ptr = library.symbol(ii->second->name());
+    if (!ptr)
+      continue;
+    
+    JitPerfMap::Symbol sym;
+    sym.start = *ptr;
+    sym.size = Platform::symbol_size(*ptr).get_value_or(0);
+    sym.name = ii->second->name();
+    result.push_back(sym);
+  }
+  
+  std::sort(result.begin(), result.end(), symbol_start_less);
+  for (std::size_t ii = 0, ie = result.size(); ii != ie; ++ii) {
+    if (!result[ii].size) {
+      if (ii + 1 != ie)
+        result[ii].size = static_cast<const char*>(result[ii+1].start) - static_cast<const char*>(result[ii].start);
+      else
+        result[ii].size = default_size;
+    }
+  }
+  
+  return result;
 }
 
 void* CJit::get_symbol(const ValuePtr<Global>& symbol) {
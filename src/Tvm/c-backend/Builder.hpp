@@ -45,6 +45,16 @@ public:
   bool has_variable_length_arrays;
   /// \brief Has designated initializer support
   bool has_designated_initializer;
+  /// \brief Has GCC style vector types and \c __builtin_convertvector
+  bool has_vector_extensions;
+  /// \brief Has GCC style \c __atomic builtins
+  bool has_atomic_builtins;
+  /// \brief Supports thread local variables
+  bool has_thread_local;
+  /// \brief Has GCC style \c __builtin_expect
+  bool has_builtin_expect;
+  /// \brief Has the \c musttail statement attribute, which guarantees a call in a return statement is a tail call
+  bool has_attribute_musttail;
   /// \brief Supported primitive types
   PrimitiveTypeSet primitive_types;
   
@@ -56,6 +66,27 @@ public:
   virtual void emit_alignment(CModuleEmitter& emitter, unsigned n) = 0;
   
   virtual bool emit_unreachable(CModuleEmitter& emitter);
+  
+  /**
+   * \brief Emit the storage class specifier for a thread local variable.
+   * 
+   * Only called if \c has_thread_local is set.
+   */
+  virtual void emit_thread_local(CModuleEmitter& emitter);
+  
+  /**
+   * \brief Emit the qualifier which marks a pointer parameter as not aliased.
+   * 
+   * This follows the pointer declarator and precedes the parameter name.
+   */
+  virtual void emit_restrict(CModuleEmitter& emitter);
+  
+  /**
+   * \brief Emit the attribute which makes a typedef a vector type.
+   * 
+   * Only called if \c has_vector_extensions is set.
+   */
+  virtual void emit_vector_attribute(CModuleEmitter& emitter, unsigned size);
 
   /// \brief Emit function attributes
   virtual void emit_function_attributes(CModuleEmitter& emitter, CFunction *function) = 0;
@@ -114,6 +145,8 @@ public:
 class ValueBuilder {
   TypeBuilder *m_type_builder;
   CExpressionBuilder m_c_builder;
+  /// Module level builder, whose values are visible to this one but not copied into it; NULL for the module level builder itself
+  const ValueBuilder *m_global;
   typedef boost::unordered_map<ValuePtr<>, CExpression*> ExpressionMapType;
   ExpressionMapType m_expressions;
   typedef boost::unordered_map<ValuePtr<Phi>, CExpression*> PhiMapType;
@@ -154,6 +187,17 @@ class CModuleBuilder {
 public:
   CModuleBuilder(CCompiler *c_compiler, Module& module);
   std::string run();
+  
+  /// \brief Call functions loaded from constant interface tables directly, see DevirtualizePass
+  bool devirtualize;
+  /// \brief Hoist fixed size allocas and share their storage, see StackSlotPass
+  bool stack_slots;
+  /// \brief Write the stack usage of each function to standard error
+  bool stack_slot_report;
+  /// \brief Largest memcpy to replace with loads and stores, see AggregateLoweringPass::inline_memcpy_limit
+  std::size_t inline_memcpy_limit;
+  /// \brief Largest memzero to replace with stores, see AggregateLoweringPass::inline_memzero_limit
+  std::size_t inline_memzero_limit;
 };
 
 class CJit : public Jit {
@@ -162,6 +206,13 @@ class CJit : public Jit {
   ModuleMap m_modules;
   boost::shared_ptr<CCompiler> m_compiler;
   bool m_dump_code;
+  bool m_devirtualize, m_stack_slots, m_stack_slot_report;
+  std::size_t m_inline_memcpy_limit, m_inline_memzero_limit;
+  JitPerfMap *m_perf_map;
+  typedef std::map<Module*, JitPerfMap::SymbolList> PerfSymbolMap;
+  PerfSymbolMap m_perf_symbols;
+  
+  static JitPerfMap::SymbolList perf_symbols(Module *module, Platform::PlatformLibrary& library);
   
 public:
   CJit(CompileErrorContext& error_conext, const boost::shared_ptr<CCompiler>& compiler, const Psi::PropertyValue& configuration);
@@ -17,11 +17,28 @@ namespace CBackend {
 CCompiler::CCompiler() {
   has_variable_length_arrays = false;
   has_designated_initializer = false;
+  has_vector_extensions = false;
+  has_atomic_builtins = false;
+  has_thread_local = false;
+  has_builtin_expect = false;
+  has_attribute_musttail = false;
+}
+
+void CCompiler::emit_thread_local(CModuleEmitter& PSI_UNUSED(emitter)) {
+  PSI_FAIL("Thread local variables are not supported by this C compiler");
+}
+
+void CCompiler::emit_vector_attribute(CModuleEmitter& PSI_UNUSED(emitter), unsigned PSI_UNUSED(size)) {
+  PSI_FAIL("Vector types should have been scalarized for this C compiler");
 }
 
 void CCompiler::emit_alignment(CModuleEmitter& PSI_UNUSED(emitter), unsigned PSI_UNUSED(alignment)) {
 }
 
+void CCompiler::emit_restrict(CModuleEmitter& emitter) {
+  emitter.output() << "restrict ";
+}
+
 /**
  * \brief Emit an unreachable statement.
  * 
@@ -262,6 +279,7 @@ class CCompilerMSVC : public CCompilerCommon {
 public:
   CCompilerMSVC(const CompilerCommonInfo& common_info, const Platform::Path& path, unsigned version)
   : CCompilerCommon(common_info), m_path(path), m_version(version) {
+    has_thread_local = true;
   }
   
   virtual void emit_alignment(CModuleEmitter& emitter, unsigned n) {
@@ -273,6 +291,14 @@ public:
     return true;
   }
   
+  virtual void emit_thread_local(CModuleEmitter& emitter) {
+    emitter.output() << "__declspec(thread) ";
+  }
+  
+  virtual void emit_restrict(CModuleEmitter& emitter) {
+    emitter.output() << "__restrict ";
+  }
+  
   void emit_global_attributes(AttributeWriter& aw, CGlobal *global) {
     switch (global->linkage) {
     case link_local: break;
@@ -402,17 +428,28 @@ public:
 class CCompilerGCCLike : public CCompilerCommon {
 public:
   bool has_attribute_visibility;
+  /// \brief Supports the \c hot and \c cold function attributes
+  bool has_attribute_hot_cold;
   
   CCompilerGCCLike(const CompilerCommonInfo& common_info)
   : CCompilerCommon(common_info) {
     has_variable_length_arrays = true;
     has_designated_initializer = true;
     has_attribute_visibility = false;
+    has_attribute_hot_cold = false;
   }
 
   virtual void emit_alignment(CModuleEmitter& emitter, unsigned n) {
     emitter.output() << "__attribute__((aligned(" << n << "))) ";
   }
+  
+  virtual void emit_thread_local(CModuleEmitter& emitter) {
+    emitter.output() << "__thread ";
+  }
+  
+  virtual void emit_vector_attribute(CModuleEmitter& emitter, unsigned size) {
+    emitter.output() << " __attribute__((vector_size(" << size << ")))";
+  }
 
   void emit_global_attributes(AttributeWriter& aw, CGlobal *global) {
     if (global->alignment) aw.next() << "aligned(" << global->alignment << ")";
@@ -452,6 +489,14 @@ public:
       aw.next() << "constructor(" << function->constructor_priority << ")";
     else if (function->destructor_priority >= 0)
       aw.next() << "destructor(" << function->destructor_priority << ")";
+    if (has_attribute_hot_cold) {
+      switch (function->hotness) {
+      case hotness_normal: break;
+      case hotness_hot: aw.next() << "hot"; break;
+      case hotness_cold: aw.next() << "cold"; break;
+      default: PSI_FAIL("Unknown function hotness");
+      }
+    }
     aw.done();
   }
   
@@ -517,6 +562,15 @@ public:
     has_variable_length_arrays = true;
     has_designated_initializer = true;
     has_attribute_visibility = !windows();
+    // __builtin_convertvector first appeared in GCC 9
+    has_vector_extensions = has_version(9,0);
+    // __atomic builtins first appeared in GCC 4.7
+    has_atomic_builtins = has_version(4,7);
+    has_thread_local = true;
+    has_builtin_expect = true;
+    has_attribute_hot_cold = true;
+    // musttail first appeared in GCC 15
+    has_attribute_musttail = has_version(15,0);
   }
   
   /**
@@ -596,6 +650,13 @@ public:
     has_variable_length_arrays = true;
     has_designated_initializer = true;
     has_attribute_visibility = !windows();
+    has_vector_extensions = true;
+    has_atomic_builtins = true;
+    has_thread_local = true;
+    has_builtin_expect = true;
+    has_attribute_hot_cold = true;
+    // musttail first appeared in Clang 13
+    has_attribute_musttail = (m_major_version >= 13);
   }
 
   virtual bool emit_unreachable(CModuleEmitter& emitter) {
@@ -1016,7 +1077,7 @@ boost::shared_ptr<CCompiler> detect_c_compiler(const CompileErrorPair& err_loc,
   } else if (*kind == "tcc") {
     return CCompilerTCC::detect(err_loc, *cc_full_path, configuration);
   } else {
-    err_loc.error_throw(boost::format("Unknown C compiler kind: %s") % kind);
+    err_loc.error_throw(boost::format("Unknown C compiler kind: %s") % *kind);
   }
 }
 }
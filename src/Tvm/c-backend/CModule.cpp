@@ -157,6 +157,34 @@ CExpression* CExpressionBuilder::call(const SourceLocation* location, CExpressio
   return call;
 }
 
+/**
+ * \brief Call a compiler builtin function.
+ * 
+ * Builtins such as \c __atomic_load_n are generic, so have no C function type
+ * and must not be declared. The call is written using the name of the builtin
+ * directly and its result type is given explicitly.
+ */
+CExpression* CExpressionBuilder::builtin_call(const SourceLocation* location, CType *ty, const char *name, unsigned n_args, CExpression *const* args) {
+  CExpressionLiteral *target = m_module->pool().alloc<CExpressionLiteral>();
+  target->type = NULL;
+  target->op = c_op_literal;
+  target->str = name;
+  target->eval = c_eval_never;
+  target->lvalue = false;
+  append(location, target, false);
+  
+  CExpressionCall *call = m_module->pool().alloc_varstruct<CExpressionCall, CExpression*>(n_args);
+  call->type = ty;
+  call->op = c_op_call;
+  call->target = target;
+  call->n_args = n_args;
+  call->eval = c_eval_write;
+  call->lvalue = false;
+  std::copy(args, args+n_args, call->args);
+  append(location, call);
+  return call;
+}
+
 CExpression* CExpressionBuilder::aggregate_value(const SourceLocation* location, COperatorType op, CType *ty, unsigned n_members, CExpression *const* members) {
   PSI_ASSERT(n_members == ((op == c_op_array_value) ? checked_cast<CTypeArray*>(ty)->length : checked_cast<CTypeAggregate*>(ty)->n_members));
   CExpressionAggregateValue *agg = m_module->pool().alloc_varstruct<CExpressionAggregateValue, CExpression*>(n_members);
@@ -248,6 +276,16 @@ CType* CExpressionBuilder::array_type(CType *member, unsigned length) {
   return arr;
 }
 
+CType* CExpressionBuilder::vector_type(const SourceLocation* location, CType *member, unsigned length, unsigned size) {
+  CTypeVector *vec = m_module->pool().alloc<CTypeVector>();
+  vec->type = c_type_vector;
+  vec->member = member;
+  vec->length = length;
+  vec->size = size;
+  append(vec, location);
+  return vec;
+}
+
 CType* CExpressionBuilder::function_type(const SourceLocation* location, CType *result_ty, unsigned n_args, const CTypeFunctionArgument *args) {
   CTypeFunction *f = m_module->pool().alloc_varstruct<CTypeFunction, CTypeFunctionArgument>(n_args);
   f->type = c_type_function;
@@ -454,6 +492,17 @@ void CModuleEmitter::emit_types() {
       break;
     }
     
+    case c_type_vector: {
+      emit_location(*ty.location);
+      CTypeVector& vec = checked_cast<CTypeVector&>(ty);
+      output() << "typedef ";
+      emit_type_prolog(vec.member, true);
+      output() << ty.name;
+      c_compiler().emit_vector_attribute(*this, vec.size);
+      output() << ";\n";
+      break;
+    }
+    
     default: PSI_FAIL("Unknown C type category");
     }
   }
@@ -474,6 +523,7 @@ void CModuleEmitter::emit_declaration(CGlobal& global, bool no_extern) {
 
   if (global.op == c_op_global_variable) {
     global_var = checked_cast<CGlobalVariable*>(&global);
+    if (global_var->is_thread_local) c_compiler().emit_thread_local(*this);
     c_compiler().emit_global_variable_attributes(*this, global_var);
     if (global_var->is_const) output() << "const ";
   } else {
@@ -512,6 +562,8 @@ void CModuleEmitter::emit_definition(CGlobal& global) {
         if (arg_index) output() << ", ";
         CTypeFunctionArgument& arg = ftype->args[arg_index];
         emit_type_prolog(arg.type, true);
+        if (arg.is_restrict)
+          c_compiler().emit_restrict(*this);
         PSI_ASSERT(ii->name.prefix); // Parameters cannot be anonymous in C
         output() << ii->name;
         emit_type_epilog(arg.type);
@@ -566,9 +618,18 @@ void CModuleEmitter::emit_expression_def(CExpression *expression, EmitFlags flag
     break;
   }
   
-  case c_expr_literal:
-    output() << checked_cast<CExpressionLiteral*>(expression)->str;
+  case c_expr_literal: {
+    CExpressionLiteral *lit = checked_cast<CExpressionLiteral*>(expression);
+    // Brace enclosed literals are only valid in initializers; elsewhere they must be compound literals
+    if ((lit->str[0] == '{') && !flags.initializer()) {
+      output() << '(';
+      emit_type_prolog(lit->type, false);
+      emit_type_epilog(lit->type);
+      output() << ')';
+    }
+    output() << lit->str;
     break;
+  }
   
   case c_expr_array_value:
   case c_expr_struct_value: {
@@ -610,6 +671,15 @@ void CModuleEmitter::emit_expression_def(CExpression *expression, EmitFlags flag
     emit_expression(checked_cast<CExpressionUnary*>(expression)->arg, flags);
     break;
     
+  case c_expr_convert_vector:
+    output() << "__builtin_convertvector(";
+    emit_expression(checked_cast<CExpressionUnary*>(expression)->arg);
+    output() << ", ";
+    emit_type_prolog(expression->type, false);
+    emit_type_epilog(expression->type);
+    output() << ')';
+    break;
+    
   case c_expr_cast:
     output().put('(');
     emit_type_prolog(expression->type, false);
@@ -723,6 +793,12 @@ void CModuleEmitter::emit_statement(CExpression *expression) {
     break;
   }
     
+  case c_op_musttail_return:
+    output() << "__attribute__((musttail)) return ";
+    emit_expression(checked_cast<CExpressionUnary*>(expression)->arg);
+    output() << ";\n";
+    break;
+    
   case c_op_goto:
     output() << "goto ";
     emit_expression(checked_cast<CExpressionUnary*>(expression)->arg);
@@ -803,11 +879,49 @@ bool CNameMap::NameCompare::operator () (const CName& lhs, const CName& rhs) con
     return false;
 }
 
-CNameMap::CNameMap(WriteMemoryPool *pool) : m_map(NameCompare(), pool) {
+CNameMap::CNameMap(WriteMemoryPool *pool)
+: m_parent(NULL),
+m_map(NameCompare(), pool) {
+}
+
+/**
+ * \brief Create a name map for a nested scope.
+ * 
+ * Names in \c parent are taken into account when generating names, but are
+ * looked up there rather than copied, so creating a scope is cheap however
+ * many names \c parent holds. \c parent must not be modified while this
+ * map is in use.
+ */
+CNameMap::CNameMap(const CNameMap *parent, WriteMemoryPool *pool)
+: m_parent(parent),
+m_map(NameCompare(), pool) {
+}
+
+/**
+ * \brief Find an existing copy of the first \c n characters of \c s in this map or its parents.
+ */
+const char *CNameMap::find_prefix(const char *s, std::size_t n) const {
+  for (const CNameMap *map = this; map; map = map->m_parent) {
+    CName tmp = {s, 0};
+    NameMap::const_iterator it = map->m_map.upper_bound(tmp);
+    if (it != map->m_map.begin()) {
+      --it;
+      if ((std::strncmp(it->prefix, s, n) == 0) && (it->prefix[n] == '\0'))
+        return it->prefix;
+    }
+  }
+  return NULL;
 }
 
-CNameMap::CNameMap(const CNameMap& src, WriteMemoryPool *pool)
-: m_map(src.m_map.begin(), src.m_map.end(), NameCompare(), pool) {
+/**
+ * \brief Check whether a name is in use in this map or its parents.
+ */
+bool CNameMap::contains(const CName& name) const {
+  for (const CNameMap *map = this; map; map = map->m_parent) {
+    if (map->m_map.find(name) != map->m_map.end())
+      return true;
+  }
+  return false;
 }
 
 CName CNameMap::insert(const char *s, bool ignore_duplicate) {
@@ -830,23 +944,14 @@ CName CNameMap::insert(const char *s, bool ignore_duplicate) {
   if (*q != '\0')
     std::sscanf(q, "%d", &index);
   
-  CName tmp = {s, 0};
-  NameMap::iterator it = m_map.upper_bound(tmp);
-  if (it != m_map.begin()) {
-    --it;
-    if ((std::strncmp(it->prefix, s, q-s) == 0) && (it->prefix[q-s] == '\0')) {
-      CName result = {it->prefix, index};
-      if (ignore_duplicate) {
-        m_map.insert(result);
-        return result;
-      } else {
-        while (true) {
-          if (m_map.insert(result).second)
-            return result;
-          ++result.index;
-        }
-      }
+  if (const char *prefix = find_prefix(s, q-s)) {
+    CName result = {prefix, index};
+    if (!ignore_duplicate) {
+      while (contains(result))
+        ++result.index;
     }
+    m_map.insert(result);
+    return result;
   }
   
   WriteMemoryPool& pool = m_map.get_allocator().pool();
@@ -900,6 +1005,7 @@ CGlobalVariable *CModule::new_global(const SourceLocation *location, CType *type
   CGlobalVariable *gvar = m_pool.alloc<CGlobalVariable>();
   gvar->op = c_op_global_variable;
   gvar->is_const = false;
+  gvar->is_thread_local = false;
   add_global(gvar, location, type, name);
   return gvar;
 }
@@ -910,6 +1016,7 @@ CFunction *CModule::new_function(const SourceLocation *location, CType *type, co
   f->is_external = true;
   f->constructor_priority = -1;
   f->destructor_priority = -1;
+  f->hotness = hotness_normal;
   add_global(f, location, type, name);
   return f;
 }
@@ -923,6 +1030,7 @@ void CModule::name_types() {
     switch (ii->type) {
     case c_type_struct:
     case c_type_union:
+    case c_type_vector:
     case c_type_function: {
       PSI_ASSERT(!ii->name.prefix);
       std::string s = location_to_c_identifier(*ii->location, location(), true);
@@ -951,7 +1059,7 @@ void CModule::name_types() {
  * called on the module first.
  */
 void CModule::name_locals(CFunction *function) {
-  CNameMap local_names(m_names);
+  CNameMap local_names(&m_names, &m_pool);
   for (SinglyLinkedList<CExpression>::iterator ii = function->parameters.begin(), ie = function->parameters.end(); ii != ie; ++ii) {
     PSI_ASSERT(!ii->name.prefix && ii->requires_name);
     std::string base_name = location_to_c_identifier(*ii->location, *function->location, false);
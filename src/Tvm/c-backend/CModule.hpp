@@ -5,6 +5,7 @@
 #include "../../Utility.hpp"
 #include "../../SourceLocation.hpp"
 #include "../Core.hpp"
+#include "../Function.hpp"
 
 #include <set>
 #include <boost/intrusive/list.hpp>
@@ -28,6 +29,7 @@ PSI_SMALL_ENUM(CTypeType) {
   c_type_function,
   c_type_pointer,
   c_type_array,
+  c_type_vector,
   c_type_void
 };
 
@@ -116,16 +118,20 @@ struct CName {
   unsigned index;
 };
 
-class CNameMap {
+class CNameMap : public boost::noncopyable {
   struct NameCompare {bool operator () (const CName&, const CName&) const;};
   typedef std::set<CName, NameCompare, WriteMemoryPoolAllocator<CName> > NameMap; 
+  /// Enclosing scope, whose names are visible but not copied into this map
+  const CNameMap *m_parent;
   NameMap m_map;
 
   CName insert(const char *fullname, bool ignore_duplicate);
+  const char *find_prefix(const char *s, std::size_t n) const;
+  bool contains(const CName& name) const;
   
 public:
   CNameMap(WriteMemoryPool *pool);
-  CNameMap(const CNameMap& src, WriteMemoryPool *pool);
+  CNameMap(const CNameMap *parent, WriteMemoryPool *pool);
   
   CName reserve(const char *s);
   CName get(const char *s);
@@ -154,8 +160,23 @@ struct CTypeArray : CType {
   unsigned length;
 };
 
+/**
+ * \brief GCC style vector type.
+ * 
+ * These are always given a name, since the vector attribute can only
+ * be attached to a typedef.
+ */
+struct CTypeVector : CTypeArray {
+  /// Size of the vector in bytes
+  unsigned size;
+};
+
 struct CTypeFunctionArgument {
   CType *type;
+  /// Whether this is a pointer argument which should be declared \c restrict
+  bool is_restrict;
+  
+  CTypeFunctionArgument() : type(NULL), is_restrict(false) {}
 };
 
 struct CTypeFunction : CType {
@@ -267,6 +288,7 @@ public:
   CExpression* declare(const SourceLocation* location, CType *type, COperatorType op, CExpression *arg, unsigned index_or_alignment);
   CExpression* literal(const SourceLocation* location, CType *ty, const char *str);
   CExpression* call(const SourceLocation* location, CExpression *target, unsigned n_args, CExpression *const* args, bool conditional=false);
+  CExpression* builtin_call(const SourceLocation* location, CType *ty, const char *name, unsigned n_args, CExpression *const* args);
   CExpression* aggregate_value(const SourceLocation* location, COperatorType op, CType *ty, unsigned n_members, CExpression *const* members);
   CExpression* union_value(const SourceLocation* location, CType *ty, unsigned index, CExpression *value);
   CExpression* cast(const SourceLocation* location, CType *ty, CExpression *arg);
@@ -276,6 +298,7 @@ public:
   CType* builtin_type(const char *name);
   CType* pointer_type(CType *arg);
   CType* array_type(CType *arg, unsigned length);
+  CType* vector_type(const SourceLocation* location, CType *arg, unsigned length, unsigned size);
   CType* function_type(const SourceLocation* location, CType *result_ty, unsigned n_args, const CTypeFunctionArgument *args);
 private:
   CType* aggregate_type(const SourceLocation* location, CTypeType op, unsigned n_members, const CTypeAggregateMember *members);
@@ -296,6 +319,8 @@ struct CFunction : CGlobal {
   int constructor_priority;
   /// If >= 0, this is a constructor with given priority
   int destructor_priority;
+  /// How often this function is expected to be called
+  FunctionHotness hotness;
   SinglyLinkedList<CExpression> parameters;
   SinglyLinkedList<CExpression> instructions;
 };
@@ -304,6 +329,7 @@ struct CGlobalVariable : CGlobal {
   CType *type;
   CExpression *value;
   bool is_const;
+  bool is_thread_local;
 };
 
 class CCompiler;
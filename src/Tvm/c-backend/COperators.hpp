@@ -12,10 +12,10 @@ PSI_TVM_C_OP_STR(xor, binary, 11, false, "^")
 
 PSI_TVM_C_OP_STR(cmp_eq, binary, 9, false, "==")
 PSI_TVM_C_OP_STR(cmp_ne, binary, 9, false, "!=")
-PSI_TVM_C_OP_STR(cmp_lt, binary, 8, false, "<=")
-PSI_TVM_C_OP_STR(cmp_gt, binary, 8, false, ">=")
-PSI_TVM_C_OP_STR(cmp_le, binary, 8, false, "<")
-PSI_TVM_C_OP_STR(cmp_ge, binary, 8, false, ">")
+PSI_TVM_C_OP_STR(cmp_lt, binary, 8, false, "<")
+PSI_TVM_C_OP_STR(cmp_gt, binary, 8, false, ">")
+PSI_TVM_C_OP_STR(cmp_le, binary, 8, false, "<=")
+PSI_TVM_C_OP_STR(cmp_ge, binary, 8, false, ">=")
 
 PSI_TVM_C_OP_STR(assign, binary, 15, true, "=")
 
@@ -42,6 +42,9 @@ PSI_TVM_C_OP(struct_value, 3, true)
 PSI_TVM_C_OP(array_value, 3, true)
 PSI_TVM_C_OP(union_value, 3, true)
 
+// __builtin_convertvector, which is written like a function call
+PSI_TVM_C_OP(convert_vector, 2, false)
+
 PSI_TVM_C_OP(if, 0, false)
 PSI_TVM_C_OP(else, 0, false)
 PSI_TVM_C_OP(elif, 0, false)
@@ -50,6 +53,7 @@ PSI_TVM_C_OP(endif, 0, false)
 PSI_TVM_C_OP(load, 0, false)
 PSI_TVM_C_OP(cast, 3, true)
 PSI_TVM_C_OP(return, 0, false)
+PSI_TVM_C_OP(musttail_return, 0, false)
 PSI_TVM_C_OP(goto, 0, false)
 PSI_TVM_C_OP(ternary, 15, true)
 PSI_TVM_C_OP(unreachable, 0, false)
@@ -84,6 +84,19 @@ struct TypeBuilderCallbacks {
     return builder.c_builder().struct_type(&term->location(), 1, &member);
   }
   
+  static CType* vector_type_callback(TypeBuilder& builder, const ValuePtr<VectorType>& term) {
+    CType *element_type = builder.build(term->element_type());
+    const PrimitiveTypeSet& pts = builder.c_compiler().primitive_types;
+    unsigned element_size;
+    if (ValuePtr<IntegerType> int_type = dyn_cast<IntegerType>(term->element_type()))
+      element_size = pts.int_types[int_type->width()].size;
+    else if (ValuePtr<FloatType> float_type = dyn_cast<FloatType>(term->element_type()))
+      element_size = pts.float_types[float_type->width()].size;
+    else
+      element_size = 1; // Booleans are stored as unsigned char
+    return builder.c_builder().vector_type(&term->location(), element_type, term->length(), element_size * term->length());
+  }
+  
   static CType* byte_type_callback(TypeBuilder& builder, const ValuePtr<ByteType>&) {
     return builder.integer_type(IntegerType::i8, false);
   }
@@ -109,6 +122,7 @@ struct TypeBuilderCallbacks {
       .add<UnionType>(union_type_callback)
       .add<PointerType>(pointer_type_callback)
       .add<ArrayType>(array_type_callback)
+      .add<VectorType>(vector_type_callback)
       .add<ByteType>(byte_type_callback)
       .add<BooleanType>(boolean_type_callback)
       .add<IntegerType>(integer_type_callback)
@@ -123,6 +137,7 @@ TypeBuilder::TypeBuilder(CModule *module)
 m_psi_alloca(NULL),
 m_psi_freea(NULL),
 m_memcpy(NULL),
+m_memset(NULL),
 m_null(NULL) {
   m_void_type = NULL;
   std::fill_n(m_signed_integer_types, array_size(m_signed_integer_types), static_cast<CType*>(NULL));
@@ -185,7 +200,9 @@ CType* TypeBuilder::build_function_type(const ValuePtr<FunctionType>& ftype) {
   SmallArray<CTypeFunctionArgument, 8> arguments;
   arguments.resize(ftype->parameter_types().size());
   for (std::size_t ii = 0, ie = arguments.size(); ii != ie; ++ii) {
-    arguments[ii].type = build(ftype->parameter_types()[ii].value);
+    const ParameterType& param = ftype->parameter_types()[ii];
+    arguments[ii].type = build(param.value);
+    arguments[ii].is_restrict = (param.attributes.flags & ParameterAttributes::noalias) && (arguments[ii].type->type == c_type_pointer);
   }
   CType *result_type = build(ftype->result_type().value);
   return c_builder().function_type(&ftype->location(), result_type, arguments.size(), arguments.get());
@@ -198,7 +215,9 @@ CExpression *TypeBuilder::get_psi_alloca() {
     args[0].type = size_type;
     args[1].type = size_type;
     CType *type = c_builder().function_type(&module().location(), c_builder().pointer_type(void_type()), 2, args);
-    m_psi_alloca = module().new_function(&module().location(), type, "__psi_alloca");
+    CFunction *f = module().new_function(&module().location(), type, "__psi_alloca");
+    f->linkage = link_import;
+    m_psi_alloca = f;
   }
   return m_psi_alloca;
 }
@@ -211,7 +230,9 @@ CExpression *TypeBuilder::get_psi_freea() {
     args[1].type = size_type;
     args[2].type = size_type;
     CType *type = c_builder().function_type(&module().location(), void_type(), 3, args);
-    m_psi_freea = module().new_function(&module().location(), type, "__psi_freea");
+    CFunction *f = module().new_function(&module().location(), type, "__psi_freea");
+    f->linkage = link_import;
+    m_psi_freea = f;
   }
   return m_psi_freea;
 }
@@ -219,11 +240,14 @@ CExpression *TypeBuilder::get_psi_freea() {
 CExpression *TypeBuilder::get_memcpy() {
   if (!m_memcpy) {
     CType *vptr_type = c_builder().pointer_type(void_type());
-    CTypeFunctionArgument args[2];
+    CTypeFunctionArgument args[3];
     args[0].type = vptr_type;
     args[1].type = vptr_type;
-    CType *type = c_builder().function_type(&module().location(), vptr_type, 2, args);
-    m_memcpy = module().new_function(&module().location(), type, "memcpy");
+    args[2].type = integer_type(IntegerType::iptr, false);
+    CType *type = c_builder().function_type(&module().location(), vptr_type, 3, args);
+    CFunction *f = module().new_function(&module().location(), type, "memcpy");
+    f->linkage = link_import;
+    m_memcpy = f;
   }
   return m_memcpy;
 }
@@ -236,7 +260,9 @@ CExpression *TypeBuilder::get_memset() {
     args[1].type = c_builder().builtin_type("int");
     args[2].type = integer_type(IntegerType::iptr, false);
     CType *type = c_builder().function_type(&module().location(), vptr_type, 3, args);
-    m_memset = module().new_function(&module().location(), type, "memset");
+    CFunction *f = module().new_function(&module().location(), type, "memset");
+    f->linkage = link_import;
+    m_memset = f;
   }
   return m_memset;
 }
@@ -2,6 +2,7 @@
 #include "../Aggregate.hpp"
 #include "../Number.hpp"
 #include "../Instructions.hpp"
+#include "../FunctionalBuilder.hpp"
 
 #include "Builder.hpp"
 #include "CModule.hpp"
@@ -123,13 +124,147 @@ struct ValueBuilderCallbacks {
     }
   }
   
+  static CExpression* element_value_callback(ValueBuilder& builder, const ValuePtr<ElementValue>& term) {
+    CExpression *inner = builder.build(term->aggregate());
+    ValuePtr<> aggregate_type = term->aggregate()->type();
+    CExpression *result;
+    if (isa<StructType>(aggregate_type) || isa<UnionType>(aggregate_type)) {
+      unsigned idx = size_to_unsigned(term->index());
+      result = builder.c_builder().member(&term->location(), c_op_member, inner, idx);
+    } else {
+      CType *ty = builder.build_type(term->type());
+      CExpression *array = builder.c_builder().member(&term->location(), c_op_member, inner, 0);
+      CExpression *idx = builder.build(term->index());
+      result = builder.c_builder().binary(&term->location(), ty, c_eval_never, c_op_subscript, array, idx);
+    }
+    // The member value itself, rather than an object a pointer refers to
+    result->lvalue = false;
+    return result;
+  }
+  
+  /**
+   * Mark an expression which is used more than once, in the same way as ValueBuilder::build
+   * does for values looked up a second time, so that it is only evaluated once.
+   */
+  static CExpression* reuse(CExpression *expr) {
+    if (expr->eval != c_eval_never)
+      expr->requires_name = true;
+    return expr;
+  }
+  
+  /**
+   * Get a vector of integers with the same lane width and count as \c type.
+   * 
+   * This is the type GCC uses for the result of vector comparisons, and the type
+   * used for bit masks in vector selects.
+   */
+  static ValuePtr<> vector_mask_type(ValueBuilder& builder, const ValuePtr<VectorType>& type, bool is_signed, const SourceLocation& location) {
+    IntegerType::Width width;
+    if (ValuePtr<IntegerType> int_type = dyn_cast<IntegerType>(type->element_type())) {
+      width = int_type->width();
+    } else if (ValuePtr<FloatType> float_type = dyn_cast<FloatType>(type->element_type())) {
+      switch (float_type->width()) {
+      case FloatType::fp32: width = IntegerType::i32; break;
+      case FloatType::fp64: width = IntegerType::i64; break;
+      default: builder.error_context().error_throw(location, "Vector select not supported for this floating point type");
+      }
+    } else {
+      width = IntegerType::i8;
+    }
+    ValuePtr<> element_type = FunctionalBuilder::int_type(type->context(), width, is_signed, location);
+    return FunctionalBuilder::vector_type(element_type, type->length(), location);
+  }
+  
+  /**
+   * C has no conditional operator on vectors, so a vector select is
+   * written using a bit mask built from the condition.
+   */
+  static CExpression* vector_select(ValueBuilder& builder, const ValuePtr<Select>& term) {
+    const SourceLocation *location = &term->location();
+    CType *ty = builder.build_type(term->type());
+    CType *mask_ty = builder.build_type(vector_mask_type(builder, value_cast<VectorType>(term->type()), false, term->location()));
+    CExpression *which = builder.build(term->condition());
+    CExpression *if_true = builder.build(term->true_value());
+    CExpression *if_false = builder.build(term->false_value());
+    
+    CExpression *which_wide = builder.c_builder().unary(location, mask_ty, c_eval_pure, c_op_convert_vector, which);
+    CExpression *mask = reuse(builder.c_builder().unary(location, mask_ty, c_eval_pure, c_op_negate, which_wide));
+    CExpression *not_mask = builder.c_builder().unary(location, mask_ty, c_eval_pure, c_op_not, mask);
+    CExpression *true_bits = builder.c_builder().binary(location, mask_ty, c_eval_pure, c_op_and, builder.c_builder().cast(location, mask_ty, if_true), mask);
+    CExpression *false_bits = builder.c_builder().binary(location, mask_ty, c_eval_pure, c_op_and, builder.c_builder().cast(location, mask_ty, if_false), not_mask);
+    CExpression *bits = builder.c_builder().binary(location, mask_ty, c_eval_pure, c_op_or, true_bits, false_bits);
+    return builder.c_builder().cast(location, ty, bits);
+  }
+  
   static CExpression* select_value_callback(ValueBuilder& builder, const ValuePtr<Select>& term) {
+    if (isa<VectorType>(term->condition()->type()))
+      return vector_select(builder, term);
+    
     CType *ty = builder.build_type(term->type());
     CExpression *which = builder.build(term->condition());
     CExpression *if_true = builder.build(term->true_value(), true);
     CExpression *if_false = builder.build(term->false_value(), true);
     return builder.c_builder().ternary(&term->location(), ty, c_eval_pure, c_op_ternary, which, if_true, if_false);
   }
+  
+  static CExpression* vector_value_callback(ValueBuilder& builder, const ValuePtr<VectorValue>& term) {
+    CType *ty = builder.build_type(term->type());
+    unsigned n = term->length();
+    SmallArray<CExpression*, small_array_size> members(n);
+    for (unsigned i = 0; i != n; ++i)
+      members[i] = builder.build(term->value(i));
+    return builder.c_builder().aggregate_value(&term->location(), c_op_array_value, ty, n, members.get());
+  }
+  
+  static CExpression* vector_element_callback(ValueBuilder& builder, const ValuePtr<VectorElement>& term) {
+    CType *ty = builder.build_type(term->type());
+    CExpression *vector = builder.build(term->vector());
+    CExpression *idx = builder.build(term->index());
+    return builder.c_builder().binary(&term->location(), ty, c_eval_pure, c_op_subscript, vector, idx);
+  }
+  
+  static CExpression* vector_insert_callback(ValueBuilder& builder, const ValuePtr<VectorInsert>& term) {
+    CType *ty = builder.build_type(term->type());
+    CType *element_ty = builder.build_type(term->value()->type());
+    CExpression *vector = builder.build(term->vector());
+    CExpression *idx = builder.build(term->index());
+    CExpression *value = builder.build(term->value());
+    CExpression *copy = builder.c_builder().declare(&term->location(), ty, c_op_declare, vector, 0);
+    CExpression *lane = builder.c_builder().binary(&term->location(), element_ty, c_eval_never, c_op_subscript, copy, idx, true);
+    builder.c_builder().binary(&term->location(), NULL, c_eval_write, c_op_assign, lane, value);
+    return builder.c_builder().unary(&term->location(), ty, c_eval_read, c_op_load, copy);
+  }
+  
+  static CExpression* vector_shuffle_callback(ValueBuilder& builder, const ValuePtr<VectorShuffle>& term) {
+    CType *ty = builder.build_type(term->type());
+    CType *element_ty = builder.build_type(value_cast<VectorType>(term->type())->element_type());
+    CExpression *lhs = reuse(builder.build(term->lhs()));
+    CExpression *rhs = reuse(builder.build(term->rhs()));
+    unsigned length = value_cast<VectorType>(term->lhs()->type())->length();
+    const std::vector<unsigned>& mask = term->mask();
+    SmallArray<CExpression*, small_array_size> members(mask.size());
+    for (unsigned i = 0, e = mask.size(); i != e; ++i) {
+      CExpression *source = (mask[i] < length) ? lhs : rhs;
+      CExpression *idx = builder.integer_literal((mask[i] < length) ? mask[i] : mask[i] - length);
+      members[i] = builder.c_builder().binary(&term->location(), element_ty, c_eval_pure, c_op_subscript, source, idx);
+    }
+    return builder.c_builder().aggregate_value(&term->location(), c_op_array_value, ty, mask.size(), members.get());
+  }
+  
+  struct VectorReduceHandler {
+    COperatorType op;
+    VectorReduceHandler(COperatorType op_) : op(op_) {}
+    CExpression* operator () (ValueBuilder& builder, const ValuePtr<VectorReduceOp>& term) {
+      CType *ty = builder.build_type(term->type());
+      CExpression *vector = reuse(builder.build(term->parameter()));
+      CExpression *result = NULL;
+      for (unsigned i = 0, e = value_cast<VectorType>(term->parameter()->type())->length(); i != e; ++i) {
+        CExpression *lane = builder.c_builder().binary(&term->location(), ty, c_eval_pure, c_op_subscript, vector, builder.integer_literal(i));
+        result = result ? builder.c_builder().binary(&term->location(), ty, c_eval_pure, op, result, lane) : lane;
+      }
+      return result;
+    }
+  };
 
   static CExpression* bitcast_callback(ValueBuilder& builder, const ValuePtr<BitCast>& term) {
     CType *ty = builder.build_type(term->type());
@@ -158,14 +293,96 @@ struct ValueBuilderCallbacks {
     }
   };
   
+  /**
+   * Comparisons differ from other binary operators on vectors, because GCC
+   * gives 0 or -1 in each lane of a signed integer vector, whereas TVM booleans
+   * are stored as 0 or 1 in an unsigned char.
+   */
+  struct CompareOpHandler {
+    COperatorType op;
+    CompareOpHandler(COperatorType op_) : op(op_) {}
+    CExpression* operator () (ValueBuilder& builder, const ValuePtr<BinaryOp>& term) {
+      CType *ty = builder.build_type(term->type());
+      CExpression *lhs = builder.build(term->lhs());
+      CExpression *rhs = builder.build(term->rhs());
+      if (ValuePtr<VectorType> vector_type = dyn_cast<VectorType>(term->lhs()->type())) {
+        CType *mask_ty = builder.build_type(vector_mask_type(builder, vector_type, true, term->location()));
+        CExpression *mask = builder.c_builder().binary(&term->location(), mask_ty, c_eval_pure, op, lhs, rhs);
+        CExpression *ones = builder.c_builder().unary(&term->location(), mask_ty, c_eval_pure, c_op_negate, mask);
+        return builder.c_builder().unary(&term->location(), ty, c_eval_pure, c_op_convert_vector, ones);
+      }
+      return builder.c_builder().binary(&term->location(), ty, c_eval_pure, op, lhs, rhs);
+    }
+  };
+  
+  typedef std::vector<std::pair<CExpression*, CExpression*> > PhiListType;
+
+  /**
+   * \brief Check whether a call is a tail call of the function containing it.
+   * 
+   * Such calls are turned into a jump back to the start of the function, since
+   * C compilers are not required to eliminate tail calls.
+   */
+  static bool is_self_tail_call(const ValuePtr<Call>& call) {
+    return (call->tail != tail_call_none) && (call->target == call->block()->function());
+  }
+  
+  /**
+   * \brief Check whether a call should be written directly into a \c musttail return statement.
+   */
+  static bool is_musttail_call(ValueBuilder& builder, const ValuePtr<Call>& call) {
+    return (call->tail == tail_call_required) && builder.c_compiler().has_attribute_musttail && !is_self_tail_call(call);
+  }
+  
+  /**
+   * \brief Replace a self tail call by assigning the new arguments to the
+   * function parameters and jumping to the entry block.
+   * 
+   * All arguments are evaluated before any parameter is assigned, since
+   * arguments may depend on the old parameter values.
+   */
+  static void self_tail_call(ValueBuilder& builder, const ValuePtr<Call>& call, const SourceLocation& location) {
+    ValuePtr<Function> function = call->block()->function();
+    PSI_ASSERT(call->parameters.size() == function->parameters().size());
+    
+    PhiListType values;
+    Function::ParameterList::iterator ji = function->parameters().begin();
+    for (std::size_t ii = 0, ie = call->parameters.size(); ii != ie; ++ii, ++ji) {
+      if (builder.is_void_type((*ji)->type()))
+        continue;
+      CExpression *parameter = builder.build(*ji);
+      CExpression *value = builder.c_builder().declare(&location, parameter->type, c_op_declare, builder.build_rvalue(call->parameters[ii]), 0);
+      value->lvalue = false;
+      values.push_back(std::make_pair(parameter, value));
+    }
+    
+    for (PhiListType::const_iterator ii = values.begin(), ie = values.end(); ii != ie; ++ii)
+      builder.c_builder().binary(&location, NULL, c_eval_write, c_op_assign, ii->first, ii->second);
+    
+    CExpression *entry = builder.build(function->blocks().front());
+    entry->requires_name = true;
+    builder.c_builder().unary(&location, NULL, c_eval_write, c_op_goto, entry);
+  }
+  
   static CExpression* return_callback(ValueBuilder& builder, const ValuePtr<Return>& term) {
+    if (ValuePtr<Call> call = term->preceding_call()) {
+      if (is_self_tail_call(call)) {
+        self_tail_call(builder, call, term->location());
+        return NULL;
+      } else if (is_musttail_call(builder, call)) {
+        // If the result is empty, the call is still written into the return statement:
+        // returning a void expression from a void function is accepted by every
+        // compiler which supports musttail
+        builder.c_builder().unary(&term->location(), NULL, c_eval_write, c_op_musttail_return, builder.build(call));
+        return NULL;
+      }
+    }
+    
     CExpression *value = builder.is_void_type(term->value->type()) ? NULL : builder.build(term->value);
     builder.c_builder().unary(&term->location(), NULL, c_eval_write, c_op_return, value);
     return NULL;
   }
   
-  typedef std::vector<std::pair<CExpression*, CExpression*> > PhiListType;
-
   /**
    * Prepare values for assignment to PHI nodes
    * 
@@ -176,7 +393,7 @@ struct ValueBuilderCallbacks {
     PhiListType result;
     for (Block::PhiList::iterator ii = target->phi_nodes().begin(), ie = target->phi_nodes().end(); ii != ie; ++ii) {
       const ValuePtr<Phi>& phi = *ii;
-      result.push_back(std::make_pair(builder.phi_get(phi), builder.build(phi->incoming_value_from(current))));
+      result.push_back(std::make_pair(builder.phi_get(phi), builder.build_rvalue(phi->incoming_value_from(current))));
     }
     return result;
   }
@@ -192,6 +409,16 @@ struct ValueBuilderCallbacks {
   
   static CExpression* conditional_branch_callback(ValueBuilder& builder, const ValuePtr<ConditionalBranch>& term) {
     CExpression *cond = builder.build(term->condition);
+    if (builder.c_compiler().has_builtin_expect) {
+      const char *expected = term->is_unlikely(term->false_target) ? "1" : term->is_unlikely(term->true_target) ? "0" : NULL;
+      if (expected) {
+        CType *long_type = builder.type_builder().integer_type(IntegerType::i64, true);
+        CExpression *args[2] = {cond, builder.c_builder().literal(&term->location(), long_type, expected)};
+        cond = builder.c_builder().builtin_call(&term->location(), long_type, "__builtin_expect", 2, args);
+        // No side effects, so this can be written directly into the if statement
+        cond->eval = c_eval_pure;
+      }
+    }
     
     // Need to build PHI values before if/else block (so that values put into the value map are in scope in child blocks)
     const ValuePtr<Block>& block = term->block();
@@ -218,6 +445,10 @@ struct ValueBuilderCallbacks {
   }
   
   static CExpression* function_call_callback(ValueBuilder& builder, const ValuePtr<Call>& term) {
+    // Built by the following return instruction
+    if (is_self_tail_call(term))
+      return NULL;
+    
     CExpression *target = builder.build(term->target);
     SmallArray<CExpression*, small_array_size> args;
     args.resize(term->parameters.size());
@@ -230,12 +461,44 @@ struct ValueBuilderCallbacks {
     
     for (unsigned ii = 0, ie = args.size()-sret; ii != ie; ++ii)
       args[ii+sret] = builder.build(term->parameters[ii]);
-    return builder.c_builder().call(&term->location(), target, args.size(), args.get());
+    // A musttail call must appear directly in the return statement
+    return builder.c_builder().call(&term->location(), target, args.size(), args.get(), is_musttail_call(builder, term));
+  }
+  
+  static void check_atomic_builtins(ValueBuilder& builder, const ValuePtr<Instruction>& term) {
+    if (!builder.c_compiler().has_atomic_builtins)
+      term->error_context().error_throw(term->location(), "C compiler does not support atomic operations");
+  }
+  
+  /**
+   * Get the \c __ATOMIC_* memory order constant corresponding to \c ordering.
+   */
+  static CExpression* atomic_order(ValueBuilder& builder, AtomicOrdering ordering, const SourceLocation *location) {
+    const char *name;
+    switch (ordering) {
+    case atomic_relaxed: name = "__ATOMIC_RELAXED"; break;
+    case atomic_acquire: name = "__ATOMIC_ACQUIRE"; break;
+    case atomic_release: name = "__ATOMIC_RELEASE"; break;
+    case atomic_acq_rel: name = "__ATOMIC_ACQ_REL"; break;
+    case atomic_seq_cst: name = "__ATOMIC_SEQ_CST"; break;
+    default: PSI_FAIL("unexpected atomic ordering");
+    }
+    return builder.c_builder().literal(location, builder.type_builder().integer_type(IntegerType::i32, true), name);
+  }
+  
+  static CExpression* atomic_load_callback(ValueBuilder& builder, const ValuePtr<Load>& term) {
+    check_atomic_builtins(builder, term);
+    CType *ty = builder.build_type(term->type());
+    CExpression *args[2] = {builder.build_rvalue(term->target), atomic_order(builder, term->ordering, &term->location())};
+    return builder.c_builder().builtin_call(&term->location(), ty, "__atomic_load_n", 2, args);
   }
   
   static CExpression* load_callback(ValueBuilder& builder, const ValuePtr<Load>& term) {
     if (builder.is_void_type(term->type()))
       return NULL;
+    
+    if (term->ordering != atomic_none)
+      return atomic_load_callback(builder, term);
 
     CExpression *target = builder.build(term->target);
     if (!target->lvalue) {
@@ -250,6 +513,13 @@ struct ValueBuilderCallbacks {
       return NULL;
 
     CExpression *value = builder.build_rvalue(term->value);
+    if (term->ordering != atomic_none) {
+      check_atomic_builtins(builder, term);
+      CExpression *args[3] = {builder.build_rvalue(term->target), value, atomic_order(builder, term->ordering, &term->location())};
+      builder.c_builder().builtin_call(&term->location(), builder.type_builder().void_type(), "__atomic_store_n", 3, args);
+      return NULL;
+    }
+    
     CExpression *target = builder.build(term->target);
     if (!target->lvalue)
       target = builder.c_builder().unary(&term->location(), value->type, c_eval_never, c_op_dereference, target);
@@ -257,6 +527,101 @@ struct ValueBuilderCallbacks {
     return NULL;
   }
   
+  /**
+   * GCC has no atomic minimum or maximum builtins, so these are written as a
+   * compare and exchange loop:
+   * 
+   * \code
+   * T old = __atomic_load_n(ptr, __ATOMIC_RELAXED);
+   * retry: {
+   *   int done = __atomic_compare_exchange_n(ptr, &old, old < value ? old : value, 1, ordering, __ATOMIC_RELAXED);
+   *   if (done == 0) {goto retry;}
+   * }
+   * \endcode
+   */
+  static CExpression* atomic_min_max(ValueBuilder& builder, const ValuePtr<AtomicRMW>& term, CType *ty, CExpression *ptr, CExpression *value) {
+    const SourceLocation *location = &term->location();
+    CType *int_ty = builder.type_builder().integer_type(IntegerType::i32, true);
+    
+    CExpression *load_args[2] = {ptr, atomic_order(builder, atomic_relaxed, location)};
+    CExpression *initial = reuse(builder.c_builder().builtin_call(location, ty, "__atomic_load_n", 2, load_args));
+    CExpression *old = builder.c_builder().declare(location, ty, c_op_declare, initial, 0);
+    // The variable holds the value, not an object the value points to
+    old->lvalue = false;
+    
+    CExpression *retry = builder.c_builder().nullary(location, c_op_label);
+    retry->requires_name = true;
+    builder.c_builder().nullary(location, c_op_block_begin);
+    COperatorType cmp_op = (term->op == atomic_rmw_min) ? c_op_cmp_lt : c_op_cmp_gt;
+    CExpression *keep_old = builder.c_builder().binary(location, int_ty, c_eval_pure, cmp_op, old, value);
+    CExpression *desired = builder.c_builder().ternary(location, ty, c_eval_pure, c_op_ternary, keep_old, old, value);
+    CExpression *old_ptr = builder.c_builder().unary(location, builder.c_builder().pointer_type(ty), c_eval_never, c_op_address_of, old);
+    CExpression *cas_args[6] = {ptr, old_ptr, desired, builder.integer_literal(1),
+      atomic_order(builder, term->ordering, location), atomic_order(builder, atomic_relaxed, location)};
+    CExpression *done = reuse(builder.c_builder().builtin_call(location, int_ty, "__atomic_compare_exchange_n", 6, cas_args));
+    CExpression *failed = builder.c_builder().binary(location, int_ty, c_eval_pure, c_op_cmp_eq, done, builder.integer_literal(0));
+    builder.c_builder().unary(location, NULL, c_eval_write, c_op_if, failed);
+    builder.c_builder().unary(location, NULL, c_eval_write, c_op_goto, retry);
+    builder.c_builder().nullary(location, c_op_endif);
+    builder.c_builder().nullary(location, c_op_block_end);
+    
+    return builder.c_builder().unary(location, ty, c_eval_read, c_op_load, old);
+  }
+  
+  static CExpression* atomic_rmw_callback(ValueBuilder& builder, const ValuePtr<AtomicRMW>& term) {
+    check_atomic_builtins(builder, term);
+    CType *ty = builder.build_type(term->type());
+    CExpression *ptr = builder.build_rvalue(term->target);
+    CExpression *value = builder.build_rvalue(term->value);
+    
+    const char *name;
+    switch (term->op) {
+    case atomic_rmw_add: name = "__atomic_fetch_add"; break;
+    case atomic_rmw_sub: name = "__atomic_fetch_sub"; break;
+    case atomic_rmw_and: name = "__atomic_fetch_and"; break;
+    case atomic_rmw_or: name = "__atomic_fetch_or"; break;
+    case atomic_rmw_xor: name = "__atomic_fetch_xor"; break;
+    case atomic_rmw_xchg: name = "__atomic_exchange_n"; break;
+    case atomic_rmw_min:
+    case atomic_rmw_max:
+      return atomic_min_max(builder, term, ty, ptr, value);
+    default: PSI_FAIL("unexpected atomic operation");
+    }
+    
+    CExpression *args[3] = {ptr, value, atomic_order(builder, term->ordering, &term->location())};
+    return builder.c_builder().builtin_call(&term->location(), ty, name, 3, args);
+  }
+  
+  /**
+   * \c __atomic_compare_exchange_n writes the value found back through its
+   * second argument, so this is passed a temporary initialized to the expected
+   * value and the temporary is the result.
+   */
+  static CExpression* cmpxchg_callback(ValueBuilder& builder, const ValuePtr<CmpXchg>& term) {
+    check_atomic_builtins(builder, term);
+    const SourceLocation *location = &term->location();
+    CType *ty = builder.build_type(term->type());
+    CExpression *ptr = builder.build_rvalue(term->target);
+    CExpression *expected = builder.build_rvalue(term->expected);
+    CExpression *value = builder.build_rvalue(term->value);
+    
+    CExpression *old = builder.c_builder().declare(location, ty, c_op_declare, expected, 0);
+    old->lvalue = false;
+    CExpression *old_ptr = builder.c_builder().unary(location, builder.c_builder().pointer_type(ty), c_eval_never, c_op_address_of, old);
+    CExpression *args[6] = {ptr, old_ptr, value, builder.integer_literal(0),
+      atomic_order(builder, term->success_ordering, location), atomic_order(builder, term->failure_ordering, location)};
+    builder.c_builder().builtin_call(location, builder.type_builder().integer_type(IntegerType::i32, true), "__atomic_compare_exchange_n", 6, args);
+    
+    return builder.c_builder().unary(location, ty, c_eval_read, c_op_load, old);
+  }
+  
+  static CExpression* fence_callback(ValueBuilder& builder, const ValuePtr<Fence>& term) {
+    check_atomic_builtins(builder, term);
+    CExpression *order = atomic_order(builder, term->ordering, &term->location());
+    builder.c_builder().builtin_call(&term->location(), builder.type_builder().void_type(), "__atomic_thread_fence", 1, &order);
+    return NULL;
+  }
+  
   static CExpression* alloca_callback(ValueBuilder& builder, const ValuePtr<Alloca>& term) {
     if (builder.is_void_type(term->element_type))
       return builder.type_builder().get_null();
@@ -306,7 +671,7 @@ struct ValueBuilderCallbacks {
       PSI_ASSERT(has_vla);
       PSI_ASSERT(count && max_count);
       // Need to check whether we have fewer or more than the maximum number of elements
-      CExpression *count_is_large = builder.c_builder().binary(&term->location(), NULL, c_eval_pure, c_op_cmp_ge, count, builder.integer_literal(*max_count));
+      CExpression *count_is_large = builder.c_builder().binary(&term->location(), NULL, c_eval_pure, c_op_cmp_gt, count, builder.integer_literal(*max_count));
       CExpression *local_count = builder.c_builder().ternary(&term->location(), NULL, c_eval_write, c_op_ternary, count_is_large, builder.integer_literal(0), count);
       CExpression *count = builder.build(term->count);
       CExpression *local_alloc = builder.c_builder().declare(&term->location(), el_ty, c_op_vardeclare, local_count, alignment_value);
@@ -385,7 +750,15 @@ struct ValueBuilderCallbacks {
       .add<PointerCast>(pointer_cast_callback)
       .add<PointerOffset>(pointer_offset_callback)
       .add<ElementPtr>(element_ptr_callback)
+      .add<ElementValue>(element_value_callback)
       .add<Select>(select_value_callback)
+      .add<VectorValue>(vector_value_callback)
+      .add<VectorElement>(vector_element_callback)
+      .add<VectorInsert>(vector_insert_callback)
+      .add<VectorShuffle>(vector_shuffle_callback)
+      .add<VectorReduceAdd>(VectorReduceHandler(c_op_add))
+      .add<VectorReduceAnd>(VectorReduceHandler(c_op_and))
+      .add<VectorReduceOr>(VectorReduceHandler(c_op_or))
       .add<BitCast>(bitcast_callback)
       .add<ShiftLeft>(BinaryOpHandler(c_op_shl))
       .add<ShiftRight>(BinaryOpHandler(c_op_shr))
@@ -397,12 +770,12 @@ struct ValueBuilderCallbacks {
       .add<BitOr>(BinaryOpHandler(c_op_or))
       .add<BitXor>(BinaryOpHandler(c_op_xor))
       .add<BitNot>(UnaryOpHandler(c_op_not))
-      .add<IntegerCompareEq>(BinaryOpHandler(c_op_cmp_eq))
-      .add<IntegerCompareNe>(BinaryOpHandler(c_op_cmp_ne))
-      .add<IntegerCompareGt>(BinaryOpHandler(c_op_cmp_gt))
-      .add<IntegerCompareLt>(BinaryOpHandler(c_op_cmp_lt))
-      .add<IntegerCompareGe>(BinaryOpHandler(c_op_cmp_ge))
-      .add<IntegerCompareLe>(BinaryOpHandler(c_op_cmp_gt));
+      .add<IntegerCompareEq>(CompareOpHandler(c_op_cmp_eq))
+      .add<IntegerCompareNe>(CompareOpHandler(c_op_cmp_ne))
+      .add<IntegerCompareGt>(CompareOpHandler(c_op_cmp_gt))
+      .add<IntegerCompareLt>(CompareOpHandler(c_op_cmp_lt))
+      .add<IntegerCompareGe>(CompareOpHandler(c_op_cmp_ge))
+      .add<IntegerCompareLe>(CompareOpHandler(c_op_cmp_le));
   }
   
   typedef TermOperationMap<Instruction, CExpression*, ValueBuilder&> InstructionCallbackMap;
@@ -416,6 +789,9 @@ struct ValueBuilderCallbacks {
       .add<Call>(function_call_callback)
       .add<Load>(load_callback)
       .add<Store>(store_callback)
+      .add<AtomicRMW>(atomic_rmw_callback)
+      .add<CmpXchg>(cmpxchg_callback)
+      .add<Fence>(fence_callback)
       .add<Alloca>(alloca_callback)
       .add<AllocaConst>(alloca_const_callback)
       .add<FreeAlloca>(freea_callback)
@@ -430,14 +806,26 @@ ValueBuilderCallbacks::InstructionCallbackMap ValueBuilderCallbacks::instruction
 
 ValueBuilder::ValueBuilder(TypeBuilder *type_builder)
 : m_type_builder(type_builder),
-m_c_builder(&type_builder->module()) {
+m_c_builder(&type_builder->module()),
+m_global(NULL) {
 }
 
+/**
+ * \brief Create a builder for a function or block.
+ * 
+ * Values built by \c base are visible to the new builder. Values
+ * from the module level builder are looked up there rather than
+ * copied, so that starting a function does not cost time proportional
+ * to the number of globals in the module.
+ */
 ValueBuilder::ValueBuilder(const ValueBuilder& base, CFunction *function)
 : m_type_builder(base.m_type_builder),
 m_c_builder(&base.module(), function),
-m_expressions(base.m_expressions),
-m_phis(base.m_phis) {
+m_global(base.m_global ? base.m_global : &base) {
+  if (base.m_global) {
+    m_expressions = base.m_expressions;
+    m_phis = base.m_phis;
+  }
 }
 
 /**
@@ -451,7 +839,13 @@ m_phis(base.m_phis) {
  */
 CExpression* ValueBuilder::build(const ValuePtr<>& value, bool PSI_UNUSED(force_eval)) {
   ExpressionMapType::const_iterator it = m_expressions.find(value);
-  if (it != m_expressions.end()) {
+  bool found = (it != m_expressions.end());
+  if (!found && m_global) {
+    it = m_global->m_expressions.find(value);
+    found = (it != m_global->m_expressions.end());
+  }
+  
+  if (found) {
     PSI_ASSERT(it->second);
     if (it->second->eval != c_eval_never)
       it->second->requires_name = true;
@@ -3,9 +3,13 @@
 
 #include "../Aggregate.hpp"
 #include "../Core.hpp"
+#include "../Devirtualize.hpp"
 #include "../Function.hpp"
 #include "../Functional.hpp"
 #include "../Recursive.hpp"
+#include "../StackSlots.hpp"
+
+#include <iostream>
 
 namespace Psi {
   namespace Tvm {
@@ -186,7 +190,7 @@ namespace Psi {
       ModuleBuilder::ModuleBuilder(CompileErrorContext *error_context,
                                    llvm::LLVMContext *llvm_context, llvm::TargetMachine *target_machine, llvm::Module *llvm_module,
                                    TargetCallback *target_callback)
-        : m_error_context(error_context), m_llvm_context(llvm_context),
+        : stack_slot_report(false), m_error_context(error_context), m_llvm_context(llvm_context),
         m_llvm_triple(target_machine->getTargetTriple()), m_llvm_target_machine(target_machine),
         m_llvm_module(llvm_module), m_target_callback(target_callback) {
         m_llvm_memcpy = intrinsic_memcpy(*llvm_module, target_machine);
@@ -253,6 +257,11 @@ namespace Psi {
         aggregate_lowering_pass.update();
         
         Module *rewritten_module = aggregate_lowering_pass.target_module();
+        DevirtualizePass().run(*rewritten_module);
+        StackSlotPass stack_slot_pass(target_callback()->aggregate_lowering_callback());
+        stack_slot_pass.run(*rewritten_module);
+        if (stack_slot_report)
+          stack_slot_pass.write_report(std::cerr);
         
         for (Module::ModuleMemberList::iterator i = module->members().begin(), e = module->members().end(); i != e; ++i) {
           const ValuePtr<Global>& old_term = i->second;
@@ -263,6 +272,9 @@ namespace Psi {
           switch (term->term_type()) {
           case term_global_variable: {
             ValuePtr<GlobalVariable> global = value_cast<GlobalVariable>(term);
+            // RuntimeDyld cannot apply TLS relocations, so MCJIT cannot load thread local globals
+            if (global->is_thread_local())
+              error_context().error_throw(global->location(), "LLVM JIT does not support thread local variables");
             llvm::Type *llvm_type = build_type(global->value_type());
             result = new llvm::GlobalVariable(*m_llvm_module, llvm_type,
                                               global->constant(), linkage,
@@ -282,6 +294,16 @@ namespace Psi {
                                                                linkage, func->name(), m_llvm_module);
             llvm_func->setAttributes(function_type_attributes(llvm_context(), func_type));
             llvm_func->setCallingConv(function_call_convention(error_context().bind(func->location()), func_type->calling_convention()));
+            switch (func->hotness()) {
+            case hotness_normal: break;
+            // There is no hot attribute, so ask for the function to be inlined into its callers instead
+            case hotness_hot: llvm_func->addFnAttr(llvm::Attribute::InlineHint); break;
+            case hotness_cold:
+              llvm_func->addFnAttr(llvm::Attribute::Cold);
+              llvm_func->addFnAttr(llvm::Attribute::OptimizeForSize);
+              break;
+            default: PSI_FAIL("Unknown function hotness");
+            }
             result = llvm_func;
             break;
           }
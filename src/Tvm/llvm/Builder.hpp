@@ -81,6 +81,9 @@ namespace Psi {
         
         ModuleMapping run(Module*);
         
+        /// \brief Write the stack usage of each function to standard error, see StackSlotPass
+        bool stack_slot_report;
+        
         llvm::Module* llvm_module() {return m_llvm_module;}
         
         llvm::Function* llvm_memcpy() {return m_llvm_memcpy;}
@@ -49,6 +49,12 @@ namespace Psi {
           if (attrs.flags & ParameterAttributes::llvm_byval) builder.addAttribute(llvm::Attribute::ByVal);
           if (attrs.flags & ParameterAttributes::llvm_inreg) builder.addAttribute(llvm::Attribute::InReg);
           if (attrs.alignment) builder.addAlignmentAttr(attrs.alignment);
+          // Aliasing attributes are only meaningful on pointers; dereferenceable is not supported before LLVM 3.6
+          if (isa<PointerType>(ftype->parameter_types()[ii].value)) {
+            if (attrs.flags & ParameterAttributes::noalias) builder.addAttribute(llvm::Attribute::NoAlias);
+            if (attrs.flags & ParameterAttributes::nocapture) builder.addAttribute(llvm::Attribute::NoCapture);
+            if (attrs.flags & ParameterAttributes::readonly) builder.addAttribute(llvm::Attribute::ReadOnly);
+          }
           
           att = att.addAttributes(ctx, idx, llvm::AttributeSet::get(ctx, idx, builder));
         }
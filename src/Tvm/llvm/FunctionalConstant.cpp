@@ -47,6 +47,14 @@ namespace Psi {
           return llvm::ConstantArray::get(llvm::cast<llvm::ArrayType>(type), elements);
         }
 
+        static llvm::Constant* vector_value_callback(ModuleBuilder& builder, const ValuePtr<VectorValue>& term) {
+          llvm::SmallVector<llvm::Constant*, 4> elements(term->length());
+          for (unsigned i = 0; i < term->length(); ++i)
+            elements[i] = builder.build_constant(term->value(i));
+
+          return llvm::ConstantVector::get(elements);
+        }
+
         static llvm::Constant* struct_value_callback(ModuleBuilder& builder, const ValuePtr<StructValue>& term) {
           llvm::StructType *type = llvm::cast<llvm::StructType>(builder.build_type(term->type()));
           llvm::SmallVector<llvm::Constant*, 4> members(term->n_members());
@@ -242,6 +250,7 @@ namespace Psi {
             .add<FloatValue>(float_value_callback)
             .add<ArrayValue>(array_value_callback)
             .add<StructValue>(struct_value_callback)
+            .add<VectorValue>(vector_value_callback)
             .add<UndefinedValue>(undefined_value_callback)
             .add<PointerCast>(pointer_cast_callback)
             .add<PointerOffset>(pointer_offset_callback)
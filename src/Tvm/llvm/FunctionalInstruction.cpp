@@ -27,6 +27,59 @@ namespace Psi {
           return array;
         }
 
+        static llvm::Value* vector_value_callback(FunctionBuilder& builder, const ValuePtr<VectorValue>& term) {
+          llvm::Type *type = builder.module_builder()->build_type(term->type());
+          llvm::Type *i32_ty = llvm::Type::getInt32Ty(builder.irbuilder().getContext());
+          llvm::Value *vector = llvm::UndefValue::get(type);
+          for (unsigned i = 0; i < term->length(); ++i) {
+            llvm::Value *element = builder.build_value(term->value(i));
+            vector = builder.irbuilder().CreateInsertElement(vector, element, llvm::ConstantInt::get(i32_ty, i));
+          }
+
+          return vector;
+        }
+        
+        static llvm::Value* vector_element_callback(FunctionBuilder& builder, const ValuePtr<VectorElement>& term) {
+          llvm::Value *vector = builder.build_value(term->vector());
+          llvm::Value *index = builder.build_value(term->index());
+          return builder.irbuilder().CreateExtractElement(vector, index);
+        }
+        
+        static llvm::Value* vector_insert_callback(FunctionBuilder& builder, const ValuePtr<VectorInsert>& term) {
+          llvm::Value *vector = builder.build_value(term->vector());
+          llvm::Value *index = builder.build_value(term->index());
+          llvm::Value *value = builder.build_value(term->value());
+          return builder.irbuilder().CreateInsertElement(vector, value, index);
+        }
+        
+        static llvm::Value* vector_shuffle_callback(FunctionBuilder& builder, const ValuePtr<VectorShuffle>& term) {
+          llvm::Value *lhs = builder.build_value(term->lhs());
+          llvm::Value *rhs = builder.build_value(term->rhs());
+          llvm::Type *i32_ty = llvm::Type::getInt32Ty(builder.irbuilder().getContext());
+          llvm::SmallVector<llvm::Constant*, 8> mask;
+          for (std::vector<unsigned>::const_iterator ii = term->mask().begin(), ie = term->mask().end(); ii != ie; ++ii)
+            mask.push_back(llvm::ConstantInt::get(i32_ty, *ii));
+          return builder.irbuilder().CreateShuffleVector(lhs, rhs, llvm::ConstantVector::get(mask));
+        }
+        
+        /// LLVM 3.x has no reduction intrinsics, so combine lanes one at a time and leave the rest to the vectorizer
+        struct VectorReduceHandler {
+          llvm::Instruction::BinaryOps opcode;
+
+          VectorReduceHandler(llvm::Instruction::BinaryOps opcode_) : opcode(opcode_) {}
+
+          llvm::Value* operator () (FunctionBuilder& builder, const ValuePtr<VectorReduceOp>& term) const {
+            llvm::Value *vector = builder.build_value(term->parameter());
+            llvm::Type *i32_ty = llvm::Type::getInt32Ty(builder.irbuilder().getContext());
+            llvm::Value *result = builder.irbuilder().CreateExtractElement(vector, llvm::ConstantInt::get(i32_ty, 0));
+            for (unsigned i = 1, e = value_cast<VectorType>(term->parameter()->type())->length(); i != e; ++i) {
+              llvm::Value *lane = builder.irbuilder().CreateExtractElement(vector, llvm::ConstantInt::get(i32_ty, i));
+              result = builder.irbuilder().CreateBinOp(opcode, result, lane);
+            }
+            return result;
+          }
+        };
+
         static llvm::Value* struct_value_callback(FunctionBuilder& builder, const ValuePtr<StructValue>& term) {
           llvm::Type *type = builder.module_builder()->build_type(term->type());
           llvm::Value *result = llvm::UndefValue::get(type);
@@ -127,16 +180,25 @@ namespace Psi {
             return builder.irbuilder().CreateBitCast(target_sized_value, target_type);
         }
         
+        /// Convert a shift count to the type of the value being shifted, splatting it across all lanes of a vector
+        static llvm::Value* shift_count(FunctionBuilder& builder, llvm::Value *shift, llvm::Type *ty) {
+          if (llvm::VectorType *vector_ty = llvm::dyn_cast<llvm::VectorType>(ty)) {
+            shift = zext_or_trunc(builder, shift, vector_ty->getElementType());
+            return builder.irbuilder().CreateVectorSplat(vector_ty->getNumElements(), shift);
+          }
+          return zext_or_trunc(builder, shift, ty);
+        }
+        
         static llvm::Value* shl_callback(FunctionBuilder& builder, const ValuePtr<ShiftLeft>& term) {
           llvm::Value *value = builder.build_value(term->lhs()), *shift = builder.build_value(term->rhs());
-          shift = zext_or_trunc(builder, shift, value->getType());
+          shift = shift_count(builder, shift, value->getType());
           return builder.irbuilder().CreateShl(value, shift);
         }
         
         static llvm::Value* shr_callback(FunctionBuilder& builder, const ValuePtr<ShiftRight>& term) {
           llvm::Value *value = builder.build_value(term->lhs()), *shift = builder.build_value(term->rhs());
-          shift = zext_or_trunc(builder, shift, value->getType());
-          return value_cast<IntegerType>(term->type())->is_signed() ?
+          shift = shift_count(builder, shift, value->getType());
+          return value_cast<IntegerType>(lane_type(term->type()))->is_signed() ?
             builder.irbuilder().CreateAShr(value, shift) : builder.irbuilder().CreateLShr(value, shift);
         }
 
@@ -176,7 +238,7 @@ namespace Psi {
           llvm::Value* operator () (FunctionBuilder& builder, const ValuePtr<BinaryOp>& term) const {
             llvm::Value* lhs = builder.build_value(term->lhs());
             llvm::Value* rhs = builder.build_value(term->rhs());
-            if (value_cast<IntegerType>(term->lhs()->type())->is_signed())
+            if (value_cast<IntegerType>(lane_type(term->lhs()->type()))->is_signed())
               return (builder.irbuilder().*si_callback)(lhs, rhs, "");
             else
               return (builder.irbuilder().*ui_callback)(lhs, rhs, "");
@@ -187,7 +249,7 @@ namespace Psi {
           // Can't use IntegerBinaryOpHandler because CreateSDiv and CreateUDiv take a default extra parameter
           llvm::Value* lhs = builder.build_value(term->lhs());
           llvm::Value* rhs = builder.build_value(term->rhs());
-          if (value_cast<IntegerType>(term->type())->is_signed())
+          if (value_cast<IntegerType>(lane_type(term->type()))->is_signed())
             return builder.irbuilder().CreateSDiv(lhs, rhs, "");
           else
             return builder.irbuilder().CreateUDiv(lhs, rhs, "");
@@ -207,6 +269,13 @@ namespace Psi {
             .add<MetatypeAlignment>(metatype_alignment_callback)
             .add<ArrayValue>(array_value_callback)
             .add<StructValue>(struct_value_callback)
+            .add<VectorValue>(vector_value_callback)
+            .add<VectorElement>(vector_element_callback)
+            .add<VectorInsert>(vector_insert_callback)
+            .add<VectorShuffle>(vector_shuffle_callback)
+            .add<VectorReduceAdd>(VectorReduceHandler(llvm::Instruction::Add))
+            .add<VectorReduceAnd>(VectorReduceHandler(llvm::Instruction::And))
+            .add<VectorReduceOr>(VectorReduceHandler(llvm::Instruction::Or))
             .add<FunctionSpecialize>(function_specialize_callback)
             .add<PointerCast>(pointer_cast_callback)
             .add<PointerOffset>(pointer_offset_callback)
@@ -2,12 +2,14 @@
 
 #include "../Aggregate.hpp"
 #include "../Instructions.hpp"
+#include "../Number.hpp"
 #include "../TermOperationMap.hpp"
 
 #include <boost/assign.hpp>
 #include <boost/make_shared.hpp>
 
 #include <llvm/IR/Function.h>
+#include <llvm/IR/MDBuilder.h>
 
 namespace Psi {
   namespace Tvm {
@@ -25,7 +27,10 @@ namespace Psi {
           llvm::Value *cond = builder.build_value(insn->condition);
           llvm::BasicBlock *true_target = llvm::cast<llvm::BasicBlock>(builder.build_value(insn->true_target));
           llvm::BasicBlock *false_target = llvm::cast<llvm::BasicBlock>(builder.build_value(insn->false_target));
-          return builder.irbuilder().CreateCondBr(cond, true_target, false_target);
+          llvm::MDNode *weights = NULL;
+          if (insn->has_weights())
+            weights = llvm::MDBuilder(builder.llvm_context()).createBranchWeights(insn->true_weight, insn->false_weight);
+          return builder.irbuilder().CreateCondBr(cond, true_target, false_target, weights);
         }
 
         static llvm::Instruction* unconditional_branch_callback(FunctionBuilder& builder, const ValuePtr<UnconditionalBranch>& insn) {
@@ -61,6 +66,9 @@ namespace Psi {
           llvm::CallInst *call = builder.irbuilder().CreateCall(cast_target, parameters);
           call->setAttributes(function_type_attributes(builder.llvm_context(), function_type));
           call->setCallingConv(function_call_convention(builder.error_context().bind(insn->location()), function_type->calling_convention()));
+          // LLVM 3.4 has no musttail marker, so required tail calls are only marked as tail calls
+          if (insn->tail != tail_call_none)
+            call->setTailCall(true);
           
           if (function_type->sret()) {
             return NULL;
@@ -71,15 +79,105 @@ namespace Psi {
           }
         }
         
+        static llvm::AtomicOrdering llvm_ordering(AtomicOrdering ordering) {
+          switch (ordering) {
+          case atomic_none: return llvm::NotAtomic;
+          case atomic_relaxed: return llvm::Monotonic;
+          case atomic_acquire: return llvm::Acquire;
+          case atomic_release: return llvm::Release;
+          case atomic_acq_rel: return llvm::AcquireRelease;
+          case atomic_seq_cst: return llvm::SequentiallyConsistent;
+          default: PSI_FAIL("unexpected atomic ordering");
+          }
+        }
+        
+        /// Atomic loads and stores must have their alignment set explicitly
+        static unsigned atomic_alignment(FunctionBuilder& builder, llvm::Type *type) {
+          return builder.module_builder()->llvm_target_machine()->getDataLayout()->getABITypeAlignment(type);
+        }
+        
         static llvm::Instruction* load_callback(FunctionBuilder& builder, const ValuePtr<Load>& term) {
           llvm::Value *target = builder.build_value(term->target);
-          return builder.irbuilder().CreateLoad(target);
+          llvm::LoadInst *load = builder.irbuilder().CreateLoad(target);
+          if (term->ordering != atomic_none) {
+            load->setAtomic(llvm_ordering(term->ordering));
+            load->setAlignment(atomic_alignment(builder, load->getType()));
+          }
+          return load;
         }
 
         static llvm::Instruction* store_callback(FunctionBuilder& builder, const ValuePtr<Store>& term) {
           llvm::Value *target = builder.build_value(term->target);
           llvm::Value *value = builder.build_value(term->value);
-          return builder.irbuilder().CreateStore(value, target);
+          llvm::StoreInst *store = builder.irbuilder().CreateStore(value, target);
+          if (term->ordering != atomic_none) {
+            store->setAtomic(llvm_ordering(term->ordering));
+            store->setAlignment(atomic_alignment(builder, value->getType()));
+          }
+          return store;
+        }
+        
+        /**
+         * LLVM only supports integer operands to atomicrmw and cmpxchg, so pointers
+         * are converted to integers of the same size.
+         */
+        static llvm::Value* atomic_integer(FunctionBuilder& builder, llvm::Value *value) {
+          if (!value->getType()->isPointerTy())
+            return value;
+          llvm::Type *int_type = builder.module_builder()->llvm_target_machine()->getDataLayout()->getIntPtrType(value->getType());
+          return builder.irbuilder().CreatePtrToInt(value, int_type);
+        }
+        
+        static llvm::Value* atomic_integer_ptr(FunctionBuilder& builder, llvm::Value *ptr, llvm::Value *integer_value) {
+          return builder.irbuilder().CreatePointerCast(ptr, integer_value->getType()->getPointerTo());
+        }
+        
+        static llvm::Value* atomic_result(FunctionBuilder& builder, llvm::Value *result, llvm::Type *type) {
+          if (type->isPointerTy())
+            return builder.irbuilder().CreateIntToPtr(result, type);
+          return result;
+        }
+
+        static llvm::Value* atomic_rmw_callback(FunctionBuilder& builder, const ValuePtr<AtomicRMW>& term) {
+          llvm::Value *value = builder.build_value(term->value);
+          llvm::Value *int_value = atomic_integer(builder, value);
+          llvm::Value *target = atomic_integer_ptr(builder, builder.build_value(term->target), int_value);
+          // Only min and max depend on signedness, and pointers are only allowed for xchg
+          bool is_signed = false;
+          if (ValuePtr<IntegerType> int_type = dyn_cast<IntegerType>(term->value->type()))
+            is_signed = int_type->is_signed();
+          
+          llvm::AtomicRMWInst::BinOp op;
+          switch (term->op) {
+          case atomic_rmw_add: op = llvm::AtomicRMWInst::Add; break;
+          case atomic_rmw_sub: op = llvm::AtomicRMWInst::Sub; break;
+          case atomic_rmw_and: op = llvm::AtomicRMWInst::And; break;
+          case atomic_rmw_or: op = llvm::AtomicRMWInst::Or; break;
+          case atomic_rmw_xor: op = llvm::AtomicRMWInst::Xor; break;
+          case atomic_rmw_xchg: op = llvm::AtomicRMWInst::Xchg; break;
+          case atomic_rmw_min: op = is_signed ? llvm::AtomicRMWInst::Min : llvm::AtomicRMWInst::UMin; break;
+          case atomic_rmw_max: op = is_signed ? llvm::AtomicRMWInst::Max : llvm::AtomicRMWInst::UMax; break;
+          default: PSI_FAIL("unexpected atomic operation");
+          }
+          
+          llvm::Value *result = builder.irbuilder().CreateAtomicRMW(op, target, int_value, llvm_ordering(term->ordering));
+          return atomic_result(builder, result, value->getType());
+        }
+        
+        static llvm::Value* cmpxchg_callback(FunctionBuilder& builder, const ValuePtr<CmpXchg>& term) {
+          llvm::Value *value = builder.build_value(term->value);
+          llvm::Value *int_value = atomic_integer(builder, value);
+          llvm::Value *int_expected = atomic_integer(builder, builder.build_value(term->expected));
+          llvm::Value *target = atomic_integer_ptr(builder, builder.build_value(term->target), int_value);
+          llvm::Value *pair = builder.irbuilder().CreateAtomicCmpXchg(target, int_expected, int_value,
+                                                                      llvm_ordering(term->success_ordering),
+                                                                      llvm_ordering(term->failure_ordering));
+          llvm::Value *result = builder.irbuilder().CreateExtractValue(pair, 0);
+          return atomic_result(builder, result, value->getType());
+        }
+        
+        static llvm::Instruction* fence_callback(FunctionBuilder& builder, const ValuePtr<Fence>& term) {
+          return builder.irbuilder().CreateFence(llvm_ordering(term->ordering));
         }
 
         static llvm::Instruction* alloca_callback(FunctionBuilder& builder, const ValuePtr<Alloca>& term) {
@@ -195,6 +293,9 @@ namespace Psi {
             .add<Call>(function_call_callback)
             .add<Load>(load_callback)
             .add<Store>(store_callback)
+            .add<AtomicRMW>(atomic_rmw_callback)
+            .add<CmpXchg>(cmpxchg_callback)
+            .add<Fence>(fence_callback)
             .add<Alloca>(alloca_callback)
             .add<AllocaConst>(alloca_const_callback)
             .add<FreeAlloca>(freea_callback)
@@ -29,6 +29,8 @@ struct LLVMJitModule {
   ModuleMapping mapping;
   ModuleJitMapping jit_mapping;
   std::size_t load_priority;
+  /// Functions written to the perf map, if enabled
+  JitPerfMap::SymbolList perf_symbols;
 };
 
 class LLVMJit : public Jit {
@@ -54,6 +56,7 @@ private:
   boost::unordered_map<Module*, LLVMJitModule> m_modules;
   typedef boost::unordered_map<std::string, void*> ExportedSymbolMap;
   ExportedSymbolMap m_exported_symbols;
+  JitPerfMap *m_perf_map;
 
   void populate_pass_manager(llvm::PassManager& pm);
   
@@ -69,6 +72,7 @@ m_error_context(&error_loc.context()),
 m_target_callback(error_loc, &m_llvm_context, host_machine, host_triple),
 m_target_machine(host_machine),
 m_load_priority_max(0) {
+  m_perf_map = JitPerfMap::get(config);
   populate_pass_manager(m_llvm_module_pass);
 }
 
@@ -120,19 +124,32 @@ namespace {
 
   typedef boost::unordered_map<std::string, void*> SymbolAddressMap;
   
+  struct EmittedSymbols {
+    SymbolAddressMap addresses;
+    JitPerfMap::SymbolList functions;
+  };
+  
   void object_notify_emitted(const llvm::ObjectImage& obj, void *user_ptr) {
-    SymbolAddressMap& sym_map = *static_cast<SymbolAddressMap*>(user_ptr);
+    EmittedSymbols& emitted = *static_cast<EmittedSymbols*>(user_ptr);
 
     llvm::error_code err;
     llvm::StringRef name;
-    uint64_t addr;
+    uint64_t addr, size;
     llvm::object::SymbolRef::Type type;
     for (llvm::object::symbol_iterator ii = obj.begin_symbols(), ie = obj.end_symbols(); ii != ie; ii.increment(err)) {
       ii->getType(type);
       if ((type == llvm::object::SymbolRef::ST_Data) || (type == llvm::object::SymbolRef::ST_Function)) {
         ii->getName(name);
         ii->getAddress(addr);
-        sym_map[name] = reinterpret_cast<void*>(addr);
+        emitted.addresses[name] = reinterpret_cast<void*>(addr);
+        
+        if ((type == llvm::object::SymbolRef::ST_Function) && !ii->getSize(size) && size) {
+          JitPerfMap::Symbol sym;
+          sym.start = reinterpret_cast<void*>(addr);
+          sym.size = size;
+          sym.name = name;
+          emitted.functions.push_back(sym);
+        }
       }
     }
   }
@@ -151,6 +168,7 @@ void LLVMJit::add_module(Module *module) {
   llvm_module->setDataLayout(m_target_machine->getDataLayout()->getStringRepresentation());
   
   ModuleBuilder builder(&error_context(), &m_llvm_context, m_target_machine.get(), llvm_module, &m_target_callback);
+  builder.stack_slot_report = m_config.path_bool("stack_slot_report");
   mapping.mapping = builder.run(module);
   
 #if PSI_DEBUG
@@ -166,8 +184,8 @@ void LLVMJit::add_module(Module *module) {
                                                         &LLVMJit::symbol_lookup, this));
   PSI_ASSERT_MSG(mapping.jit, "LLVM JIT creation failed - most likely the JIT has not been linked in");
 
-  SymbolAddressMap symbol_map;
-  boost::scoped_ptr<llvm::JITEventListener> listener(psi_tvm_llvm_make_object_notify_wrapper(&object_notify_emitted, &symbol_map));
+  EmittedSymbols emitted;
+  boost::scoped_ptr<llvm::JITEventListener> listener(psi_tvm_llvm_make_object_notify_wrapper(&object_notify_emitted, &emitted));
   mapping.jit->RegisterJITEventListener(listener.get());
   mapping.load_priority = 0;
   mapping.jit->finalizeObject();
@@ -182,13 +200,18 @@ void LLVMJit::add_module(Module *module) {
   // Add to global symbol list
   for (ModuleMapping::const_iterator ii = jit_module.mapping.begin(), ie = jit_module.mapping.end(); ii != ie; ++ii) {
     if (is_linkage_shared(ii->first->linkage())) {
-      SymbolAddressMap::iterator ji = symbol_map.find(ii->second->getName());
-      PSI_ASSERT(ji != symbol_map.end());
+      SymbolAddressMap::iterator ji = emitted.addresses.find(ii->second->getName());
+      PSI_ASSERT(ji != emitted.addresses.end());
       jit_module.jit_mapping.insert(std::make_pair(ii->first, ji->second));
       m_exported_symbols[ii->first->name()] = ji->second;
     }
   }
 
+  if (m_perf_map) {
+    jit_module.perf_symbols.swap(emitted.functions);
+    m_perf_map->add(jit_module.perf_symbols);
+  }
+
   jit_module.load_priority = ++m_load_priority_max;
   jit_module.jit->runStaticConstructorsDestructors(false);
 }
@@ -208,6 +231,8 @@ void LLVMJit::remove_module(Module *module) {
   }
 
   jit_module.jit->runStaticConstructorsDestructors(true);
+  if (m_perf_map)
+    m_perf_map->remove(jit_module.perf_symbols);
   m_modules.erase(it);
 }
 
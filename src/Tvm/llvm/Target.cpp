@@ -103,6 +103,15 @@ namespace Psi {
           return type_size_alignment_simple(integer_type(context(), target_data_layout(), int_ty->width()));
         } else if (ValuePtr<FloatType> float_ty = dyn_cast<FloatType>(type)) {
           return type_size_alignment_simple(float_type(context(), float_ty->width()));
+        } else if (ValuePtr<VectorType> vector_ty = dyn_cast<VectorType>(type)) {
+          llvm::Type *element_type;
+          if (ValuePtr<IntegerType> int_el = dyn_cast<IntegerType>(vector_ty->element_type()))
+            element_type = integer_type(context(), target_data_layout(), int_el->width());
+          else if (ValuePtr<FloatType> float_el = dyn_cast<FloatType>(vector_ty->element_type()))
+            element_type = float_type(context(), float_el->width());
+          else
+            element_type = llvm::Type::getInt1Ty(context());
+          return type_size_alignment_simple(llvm::VectorType::get(element_type, vector_ty->length()));
         } else if (isa<EmptyType>(type) || isa<BlockType>(type)) {
           TypeSizeAlignment result;
           result.size = 0;
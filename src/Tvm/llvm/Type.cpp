@@ -49,6 +49,10 @@ namespace Psi {
           return llvm::ArrayType::get(element_type, length_value.getZExtValue());
         }
 
+        static llvm::Type* vector_type_callback(ModuleBuilder& builder, const ValuePtr<VectorType>& term) {
+          return llvm::VectorType::get(builder.build_type(term->element_type()), term->length());
+        }
+
         static llvm::Type* struct_type_callback(ModuleBuilder& builder, const ValuePtr<StructType>& term) {
           llvm::SmallVector<llvm::Type*, 8> member_types;
           for (unsigned i = 0, e = term->n_members(); i != e; ++i)
@@ -72,6 +76,7 @@ namespace Psi {
             .add<IntegerType>(integer_type_callback)
             .add<FloatType>(float_type_callback)
             .add<ArrayType>(array_type_callback)
+            .add<VectorType>(vector_type_callback)
             .add<StructType>(struct_type_callback);
         }
       };
@@ -93,10 +93,18 @@ struct TvmFunctionalLowererMap {
         parameter_types.push_back(parameter.value);
         break;
         
-      default:
-        parameter_types.push_back(Tvm::FunctionalBuilder::pointer_type(parameter.value, function_ty->location()));
+      default: {
+        Tvm::ParameterAttributes attributes;
+        if (ii->flags & parameter_flag_noalias)
+          attributes.flags |= Tvm::ParameterAttributes::noalias;
+        if (ii->flags & parameter_flag_nocapture)
+          attributes.flags |= Tvm::ParameterAttributes::nocapture;
+        if (ii->flags & parameter_flag_readonly)
+          attributes.flags |= Tvm::ParameterAttributes::readonly;
+        parameter_types.push_back(Tvm::ParameterType(Tvm::FunctionalBuilder::pointer_type(parameter.value, function_ty->location()), attributes));
         break;
       }
+      }
     }
     
     for (PSI_STD::vector<TreePtr<InterfaceValue> >::const_iterator ii = function_ty->interfaces.begin(), ie = function_ty->interfaces.end(); ii != ie; ++ii) {
@@ -133,7 +133,15 @@ struct TvmFunctionBuilder::InstructionLowering {
     Tvm::ValuePtr<Tvm::Block> true_block = builder.builder().new_block(if_then_else->true_value->location());
     Tvm::ValuePtr<Tvm::Block> false_block = builder.builder().new_block(if_then_else->false_value->location());
 
-    builder.builder().cond_br(condition.value, true_block, false_block, if_then_else->location());
+    unsigned true_weight = 0, false_weight = 0;
+    switch (if_then_else->hint) {
+    case branch_hint_none: break;
+    case branch_hint_likely: true_weight = Tvm::ConditionalBranch::likely_weight; false_weight = Tvm::ConditionalBranch::unlikely_weight; break;
+    case branch_hint_unlikely: true_weight = Tvm::ConditionalBranch::unlikely_weight; false_weight = Tvm::ConditionalBranch::likely_weight; break;
+    default: PSI_FAIL("Unexpected enum value");
+    }
+    
+    builder.builder().cond_br(condition.value, true_block, false_block, true_weight, false_weight, if_then_else->location());
     
     MergeExitList results;
     DominatorState dominator_state = builder.dominator_state();
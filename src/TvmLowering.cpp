@@ -8,6 +8,9 @@
 #include "Tvm/Function.hpp"
 #include "Tvm/Recursive.hpp"
 
+#include <fstream>
+#include <iostream>
+
 #include <boost/format.hpp>
 
 namespace Psi {
@@ -369,8 +372,15 @@ const TvmTargetSymbol& TvmTargetScope::library_symbol(const TreePtr<LibrarySymbo
   return sym;
 }
 
-TvmObjectCompilerBase::TvmObjectCompilerBase(TvmJitCompiler *jit_compiler, TvmTargetScope *target, const TreePtr<Module>& module, Tvm::Module *tvm_module)
-: m_jit_compiler(jit_compiler), m_target(target), m_module(module), m_tvm_module(tvm_module) {
+/**
+ * \param share_private Whether module private globals may be used by other modules
+ * compiled alongside this one. All modules built by the JIT are loaded into the
+ * same process and together form a single library, so this is true for the JIT,
+ * and symbol names are then taken from TvmJitCompiler::symbol_names.
+ */
+TvmObjectCompilerBase::TvmObjectCompilerBase(TvmJitCompiler *jit_compiler, TvmTargetScope *target, const TreePtr<Module>& module, Tvm::Module *tvm_module, bool share_private)
+: m_jit_compiler(jit_compiler), m_target(target), m_module(module), m_tvm_module(tvm_module), m_share_private(share_private),
+m_symbol_names(share_private ? &jit_compiler->symbol_names() : &m_own_symbol_names) {
   m_scope = TvmScope::new_(m_target->scope());
 }
 
@@ -387,10 +397,10 @@ TvmResult TvmObjectCompilerBase::get_global(const TreePtr<Global>& global) {
 }
 
 namespace {
-  Tvm::Linkage tvm_linkage(Linkage linkage, bool same_module) {
+  Tvm::Linkage tvm_linkage(Linkage linkage, bool same_module, bool share_private) {
     switch (linkage) {
     case link_local: return Tvm::link_local;
-    case link_private: return Tvm::link_private;
+    case link_private: return !share_private ? Tvm::link_private : same_module ? Tvm::link_export : Tvm::link_import;
     case link_one_definition: return Tvm::link_one_definition;
     case link_public: return same_module ? Tvm::link_export : Tvm::link_import;
     case link_none: PSI_FAIL("Globals with no linkage should not generate a symbol");
@@ -407,7 +417,7 @@ namespace {
  */
 Tvm::ValuePtr<Tvm::Global> TvmObjectCompilerBase::get_global_bare(const TreePtr<Global>& global) {
   if (TreePtr<ModuleGlobal> mod_global = dyn_treeptr_cast<ModuleGlobal>(global)) {
-    const std::string& symbol_name = m_symbol_names.symbol_name(mod_global);
+    const std::string& symbol_name = m_symbol_names->symbol_name(mod_global, m_share_private && (mod_global->linkage == link_private));
     if (Tvm::ValuePtr<Tvm::Global> existing = m_tvm_module->get_member(symbol_name)) {
       notify_existing_global(global, existing);
       return existing;
@@ -420,10 +430,10 @@ Tvm::ValuePtr<Tvm::Global> TvmObjectCompilerBase::get_global_bare(const TreePtr<
     if (m_module == mod_global->module) {
       TvmResult type = target().build_type(global->type, mod_global->location());
       Tvm::ValuePtr<Tvm::Global> lowered = m_tvm_module->new_member(symbol_name, type.value, global->location());
-      lowered->set_linkage(tvm_linkage(mod_global->linkage, true));
+      lowered->set_linkage(tvm_linkage(mod_global->linkage, true, m_share_private));
       return lowered;
     } else {
-      if (mod_global->linkage != link_public)
+      if ((mod_global->linkage != link_public) && !(m_share_private && (mod_global->linkage == link_private)))
         compile_context().error_throw(global->location(), "Module private global variable used in a different module");
       
       TvmResult type = target().build_type(global->type, mod_global->location());
@@ -612,14 +622,14 @@ void TvmObjectCompilerBase::run_module_global(const TreePtr<ModuleGlobal>& globa
       tvm_gvar->set_merge(global_var->merge);
     } catch (TvmNotGlobalException&) {
       tvm_gvar->set_value(Tvm::FunctionalBuilder::undef(tvm_gvar->value_type(), global_var->location()));
-      std::string ctor_name = m_symbol_names.unique_name("_Y_ctor");
+      std::string ctor_name = m_symbol_names->unique_name("_Y_ctor");
       Tvm::ValuePtr<Tvm::Function> constructor = m_tvm_module->new_constructor(ctor_name, global_var->location());
       TreePtr<Term> ctor_tree = TermBuilder::initialize_value(global_var, global_var->value(), TermBuilder::empty_value(compile_context()), global_var->location());
       tvm_lower_init(*this, global_var->module, ctor_tree, constructor, status.dependencies);
       status.init = constructor;
       
       if (global_var->type && (global_var->type->type_info().type_mode == type_mode_complex)) {
-        std::string dtor_name = m_symbol_names.unique_name("_Y_dtor");
+        std::string dtor_name = m_symbol_names->unique_name("_Y_dtor");
         Tvm::ValuePtr<Tvm::Function> destructor = m_tvm_module->new_constructor(dtor_name, global_var->location());
         TreePtr<Term> dtor_body = TermBuilder::finalize_value(global_var, global_var->location());
         tvm_lower_init(*this, global_var->module, dtor_body, destructor, status.dependencies);
@@ -640,14 +650,14 @@ void TvmObjectCompilerBase::run_module_global(const TreePtr<ModuleGlobal>& globa
       tvm_gvar->set_value(value.value);
     } catch (TvmNotGlobalException&) {
       tvm_gvar->set_value(Tvm::FunctionalBuilder::undef(tvm_gvar->value_type(), global_stmt->location()));
-      std::string ctor_name = m_symbol_names.unique_name("_Y_ctor");
+      std::string ctor_name = m_symbol_names->unique_name("_Y_ctor");
       Tvm::ValuePtr<Tvm::Function> constructor = m_tvm_module->new_constructor(ctor_name, global_stmt->location());
       TreePtr<Term> ctor_tree = TermBuilder::initialize_value(global_stmt, global_stmt->value, TermBuilder::empty_value(compile_context()), global_stmt->location());
       tvm_lower_init(*this, global_stmt->module, ctor_tree, constructor, status.dependencies);
       status.init = constructor;
       
       if (global_stmt->type && (global_stmt->type->type_info().type_mode == type_mode_complex)) {
-        std::string dtor_name = m_symbol_names.unique_name("_Y_dtor");
+        std::string dtor_name = m_symbol_names->unique_name("_Y_dtor");
         Tvm::ValuePtr<Tvm::Function> destructor = m_tvm_module->new_constructor(dtor_name, global_stmt->location());
         TreePtr<Term> dtor_body = TermBuilder::finalize_value(global_stmt, global_stmt->location());
         tvm_lower_init(*this, global_stmt->module, dtor_body, destructor, status.dependencies);
@@ -664,18 +674,17 @@ void TvmObjectCompilerBase::run_module_global(const TreePtr<ModuleGlobal>& globa
 }
 
 TvmJitObjectCompiler::TvmJitObjectCompiler(TvmJitCompiler *jit_compiler, TvmTargetScope *target, const TreePtr<Module>& module)
-: TvmObjectCompilerBase(jit_compiler, target, module, NULL) {
+: TvmObjectCompilerBase(jit_compiler, target, module, NULL, true) {
 }
 
 void TvmJitObjectCompiler::notify_existing_global(const TreePtr<Global>& global, const Tvm::ValuePtr<Tvm::Global>& tvm_global) {
   Tvm::ValuePtr<Tvm::Global> previous;
   
   if (TreePtr<ModuleGlobal> module_global = dyn_treeptr_cast<ModuleGlobal>(global)) {
-    TvmJitCompiler::BuiltGlobalMap& globals = jit_compiler().m_pending_built_globals;
-    TvmJitCompiler::BuiltGlobalMap::iterator it = globals.find(module_global);
-    if (it == globals.end())
+    if ((jit_compiler().built_globals().find(module_global) == jit_compiler().built_globals().end()) &&
+      (jit_compiler().m_pending_built_globals.find(module_global) == jit_compiler().m_pending_built_globals.end()))
       compile_context().error_throw(global->location(), boost::format("Conflicting global symbol name: %s") % tvm_global->name());
-    previous = it->second.lowered;
+    previous = jit_compiler().built_or_pending_global(module_global).lowered;
   } else if (TreePtr<LibrarySymbol> lib_sym = dyn_treeptr_cast<LibrarySymbol>(global)) {
     TvmJitCompiler::LibrarySymbolMap& symbols = jit_compiler().m_pending_library_symbols;
     TvmJitCompiler::LibrarySymbolMap::iterator it = symbols.find(lib_sym);
@@ -691,10 +700,17 @@ void TvmJitObjectCompiler::notify_existing_global(const TreePtr<Global>& global,
     global->compile_context().error_throw(global->location(), boost::format("Conflicting global symbol: %s") % tvm_global->name());
 }
 
-void TvmJitObjectCompiler::notify_global(const TreePtr<ModuleGlobal>& global, const Tvm::ValuePtr<Tvm::Global>& tvm_global) {
-  TvmGlobalStatus& status = jit_compiler().m_pending_built_globals[global];
-  if (!status.lowered)
-    status.lowered = tvm_global;
+/**
+ * \brief Record that a global defined in another module is used.
+ * 
+ * \c tvm_global is only an import, so it is not recorded as the lowered
+ * value of \c global: that is created in the defining module when
+ * \c global is built. If \c global has already been committed to the JIT
+ * nothing is done and the import is resolved by the JIT when this
+ * module is loaded.
+ */
+void TvmJitObjectCompiler::notify_global(const TreePtr<ModuleGlobal>& global, const Tvm::ValuePtr<Tvm::Global>&) {
+  jit_compiler().built_or_pending_global(global);
 }
 
 void TvmJitObjectCompiler::notify_external_global(const TreePtr<ModuleGlobal>& global, const Tvm::ValuePtr<Tvm::Global>& tvm_global) {
@@ -709,11 +725,66 @@ void TvmJitObjectCompiler::notify_library_symbol(const TreePtr<LibrarySymbol>& l
     common = tvm_global;
 }
 
+/**
+ * \brief Constructor.
+ * 
+ * Besides selecting the JIT, \c jit_configuration may contain two profiling options:
+ * 
+ * <dl>
+ * <dt>profile_generate</dt><dd>Count how often each block and call site in JIT compiled
+ * code is executed, and add the counts to this file when the JIT is destroyed.</dd>
+ * <dt>profile_use</dt><dd>Read a profile from this file and use it to set branch weights and
+ * function hotness in all code compiled by this JIT. A missing file is ignored, so both options
+ * may name the same file to refine a profile over many runs.</dd>
+ * </dl>
+ */
 TvmJitCompiler::TvmJitCompiler(TvmTargetScope& target, const PropertyValue& jit_configuration)
 : m_target(&target) {
-  boost::shared_ptr<Tvm::JitFactory> factory =
-    Tvm::JitFactory::get_specific(target.compile_context().error_context().bind(SourceLocation::root_location("(jit)")), jit_configuration);
+  m_statistics.globals_lowered = m_statistics.modules_loaded = 0;
+  CompileErrorPair err_loc = target.compile_context().error_context().bind(SourceLocation::root_location("(jit)"));
+  boost::shared_ptr<Tvm::JitFactory> factory = Tvm::JitFactory::get_specific(err_loc, jit_configuration);
   m_jit = factory->create_jit();
+  
+  if (boost::optional<std::string> path = jit_configuration.path_str("profile_use")) {
+    std::ifstream is(path->c_str());
+    if (is && !m_profile.read(is))
+      err_loc.error_throw(boost::format("Malformed profile: %s") % *path);
+  }
+  
+  if (boost::optional<std::string> path = jit_configuration.path_str("profile_generate")) {
+    m_profile_output = *path;
+    m_profile_instrumentation.reset(new Tvm::ProfileInstrumentation());
+  }
+}
+
+TvmJitCompiler::~TvmJitCompiler() {
+  if (m_profile_instrumentation)
+    write_profile();
+}
+
+/**
+ * \brief Add the counts collected by instrumented code to the profile output file.
+ * 
+ * This is called on destruction, so errors are reported to standard error rather than thrown.
+ */
+void TvmJitCompiler::write_profile() {
+  Tvm::ProfileData profile;
+  std::ifstream is(m_profile_output.c_str());
+  if (is && !profile.read(is))
+    std::cerr << boost::format("Malformed profile will be overwritten: %s\n") % m_profile_output;
+  is.close();
+  
+  try {
+    m_profile_instrumentation->collect(*m_jit, profile);
+  } catch (CompileException&) {
+    std::cerr << boost::format("Failed to read profile counters, not writing %s\n") % m_profile_output;
+    return;
+  }
+  
+  std::ofstream os(m_profile_output.c_str());
+  profile.write(os);
+  if (!os)
+    std::cerr << boost::format("Failed to write profile: %s\n") % m_profile_output;
 }
 
 /**
@@ -816,6 +887,7 @@ Tvm::ValuePtr<Tvm::Global> TvmJitCompiler::build_module_global(const TreePtr<Mod
     case TvmGlobalStatus::global_ready: {
       status.status = TvmGlobalStatus::global_in_progress;
       module_compiler(current->module).run_module_global(current, status);
+      ++m_statistics.globals_lowered;
       status.status = TvmGlobalStatus::global_built;
       break;
     }
@@ -930,23 +1002,41 @@ void TvmJitCompiler::load_library(const TreePtr<Library>& library) {
 
 /**
  * Update all modules in the low-level JIT.
+ * 
+ * Only modules created since the last commit are passed to the JIT: each module
+ * is loaded once, and references to globals in earlier modules are resolved
+ * by the JIT when the referring module is loaded, so earlier modules are
+ * never lowered or linked again.
  */
 void TvmJitCompiler::jit_commit() {
   // Ensure all modules are up to date in the JIT
   while (!m_current_modules.empty()) {
     CurrentModuleList::value_type& val = m_current_modules.back();
     val.first->reset_tvm_module(NULL);
+    m_profile.apply(*val.second);
+    if (m_profile_instrumentation)
+      m_profile_instrumentation->instrument(*val.second);
+    try {
+      m_jit->add_module(val.second.get());
+    } catch (...) {
+      // The module will be dropped by jit_rollback, so its counters can never be read
+      if (m_profile_instrumentation)
+        m_profile_instrumentation->discard(*val.second);
+      throw;
+    }
     m_built_modules.push_back(val.second);
-    m_jit->add_module(val.second.get());
+    ++m_statistics.modules_loaded;
     m_current_modules.pop_back();
   }
   
   m_built_globals.insert(m_pending_built_globals.begin(), m_pending_built_globals.end());
   m_pending_built_globals.clear();
+  m_symbol_names.commit();
   
   if (m_library_module) {
     m_built_modules.push_back(m_library_module);
     m_jit->add_module(m_library_module.get());
+    ++m_statistics.modules_loaded;
     m_library_module.reset();
     m_library_symbols.insert(m_pending_library_symbols.begin(), m_pending_library_symbols.end());
     m_pending_library_symbols.clear();
@@ -957,8 +1047,11 @@ void TvmJitCompiler::jit_commit() {
  * Remove the result of pending compilations from the current JIT state.
  */
 void TvmJitCompiler::jit_rollback() {
+  for (CurrentModuleList::const_iterator ii = m_current_modules.begin(), ie = m_current_modules.end(); ii != ie; ++ii)
+    ii->first->reset_tvm_module(NULL);
   m_current_modules.clear();
   m_pending_built_globals.clear();
+  m_symbol_names.rollback();
   m_library_module.reset();
   m_pending_library_symbols.clear();
 }
@@ -973,6 +1066,8 @@ void TvmJitCompiler::jit_compile(const std::vector<TreePtr<Global> >& globals) {
   // hit anything else
   jit_commit();
   
+  // Loading modules can fail too, in which case they must be discarded so
+  // that later calls do not try to load them again
   try {
     for (std::vector<TreePtr<Global> >::const_iterator ii = globals.begin(), ie = globals.end(); ii != ie; ++ii) {
       Tvm::ValuePtr<Tvm::Global> built;
@@ -984,12 +1079,12 @@ void TvmJitCompiler::jit_compile(const std::vector<TreePtr<Global> >& globals) {
         m_target->compile_context().error_throw((*ii)->location(), "Cannot build global: unknown tree type");
       }
     }
-  } catch (CompileException&) {
+    
+    jit_commit();
+  } catch (...) {
     jit_rollback();
     throw;
   }
-  
-  jit_commit();
 }
 
 /**
@@ -2,6 +2,7 @@
 #define HPP_PSI_TVMLOWERING
 
 #include <boost/optional.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/intrusive/list.hpp>
 #include <boost/intrusive/unordered_set.hpp>
 
@@ -12,6 +13,7 @@
 #include "Tvm/Core.hpp"
 #include "Tvm/Jit.hpp"
 #include "Tvm/Function.hpp"
+#include "Tvm/Profile.hpp"
 
 namespace Psi {
   namespace Compiler {
@@ -176,11 +178,15 @@ namespace Psi {
     class SymbolNameSet {
       boost::unordered_map<std::string, unsigned> m_unique_names;
       boost::unordered_map<TreePtr<Global>, std::string> m_symbol_names;
+      /// \brief Globals named since the last call to commit() or rollback()
+      std::vector<TreePtr<Global> > m_pending_globals;
       
     public:
       std::string unique_name(const std::string& base);
       
-      const std::string& symbol_name(const TreePtr<ModuleGlobal>& name);
+      const std::string& symbol_name(const TreePtr<ModuleGlobal>& name, bool unique=false);
+      void commit();
+      void rollback();
     };
 
     std::string symbol_implementation_name(const TreePtr<Interface>& interface, const PSI_STD::vector<TreePtr<Term> >& parameters);
@@ -191,8 +197,11 @@ namespace Psi {
       TvmScopePtr m_scope;
       TreePtr<Module> m_module;
       Tvm::Module *m_tvm_module;
+      bool m_share_private;
       TvmGeneratedImplementationSet m_implementations;
-      SymbolNameSet m_symbol_names;
+      SymbolNameSet m_own_symbol_names;
+      /// \brief Either \c m_own_symbol_names or, if private globals are shared, a set common to all modules
+      SymbolNameSet *m_symbol_names;
       
       /** Notify a global with a matching name to one that has been requested already exists.
        * The derived class should check this matches the global used to create the symbol. */
@@ -202,7 +211,7 @@ namespace Psi {
       virtual void notify_library_symbol(const TreePtr<LibrarySymbol>& lib_sym, const Tvm::ValuePtr<Tvm::Global>& tvm_global) = 0;
       
     public:
-      TvmObjectCompilerBase(TvmJitCompiler *jit_compiler, TvmTargetScope *target, const TreePtr<Module>& module, Tvm::Module *tvm_module);
+      TvmObjectCompilerBase(TvmJitCompiler *jit_compiler, TvmTargetScope *target, const TreePtr<Module>& module, Tvm::Module *tvm_module, bool share_private);
       CompileContext& compile_context() {return m_target->compile_context();}
       Tvm::Context& tvm_context() {return m_target->tvm_context();}
       TvmTargetScope& target() {return *m_target;}
@@ -242,7 +251,18 @@ namespace Psi {
     class TvmJitCompiler {
       friend class TvmJitObjectCompiler;
       
+    public:
+      /// \brief Counts of work done by a TvmJitCompiler.
+      struct Statistics {
+        /// \brief Number of globals lowered to TVM.
+        std::size_t globals_lowered;
+        /// \brief Number of TVM modules loaded into the JIT.
+        std::size_t modules_loaded;
+      };
+      
+    private:
       TvmTargetScope *m_target;
+      Statistics m_statistics;
       boost::shared_ptr<Tvm::Jit> m_jit;
 
       typedef boost::unordered_map<TreePtr<Library>, boost::shared_ptr<Platform::PlatformLibrary> > LibraryMap;
@@ -256,6 +276,9 @@ namespace Psi {
       // This is const so that all uses of m_built_globals can be easily located
       const BuiltGlobalMap& built_globals() const {return m_built_globals;}
       
+      /// \brief Symbol names, which are shared between all modules built by the JIT.
+      SymbolNameSet m_symbol_names;
+      
       std::vector<boost::shared_ptr<Tvm::Module> > m_built_modules;
       typedef std::vector<std::pair<TvmJitObjectCompiler*, boost::shared_ptr<Tvm::Module> > > CurrentModuleList;
       CurrentModuleList m_current_modules;
@@ -270,6 +293,13 @@ namespace Psi {
       
       typedef boost::unordered_map<TreePtr<Module>, boost::shared_ptr<TvmJitObjectCompiler> > ModuleCompilerMap;
       ModuleCompilerMap m_modules;
+      
+      /// \brief Profile applied to modules before they are loaded.
+      Tvm::ProfileData m_profile;
+      /// \brief File counters are written to on destruction, if \c m_profile_instrumentation is set.
+      std::string m_profile_output;
+      boost::scoped_ptr<Tvm::ProfileInstrumentation> m_profile_instrumentation;
+      void write_profile();
 
       TvmJitObjectCompiler& module_compiler(const TreePtr<Module>& module);
       std::set<TreePtr<ModuleGlobal> > initializer_dependencies(const TreePtr<ModuleGlobal>& global, bool already_built);
@@ -280,10 +310,18 @@ namespace Psi {
 
     public:
       TvmJitCompiler(TvmTargetScope& target, const PropertyValue& jit_configuration);
+      ~TvmJitCompiler();
       void jit_compile(const std::vector<TreePtr<Global> >& globals);
       void *jit_get(const TreePtr<Global>& global);
       void *compile(const TreePtr<Global>& global);
       void load_library(const TreePtr<Library>& library);
+      
+      /// \brief Symbol names used by all modules built by this JIT.
+      SymbolNameSet& symbol_names() {return m_symbol_names;}
+      /// \brief Get counts of work done by this JIT.
+      const Statistics& statistics() const {return m_statistics;}
+      /// \brief Get the profile used to optimize JIT compiled code, which is empty unless \c profile_use is configured.
+      const Tvm::ProfileData& profile() const {return m_profile;}
     };
     
     /**
@@ -54,6 +54,26 @@ std::string SymbolNameSet::unique_name(const std::string& base) {
   return ss.str();
 }
 
+/**
+ * \brief Keep the names of all globals named so far.
+ */
+void SymbolNameSet::commit() {
+  m_pending_globals.clear();
+}
+
+/**
+ * \brief Forget the names of globals named since the last commit().
+ * 
+ * These globals were never loaded, so keeping their names would keep the globals
+ * alive for the life of this set. Counters used by unique_name() are not reset,
+ * so a name is never reused.
+ */
+void SymbolNameSet::rollback() {
+  for (std::vector<TreePtr<Global> >::const_iterator ii = m_pending_globals.begin(), ie = m_pending_globals.end(); ii != ie; ++ii)
+    m_symbol_names.erase(*ii);
+  m_pending_globals.clear();
+}
+
 class SymbolLocationWriter {
   struct Node {
     int key;
@@ -114,11 +134,22 @@ public:
   }
 };
 
-const std::string& SymbolNameSet::symbol_name(const TreePtr<ModuleGlobal>& global) {
+/**
+ * \brief Get the symbol name of a global.
+ * 
+ * \param unique Append a counter to generated names so that they are distinct from
+ * every other name in this set. This is always done for local globals.
+ * The JIT sets this for private globals: it exports them from the module which
+ * defines them so that other modules loaded into the same process can import them,
+ * so their names must be unique across all those modules rather than just the
+ * defining one. The JIT shares one set between all modules for this reason.
+ */
+const std::string& SymbolNameSet::symbol_name(const TreePtr<ModuleGlobal>& global, bool unique) {
   std::string& name = m_symbol_names[global];
   if (!name.empty())
     return name;
   
+  m_pending_globals.push_back(global);
   if (!global->symbol_name.empty()) {
     PSI_ASSERT(global->linkage != link_local);
     name = global->symbol_name;
@@ -128,7 +159,7 @@ const std::string& SymbolNameSet::symbol_name(const TreePtr<ModuleGlobal>& globa
     SymbolLocationWriter lw(ss);
     lw.write(global->location().logical, true, '\0', '\0');
     name = ss.str();
-    if (global->linkage == link_local)
+    if (unique || (global->linkage == link_local))
       name = unique_name(name);
   }
   return name;
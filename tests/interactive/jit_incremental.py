@@ -0,0 +1,26 @@
+from psi_interact import test_start
+import re
+
+# Each input line should only lower and load the globals it defines:
+# functions compiled by earlier lines must be linked to, not rebuilt, so
+# the work done per line should not grow with the length of the session.
+n_functions = 120
+
+with test_start(['--stats']) as p:
+  p.check('libc : library{};')
+  p.check('getpid : libc.symbol (function (-: int)) {"type":"c","name":"getpid"};')
+  p.check('f0 : function (-: int) [getpid()];')
+  for i in xrange(1, n_functions + 1):
+    p.check('f%d : function (-: int) [f%d()];' % (i, i - 1))
+    p.check('x%d : f%d();' % (i, i))
+  out, err = p.finish()
+  
+  match = re.search(r'JIT: (\d+) globals lowered, (\d+) modules loaded', err)
+  if not match:
+    raise Exception('JIT statistics missing from output: %s' % err)
+  lowered, loaded = int(match.group(1)), int(match.group(2))
+  # Each pair of lines builds one new function and one new variable
+  if lowered > 2 * n_functions + 1:
+    raise Exception('%d globals lowered for %d functions: earlier globals were rebuilt' % (lowered, n_functions))
+  if loaded > 2 * n_functions + 2:
+    raise Exception('%d modules loaded for %d functions: earlier modules were reloaded' % (loaded, n_functions))
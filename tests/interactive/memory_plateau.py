@@ -0,0 +1,46 @@
+from psi_interact import test_start
+import re
+
+# Repeating inputs should not cause memory use to grow without bound.
+# An input which fails to compile leaves trees which are unreachable once
+# the error has been reported, and redefining a name leaves the scope
+# which held its old definition unreachable. Both should be reclaimed by
+# the collector. The definition is parsed through the parse cache, which
+# must not keep the text of each line alive; the padding makes each line
+# large enough for that to show. The statistics printed on exit check
+# that the caches were used and that collections actually ran.
+n_rounds = 4000
+window = 1000
+padding = ' ' * 2000
+
+def run_rounds(p, n):
+  for i in xrange(n):
+    p.check('u : pointer(s);' + padding)
+    p.check_fail('s : struct [x : int;]; undefined;')
+
+with test_start(['--stats']) as p:
+  p.check('t : pointer(ubyte);')
+  p.check('s : struct [x : int;];')
+  run_rounds(p, window)
+  early = p.resident_memory()
+  run_rounds(p, n_rounds - window)
+  late = p.resident_memory()
+  p.check('v : t;')
+  out, err = p.finish()
+  
+  print 'resident memory: after %d rounds %dkB, after %d rounds %dkB' % (window, early, n_rounds, late)
+  if late - early > early / 4:
+    raise Exception('Resident memory grew from %dkB to %dkB' % (early, late))
+  
+  cache_match = re.search(r'Caches: overload (\d+) hits, (\d+) misses; parse (\d+) hits, (\d+) misses', err)
+  gc_match = re.search(r'Garbage collection: (\d+) collections, (\d+) objects destroyed', err)
+  if not cache_match or not gc_match:
+    raise Exception('Statistics missing from output: %s' % err)
+  overload_hits, overload_misses, parse_hits, parse_misses = [int(x) for x in cache_match.groups()]
+  collections, destroyed = int(gc_match.group(1)), int(gc_match.group(2))
+  print 'overload cache %d hits, %d misses; parse cache %d misses; %d collections destroyed %d objects' % \
+    (overload_hits, overload_misses, parse_misses, collections, destroyed)
+  if overload_hits < n_rounds or parse_misses < n_rounds:
+    raise Exception('Inputs did not go through the overload and parse caches')
+  if collections < 2 or destroyed == 0:
+    raise Exception('Garbage collection did not run')
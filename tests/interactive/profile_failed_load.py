@@ -0,0 +1,28 @@
+from psi_interact import test_start
+import os
+import shutil
+import tempfile
+
+# A line whose module fails to load should not stop the counters of every
+# other line from being written to the profile when the interpreter exits.
+temp_dir = tempfile.mkdtemp()
+try:
+  profile_path = os.path.join(temp_dir, 'profile')
+  with test_start(['--set', 'tvm.cc.profile_generate="%s"' % profile_path]) as p:
+    p.check('libc : library{};')
+    p.check('getpid : libc.symbol (function (-: int)) {"type":"c","name":"getpid"};')
+    p.check('missing : libc.symbol (function (-: int)) {"type":"c","name":"psi_profile_test_missing_symbol"};')
+    p.check('f : function (-: int) [getpid()];')
+    p.check('x : f();')
+    p.check_fail('y : missing();')
+    p.check('z : f();')
+    out, err = p.finish()
+    if err.strip('\0'):
+      raise Exception('Interpreter reported an error on exit: %r' % err)
+
+  with open(profile_path) as f:
+    profile = f.read()
+  if 'function ' not in profile:
+    raise Exception('Profile contains no functions:\n%s' % profile)
+finally:
+  shutil.rmtree(temp_dir)
@@ -81,13 +81,37 @@ class PsiInterpreter(object):
     if not err:
       raise PsiInterpreterError('Psi interpreter did not emit the expected error, instead got: %s' % out)
     return err
+  
+  def finish(self):
+    '''
+    Close the interpreter's input and wait for it to exit.
+    
+    Returns a pair (output,error) of everything written after the last command.
+    '''
+    self._child.stdin.close()
+    out = self._child.stdout.read()
+    err = self._child.stderr.read()
+    self._child.wait()
+    return (out, err)
+  
+  def resident_memory(self):
+    '''
+    Get the resident set size of the interpreter process in kilobytes.
+    
+    Only works where /proc is available.
+    '''
+    with open('/proc/%d/status' % self._child.pid) as f:
+      for line in f:
+        if line.startswith('VmRSS:'):
+          return int(line.split()[1])
+    raise PsiInterpreterError('VmRSS not found in process status')
 
 
 
-def test_start():
+def test_start(args=[]):
   '''
   Parse command line arguments for an interactive session test
   and return the resulting interpreter.
   '''
   import sys
-  return PsiInterpreter(sys.argv[1])
+  return PsiInterpreter(sys.argv[1], args)
@@ -0,0 +1,25 @@
+from psi_interact import test_start
+import re
+
+# Defining a name should not get slower as the number of names already
+# defined grows. Each definition looks up one name, which should search
+# a bounded number of evaluation contexts however many scopes earlier
+# lines have created.
+n_names = 5000
+max_contexts_per_line = 10
+
+with test_start(['--stats']) as p:
+  p.check('t : pointer(ubyte);')
+  for i in xrange(n_names):
+    p.check('n%d : t;' % i)
+  p.check('u : n0;')
+  p.check('v : n%d;' % (n_names - 1))
+  out, err = p.finish()
+  
+  match = re.search(r'Name lookup: (\d+) evaluation contexts searched', err)
+  if not match:
+    raise Exception('Name lookup statistics missing from output: %s' % err)
+  searched = int(match.group(1))
+  print '%d evaluation contexts searched for %d definitions' % (searched, n_names)
+  if searched > max_contexts_per_line * (n_names + 3):
+    raise Exception('%d evaluation contexts searched for %d definitions: lookup cost grows with the number of scopes' % (searched, n_names))
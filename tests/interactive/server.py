@@ -0,0 +1,63 @@
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+# Files sent to a compile server should behave as if run directly, and a
+# request which fails to compile or crashes at run time should not affect
+# later requests.
+psi = sys.argv[1]
+
+def client(socket_path, filename):
+  child = subprocess.Popen([psi, '--client', socket_path, filename], stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+  out, err = child.communicate()
+  return child.returncode, out, err
+
+def expect(socket_path, name):
+  with open('../%s.expect' % name) as f:
+    expected = f.read()
+  status, out, err = client(socket_path, '../%s.psi' % name)
+  if status != 0 or out != expected:
+    raise Exception('Wrong output from server for %s (status %d):\n%s%s' % (name, status, out, err))
+
+temp_dir = tempfile.mkdtemp()
+try:
+  socket_path = os.path.join(temp_dir, 'psi.sock')
+  server = subprocess.Popen([psi, '--server', socket_path])
+  try:
+    for i in xrange(100):
+      if os.path.exists(socket_path):
+        break
+      time.sleep(0.1)
+    
+    expect(socket_path, 'import')
+    
+    bad_path = os.path.join(temp_dir, 'bad.psi')
+    with open(bad_path, 'w') as f:
+      f.write('main : undefined;\n')
+    status, out, err = client(socket_path, bad_path)
+    if status == 0 or 'undefined' not in out:
+      raise Exception('Server did not report compile error, instead got: %s' % out)
+    
+    expect(socket_path, 'construct_destruct')
+    expect(socket_path, 'import')
+    
+    crash_path = os.path.join(temp_dir, 'crash.psi')
+    with open(crash_path, 'w') as f:
+      f.write('libc : library {};\n')
+      f.write('abort : libc.symbol (function ()) {"type":"c","name":"abort"};\n')
+      f.write('main : function () [abort();];\n')
+    status, out, err = client(socket_path, crash_path)
+    if status == 0 or 'terminated abnormally' not in out:
+      raise Exception('Server did not report run time failure, instead got: %s' % out)
+    
+    expect(socket_path, 'import')
+    if server.poll() is not None:
+      raise Exception('Server exited with status %d' % server.returncode)
+  finally:
+    server.terminate()
+    server.wait()
+finally:
+  shutil.rmtree(temp_dir)